@@ -202,7 +202,7 @@ private:
 				[&, this](auto uIndex){
 					const auto pStorage = this->x_pStorage;
 					const auto uSourceIndex = X_Retreat(uIndex, uDeltaSize);
-					Construct(pStorage + uIndex, std::move(pStorage + uSourceIndex)));
+					Construct(pStorage + uIndex, std::move(*(pStorage + uSourceIndex)));
 					Destruct(pStorage + uSourceIndex);
 				});
 		}
@@ -16,6 +16,9 @@ inline std::uint32_t ReadTimeStampCounter32() noexcept {
 inline std::uint64_t ReadTimeStampCounter64() noexcept {
 	return ::_MCFCRT_ReadTimeStampCounter64();
 }
+inline std::uint64_t ReadTimeStampCounter64Ordered(std::uint32_t *pu32Aux = nullptr) noexcept {
+	return ::_MCFCRT_ReadTimeStampCounter64Ordered(pu32Aux);
+}
 
 inline std::uint64_t GetUtcClock() noexcept {
 	return ::_MCFCRT_GetUtcClock();
@@ -38,6 +41,20 @@ inline double GetHiResMonoClock() noexcept {
 	return ::_MCFCRT_GetHiResMonoClock();
 }
 
+// 单位是纳秒。
+inline std::uint64_t GetTscMonoClock() noexcept {
+	return ::_MCFCRT_GetTscMonoClock();
+}
+inline std::uint64_t GetTscMonoClockOrdered() noexcept {
+	return ::_MCFCRT_GetTscMonoClockOrdered();
+}
+inline bool IsTscMonoClockInvariant() noexcept {
+	return ::_MCFCRT_IsTscMonoClockInvariant();
+}
+inline std::uint64_t GetTscFrequency() noexcept {
+	return ::_MCFCRT_GetTscFrequency();
+}
+
 }
 
 #endif
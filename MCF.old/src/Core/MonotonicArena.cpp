@@ -0,0 +1,143 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#include "MonotonicArena.hpp"
+#include "_CheckedSizeArithmetic.hpp"
+#include "Assert.hpp"
+#include "Atomic.hpp"
+#include "Exception.hpp"
+#include <MCFCRT/env/once_flag.h>
+#include <MCFCRT/env/last_error.h>
+#include <MCFCRT/pre/tls.h>
+
+namespace MCF {
+
+namespace {
+	// 当前 MonotonicArena 的指针保存在 CRT 的线程局部存储中。键在第一次创建 Scope 时分配。
+	::_MCFCRT_OnceFlag g_vCurrentKeyOnce = { 0 };
+	Atomic<::_MCFCRT_TlsKeyHandle> g_hCurrentKey(nullptr);
+
+	::_MCFCRT_TlsKeyHandle RequireCurrentKey(){
+		const auto eResult = ::_MCFCRT_WaitForOnceFlagForever(&g_vCurrentKeyOnce);
+		if(eResult == ::_MCFCRT_kOnceResultInitial){
+			const auto hKey = ::_MCFCRT_TlsAllocKey(sizeof(MonotonicArena *), nullptr, nullptr, 0);
+			if(!hKey){
+				const auto dwErrorCode = ::_MCFCRT_GetLastError();
+				::_MCFCRT_SignalOnceFlagAsAborted(&g_vCurrentKeyOnce);
+				MCF_THROW(Exception, dwErrorCode, Rcntws::View(L"MonotonicArena: _MCFCRT_TlsAllocKey() 失败。"));
+			}
+			g_hCurrentKey.Store(hKey, kAtomicRelease);
+			::_MCFCRT_SignalOnceFlagAsFinished(&g_vCurrentKeyOnce);
+		}
+		return g_hCurrentKey.Load(kAtomicAcquire);
+	}
+	MonotonicArena **GetCurrentSlot() noexcept {
+		// 如果键还没有分配，那么没有任何线程创建过 Scope。
+		const auto hKey = g_hCurrentKey.Load(kAtomicAcquire);
+		if(!hKey){
+			return nullptr;
+		}
+		void *pStorage;
+		if(!::_MCFCRT_TlsGet(hKey, &pStorage)){
+			return nullptr;
+		}
+		return static_cast<MonotonicArena **>(pStorage);
+	}
+
+	constexpr std::size_t kMaxChunkSize = 0x100000;
+}
+
+struct MonotonicArena::X_ChunkHeader {
+	static X_ChunkHeader *Create(std::size_t uCapacity, X_ChunkHeader *pPrev){
+		const auto pChunk = static_cast<X_ChunkHeader *>(::operator new(Impl_CheckedSizeArithmetic::Add(sizeof(X_ChunkHeader), uCapacity)));
+		pChunk->uCapacity = uCapacity;
+		pChunk->pPrev     = pPrev;
+		return pChunk;
+	}
+	static void Destroy(X_ChunkHeader *pChunk) noexcept {
+		::operator delete(pChunk);
+	}
+
+	std::size_t uCapacity;
+	X_ChunkHeader *pPrev;
+	__extension__ alignas(std::max_align_t) unsigned char abyData[];
+};
+
+MonotonicArena::Scope::Scope(MonotonicArena &vArena){
+	void *pStorage;
+	if(!::_MCFCRT_TlsRequire(RequireCurrentKey(), &pStorage)){
+		MCF_THROW(Exception, ::_MCFCRT_GetLastError(), Rcntws::View(L"MonotonicArena: _MCFCRT_TlsRequire() 失败。"));
+	}
+	const auto ppCurrent = static_cast<MonotonicArena **>(pStorage);
+	x_pPrev = *ppCurrent;
+	*ppCurrent = &vArena;
+}
+MonotonicArena::Scope::~Scope(){
+	const auto ppCurrent = GetCurrentSlot();
+	MCF_ASSERT_MSG(ppCurrent, L"当前线程的 MonotonicArena 指针已被销毁。");
+	*ppCurrent = x_pPrev;
+}
+
+MonotonicArena *MonotonicArena::GetCurrent() noexcept {
+	const auto ppCurrent = GetCurrentSlot();
+	if(!ppCurrent){
+		return nullptr;
+	}
+	return *ppCurrent;
+}
+
+MonotonicArena::~MonotonicArena(){
+	for(const auto pFirst : { x_pLast, x_pLarge }){
+		auto pChunk = pFirst;
+		while(pChunk){
+			const auto pPrev = pChunk->pPrev;
+			X_ChunkHeader::Destroy(pChunk);
+			pChunk = pPrev;
+		}
+	}
+}
+
+void *MonotonicArena::X_AllocateSlow(std::size_t uSize){
+	const auto uSizeAligned = Impl_CheckedSizeArithmetic::Add(uSize, alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+	if(uSizeAligned > x_uNextChunkSize / 2){
+		// 大块单独分配并且保存在另一个链表中，以免浪费当前大块的剩余空间。Release() 会释放它们。
+		const auto pChunk = X_ChunkHeader::Create(uSizeAligned, x_pLarge);
+		x_pLarge = pChunk;
+		return pChunk->abyData;
+	}
+	const auto pChunk = X_ChunkHeader::Create(x_uNextChunkSize, x_pLast);
+	x_pLast = pChunk;
+	x_pbyNext = pChunk->abyData + uSizeAligned;
+	x_pbyEnd  = pChunk->abyData + pChunk->uCapacity;
+	if(x_uNextChunkSize < kMaxChunkSize){
+		x_uNextChunkSize *= 2;
+	}
+	return pChunk->abyData;
+}
+
+void MonotonicArena::Release() noexcept {
+	auto pChunk = x_pLarge;
+	while(pChunk){
+		const auto pPrev = pChunk->pPrev;
+		X_ChunkHeader::Destroy(pChunk);
+		pChunk = pPrev;
+	}
+	x_pLarge = nullptr;
+
+	const auto pLast = x_pLast;
+	if(!pLast){
+		return;
+	}
+	pChunk = pLast->pPrev;
+	while(pChunk){
+		const auto pPrev = pChunk->pPrev;
+		X_ChunkHeader::Destroy(pChunk);
+		pChunk = pPrev;
+	}
+	pLast->pPrev = nullptr;
+	x_pbyNext = pLast->abyData;
+	x_pbyEnd  = pLast->abyData + pLast->uCapacity;
+}
+
+}
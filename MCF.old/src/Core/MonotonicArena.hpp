@@ -0,0 +1,106 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#ifndef MCF_CORE_MONOTONIC_ARENA_HPP_
+#define MCF_CORE_MONOTONIC_ARENA_HPP_
+
+#include <new>
+#include <cstddef>
+
+namespace MCF {
+
+// 单调分配器。内存从大块中顺序切出，单独释放是空操作，所有内存在 Release() 或析构时一并释放。
+// 适用于生命周期相同的大量临时对象，例如单个请求中用到的容器。
+class MonotonicArena {
+private:
+	struct X_ChunkHeader;
+
+public:
+	// 在当前线程上将一个 MonotonicArena 设为当前的，供 MonotonicArenaAllocator 使用。可以嵌套。
+	class Scope {
+	private:
+		MonotonicArena *x_pPrev;
+
+	public:
+		explicit Scope(MonotonicArena &vArena);
+		~Scope();
+
+		Scope(const Scope &) = delete;
+		Scope &operator=(const Scope &) = delete;
+	};
+
+	static MonotonicArena *GetCurrent() noexcept;
+
+private:
+	X_ChunkHeader *x_pLast = nullptr;
+	X_ChunkHeader *x_pLarge = nullptr;
+	unsigned char *x_pbyNext = nullptr;
+	unsigned char *x_pbyEnd = nullptr;
+	std::size_t x_uNextChunkSize;
+
+public:
+	explicit constexpr MonotonicArena(std::size_t uInitialChunkSize = 4096) noexcept
+		: x_uNextChunkSize(uInitialChunkSize)
+	{ }
+	~MonotonicArena();
+
+	MonotonicArena(const MonotonicArena &) = delete;
+	MonotonicArena &operator=(const MonotonicArena &) = delete;
+
+private:
+	void *X_AllocateSlow(std::size_t uSize);
+
+public:
+	__attribute__((__malloc__))
+	void *Allocate(std::size_t uSize){
+		// 所有块都按 max_align_t 对齐。大小为零的请求按一个字节处理，以便返回唯一的非空指针。
+		constexpr auto kAlignment = alignof(std::max_align_t);
+		const auto uSizeNonZero = (uSize != 0) ? uSize : 1;
+		const auto uSizeAligned = (uSizeNonZero + kAlignment - 1) & ~(kAlignment - 1);
+		if((uSizeAligned < uSizeNonZero) || (static_cast<std::size_t>(x_pbyEnd - x_pbyNext) < uSizeAligned)){
+			return X_AllocateSlow(uSizeNonZero);
+		}
+		const auto pbyBlock = x_pbyNext;
+		x_pbyNext += uSizeAligned;
+		return pbyBlock;
+	}
+	__attribute__((__malloc__))
+	void *Allocate(const std::nothrow_t &, std::size_t uSize) noexcept {
+		try {
+			return Allocate(uSize);
+		} catch(std::bad_alloc &){
+			return nullptr;
+		}
+	}
+	// 保留最后一个普通大小的大块以供重复使用，释放其余所有内存（包括单独分配的大块）。之前分配的所有块都将失效。
+	void Release() noexcept;
+};
+
+// 满足容器 AllocatorT 要求的适配器，从当前线程的当前 MonotonicArena 中分配内存。
+// 使用此分配器的容器必须在对应的 MonotonicArena::Scope 之内创建，并在 MonotonicArena 被释放之前销毁。
+struct MonotonicArenaAllocator {
+	__attribute__((__malloc__))
+	void *operator()(std::size_t uSize){
+		const auto pArena = MonotonicArena::GetCurrent();
+		if(!pArena){
+			throw std::bad_alloc();
+		}
+		return pArena->Allocate(uSize);
+	}
+	__attribute__((__malloc__))
+	void *operator()(const std::nothrow_t &, std::size_t uSize) noexcept {
+		const auto pArena = MonotonicArena::GetCurrent();
+		if(!pArena){
+			return nullptr;
+		}
+		return pArena->Allocate(std::nothrow, uSize);
+	}
+	void operator()(void *pBlock) noexcept {
+		static_cast<void>(pBlock);
+	}
+};
+
+}
+
+#endif
@@ -5,6 +5,7 @@
 #include "String.hpp"
 #include "Exception.hpp"
 #include <MCFCRT/ext/utf.h>
+#include <MCFCRT/ext/utf_bulk.h>
 #include <ntdef.h>
 #include <ntstatus.h>
 
@@ -40,13 +41,10 @@ void Utf8String::UnifyAppend(Utf16String &u16sDst, const Utf8StringView &u8svSrc
 		auto pc16Write = pc16WriteBegin;
 		auto pchRead = u8svSrc.GetBegin();
 		const auto pchReadEnd = u8svSrc.GetEnd();
-		while(pchRead < pchReadEnd){
-			auto c32CodePoint = ::_MCFCRT_DecodeUtf8(&pchRead, pchReadEnd, false);
-			if(!_MCFCRT_UTF_SUCCESS(c32CodePoint)){
-				MCF_THROW(Exception, ERROR_INVALID_DATA, Rcntws::View(L"Utf8String: _MCFCRT_DecodeUtf8() 失败。"));
-			}
-			c32CodePoint = ::_MCFCRT_UncheckedEncodeUtf16(&pc16Write, c32CodePoint, true);
-			MCF_ASSERT(_MCFCRT_UTF_SUCCESS(c32CodePoint));
+		const auto c32Result = ::_MCFCRT_ConvertUtf8ToUtf16(&pc16Write, u16sDst.GetEnd(), &pchRead, pchReadEnd, false);
+		MCF_ASSERT(c32Result != _MCFCRT_UTF_BUFFER_TOO_SMALL);
+		if(c32Result != _MCFCRT_UTF_NO_DATA){
+			MCF_THROW(Exception, ERROR_INVALID_DATA, Rcntws::View(L"Utf8String: _MCFCRT_ConvertUtf8ToUtf16() 失败。"));
 		}
 		u16sDst.Pop(static_cast<std::size_t>(u16sDst.GetEnd() - pc16Write));
 	} catch(...){
@@ -62,13 +60,10 @@ void Utf8String::DeunifyAppend(Utf8String &u8sDst, const Utf16StringView &u16svS
 		auto pchWrite = pchWriteBegin;
 		auto pc16Read = u16svSrc.GetBegin();
 		const auto pc16ReadEnd = u16svSrc.GetEnd();
-		while(pc16Read < pc16ReadEnd){
-			auto c32CodePoint = ::_MCFCRT_DecodeUtf16(&pc16Read, pc16ReadEnd, false);
-			if(!_MCFCRT_UTF_SUCCESS(c32CodePoint)){
-				MCF_THROW(Exception, ERROR_INVALID_DATA, Rcntws::View(L"Utf8String: _MCFCRT_DecodeUtf16() 失败。"));
-			}
-			c32CodePoint = ::_MCFCRT_UncheckedEncodeUtf8(&pchWrite, c32CodePoint, true);
-			MCF_ASSERT(_MCFCRT_UTF_SUCCESS(c32CodePoint));
+		const auto c32Result = ::_MCFCRT_ConvertUtf16ToUtf8(&pchWrite, u8sDst.GetEnd(), &pc16Read, pc16ReadEnd, false);
+		MCF_ASSERT(c32Result != _MCFCRT_UTF_BUFFER_TOO_SMALL);
+		if(c32Result != _MCFCRT_UTF_NO_DATA){
+			MCF_THROW(Exception, ERROR_INVALID_DATA, Rcntws::View(L"Utf8String: _MCFCRT_ConvertUtf16ToUtf8() 失败。"));
 		}
 		u8sDst.Pop(static_cast<std::size_t>(u8sDst.GetEnd() - pchWrite));
 	} catch(...){
@@ -85,13 +80,10 @@ void Utf8String::UnifyAppend(Utf32String &u32sDst, const Utf8StringView &u8svSrc
 		auto pc32Write = pc32WriteBegin;
 		auto pchRead = u8svSrc.GetBegin();
 		const auto pchReadEnd = u8svSrc.GetEnd();
-		while(pchRead < pchReadEnd){
-			auto c32CodePoint = ::_MCFCRT_DecodeUtf8(&pchRead, pchReadEnd, false);
-			if(!_MCFCRT_UTF_SUCCESS(c32CodePoint)){
-				MCF_THROW(Exception, ERROR_INVALID_DATA, Rcntws::View(L"Utf8String: _MCFCRT_DecodeUtf8() 失败。"));
-			}
-			c32CodePoint = ::_MCFCRT_UncheckedEncodeUtf32(&pc32Write, c32CodePoint, true);
-			MCF_ASSERT(_MCFCRT_UTF_SUCCESS(c32CodePoint));
+		const auto c32Result = ::_MCFCRT_ConvertUtf8ToUtf32(&pc32Write, u32sDst.GetEnd(), &pchRead, pchReadEnd, false);
+		MCF_ASSERT(c32Result != _MCFCRT_UTF_BUFFER_TOO_SMALL);
+		if(c32Result != _MCFCRT_UTF_NO_DATA){
+			MCF_THROW(Exception, ERROR_INVALID_DATA, Rcntws::View(L"Utf8String: _MCFCRT_ConvertUtf8ToUtf32() 失败。"));
 		}
 		u32sDst.Pop(static_cast<std::size_t>(u32sDst.GetEnd() - pc32Write));
 	} catch(...){
@@ -107,13 +99,10 @@ void Utf8String::DeunifyAppend(Utf8String &u8sDst, const Utf32StringView &u32svS
 		auto pchWrite = pchWriteBegin;
 		auto pc32Read = u32svSrc.GetBegin();
 		const auto pc32ReadEnd = u32svSrc.GetEnd();
-		while(pc32Read < pc32ReadEnd){
-			auto c32CodePoint = ::_MCFCRT_DecodeUtf32(&pc32Read, pc32ReadEnd, false);
-			if(!_MCFCRT_UTF_SUCCESS(c32CodePoint)){
-				MCF_THROW(Exception, ERROR_INVALID_DATA, Rcntws::View(L"Utf8String: _MCFCRT_DecodeUtf32() 失败。"));
-			}
-			c32CodePoint = ::_MCFCRT_UncheckedEncodeUtf8(&pchWrite, c32CodePoint, true);
-			MCF_ASSERT(_MCFCRT_UTF_SUCCESS(c32CodePoint));
+		const auto c32Result = ::_MCFCRT_ConvertUtf32ToUtf8(&pchWrite, u8sDst.GetEnd(), &pc32Read, pc32ReadEnd, false);
+		MCF_ASSERT(c32Result != _MCFCRT_UTF_BUFFER_TOO_SMALL);
+		if(c32Result != _MCFCRT_UTF_NO_DATA){
+			MCF_THROW(Exception, ERROR_INVALID_DATA, Rcntws::View(L"Utf8String: _MCFCRT_ConvertUtf32ToUtf8() 失败。"));
 		}
 		u8sDst.Pop(static_cast<std::size_t>(u8sDst.GetEnd() - pchWrite));
 	} catch(...){
@@ -176,13 +165,10 @@ void Utf16String::UnifyAppend(Utf32String &u32sDst, const Utf16StringView &u16sv
 		auto pc32Write = pc32WriteBegin;
 		auto pc16Read = u16svSrc.GetBegin();
 		const auto pc16ReadEnd = u16svSrc.GetEnd();
-		while(pc16Read < pc16ReadEnd){
-			auto c32CodePoint = ::_MCFCRT_DecodeUtf16(&pc16Read, pc16ReadEnd, false);
-			if(!_MCFCRT_UTF_SUCCESS(c32CodePoint)){
-				MCF_THROW(Exception, ERROR_INVALID_DATA, Rcntws::View(L"Utf16String: _MCFCRT_DecodeUtf16() 失败。"));
-			}
-			c32CodePoint = ::_MCFCRT_UncheckedEncodeUtf32(&pc32Write, c32CodePoint, true);
-			MCF_ASSERT(_MCFCRT_UTF_SUCCESS(c32CodePoint));
+		const auto c32Result = ::_MCFCRT_ConvertUtf16ToUtf32(&pc32Write, u32sDst.GetEnd(), &pc16Read, pc16ReadEnd, false);
+		MCF_ASSERT(c32Result != _MCFCRT_UTF_BUFFER_TOO_SMALL);
+		if(c32Result != _MCFCRT_UTF_NO_DATA){
+			MCF_THROW(Exception, ERROR_INVALID_DATA, Rcntws::View(L"Utf16String: _MCFCRT_ConvertUtf16ToUtf32() 失败。"));
 		}
 		u32sDst.Pop(static_cast<std::size_t>(u32sDst.GetEnd() - pc32Write));
 	} catch(...){
@@ -198,13 +184,10 @@ void Utf16String::DeunifyAppend(Utf16String &u16sDst, const Utf32StringView &u32
 		auto pc16Write = pc16WriteBegin;
 		auto pc32Read = u32svSrc.GetBegin();
 		const auto pc32ReadEnd = u32svSrc.GetEnd();
-		while(pc32Read < pc32ReadEnd){
-			auto c32CodePoint = ::_MCFCRT_DecodeUtf32(&pc32Read, pc32ReadEnd, false);
-			if(!_MCFCRT_UTF_SUCCESS(c32CodePoint)){
-				MCF_THROW(Exception, ERROR_INVALID_DATA, Rcntws::View(L"Utf16String: _MCFCRT_DecodeUtf32() 失败。"));
-			}
-			c32CodePoint = ::_MCFCRT_UncheckedEncodeUtf16(&pc16Write, c32CodePoint, true);
-			MCF_ASSERT(_MCFCRT_UTF_SUCCESS(c32CodePoint));
+		const auto c32Result = ::_MCFCRT_ConvertUtf32ToUtf16(&pc16Write, u16sDst.GetEnd(), &pc32Read, pc32ReadEnd, false);
+		MCF_ASSERT(c32Result != _MCFCRT_UTF_BUFFER_TOO_SMALL);
+		if(c32Result != _MCFCRT_UTF_NO_DATA){
+			MCF_THROW(Exception, ERROR_INVALID_DATA, Rcntws::View(L"Utf16String: _MCFCRT_ConvertUtf32ToUtf16() 失败。"));
 		}
 		u16sDst.Pop(static_cast<std::size_t>(u16sDst.GetEnd() - pc16Write));
 	} catch(...){
@@ -222,13 +205,10 @@ void Utf32String::UnifyAppend(Utf16String &u16sDst, const Utf32StringView &u32sv
 		auto pc16Write = pc16WriteBegin;
 		auto pc32Read = u32svSrc.GetBegin();
 		const auto pc32ReadEnd = u32svSrc.GetEnd();
-		while(pc32Read < pc32ReadEnd){
-			auto c32CodePoint = ::_MCFCRT_DecodeUtf32(&pc32Read, pc32ReadEnd, false);
-			if(!_MCFCRT_UTF_SUCCESS(c32CodePoint)){
-				MCF_THROW(Exception, ERROR_INVALID_DATA, Rcntws::View(L"Utf32String: _MCFCRT_DecodeUtf32() 失败。"));
-			}
-			c32CodePoint = ::_MCFCRT_UncheckedEncodeUtf16(&pc16Write, c32CodePoint, true);
-			MCF_ASSERT(_MCFCRT_UTF_SUCCESS(c32CodePoint));
+		const auto c32Result = ::_MCFCRT_ConvertUtf32ToUtf16(&pc16Write, u16sDst.GetEnd(), &pc32Read, pc32ReadEnd, false);
+		MCF_ASSERT(c32Result != _MCFCRT_UTF_BUFFER_TOO_SMALL);
+		if(c32Result != _MCFCRT_UTF_NO_DATA){
+			MCF_THROW(Exception, ERROR_INVALID_DATA, Rcntws::View(L"Utf32String: _MCFCRT_ConvertUtf32ToUtf16() 失败。"));
 		}
 		u16sDst.Pop(static_cast<std::size_t>(u16sDst.GetEnd() - pc16Write));
 	} catch(...){
@@ -244,13 +224,10 @@ void Utf32String::DeunifyAppend(Utf32String &u32sDst, const Utf16StringView &u16
 		auto pc32Write = pc32WriteBegin;
 		auto pc16Read = u16svSrc.GetBegin();
 		const auto pc16ReadEnd = u16svSrc.GetEnd();
-		while(pc16Read < pc16ReadEnd){
-			auto c32CodePoint = ::_MCFCRT_DecodeUtf16(&pc16Read, pc16ReadEnd, false);
-			if(!_MCFCRT_UTF_SUCCESS(c32CodePoint)){
-				MCF_THROW(Exception, ERROR_INVALID_DATA, Rcntws::View(L"Utf32String: _MCFCRT_DecodeUtf16() 失败。"));
-			}
-			c32CodePoint = ::_MCFCRT_UncheckedEncodeUtf32(&pc32Write, c32CodePoint, true);
-			MCF_ASSERT(_MCFCRT_UTF_SUCCESS(c32CodePoint));
+		const auto c32Result = ::_MCFCRT_ConvertUtf16ToUtf32(&pc32Write, u32sDst.GetEnd(), &pc16Read, pc16ReadEnd, false);
+		MCF_ASSERT(c32Result != _MCFCRT_UTF_BUFFER_TOO_SMALL);
+		if(c32Result != _MCFCRT_UTF_NO_DATA){
+			MCF_THROW(Exception, ERROR_INVALID_DATA, Rcntws::View(L"Utf32String: _MCFCRT_ConvertUtf16ToUtf32() 失败。"));
 		}
 		u32sDst.Pop(static_cast<std::size_t>(u32sDst.GetEnd() - pc32Write));
 	} catch(...){
@@ -313,13 +290,10 @@ void Cesu8String::UnifyAppend(Utf16String &u16sDst, const Cesu8StringView &u8svS
 		auto pc16Write = pc16WriteBegin;
 		auto pchRead = u8svSrc.GetBegin();
 		const auto pchReadEnd = u8svSrc.GetEnd();
-		while(pchRead < pchReadEnd){
-			auto c32CodePoint = ::_MCFCRT_DecodeCesu8(&pchRead, pchReadEnd, false);
-			if(!_MCFCRT_UTF_SUCCESS(c32CodePoint)){
-				MCF_THROW(Exception, ERROR_INVALID_DATA, Rcntws::View(L"Cesu8String: _MCFCRT_DecodeCesu8() 失败。"));
-			}
-			c32CodePoint = ::_MCFCRT_UncheckedEncodeUtf16(&pc16Write, c32CodePoint, true);
-			MCF_ASSERT(_MCFCRT_UTF_SUCCESS(c32CodePoint));
+		const auto c32Result = ::_MCFCRT_ConvertCesu8ToUtf16(&pc16Write, u16sDst.GetEnd(), &pchRead, pchReadEnd, false);
+		MCF_ASSERT(c32Result != _MCFCRT_UTF_BUFFER_TOO_SMALL);
+		if(c32Result != _MCFCRT_UTF_NO_DATA){
+			MCF_THROW(Exception, ERROR_INVALID_DATA, Rcntws::View(L"Cesu8String: _MCFCRT_ConvertCesu8ToUtf16() 失败。"));
 		}
 		u16sDst.Pop(static_cast<std::size_t>(u16sDst.GetEnd() - pc16Write));
 	} catch(...){
@@ -335,13 +309,10 @@ void Cesu8String::DeunifyAppend(Cesu8String &u8sDst, const Utf16StringView &u16s
 		auto pchWrite = pchWriteBegin;
 		auto pc16Read = u16svSrc.GetBegin();
 		const auto pc16ReadEnd = u16svSrc.GetEnd();
-		while(pc16Read < pc16ReadEnd){
-			auto c32CodePoint = ::_MCFCRT_DecodeUtf16(&pc16Read, pc16ReadEnd, false);
-			if(!_MCFCRT_UTF_SUCCESS(c32CodePoint)){
-				MCF_THROW(Exception, ERROR_INVALID_DATA, Rcntws::View(L"Cesu8String: _MCFCRT_DecodeUtf16() 失败。"));
-			}
-			c32CodePoint = ::_MCFCRT_UncheckedEncodeCesu8(&pchWrite, c32CodePoint, true);
-			MCF_ASSERT(_MCFCRT_UTF_SUCCESS(c32CodePoint));
+		const auto c32Result = ::_MCFCRT_ConvertUtf16ToCesu8(&pchWrite, u8sDst.GetEnd(), &pc16Read, pc16ReadEnd, false);
+		MCF_ASSERT(c32Result != _MCFCRT_UTF_BUFFER_TOO_SMALL);
+		if(c32Result != _MCFCRT_UTF_NO_DATA){
+			MCF_THROW(Exception, ERROR_INVALID_DATA, Rcntws::View(L"Cesu8String: _MCFCRT_ConvertUtf16ToCesu8() 失败。"));
 		}
 		u8sDst.Pop(static_cast<std::size_t>(u8sDst.GetEnd() - pchWrite));
 	} catch(...){
@@ -358,13 +329,10 @@ void Cesu8String::UnifyAppend(Utf32String &u32sDst, const Cesu8StringView &u8svS
 		auto pc32Write = pc32WriteBegin;
 		auto pchRead = u8svSrc.GetBegin();
 		const auto pchReadEnd = u8svSrc.GetEnd();
-		while(pchRead < pchReadEnd){
-			auto c32CodePoint = ::_MCFCRT_DecodeCesu8(&pchRead, pchReadEnd, false);
-			if(!_MCFCRT_UTF_SUCCESS(c32CodePoint)){
-				MCF_THROW(Exception, ERROR_INVALID_DATA, Rcntws::View(L"Cesu8String: _MCFCRT_DecodeCesu8() 失败。"));
-			}
-			c32CodePoint = ::_MCFCRT_UncheckedEncodeUtf32(&pc32Write, c32CodePoint, true);
-			MCF_ASSERT(_MCFCRT_UTF_SUCCESS(c32CodePoint));
+		const auto c32Result = ::_MCFCRT_ConvertCesu8ToUtf32(&pc32Write, u32sDst.GetEnd(), &pchRead, pchReadEnd, false);
+		MCF_ASSERT(c32Result != _MCFCRT_UTF_BUFFER_TOO_SMALL);
+		if(c32Result != _MCFCRT_UTF_NO_DATA){
+			MCF_THROW(Exception, ERROR_INVALID_DATA, Rcntws::View(L"Cesu8String: _MCFCRT_ConvertCesu8ToUtf32() 失败。"));
 		}
 		u32sDst.Pop(static_cast<std::size_t>(u32sDst.GetEnd() - pc32Write));
 	} catch(...){
@@ -380,13 +348,10 @@ void Cesu8String::DeunifyAppend(Cesu8String &u8sDst, const Utf32StringView &u32s
 		auto pchWrite = pchWriteBegin;
 		auto pc32Read = u32svSrc.GetBegin();
 		const auto pc32ReadEnd = u32svSrc.GetEnd();
-		while(pc32Read < pc32ReadEnd){
-			auto c32CodePoint = ::_MCFCRT_DecodeUtf32(&pc32Read, pc32ReadEnd, false);
-			if(!_MCFCRT_UTF_SUCCESS(c32CodePoint)){
-				MCF_THROW(Exception, ERROR_INVALID_DATA, Rcntws::View(L"Cesu8String: _MCFCRT_DecodeUtf32() 失败。"));
-			}
-			c32CodePoint = ::_MCFCRT_UncheckedEncodeCesu8(&pchWrite, c32CodePoint, true);
-			MCF_ASSERT(_MCFCRT_UTF_SUCCESS(c32CodePoint));
+		const auto c32Result = ::_MCFCRT_ConvertUtf32ToCesu8(&pchWrite, u8sDst.GetEnd(), &pc32Read, pc32ReadEnd, false);
+		MCF_ASSERT(c32Result != _MCFCRT_UTF_BUFFER_TOO_SMALL);
+		if(c32Result != _MCFCRT_UTF_NO_DATA){
+			MCF_THROW(Exception, ERROR_INVALID_DATA, Rcntws::View(L"Cesu8String: _MCFCRT_ConvertUtf32ToCesu8() 失败。"));
 		}
 		u8sDst.Pop(static_cast<std::size_t>(u8sDst.GetEnd() - pchWrite));
 	} catch(...){
@@ -0,0 +1,251 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#include "Trace.hpp"
+#include "Clocks.hpp"
+#include "Defer.hpp"
+#include "../Containers/Vector.hpp"
+#include "../Streams/AbstractOutputStream.hpp"
+#include <MCFCRT/env/mutex.h>
+#include <MCFCRT/env/once_flag.h>
+#include <MCFCRT/env/thread.h>
+#include <MCFCRT/pre/tls.h>
+#include <MCFCRT/env/mcfwin.h>
+#include <new>
+
+namespace MCF {
+
+namespace Impl_Trace {
+	Atomic<bool> g_bEnabled(false);
+
+	struct Event {
+		std::uint64_t u64TimestampNs;
+		const char *pszName;
+		const char *pszCategory;
+		char chPhase;
+	};
+
+	constexpr std::size_t kRingSize = 4096;
+
+	// 只有所有者写入 aEvents 和 u64Head。写出者在复制事件之后重新读取 u64Head，以丢弃在复制过程中被覆盖的事件。
+	struct Ring {
+		Ring *pNext;
+		std::uintptr_t uThreadId;
+		Atomic<std::uint64_t> u64Head;
+		std::uint64_t u64Tail;
+		Atomic<bool> bExited;
+		Event aEvents[kRingSize];
+	};
+
+	struct FlushedEvent {
+		Event vEvent;
+		std::uintptr_t uThreadId;
+	};
+}
+
+namespace {
+	// 因为写出时需要分配内存，而分配内存可能会记录事件，所以注册缓冲区和写出使用不同的锁。注册缓冲区时不会调用任何其他函数。
+	::_MCFCRT_Mutex g_vRegistryMutex = { 0 };
+	Impl_Trace::Ring *g_pFirstRing = nullptr;
+	::_MCFCRT_Mutex g_vFlushMutex = { 0 };
+
+	// 每个线程的缓冲区指针保存在 CRT 的线程局部存储中，线程退出时由 CRT 调用析构函数将缓冲区标记为已退出。
+	::_MCFCRT_OnceFlag g_vRingKeyOnce = { 0 };
+	::_MCFCRT_TlsKeyHandle g_hRingKey = nullptr;
+
+	void RingSlotDestructor(std::intptr_t /* nContext */, void *pStorage) noexcept {
+		const auto ppRing = static_cast<Impl_Trace::Ring **>(pStorage);
+		const auto pRing = *ppRing;
+		if(!pRing){
+			return;
+		}
+		// 缓冲区被标记为已退出之后随时可能被 FlushTrace() 释放。
+		// 之后运行的其他 TLS 析构函数仍然可能记录事件，因此这里必须清空槽位，不能留下悬空指针。
+		*ppRing = nullptr;
+		pRing->bExited.Store(true, kAtomicRelease);
+	}
+
+	::_MCFCRT_TlsKeyHandle GetRingKey() noexcept {
+		const auto eResult = ::_MCFCRT_WaitForOnceFlagForever(&g_vRingKeyOnce);
+		if(eResult == ::_MCFCRT_kOnceResultInitial){
+			// 如果分配失败，g_hRingKey 保持为空指针，不记录任何事件。
+			g_hRingKey = ::_MCFCRT_TlsAllocKey(sizeof(Impl_Trace::Ring *), nullptr, &RingSlotDestructor, 0);
+			::_MCFCRT_SignalOnceFlagAsFinished(&g_vRingKeyOnce);
+		}
+		return g_hRingKey;
+	}
+
+	Impl_Trace::Ring *GetCurrentRing() noexcept {
+		const auto hRingKey = GetRingKey();
+		if(!hRingKey){
+			return nullptr;
+		}
+		void *pStorage;
+		if(!::_MCFCRT_TlsRequire(hRingKey, &pStorage)){
+			return nullptr;
+		}
+		const auto ppRing = static_cast<Impl_Trace::Ring **>(pStorage);
+		auto pRing = *ppRing;
+		if(pRing){
+			return pRing;
+		}
+		pRing = new(std::nothrow) Impl_Trace::Ring;
+		if(!pRing){
+			return nullptr;
+		}
+		pRing->uThreadId = ::_MCFCRT_GetCurrentThreadId();
+		pRing->u64Head.Store(0, kAtomicRelaxed);
+		pRing->u64Tail = 0;
+		pRing->bExited.Store(false, kAtomicRelaxed);
+		::_MCFCRT_WaitForMutexForever(&g_vRegistryMutex, _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+		pRing->pNext = g_pFirstRing;
+		g_pFirstRing = pRing;
+		::_MCFCRT_SignalMutex(&g_vRegistryMutex);
+		*ppRing = pRing;
+		return pRing;
+	}
+
+	void PutString(AbstractOutputStream &vStream, const char *pszString){
+		vStream.Put(pszString, __builtin_strlen(pszString));
+	}
+	void PutUnsigned(AbstractOutputStream &vStream, std::uint64_t u64Value, unsigned uMinDigits = 1){
+		char achBuffer[24];
+		auto pchBegin = achBuffer + sizeof(achBuffer);
+		unsigned uDigits = 0;
+		do {
+			*--pchBegin = static_cast<char>('0' + u64Value % 10);
+			u64Value /= 10;
+			++uDigits;
+		} while((u64Value != 0) || (uDigits < uMinDigits));
+		vStream.Put(pchBegin, static_cast<std::size_t>(achBuffer + sizeof(achBuffer) - pchBegin));
+	}
+	void PutJsonString(AbstractOutputStream &vStream, const char *pszString){
+		static constexpr char kHexTable[] = "0123456789ABCDEF";
+
+		vStream.Put('\"');
+		for(auto pch = pszString; *pch; ++pch){
+			const auto byChar = static_cast<unsigned char>(*pch);
+			if((byChar == '\"') || (byChar == '\\')){
+				vStream.Put('\\');
+				vStream.Put(byChar);
+			} else if(byChar < 0x20){
+				const char achEscaped[6] = { '\\', 'u', '0', '0', kHexTable[byChar >> 4], kHexTable[byChar & 0x0F] };
+				vStream.Put(achEscaped, sizeof(achEscaped));
+			} else {
+				vStream.Put(byChar);
+			}
+		}
+		vStream.Put('\"');
+	}
+}
+
+void Impl_Trace::Record(char chPhase, const char *pszName, const char *pszCategory) noexcept {
+	const auto pRing = GetCurrentRing();
+	if(!pRing){
+		return;
+	}
+	const auto u64Head = pRing->u64Head.Load(kAtomicRelaxed);
+	auto &vEvent = pRing->aEvents[u64Head % kRingSize];
+	vEvent.u64TimestampNs = GetTscMonoClock();
+	vEvent.pszName        = pszName;
+	vEvent.pszCategory    = pszCategory;
+	vEvent.chPhase        = chPhase;
+	pRing->u64Head.Store(u64Head + 1, kAtomicRelease);
+}
+
+void StartTracing() noexcept {
+	Impl_Trace::g_bEnabled.Store(true, kAtomicRelaxed);
+}
+void StopTracing() noexcept {
+	Impl_Trace::g_bEnabled.Store(false, kAtomicRelaxed);
+}
+
+void FlushTrace(AbstractOutputStream &vStream){
+	::_MCFCRT_WaitForMutexForever(&g_vFlushMutex, _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+	const auto vUnlock = Defer([&]{ ::_MCFCRT_SignalMutex(&g_vFlushMutex); });
+
+	Vector<Impl_Trace::FlushedEvent> vecEvents;
+
+	// 新的缓冲区只会被插入到链表头部，而只有这个函数会删除缓冲区，因此遍历链表时不需要持有注册锁。
+	::_MCFCRT_WaitForMutexForever(&g_vRegistryMutex, _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+	auto pRing = g_pFirstRing;
+	::_MCFCRT_SignalMutex(&g_vRegistryMutex);
+	while(pRing){
+		const auto pNext = pRing->pNext;
+		const bool bExited = pRing->bExited.Load(kAtomicAcquire);
+		const auto u64Head = pRing->u64Head.Load(kAtomicAcquire);
+		auto u64Begin = pRing->u64Tail;
+		if(u64Head - u64Begin > Impl_Trace::kRingSize){
+			u64Begin = u64Head - Impl_Trace::kRingSize;
+		}
+		const auto uFirstCopied = vecEvents.GetSize();
+		for(auto u64Index = u64Begin; u64Index < u64Head; ++u64Index){
+			vecEvents.Push(Impl_Trace::FlushedEvent{ pRing->aEvents[u64Index % Impl_Trace::kRingSize], pRing->uThreadId });
+		}
+		// 丢弃在复制过程中被覆盖的事件，它们位于刚复制的事件的开头。
+		// 这个栅栏保证上面对事件的读取不会被重排到下面对 u64Head 的读取之后。
+		// 所有者在发布 u64NewHead 之前可能正在写入下标为 u64NewHead 的事件，它占用的是下标为 u64NewHead - kRingSize 的事件的位置，因此这个事件也必须被丢弃。
+		AtomicFence(kAtomicAcquire);
+		const auto u64NewHead = pRing->u64Head.Load(kAtomicAcquire);
+		if(u64NewHead + 1 - u64Begin > Impl_Trace::kRingSize){
+			auto u64Overwritten = u64NewHead + 1 - Impl_Trace::kRingSize - u64Begin;
+			if(u64Overwritten > u64Head - u64Begin){
+				u64Overwritten = u64Head - u64Begin;
+			}
+			const auto uOverwritten = static_cast<std::size_t>(u64Overwritten);
+			const auto pCopied = vecEvents.GetData() + uFirstCopied;
+			const auto uCopied = vecEvents.GetSize() - uFirstCopied;
+			for(std::size_t uIndex = uOverwritten; uIndex < uCopied; ++uIndex){
+				pCopied[uIndex - uOverwritten] = pCopied[uIndex];
+			}
+			vecEvents.Pop(uOverwritten);
+		}
+		pRing->u64Tail = u64Head;
+
+		if(bExited && (u64NewHead == u64Head)){
+			// 所有者已经退出并且所有事件都已经被复制，删除这个缓冲区。
+			::_MCFCRT_WaitForMutexForever(&g_vRegistryMutex, _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+			auto ppLink = &g_pFirstRing;
+			while(*ppLink != pRing){
+				ppLink = &((*ppLink)->pNext);
+			}
+			*ppLink = pNext;
+			::_MCFCRT_SignalMutex(&g_vRegistryMutex);
+			delete pRing;
+		}
+		pRing = pNext;
+	}
+
+	const auto uProcessId = static_cast<std::uint64_t>(::GetCurrentProcessId());
+	PutString(vStream, "{\"traceEvents\":[");
+	bool bFirst = true;
+	for(const auto &vFlushed : vecEvents){
+		if(!bFirst){
+			vStream.Put(',');
+		}
+		bFirst = false;
+		PutString(vStream, "\n{\"name\":");
+		PutJsonString(vStream, vFlushed.vEvent.pszName);
+		PutString(vStream, ",\"cat\":");
+		PutJsonString(vStream, vFlushed.vEvent.pszCategory);
+		PutString(vStream, ",\"ph\":\"");
+		vStream.Put(static_cast<unsigned char>(vFlushed.vEvent.chPhase));
+		if(vFlushed.vEvent.chPhase == 'i'){
+			PutString(vStream, "\",\"s\":\"t");
+		}
+		// Chrome 的时间戳以微秒为单位。
+		PutString(vStream, "\",\"ts\":");
+		PutUnsigned(vStream, vFlushed.vEvent.u64TimestampNs / 1000);
+		vStream.Put('.');
+		PutUnsigned(vStream, vFlushed.vEvent.u64TimestampNs % 1000, 3);
+		PutString(vStream, ",\"pid\":");
+		PutUnsigned(vStream, uProcessId);
+		PutString(vStream, ",\"tid\":");
+		PutUnsigned(vStream, vFlushed.uThreadId);
+		vStream.Put('}');
+	}
+	PutString(vStream, "\n]}\n");
+}
+
+}
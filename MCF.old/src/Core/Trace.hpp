@@ -0,0 +1,83 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#ifndef MCF_CORE_TRACE_HPP_
+#define MCF_CORE_TRACE_HPP_
+
+#include "Atomic.hpp"
+#include <MCFCRT/env/pp.h>
+#include <cstddef>
+#include <cstdint>
+
+namespace MCF {
+
+class AbstractOutputStream;
+
+// 跟踪事件记录在每个线程自己的环形缓冲区中。缓冲区在线程第一次记录事件时分配，此后记录事件既不分配内存也不加锁。
+// 缓冲区满时最旧的事件被覆盖。只有指针被记录，因此事件名和类别必须具有静态存储期，通常是字符串字面量。
+// 时间戳来自 GetTscMonoClock()。跟踪没有启动时，每个跟踪点的开销只是读取一个全局标志。
+
+namespace Impl_Trace {
+	extern Atomic<bool> g_bEnabled;
+
+	extern void Record(char chPhase, const char *pszName, const char *pszCategory) noexcept;
+}
+
+inline bool IsTracing() noexcept {
+	return __builtin_expect(Impl_Trace::g_bEnabled.Load(kAtomicRelaxed), false);
+}
+extern void StartTracing() noexcept;
+extern void StopTracing() noexcept;
+
+inline void TraceBegin(const char *pszName, const char *pszCategory = "mcf") noexcept {
+	if(IsTracing()){
+		Impl_Trace::Record('B', pszName, pszCategory);
+	}
+}
+inline void TraceEnd(const char *pszName, const char *pszCategory = "mcf") noexcept {
+	if(IsTracing()){
+		Impl_Trace::Record('E', pszName, pszCategory);
+	}
+}
+inline void TraceInstant(const char *pszName, const char *pszCategory = "mcf") noexcept {
+	if(IsTracing()){
+		Impl_Trace::Record('i', pszName, pszCategory);
+	}
+}
+
+class TraceScope {
+private:
+	const char *x_pszName;
+	const char *x_pszCategory;
+	bool x_bRecorded;
+
+public:
+	explicit TraceScope(const char *pszName, const char *pszCategory = "mcf") noexcept
+		: x_pszName(pszName), x_pszCategory(pszCategory), x_bRecorded(IsTracing())
+	{
+		if(x_bRecorded){
+			Impl_Trace::Record('B', x_pszName, x_pszCategory);
+		}
+	}
+	~TraceScope(){
+		// 即使跟踪已经停止，也要记录结束事件，以便开始和结束事件总是成对出现。
+		if(x_bRecorded){
+			Impl_Trace::Record('E', x_pszName, x_pszCategory);
+		}
+	}
+
+	TraceScope(const TraceScope &) = delete;
+	TraceScope &operator=(const TraceScope &) = delete;
+};
+
+// 将所有线程（包括已经退出的线程）缓冲区中的事件以 Chrome trace_event JSON 格式写出，然后清空这些缓冲区。
+// 每次调用写出一个完整的 JSON 文档。同一时刻只有一个线程可以写出。
+extern void FlushTrace(AbstractOutputStream &vStream);
+
+}
+
+#define MCF_TRACE_SCOPE(...)	\
+	const ::MCF::TraceScope _MCFCRT_PP_LAZY(_MCFCRT_PP_CAT2, vTraceScope_, __LINE__)(__VA_ARGS__)
+
+#endif
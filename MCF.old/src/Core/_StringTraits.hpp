@@ -6,6 +6,8 @@
 #define MCF_CORE_STRING_TRAITS_HPP_
 
 #include <MCFCRT/env/expect.h>
+#include <MCFCRT/ext/memmem.h>
+#include <MCFCRT/ext/wmemmem.h>
 #include <type_traits>
 #include <cstddef>
 
@@ -219,6 +221,29 @@ namespace Impl_StringTraits {
 		}
 	}
 
+	// 连续的 8 位和 16 位字符序列使用 MCFCRT 中向量化的 Two-Way 实现进行搜索。
+	// 传入指针时，这些重载优先于上面的模板被选中。
+	inline const char *FindSpan(const char *pchTextBegin, const char *pchTextEnd, const char *pchPatternBegin, const char *pchPatternEnd) noexcept {
+		const auto pchPosition = static_cast<const char *>(::_MCFCRT_memmem(pchTextBegin, static_cast<std::size_t>(pchTextEnd - pchTextBegin), pchPatternBegin, static_cast<std::size_t>(pchPatternEnd - pchPatternBegin)));
+		if(!pchPosition){
+			return pchTextEnd;
+		}
+		return pchPosition;
+	}
+	inline const wchar_t *FindSpan(const wchar_t *pwcTextBegin, const wchar_t *pwcTextEnd, const wchar_t *pwcPatternBegin, const wchar_t *pwcPatternEnd) noexcept {
+		const auto pwcPosition = ::_MCFCRT_wmemmem(pwcTextBegin, static_cast<std::size_t>(pwcTextEnd - pwcTextBegin), pwcPatternBegin, static_cast<std::size_t>(pwcPatternEnd - pwcPatternBegin));
+		if(!pwcPosition){
+			return pwcTextEnd;
+		}
+		return pwcPosition;
+	}
+	inline const char16_t *FindSpan(const char16_t *pc16TextBegin, const char16_t *pc16TextEnd, const char16_t *pc16PatternBegin, const char16_t *pc16PatternEnd) noexcept {
+		static_assert(sizeof(wchar_t) == sizeof(char16_t), "wchar_t does not have the same size with char16_t.");
+
+		const auto pwcPosition = FindSpan(reinterpret_cast<const wchar_t *>(pc16TextBegin), reinterpret_cast<const wchar_t *>(pc16TextEnd), reinterpret_cast<const wchar_t *>(pc16PatternBegin), reinterpret_cast<const wchar_t *>(pc16PatternEnd));
+		return reinterpret_cast<const char16_t *>(pwcPosition);
+	}
+
 	template<typename TextBeginT, typename TextEndT, typename PatternT>
 	TextBeginT FindRepeat(TextBeginT itTextBegin, TextEndT itTextEnd, const PatternT &chPattern, std::size_t uPatternLength){
 		const auto nPatternLength = static_cast<std::ptrdiff_t>(uPatternLength);
@@ -4,6 +4,7 @@
 
 #include "BufferingOutputStreamFilter.hpp"
 #include "../Core/MinMax.hpp"
+#include "../Core/Trace.hpp"
 
 namespace MCF {
 
@@ -31,6 +32,8 @@ void BufferingOutputStreamFilter::Put(const void *pData, std::size_t uSize){
 	}
 }
 void BufferingOutputStreamFilter::Flush(bool bHard){
+	const TraceScope vTraceScope("BufferingOutputStreamFilter::Flush", "io");
+
 	if(x_vecBuffer.GetSize() > 0){
 		GetUnderlyingStream()->Put(x_vecBuffer.GetData(), x_vecBuffer.GetSize());
 		x_vecBuffer.Clear();
@@ -4,6 +4,7 @@
 
 #include "FileOutputStream.hpp"
 #include "../Core/Exception.hpp"
+#include "../Core/Trace.hpp"
 
 namespace MCF {
 
@@ -28,6 +29,8 @@ void FileOutputStream::Put(const void *pData, std::size_t uSize){
 	x_u64Offset += uBytesTotal;
 }
 void FileOutputStream::Flush(bool bHard){
+	const TraceScope vTraceScope("FileOutputStream::Flush", "io");
+
 	if(bHard){
 		x_vFile.Flush();
 	}
@@ -20,20 +20,18 @@ public:
 	enum : std::size_t { kSuggestedSpinCount = _MCFCRT_CONDITION_VARIABLE_SUGGESTED_SPIN_COUNT };
 
 private:
+	// 上下文是互斥锁而不是 UniqueLock 的地址，这样等待同一个互斥锁的线程在广播时可以被串起来逐个唤醒。
 	template<typename LockT>
 	static std::intptr_t X_UnlockCallback(std::intptr_t nContext) noexcept {
-		const auto pLock = reinterpret_cast<LockT *>(nContext);
-		const auto pMutex = pLock->GetMutex();
-		MCF_ASSERT(pMutex);
-		pLock->Reset();
-		return reinterpret_cast<std::intptr_t>(pMutex);
+		const auto pMutex = reinterpret_cast<typename LockT::Mutex *>(nContext);
+		LockT::Traits::Unlock(pMutex);
+		return 1;
 	}
 	template<typename LockT>
 	static void X_RelockCallback(std::intptr_t nContext, std::intptr_t nUnlocked) noexcept {
-		const auto pLock = reinterpret_cast<LockT *>(nContext);
-		const auto pMutex = reinterpret_cast<std::decay_t<decltype(pLock->Release())>>(nUnlocked);
-		MCF_ASSERT(pMutex);
-		pLock->Reset(*pMutex);
+		const auto pMutex = reinterpret_cast<typename LockT::Mutex *>(nContext);
+		MCF_ASSERT(nUnlocked == 1);
+		LockT::Traits::Lock(pMutex);
 	}
 
 private:
@@ -58,15 +56,28 @@ public:
 
 	template<typename LockT>
 	bool Wait(LockT &vLock, std::uint64_t u64UntilFastMonoClock){
-		return ::_MCFCRT_WaitForConditionVariable(&x_vCond, &X_UnlockCallback<LockT>, &X_RelockCallback<LockT>, reinterpret_cast<std::intptr_t>(AddressOf(vLock)), GetSpinCount(), u64UntilFastMonoClock);
+		const auto pMutex = vLock.Release();
+		MCF_ASSERT(pMutex);
+		const bool bSignaled = ::_MCFCRT_WaitForConditionVariable(&x_vCond, &X_UnlockCallback<LockT>, &X_RelockCallback<LockT>, reinterpret_cast<std::intptr_t>(pMutex), GetSpinCount(), u64UntilFastMonoClock);
+		vLock.Reset(LockT(pMutex));
+		return bSignaled;
 	}
 	template<typename LockT>
 	bool WaitOrAbandon(LockT &vLock, std::uint64_t u64UntilFastMonoClock){
-		return ::_MCFCRT_WaitForConditionVariableOrAbandon(&x_vCond, &X_UnlockCallback<LockT>, &X_RelockCallback<LockT>, reinterpret_cast<std::intptr_t>(AddressOf(vLock)), GetSpinCount(), u64UntilFastMonoClock);
+		const auto pMutex = vLock.Release();
+		MCF_ASSERT(pMutex);
+		const bool bSignaled = ::_MCFCRT_WaitForConditionVariableOrAbandon(&x_vCond, &X_UnlockCallback<LockT>, &X_RelockCallback<LockT>, reinterpret_cast<std::intptr_t>(pMutex), GetSpinCount(), u64UntilFastMonoClock);
+		if(bSignaled){
+			vLock.Reset(LockT(pMutex));
+		}
+		return bSignaled;
 	}
 	template<typename LockT>
 	void Wait(LockT &vLock){
-		::_MCFCRT_WaitForConditionVariableForever(&x_vCond, &X_UnlockCallback<LockT>, &X_RelockCallback<LockT>, reinterpret_cast<std::intptr_t>(AddressOf(vLock)), GetSpinCount());
+		const auto pMutex = vLock.Release();
+		MCF_ASSERT(pMutex);
+		::_MCFCRT_WaitForConditionVariableForever(&x_vCond, &X_UnlockCallback<LockT>, &X_RelockCallback<LockT>, reinterpret_cast<std::intptr_t>(pMutex), GetSpinCount());
+		vLock.Reset(LockT(pMutex));
 	}
 
 	std::size_t Signal(std::size_t uMaxCountToWakeUp = 1) noexcept {
@@ -0,0 +1,39 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#include "FiberConditionVariable.hpp"
+
+namespace MCF {
+
+void FiberConditionVariable::X_SuspendAndUnlockGuard() noexcept {
+	FiberScheduler::Suspend([](void *pContext){ static_cast<Mutex *>(pContext)->Unlock(); }, &x_mtxGuard);
+}
+
+std::size_t FiberConditionVariable::Signal(std::size_t uMaxCountToWakeUp) noexcept {
+	Impl_FiberScheduler::WaitQueue queWoken;
+	std::size_t uCount = 0;
+	x_mtxGuard.Lock();
+	while(uCount < uMaxCountToWakeUp){
+		const auto hFiber = x_queWaiters.Shift();
+		if(!hFiber){
+			break;
+		}
+		queWoken.Push(hFiber);
+		++uCount;
+	}
+	x_mtxGuard.Unlock();
+	for(;;){
+		const auto hFiber = queWoken.Shift();
+		if(!hFiber){
+			break;
+		}
+		FiberScheduler::Resume(hFiber);
+	}
+	return uCount;
+}
+std::size_t FiberConditionVariable::Broadcast() noexcept {
+	return Signal(SIZE_MAX);
+}
+
+}
@@ -0,0 +1,52 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#ifndef MCF_THREAD_FIBER_CONDITION_VARIABLE_HPP_
+#define MCF_THREAD_FIBER_CONDITION_VARIABLE_HPP_
+
+#include "FiberScheduler.hpp"
+#include "Mutex.hpp"
+#include "../Core/Assert.hpp"
+#include <cstddef>
+
+namespace MCF {
+
+// 供 FiberScheduler 中的纤程使用的条件变量，通常和 FiberMutex 一起使用。等待的纤程被挂起，而不会阻塞工作线程。
+class FiberConditionVariable {
+private:
+	Mutex x_mtxGuard;
+	Impl_FiberScheduler::WaitQueue x_queWaiters;
+
+public:
+	FiberConditionVariable() noexcept = default;
+
+	FiberConditionVariable(const FiberConditionVariable &) = delete;
+	FiberConditionVariable &operator=(const FiberConditionVariable &) = delete;
+
+private:
+	void X_SuspendAndUnlockGuard() noexcept;
+
+public:
+	template<typename LockT>
+	void Wait(LockT &vLock){
+		const auto hFiber = FiberScheduler::GetCurrentFiber();
+		MCF_DEBUG_CHECK_MSG(hFiber, L"当前线程不在纤程中运行。");
+		const auto pMutex = vLock.GetMutex();
+		MCF_ASSERT(pMutex);
+
+		x_mtxGuard.Lock();
+		x_queWaiters.Push(hFiber);
+		// 在释放 x_mtxGuard 之前不可能被唤醒，因此这里释放锁不会错过通知。
+		vLock.Reset();
+		X_SuspendAndUnlockGuard();
+		vLock.Reset(*pMutex);
+	}
+
+	std::size_t Signal(std::size_t uMaxCountToWakeUp = 1) noexcept;
+	std::size_t Broadcast() noexcept;
+};
+
+}
+
+#endif
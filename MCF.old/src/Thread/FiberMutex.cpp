@@ -0,0 +1,54 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#include "FiberMutex.hpp"
+#include "../Core/Assert.hpp"
+#include "../Core/Clocks.hpp"
+
+namespace MCF {
+
+bool FiberMutex::Try(std::uint64_t u64UntilFastMonoClock) noexcept {
+	for(;;){
+		x_mtxGuard.Lock();
+		const bool bLocked = x_bLocked;
+		x_bLocked = true;
+		x_mtxGuard.Unlock();
+		if(!bLocked){
+			return true;
+		}
+		if(GetFastMonoClock() >= u64UntilFastMonoClock){
+			return false;
+		}
+		FiberScheduler::YieldFiber();
+	}
+}
+void FiberMutex::Lock() noexcept {
+	const auto hFiber = FiberScheduler::GetCurrentFiber();
+	MCF_DEBUG_CHECK_MSG(hFiber, L"当前线程不在纤程中运行。");
+
+	x_mtxGuard.Lock();
+	if(!x_bLocked){
+		x_bLocked = true;
+		x_mtxGuard.Unlock();
+		return;
+	}
+	x_queWaiters.Push(hFiber);
+	// 在纤程被挂起之后才释放 x_mtxGuard，防止它在切换完成之前被恢复。
+	FiberScheduler::Suspend([](void *pContext){ static_cast<Mutex *>(pContext)->Unlock(); }, &x_mtxGuard);
+	// Unlock() 已经将所有权转交给了我们。
+}
+void FiberMutex::Unlock() noexcept {
+	x_mtxGuard.Lock();
+	MCF_DEBUG_CHECK_MSG(x_bLocked, L"互斥体没有被锁定。");
+	const auto hWaiter = x_queWaiters.Shift();
+	if(!hWaiter){
+		x_bLocked = false;
+	}
+	x_mtxGuard.Unlock();
+	if(hWaiter){
+		FiberScheduler::Resume(hWaiter);
+	}
+}
+
+}
@@ -0,0 +1,47 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#ifndef MCF_THREAD_FIBER_MUTEX_HPP_
+#define MCF_THREAD_FIBER_MUTEX_HPP_
+
+#include "FiberScheduler.hpp"
+#include "Mutex.hpp"
+#include "UniqueLock.hpp"
+#include <cstdint>
+
+namespace MCF {
+
+// 供 FiberScheduler 中的纤程使用的互斥体。等待的纤程被挂起，而不会阻塞工作线程。
+// 解锁时所有权被直接转交给等待时间最长的纤程。
+class FiberMutex {
+private:
+	Mutex x_mtxGuard;
+	bool x_bLocked;
+	Impl_FiberScheduler::WaitQueue x_queWaiters;
+
+public:
+	FiberMutex() noexcept
+		: x_bLocked(false)
+	{ }
+
+	FiberMutex(const FiberMutex &) = delete;
+	FiberMutex &operator=(const FiberMutex &) = delete;
+
+public:
+	// 在超时之前，等待的纤程会不断让出执行权。
+	bool Try(std::uint64_t u64UntilFastMonoClock = 0) noexcept;
+	void Lock() noexcept;
+	void Unlock() noexcept;
+
+	UniqueLock<FiberMutex> TryGetLock(std::uint64_t u64UntilFastMonoClock = 0) noexcept {
+		return UniqueLock<FiberMutex>(*this, u64UntilFastMonoClock);
+	}
+	UniqueLock<FiberMutex> GetLock() noexcept {
+		return UniqueLock<FiberMutex>(*this);
+	}
+};
+
+}
+
+#endif
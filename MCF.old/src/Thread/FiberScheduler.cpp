@@ -0,0 +1,312 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#include "FiberScheduler.hpp"
+#include "Thread.hpp"
+#include "../Core/Assert.hpp"
+#include "../Core/Exception.hpp"
+#include "../Core/Bail.hpp"
+#include <MCFCRT/env/once_flag.h>
+#include <MCFCRT/env/last_error.h>
+#include <MCFCRT/pre/tls.h>
+#include <MCFCRT/env/fiber.h>
+#include <MCFCRT/env/futex.h>
+#include <MCFCRT/env/mcfwin.h>
+
+namespace MCF {
+
+namespace Impl_FiberScheduler {
+	class Fiber {
+	private:
+		static void X_FiberProc(std::intptr_t nContext) noexcept {
+			const auto pFiber = reinterpret_cast<Fiber *>(nContext);
+			(*(pFiber->pProc))();
+		}
+
+	public:
+		FiberScheduler *const pScheduler;
+		const UniquePtr<FiberScheduler::Proc> pProc;
+		::_MCFCRT_Fiber vFiber;
+		Fiber *pNext = nullptr;
+
+	public:
+		Fiber(FiberScheduler *pScheduler_, UniquePtr<FiberScheduler::Proc> pProc_, std::size_t uStackSize)
+			: pScheduler(pScheduler_), pProc(std::move(pProc_))
+		{
+			if(!::_MCFCRT_CreateFiber(&vFiber, &X_FiberProc, reinterpret_cast<std::intptr_t>(this), uStackSize)){
+				MCF_THROW(Exception, ::GetLastError(), Rcntws::View(L"_MCFCRT_CreateFiber() 失败。"));
+			}
+		}
+		~Fiber(){
+			::_MCFCRT_DestroyFiber(&vFiber);
+		}
+
+		Fiber(const Fiber &) = delete;
+		Fiber &operator=(const Fiber &) = delete;
+	};
+
+	void WaitQueue::Push(Fiber *pFiber) noexcept {
+		MCF_DEBUG_CHECK(!pFiber->pNext);
+
+		if(x_pLast){
+			x_pLast->pNext = pFiber;
+		} else {
+			x_pFirst = pFiber;
+		}
+		x_pLast = pFiber;
+	}
+	Fiber *WaitQueue::Shift() noexcept {
+		const auto pFiber = x_pFirst;
+		if(!pFiber){
+			return nullptr;
+		}
+		x_pFirst = pFiber->pNext;
+		if(!x_pFirst){
+			x_pLast = nullptr;
+		}
+		pFiber->pNext = nullptr;
+		return pFiber;
+	}
+
+	class Worker {
+	public:
+		FiberScheduler *const pOwner;
+		::_MCFCRT_Fiber vRootFiber;
+		Fiber *pCurrent = nullptr;
+		FiberScheduler::AfterSuspendCallback pfnAfterSuspend = nullptr;
+		void *pAfterSuspendContext = nullptr;
+		IntrusivePtr<Thread> pThread;
+
+	public:
+		explicit Worker(FiberScheduler *pOwner_) noexcept
+			: pOwner(pOwner_)
+		{ }
+	};
+
+	class WorkerThread final : public Thread {
+	private:
+		Worker *const x_pWorker;
+
+	public:
+		explicit WorkerThread(Worker *pWorker)
+			: x_pWorker(pWorker)
+		{
+			X_Spawn(false);
+		}
+		~WorkerThread() override;
+
+	protected:
+		void X_ThreadProc() const override {
+			x_pWorker->pOwner->X_WorkerProc(x_pWorker);
+		}
+	};
+
+	WorkerThread::~WorkerThread(){ }
+}
+
+namespace {
+	constexpr unsigned kSpinCount = 64;
+
+	// 当前工作线程的指针保存在 CRT 的线程局部存储中。键在第一个纤程调度器构造时分配，因此在任何工作线程启动之前就已经存在。
+	::_MCFCRT_OnceFlag g_vCurrentWorkerKeyOnce = { 0 };
+	Atomic<::_MCFCRT_TlsKeyHandle> g_hCurrentWorkerKey(nullptr);
+
+	void RequireCurrentWorkerKey(){
+		const auto eResult = ::_MCFCRT_WaitForOnceFlagForever(&g_vCurrentWorkerKeyOnce);
+		if(eResult == ::_MCFCRT_kOnceResultInitial){
+			const auto hKey = ::_MCFCRT_TlsAllocKey(sizeof(Impl_FiberScheduler::Worker *), nullptr, nullptr, 0);
+			if(!hKey){
+				const auto dwErrorCode = ::_MCFCRT_GetLastError();
+				::_MCFCRT_SignalOnceFlagAsAborted(&g_vCurrentWorkerKeyOnce);
+				MCF_THROW(Exception, dwErrorCode, Rcntws::View(L"FiberScheduler: _MCFCRT_TlsAllocKey() 失败。"));
+			}
+			g_hCurrentWorkerKey.Store(hKey, kAtomicRelease);
+			::_MCFCRT_SignalOnceFlagAsFinished(&g_vCurrentWorkerKeyOnce);
+		}
+	}
+	void SetCurrentWorker(Impl_FiberScheduler::Worker *pWorker) noexcept {
+		const auto hKey = g_hCurrentWorkerKey.Load(kAtomicAcquire);
+		MCF_ASSERT(hKey);
+		void *pStorage;
+		if(!::_MCFCRT_TlsRequire(hKey, &pStorage)){
+			// 纤程依赖当前工作线程的指针挂起自己，没有它工作线程无法运行任何纤程。
+			Bail(L"FiberScheduler: _MCFCRT_TlsRequire() 失败。");
+		}
+		*static_cast<Impl_FiberScheduler::Worker **>(pStorage) = pWorker;
+	}
+	// 纤程可能在挂起之后被另一个线程恢复，因此线程局部存储的地址不能被缓存。
+	__attribute__((__noinline__))
+	Impl_FiberScheduler::Worker *GetCurrentWorker() noexcept {
+		const auto hKey = g_hCurrentWorkerKey.Load(kAtomicAcquire);
+		if(!hKey){
+			return nullptr;
+		}
+		void *pStorage;
+		if(!::_MCFCRT_TlsGet(hKey, &pStorage)){
+			return nullptr;
+		}
+		return *static_cast<Impl_FiberScheduler::Worker **>(pStorage);
+	}
+
+	std::size_t GetProcessorCount() noexcept {
+		::SYSTEM_INFO vSystemInfo;
+		::GetSystemInfo(&vSystemInfo);
+		return vSystemInfo.dwNumberOfProcessors;
+	}
+}
+
+FiberScheduler::FiberScheduler(std::size_t uWorkerCount, std::size_t uStackSize)
+	: x_uStackSize((uStackSize != 0) ? uStackSize : _MCFCRT_FIBER_DEFAULT_STACK_SIZE)
+	, x_uReadyCount(0), x_uEpoch(0), x_uSleeping(0), x_uFiberCount(0), x_bStopping(false)
+{
+	RequireCurrentWorkerKey();
+
+	if(uWorkerCount == 0){
+		uWorkerCount = GetProcessorCount();
+		if(uWorkerCount == 0){
+			uWorkerCount = 1;
+		}
+	}
+	x_vecWorkers.Reserve(uWorkerCount);
+	for(std::size_t uIndex = 0; uIndex < uWorkerCount; ++uIndex){
+		x_vecWorkers.Push(MakeUnique<Impl_FiberScheduler::Worker>(this));
+	}
+	try {
+		for(const auto &pWorker : x_vecWorkers){
+			pWorker->pThread = MakeIntrusive<Impl_FiberScheduler::WorkerThread>(pWorker.Get());
+		}
+	} catch(...){
+		X_StopAndJoin();
+		throw;
+	}
+}
+FiberScheduler::~FiberScheduler(){
+	MCF_DEBUG_CHECK_MSG(!GetCurrentWorker() || (GetCurrentWorker()->pOwner != this), L"不能在纤程调度器自己的纤程中销毁它。");
+
+	for(;;){
+		const auto uFiberCount = x_uFiberCount.Load(kAtomicAcquire);
+		if(uFiberCount == 0){
+			break;
+		}
+		::_MCFCRT_WaitForAddressForever(&x_uFiberCount, &uFiberCount, sizeof(uFiberCount));
+	}
+	X_StopAndJoin();
+}
+
+Impl_FiberScheduler::Fiber *FiberScheduler::X_PopReady() noexcept {
+	if(x_uReadyCount.Load(kAtomicAcquire) == 0){
+		return nullptr;
+	}
+	x_mtxReady.Lock();
+	const auto pFiber = x_queReady.Shift();
+	if(pFiber){
+		x_uReadyCount.Decrement(kAtomicRelease);
+	}
+	x_mtxReady.Unlock();
+	return pFiber;
+}
+void FiberScheduler::X_PushReady(Impl_FiberScheduler::Fiber *pFiber) noexcept {
+	x_mtxReady.Lock();
+	x_queReady.Push(pFiber);
+	x_uReadyCount.Increment(kAtomicRelease);
+	x_mtxReady.Unlock();
+
+	// 和 X_WorkerProc() 中休眠之前的检查配对。
+	AtomicFence(kAtomicSeqCst);
+	if(x_uSleeping.Load(kAtomicSeqCst) == 0){
+		return;
+	}
+	x_uEpoch.Increment(kAtomicSeqCst);
+	::_MCFCRT_WakeByAddressSingle(&x_uEpoch);
+}
+void FiberScheduler::X_WorkerProc(Impl_FiberScheduler::Worker *pWorker) noexcept {
+	SetCurrentWorker(pWorker);
+	::_MCFCRT_InitializeThreadFiber(&(pWorker->vRootFiber));
+	unsigned uSpinsLeft = kSpinCount;
+	for(;;){
+		const auto pFiber = X_PopReady();
+		if(pFiber){
+			pWorker->pCurrent = pFiber;
+			::_MCFCRT_SwitchToFiber(&(pWorker->vRootFiber), &(pFiber->vFiber));
+			pWorker->pCurrent = nullptr;
+			if(::_MCFCRT_IsFiberFinished(&(pFiber->vFiber))){
+				delete pFiber;
+				if(x_uFiberCount.Decrement(kAtomicAcqRel) == 0){
+					::_MCFCRT_WakeByAddressAll(&x_uFiberCount);
+				}
+			} else {
+				// 纤程的上下文已经保存，现在可以让其他线程恢复它了。
+				const auto pfnAfterSuspend = std::exchange(pWorker->pfnAfterSuspend, nullptr);
+				MCF_DEBUG_CHECK(pfnAfterSuspend);
+				(*pfnAfterSuspend)(pWorker->pAfterSuspendContext);
+			}
+			uSpinsLeft = kSpinCount;
+			continue;
+		}
+		if(x_bStopping.Load(kAtomicAcquire)){
+			break;
+		}
+		if(uSpinsLeft != 0){
+			--uSpinsLeft;
+			AtomicPause();
+			continue;
+		}
+		x_uSleeping.Increment(kAtomicSeqCst);
+		const auto uEpoch = x_uEpoch.Load(kAtomicSeqCst);
+		if((x_uReadyCount.Load(kAtomicSeqCst) == 0) && !x_bStopping.Load(kAtomicSeqCst)){
+			::_MCFCRT_WaitForAddressForever(&x_uEpoch, &uEpoch, sizeof(uEpoch));
+		}
+		x_uSleeping.Decrement(kAtomicSeqCst);
+		uSpinsLeft = kSpinCount;
+	}
+	SetCurrentWorker(nullptr);
+}
+void FiberScheduler::X_StopAndJoin() noexcept {
+	x_bStopping.Store(true, kAtomicSeqCst);
+	x_uEpoch.Increment(kAtomicSeqCst);
+	::_MCFCRT_WakeByAddressAll(&x_uEpoch);
+	for(const auto &pWorker : x_vecWorkers){
+		if(pWorker->pThread){
+			pWorker->pThread->Wait();
+		}
+	}
+}
+
+void FiberScheduler::Spawn(UniquePtr<Proc> pProc){
+	MCF_DEBUG_CHECK(pProc);
+	MCF_DEBUG_CHECK_MSG(!x_bStopping.Load(kAtomicRelaxed), L"纤程调度器正在被销毁。");
+
+	auto pFiber = MakeUnique<Impl_FiberScheduler::Fiber>(this, std::move(pProc), x_uStackSize);
+	x_uFiberCount.Increment(kAtomicRelaxed);
+	X_PushReady(pFiber.Release());
+}
+
+FiberScheduler::FiberHandle FiberScheduler::GetCurrentFiber() noexcept {
+	const auto pWorker = GetCurrentWorker();
+	if(!pWorker){
+		return nullptr;
+	}
+	return pWorker->pCurrent;
+}
+void FiberScheduler::Suspend(AfterSuspendCallback pfnAfterSuspend, void *pContext) noexcept {
+	MCF_DEBUG_CHECK(pfnAfterSuspend);
+
+	const auto pWorker = GetCurrentWorker();
+	MCF_DEBUG_CHECK_MSG(pWorker && pWorker->pCurrent, L"当前线程不在纤程中运行。");
+	const auto pFiber = pWorker->pCurrent;
+	pWorker->pfnAfterSuspend = pfnAfterSuspend;
+	pWorker->pAfterSuspendContext = pContext;
+	::_MCFCRT_SwitchToFiber(&(pFiber->vFiber), &(pWorker->vRootFiber));
+	// 此时可能已经在另一个线程中了，不要再使用 pWorker。
+}
+void FiberScheduler::Resume(FiberHandle hFiber) noexcept {
+	MCF_DEBUG_CHECK(hFiber);
+
+	hFiber->pScheduler->X_PushReady(hFiber);
+}
+void FiberScheduler::YieldFiber() noexcept {
+	Suspend([](void *pContext){ Resume(static_cast<FiberHandle>(pContext)); }, GetCurrentFiber());
+}
+
+}
@@ -0,0 +1,107 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#ifndef MCF_THREAD_FIBER_SCHEDULER_HPP_
+#define MCF_THREAD_FIBER_SCHEDULER_HPP_
+
+#include "Mutex.hpp"
+#include "../Core/Atomic.hpp"
+#include "../Function/Function.hpp"
+#include "../SmartPointers/UniquePtr.hpp"
+#include "../Containers/Vector.hpp"
+#include <type_traits>
+#include <utility>
+#include <cstddef>
+
+namespace MCF {
+
+namespace Impl_FiberScheduler {
+	class Fiber;
+	class Worker;
+	class WorkerThread;
+
+	// 纤程的侵入式先进先出队列。一个纤程同时只能位于一个队列中。
+	class WaitQueue {
+	private:
+		Fiber *x_pFirst = nullptr;
+		Fiber *x_pLast = nullptr;
+
+	public:
+		bool IsEmpty() const noexcept {
+			return !x_pFirst;
+		}
+		void Push(Fiber *pFiber) noexcept;
+		Fiber *Shift() noexcept;
+	};
+}
+
+// M:N 纤程调度器。纤程在若干工作线程之间多路复用，可能在任何一个挂起点之后被另一个工作线程恢复执行。
+// 因此纤程中不应跨越挂起点使用线程局部存储，也不应跨越挂起点持有会阻塞线程的锁（例如 Mutex），而应该使用 FiberMutex 和 FiberConditionVariable。
+// 纤程函数不得抛出异常。析构函数等待所有纤程结束。
+class FiberScheduler {
+public:
+	using Proc = Function<void ()>;
+	using FiberHandle = Impl_FiberScheduler::Fiber *;
+	using AfterSuspendCallback = void (*)(void *pContext);
+
+private:
+	std::size_t x_uStackSize;
+	Vector<UniquePtr<Impl_FiberScheduler::Worker>> x_vecWorkers;
+
+	Mutex x_mtxReady;
+	Impl_FiberScheduler::WaitQueue x_queReady;
+	Atomic<std::size_t> x_uReadyCount;
+
+	Atomic<std::size_t> x_uEpoch;
+	Atomic<std::size_t> x_uSleeping;
+	Atomic<std::size_t> x_uFiberCount;
+	Atomic<bool> x_bStopping;
+
+	friend Impl_FiberScheduler::WorkerThread;
+
+public:
+	// 如果 uWorkerCount 为零，则创建与处理器数目相同的工作线程。如果 uStackSize 为零，则使用默认的栈大小。
+	explicit FiberScheduler(std::size_t uWorkerCount = 0, std::size_t uStackSize = 0);
+	~FiberScheduler();
+
+	FiberScheduler(const FiberScheduler &) = delete;
+	FiberScheduler &operator=(const FiberScheduler &) = delete;
+
+private:
+	Impl_FiberScheduler::Fiber *X_PopReady() noexcept;
+	void X_PushReady(Impl_FiberScheduler::Fiber *pFiber) noexcept;
+	void X_WorkerProc(Impl_FiberScheduler::Worker *pWorker) noexcept;
+	void X_StopAndJoin() noexcept;
+
+public:
+	std::size_t GetWorkerCount() const noexcept {
+		return x_vecWorkers.GetSize();
+	}
+	std::size_t GetFiberCount() const noexcept {
+		return x_uFiberCount.Load(kAtomicRelaxed);
+	}
+
+	void Spawn(UniquePtr<Proc> pProc);
+	template<typename FunctionT,
+		std::enable_if_t<
+			!std::is_convertible<FunctionT &&, UniquePtr<Proc>>::value,
+			int> = 0>
+	void Spawn(FunctionT &&vFunction){
+		Spawn(UniquePtr<Proc>(MakeFunction<void ()>(std::forward<FunctionT>(vFunction))));
+	}
+
+public:
+	// 如果当前线程不在纤程中运行，返回空指针。
+	static FiberHandle GetCurrentFiber() noexcept;
+	// 挂起当前纤程。切换完成之后 pfnAfterSuspend(pContext) 在工作线程中被调用，通常用于释放保护等待队列的锁。
+	// 被挂起的纤程需要由 Resume() 重新调度。
+	static void Suspend(AfterSuspendCallback pfnAfterSuspend, void *pContext) noexcept;
+	static void Resume(FiberHandle hFiber) noexcept;
+	// 将当前纤程放到就绪队列的末尾，执行其他纤程。
+	static void YieldFiber() noexcept;
+};
+
+}
+
+#endif
@@ -0,0 +1,41 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#include "Latch.hpp"
+#include "../Core/Assert.hpp"
+#include <MCFCRT/env/futex.h>
+
+namespace MCF {
+
+std::size_t Latch::CountDown(std::size_t uCount) noexcept {
+	const auto uOldCount = x_uCount.FetchSub(uCount, kAtomicAcqRel);
+	MCF_DEBUG_CHECK_MSG(uOldCount >= uCount, L"算术运算结果超出可表示范围。");
+	const auto uNewCount = uOldCount - uCount;
+	if((uNewCount == 0) && (uOldCount != 0)){
+		::_MCFCRT_WakeByAddressAll(&x_uCount);
+	}
+	return uNewCount;
+}
+bool Latch::Wait(std::uint64_t u64UntilFastMonoClock) noexcept {
+	for(;;){
+		const auto uCount = x_uCount.Load(kAtomicAcquire);
+		if(uCount == 0){
+			return true;
+		}
+		if(!::_MCFCRT_WaitForAddress(&x_uCount, &uCount, sizeof(uCount), u64UntilFastMonoClock)){
+			return IsReady();
+		}
+	}
+}
+void Latch::Wait() noexcept {
+	for(;;){
+		const auto uCount = x_uCount.Load(kAtomicAcquire);
+		if(uCount == 0){
+			return;
+		}
+		::_MCFCRT_WaitForAddressForever(&x_uCount, &uCount, sizeof(uCount));
+	}
+}
+
+}
@@ -0,0 +1,47 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#ifndef MCF_THREAD_LATCH_HPP_
+#define MCF_THREAD_LATCH_HPP_
+
+#include "../Core/Atomic.hpp"
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+
+namespace MCF {
+
+// 一次性的倒计数门闩。计数归零之后所有等待的线程都被唤醒，此后 Wait() 立即返回。
+// 等待的线程直接在计数器的地址上休眠，不需要互斥锁。
+class Latch {
+private:
+	Atomic<std::size_t> x_uCount;
+
+public:
+	explicit constexpr Latch(std::size_t uInitCount) noexcept
+		: x_uCount(uInitCount)
+	{ }
+
+	Latch(const Latch &) = delete;
+	Latch &operator=(const Latch &) = delete;
+
+public:
+	std::size_t GetCount() const noexcept {
+		return x_uCount.Load(kAtomicAcquire);
+	}
+	bool IsReady() const noexcept {
+		return GetCount() == 0;
+	}
+
+	// 返回值是剩余的计数。
+	std::size_t CountDown(std::size_t uCount = 1) noexcept;
+	bool Wait(std::uint64_t u64UntilFastMonoClock) noexcept;
+	void Wait() noexcept;
+};
+
+static_assert(std::is_trivially_destructible<Latch>::value, "Hey!");
+
+}
+
+#endif
@@ -7,6 +7,7 @@
 
 #include "../Core/Assert.hpp"
 #include "../Core/Atomic.hpp"
+#include "../Core/Trace.hpp"
 #include "UniqueLock.hpp"
 #include <MCFCRT/env/mutex.h>
 #include <type_traits>
@@ -15,6 +16,7 @@
 namespace MCF {
 
 // 由一个线程锁定的互斥锁可以由另一个线程解锁。
+// 报告给锁性能分析器的调用位置是调用这些成员函数的函数的返回地址。
 
 class Mutex {
 public:
@@ -41,10 +43,19 @@ public:
 	}
 
 	bool Try(std::uint64_t u64UntilFastMonoClock = 0) noexcept {
-		return ::_MCFCRT_WaitForMutex(&x_vMutex, GetSpinCount(), u64UntilFastMonoClock);
+		return ::__MCFCRT_WaitForMutex(&x_vMutex, GetSpinCount(), u64UntilFastMonoClock, __builtin_return_address(0));
 	}
 	void Lock() noexcept {
-		::_MCFCRT_WaitForMutexForever(&x_vMutex, GetSpinCount());
+		if(IsTracing()){
+			// 只记录需要等待的情况。
+			if(::__MCFCRT_TryMutex(&x_vMutex, __builtin_return_address(0))){
+				return;
+			}
+			const TraceScope vTraceScope("Mutex::Lock", "lock");
+			::__MCFCRT_WaitForMutexForever(&x_vMutex, GetSpinCount(), __builtin_return_address(0));
+			return;
+		}
+		::__MCFCRT_WaitForMutexForever(&x_vMutex, GetSpinCount(), __builtin_return_address(0));
 	}
 	void Unlock() noexcept {
 		::_MCFCRT_SignalMutex(&x_vMutex);
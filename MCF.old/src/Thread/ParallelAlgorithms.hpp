@@ -0,0 +1,258 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#ifndef MCF_THREAD_PARALLEL_ALGORITHMS_HPP_
+#define MCF_THREAD_PARALLEL_ALGORITHMS_HPP_
+
+#include "ThreadPool.hpp"
+#include "Latch.hpp"
+#include "../Core/ArrayView.hpp"
+#include "../Core/Assert.hpp"
+#include "../Core/Clocks.hpp"
+#include "../Core/Optional.hpp"
+#include "../Containers/Vector.hpp"
+#include "../Function/Comparators.hpp"
+#include <algorithm>
+#include <iterator>
+#include <exception>
+#include <type_traits>
+#include <utility>
+#include <cstddef>
+
+namespace MCF {
+
+// 以下算法将区间递归地二分，直到每一段不超过 uGrainSize 个元素，然后在线程池中执行各段。
+// 如果 uGrainSize 为零，则根据线程池的工作线程数目自动选择，但不小于 kParallelMinGrainSize。
+// 元素数目不超过 uGrainSize 时直接在当前线程中串行执行。
+// 调用者在等待期间会帮助执行线程池中的其他任务，因此这些算法可以在工作线程中嵌套调用。
+// 用户提供的函数抛出的异常会在所有段都结束之后被重新抛出（如果有多个，只保留一个）。
+
+constexpr std::size_t kParallelMinGrainSize = 1024;
+
+namespace Impl_ParallelAlgorithms {
+	template<typename RangeT>
+	auto MakeView(RangeT &vRange) noexcept {
+		return ArrayView<std::remove_pointer_t<decltype(vRange.GetData())>>(vRange.GetData(), vRange.GetSize());
+	}
+
+	inline std::size_t GetGrainSize(const ThreadPool &vPool, std::size_t uSize, std::size_t uGrainSize) noexcept {
+		if(uGrainSize != 0){
+			return uGrainSize;
+		}
+		// 每个工作线程大约分到八段，以便负载不均衡时可以窃取。
+		const auto uAuto = uSize / (vPool.GetWorkerCount() * 8);
+		return (uAuto < kParallelMinGrainSize) ? kParallelMinGrainSize : uAuto;
+	}
+
+	inline void Join(ThreadPool &vPool, Latch &vLatch) noexcept {
+		while(!vLatch.IsReady()){
+			if(vPool.RunOne()){
+				continue;
+			}
+			// 窃取可能因为竞争而失败，所以这里不能无限期地等待。
+			vLatch.Wait(GetFastMonoClock() + 1);
+		}
+	}
+
+	template<typename FirstT, typename SecondT>
+	void ForkJoin(ThreadPool &vPool, FirstT &&vFirst, SecondT &&vSecond){
+		Latch vLatch(1);
+		std::exception_ptr pSecondException;
+		vPool.Submit([&]{
+			try {
+				vSecond();
+			} catch(...){
+				pSecondException = std::current_exception();
+			}
+			vLatch.CountDown();
+		});
+		std::exception_ptr pFirstException;
+		try {
+			vFirst();
+		} catch(...){
+			pFirstException = std::current_exception();
+		}
+		Join(vPool, vLatch);
+		if(pFirstException){
+			std::rethrow_exception(pFirstException);
+		}
+		if(pSecondException){
+			std::rethrow_exception(pSecondException);
+		}
+	}
+
+	template<typename FunctionT>
+	void ForRange(ThreadPool &vPool, std::size_t uBegin, std::size_t uEnd, FunctionT &vFunction, std::size_t uGrainSize){
+		if(uEnd - uBegin <= uGrainSize){
+			for(auto uIndex = uBegin; uIndex < uEnd; ++uIndex){
+				vFunction(uIndex);
+			}
+			return;
+		}
+		const auto uMiddle = uBegin + (uEnd - uBegin) / 2;
+		ForkJoin(vPool,
+			[&]{ ForRange(vPool, uBegin, uMiddle, vFunction, uGrainSize); },
+			[&]{ ForRange(vPool, uMiddle, uEnd, vFunction, uGrainSize); });
+	}
+
+	template<typename ResultT, typename ElementT, typename ReducerT>
+	ResultT ReduceRange(ThreadPool &vPool, const ElementT *pBegin, std::size_t uSize, ReducerT &vReducer, std::size_t uGrainSize){
+		MCF_DEBUG_CHECK(uSize != 0);
+
+		if(uSize <= uGrainSize){
+			ResultT vResult(pBegin[0]);
+			for(std::size_t uIndex = 1; uIndex < uSize; ++uIndex){
+				vResult = vReducer(std::move(vResult), pBegin[uIndex]);
+			}
+			return vResult;
+		}
+		const auto uHalf = uSize / 2;
+		Optional<ResultT> vFirst, vSecond;
+		ForkJoin(vPool,
+			[&]{ vFirst.Reset(ReduceRange<ResultT>(vPool, pBegin, uHalf, vReducer, uGrainSize)); },
+			[&]{ vSecond.Reset(ReduceRange<ResultT>(vPool, pBegin + uHalf, uSize - uHalf, vReducer, uGrainSize)); });
+		return vReducer(std::move(*vFirst.Get()), std::move(*vSecond.Get()));
+	}
+
+	// 将 [pFirst, pFirst + uFirstSize) 和 [pSecond, pSecond + uSecondSize) 合并到 pOutput，元素被移动而不是复制。
+	template<typename ElementT, typename ComparatorT>
+	void MergeRanges(ThreadPool &vPool, ElementT *pFirst, std::size_t uFirstSize, ElementT *pSecond, std::size_t uSecondSize, ElementT *pOutput, ComparatorT &vComparator, std::size_t uGrainSize){
+		if(uFirstSize < uSecondSize){
+			std::swap(pFirst, pSecond);
+			std::swap(uFirstSize, uSecondSize);
+		}
+		// 较长一段少于两个元素时无法再分割（uFirstHalf 将为零，递归不会终止），无论粒度多小都直接合并。
+		if((uFirstSize + uSecondSize <= uGrainSize) || (uFirstSize < 2)){
+			std::merge(std::make_move_iterator(pFirst), std::make_move_iterator(pFirst + uFirstSize),
+				std::make_move_iterator(pSecond), std::make_move_iterator(pSecond + uSecondSize),
+				pOutput, vComparator);
+			return;
+		}
+		// 较长一段的中位数将输出分成两个互不相关的部分。
+		const auto uFirstHalf = uFirstSize / 2;
+		const auto uSecondHalf = static_cast<std::size_t>(std::lower_bound(pSecond, pSecond + uSecondSize, pFirst[uFirstHalf], vComparator) - pSecond);
+		ForkJoin(vPool,
+			[&]{ MergeRanges(vPool, pFirst, uFirstHalf, pSecond, uSecondHalf, pOutput, vComparator, uGrainSize); },
+			[&]{ MergeRanges(vPool, pFirst + uFirstHalf, uFirstSize - uFirstHalf, pSecond + uSecondHalf, uSecondSize - uSecondHalf, pOutput + uFirstHalf + uSecondHalf, vComparator, uGrainSize); });
+	}
+
+	// 对 pData 中的元素排序。如果 bIntoBuffer 为 true，结果被移动到 pBuffer 中，否则结果留在 pData 中。
+	template<typename ElementT, typename ComparatorT>
+	void SortRange(ThreadPool &vPool, ElementT *pData, ElementT *pBuffer, std::size_t uSize, bool bIntoBuffer, ComparatorT &vComparator, std::size_t uGrainSize){
+		if(uSize <= uGrainSize){
+			std::sort(pData, pData + uSize, vComparator);
+			if(bIntoBuffer){
+				std::move(pData, pData + uSize, pBuffer);
+			}
+			return;
+		}
+		const auto uHalf = uSize / 2;
+		ForkJoin(vPool,
+			[&]{ SortRange(vPool, pData, pBuffer, uHalf, !bIntoBuffer, vComparator, uGrainSize); },
+			[&]{ SortRange(vPool, pData + uHalf, pBuffer + uHalf, uSize - uHalf, !bIntoBuffer, vComparator, uGrainSize); });
+		const auto pSource = bIntoBuffer ? pData : pBuffer;
+		const auto pDestination = bIntoBuffer ? pBuffer : pData;
+		MergeRanges(vPool, pSource, uHalf, pSource + uHalf, uSize - uHalf, pDestination, vComparator, uGrainSize);
+	}
+}
+
+// vFunction(uIndex) 对 [uBegin, uEnd) 中的每个下标调用一次，调用顺序是不确定的。
+template<typename FunctionT>
+void ParallelFor(std::size_t uBegin, std::size_t uEnd, FunctionT &&vFunction, std::size_t uGrainSize = 0, ThreadPool &vPool = GetDefaultThreadPool()){
+	if(uBegin >= uEnd){
+		return;
+	}
+	const auto uRealGrainSize = Impl_ParallelAlgorithms::GetGrainSize(vPool, uEnd - uBegin, uGrainSize);
+	Impl_ParallelAlgorithms::ForRange(vPool, uBegin, uEnd, vFunction, uRealGrainSize);
+}
+
+// vOutput[i] = vTransformer(vInput[i])。vOutput 可以和 vInput 是同一个区间。
+template<typename InputRangeT, typename OutputRangeT, typename TransformerT>
+void ParallelTransform(const InputRangeT &vInput, OutputRangeT &&vOutput, TransformerT &&vTransformer, std::size_t uGrainSize = 0, ThreadPool &vPool = GetDefaultThreadPool()){
+	const auto avInput = Impl_ParallelAlgorithms::MakeView(vInput);
+	const auto avOutput = Impl_ParallelAlgorithms::MakeView(vOutput);
+	MCF_DEBUG_CHECK_MSG(avInput.GetSize() == avOutput.GetSize(), L"输入和输出区间的大小不一致。");
+
+	ParallelFor(0, avInput.GetSize(),
+		[&](std::size_t uIndex){ avOutput[uIndex] = vTransformer(avInput[uIndex]); },
+		uGrainSize, vPool);
+}
+
+// vReducer 必须满足结合律，但不必满足交换律。结果等于按顺序从 vInit 开始折叠所有元素。
+template<typename RangeT, typename ResultT, typename ReducerT>
+ResultT ParallelReduce(const RangeT &vRange, ResultT vInit, ReducerT &&vReducer, std::size_t uGrainSize = 0, ThreadPool &vPool = GetDefaultThreadPool()){
+	const auto avRange = Impl_ParallelAlgorithms::MakeView(vRange);
+	if(avRange.IsEmpty()){
+		return vInit;
+	}
+	const auto uRealGrainSize = Impl_ParallelAlgorithms::GetGrainSize(vPool, avRange.GetSize(), uGrainSize);
+	return vReducer(std::move(vInit), Impl_ParallelAlgorithms::ReduceRange<ResultT>(vPool, avRange.GetData(), avRange.GetSize(), vReducer, uRealGrainSize));
+}
+
+// 并行归并排序。排序是不稳定的，并且需要和区间同样大小的临时空间。
+template<typename RangeT, typename ComparatorT = Less>
+void ParallelSort(RangeT &&vRange, ComparatorT &&vComparator = ComparatorT(), std::size_t uGrainSize = 0, ThreadPool &vPool = GetDefaultThreadPool()){
+	const auto avRange = Impl_ParallelAlgorithms::MakeView(vRange);
+	const auto uSize = avRange.GetSize();
+	const auto uRealGrainSize = Impl_ParallelAlgorithms::GetGrainSize(vPool, uSize, uGrainSize);
+	if(uSize <= uRealGrainSize){
+		std::sort(avRange.GetBegin(), avRange.GetEnd(), vComparator);
+		return;
+	}
+	using Element = std::remove_cv_t<std::remove_reference_t<decltype(avRange[0])>>;
+	Vector<Element> vecBuffer(std::make_move_iterator(avRange.GetBegin()), std::make_move_iterator(avRange.GetEnd()));
+	Impl_ParallelAlgorithms::SortRange(vPool, vecBuffer.GetData(), avRange.GetData(), uSize, true, vComparator, uRealGrainSize);
+}
+
+// vOutput[i] = vInput[0] op vInput[1] op ... op vInput[i]。vOutput 可以和 vInput 是同一个区间。vScanner 必须满足结合律。
+template<typename InputRangeT, typename OutputRangeT, typename ScannerT>
+void ParallelInclusiveScan(const InputRangeT &vInput, OutputRangeT &&vOutput, ScannerT &&vScanner, std::size_t uGrainSize = 0, ThreadPool &vPool = GetDefaultThreadPool()){
+	const auto avInput = Impl_ParallelAlgorithms::MakeView(vInput);
+	const auto avOutput = Impl_ParallelAlgorithms::MakeView(vOutput);
+	MCF_DEBUG_CHECK_MSG(avInput.GetSize() == avOutput.GetSize(), L"输入和输出区间的大小不一致。");
+
+	const auto uSize = avInput.GetSize();
+	if(uSize == 0){
+		return;
+	}
+	const auto uRealGrainSize = Impl_ParallelAlgorithms::GetGrainSize(vPool, uSize, uGrainSize);
+	const auto uChunkCount = (uSize - 1) / uRealGrainSize + 1;
+	const auto fnScanChunk = [&](std::size_t uChunk){
+		const auto uBegin = uChunk * uRealGrainSize;
+		const auto uEnd = (uSize - uBegin <= uRealGrainSize) ? uSize : (uBegin + uRealGrainSize);
+		avOutput[uBegin] = avInput[uBegin];
+		for(auto uIndex = uBegin + 1; uIndex < uEnd; ++uIndex){
+			avOutput[uIndex] = vScanner(avOutput[uIndex - 1], avInput[uIndex]);
+		}
+	};
+	if(uChunkCount == 1){
+		fnScanChunk(0);
+		return;
+	}
+	// 第一趟：各段独立地扫描。
+	ParallelFor(0, uChunkCount, fnScanChunk, 1, vPool);
+	// 第二趟：串行地计算每一段之前所有元素的累积值。
+	using Element = std::remove_cv_t<std::remove_reference_t<decltype(avOutput[0])>>;
+	Vector<Element> vecCarries;
+	vecCarries.Reserve(uChunkCount - 1);
+	vecCarries.Push(avOutput[uRealGrainSize - 1]);
+	for(std::size_t uChunk = 1; uChunk < uChunkCount - 1; ++uChunk){
+		vecCarries.Push(vScanner(vecCarries[uChunk - 1], avOutput[(uChunk + 1) * uRealGrainSize - 1]));
+	}
+	// 第三趟：将累积值合并到除第一段以外的各段中。
+	ParallelFor(1, uChunkCount,
+		[&](std::size_t uChunk){
+			const auto &vCarry = vecCarries[uChunk - 1];
+			const auto uBegin = uChunk * uRealGrainSize;
+			const auto uEnd = (uSize - uBegin <= uRealGrainSize) ? uSize : (uBegin + uRealGrainSize);
+			for(auto uIndex = uBegin; uIndex < uEnd; ++uIndex){
+				avOutput[uIndex] = vScanner(vCarry, avOutput[uIndex]);
+			}
+		},
+		1, vPool);
+}
+
+}
+
+#endif
@@ -5,14 +5,21 @@
 #ifndef MCF_THREAD_READER_WRITER_MUTEX_HPP_
 #define MCF_THREAD_READER_WRITER_MUTEX_HPP_
 
-#include "Mutex.hpp"
+#include "../Core/Assert.hpp"
 #include "../Core/Atomic.hpp"
+#include "UniqueLock.hpp"
+#include <MCFCRT/env/rwlock.h>
+#include <type_traits>
+#include <cstddef>
 
 namespace MCF {
 
+// 写者优先：一旦有写者在等待，新的读者将被阻塞。
+// 报告给锁性能分析器的调用位置是调用这些成员函数的函数的返回地址。
+
 class ReadersWriterMutex {
 public:
-	enum : std::size_t { kSuggestedSpinCount = Mutex::kSuggestedSpinCount };
+	enum : std::size_t { kSuggestedSpinCount = _MCFCRT_RWLOCK_SUGGESTED_SPIN_COUNT };
 
 	struct MutexTraitsAsReader {
 		static bool Try(ReadersWriterMutex *pMutex, std::uint64_t u64UntilFastMonoClock){
@@ -38,13 +45,12 @@ public:
 	};
 
 private:
-	Mutex x_mtxReaderGuard;
-	Mutex x_mtxExclusive;
-	Atomic<std::size_t> x_uReaderCount;
+	::_MCFCRT_RwLock x_vRwLock;
+	Atomic<std::size_t> x_uSpinCount;
 
 public:
 	explicit constexpr ReadersWriterMutex(std::size_t uSpinCount = kSuggestedSpinCount) noexcept
-		: x_mtxReaderGuard(kSuggestedSpinCount), x_mtxExclusive(uSpinCount), x_uReaderCount(0)
+		: x_vRwLock{ 0 }, x_uSpinCount(uSpinCount)
 	{ }
 
 	ReadersWriterMutex(const ReadersWriterMutex &) = delete;
@@ -52,15 +58,21 @@ public:
 
 public:
 	std::size_t GetSpinCount() const noexcept {
-		return x_mtxExclusive.GetSpinCount();
+		return x_uSpinCount.Load(kAtomicRelaxed);
 	}
 	void SetSpinCount(std::size_t uSpinCount) noexcept {
-		x_mtxExclusive.SetSpinCount(uSpinCount);
+		x_uSpinCount.Store(uSpinCount, kAtomicRelaxed);
 	}
 
-	bool TryAsReader(std::uint64_t u64UntilFastMonoClock = 0) noexcept;
-	void LockAsReader() noexcept;
-	void UnlockAsReader() noexcept;
+	bool TryAsReader(std::uint64_t u64UntilFastMonoClock = 0) noexcept {
+		return ::__MCFCRT_WaitForRwLockShared(&x_vRwLock, GetSpinCount(), u64UntilFastMonoClock, __builtin_return_address(0));
+	}
+	void LockAsReader() noexcept {
+		::__MCFCRT_WaitForRwLockSharedForever(&x_vRwLock, GetSpinCount(), __builtin_return_address(0));
+	}
+	void UnlockAsReader() noexcept {
+		::_MCFCRT_SignalRwLockShared(&x_vRwLock);
+	}
 
 	UniqueLock<ReadersWriterMutex, MutexTraitsAsReader> TryGetLockAsReader(std::uint64_t u64UntilFastMonoClock = 0) noexcept {
 		return UniqueLock<ReadersWriterMutex, MutexTraitsAsReader>(*this, u64UntilFastMonoClock);
@@ -69,9 +81,15 @@ public:
 		return UniqueLock<ReadersWriterMutex, MutexTraitsAsReader>(*this);
 	}
 
-	bool TryAsWriter(std::uint64_t u64UntilFastMonoClock = 0) noexcept;
-	void LockAsWriter() noexcept;
-	void UnlockAsWriter() noexcept;
+	bool TryAsWriter(std::uint64_t u64UntilFastMonoClock = 0) noexcept {
+		return ::__MCFCRT_WaitForRwLockExclusive(&x_vRwLock, GetSpinCount(), u64UntilFastMonoClock, __builtin_return_address(0));
+	}
+	void LockAsWriter() noexcept {
+		::__MCFCRT_WaitForRwLockExclusiveForever(&x_vRwLock, GetSpinCount(), __builtin_return_address(0));
+	}
+	void UnlockAsWriter() noexcept {
+		::_MCFCRT_SignalRwLockExclusive(&x_vRwLock);
+	}
 
 	UniqueLock<ReadersWriterMutex, MutexTraitsAsWriter> TryGetLockAsWriter(std::uint64_t u64UntilFastMonoClock = 0) noexcept {
 		return UniqueLock<ReadersWriterMutex, MutexTraitsAsWriter>(*this, u64UntilFastMonoClock);
@@ -8,8 +8,10 @@
 #include "../Core/UniqueHandle.hpp"
 #include "../SmartPointers/IntrusivePtr.hpp"
 #include <MCFCRT/env/thread.h>
+#include <MCFCRT/env/cpu_topology.h>
 #include <type_traits>
 #include <utility>
+#include <cstddef>
 #include <cstdint>
 
 namespace MCF {
@@ -84,6 +86,17 @@ public:
 	void Resume() noexcept {
 		::_MCFCRT_ResumeThread(x_hThread.Get());
 	}
+
+	// 以下函数失败时返回 false，使用 GetLastError() 获取错误码。
+	bool SetAffinity(unsigned uGroup, std::uint64_t u64Mask) noexcept {
+		return ::_MCFCRT_SetThreadAffinity(x_hThread.Get(), static_cast<unsigned short>(uGroup), u64Mask);
+	}
+	bool SetIdealProcessor(unsigned uGroup, unsigned uNumber) noexcept {
+		return ::_MCFCRT_SetThreadIdealProcessor(x_hThread.Get(), static_cast<unsigned short>(uGroup), static_cast<unsigned char>(uNumber));
+	}
+	bool Place(::_MCFCRT_ThreadPlacement ePlacement, std::size_t uIndex) noexcept {
+		return ::_MCFCRT_PlaceThread(x_hThread.Get(), ePlacement, uIndex);
+	}
 };
 
 extern template class IntrusivePtr<Thread>;
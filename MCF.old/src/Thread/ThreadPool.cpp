@@ -0,0 +1,408 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#include "ThreadPool.hpp"
+#include "Thread.hpp"
+#include "../Core/Assert.hpp"
+#include "../Core/Exception.hpp"
+#include <MCFCRT/env/once_flag.h>
+#include <MCFCRT/env/last_error.h>
+#include <MCFCRT/pre/tls.h>
+#include <MCFCRT/env/futex.h>
+#include <MCFCRT/ext/random.h>
+#include <MCFCRT/env/mcfwin.h>
+
+namespace MCF {
+
+namespace Impl_ThreadPool {
+	using Job = ThreadPool::Job;
+
+	// Chase-Lev 双端队列，参考 Lê et al., Correct and Efficient Work-Stealing for Weak Memory Models, 2013。
+	// 只有所有者可以调用 Push() 和 Pop()，任何线程都可以调用 Steal()。
+	class WorkStealingDeque {
+	private:
+		struct Ring {
+			std::size_t uMask;
+			Atomic<Job *> *pSlots;
+			Ring *pRetired;
+		};
+
+		static constexpr std::size_t kInitialCapacity = 256;
+
+		static Ring *X_CreateRing(std::size_t uCapacity, Ring *pRetired){
+			const auto pSlots = new Atomic<Job *>[uCapacity];
+			try {
+				return new Ring{ uCapacity - 1, pSlots, pRetired };
+			} catch(...){
+				delete[] pSlots;
+				throw;
+			}
+		}
+
+	private:
+		alignas(64) Atomic<std::ptrdiff_t> x_nTop;
+		alignas(64) Atomic<std::ptrdiff_t> x_nBottom;
+		Atomic<Ring *> x_pRing;
+
+	public:
+		WorkStealingDeque()
+			: x_nTop(0), x_nBottom(0), x_pRing(X_CreateRing(kInitialCapacity, nullptr))
+		{ }
+		~WorkStealingDeque(){
+			auto nTop = x_nTop.Load(kAtomicRelaxed);
+			const auto nBottom = x_nBottom.Load(kAtomicRelaxed);
+			auto pRing = x_pRing.Load(kAtomicRelaxed);
+			while(nTop < nBottom){
+				delete pRing->pSlots[static_cast<std::size_t>(nTop) & pRing->uMask].Load(kAtomicRelaxed);
+				++nTop;
+			}
+			// 窃取者可能仍在读取旧的环，因此旧的环只能在这里释放。
+			while(pRing){
+				const auto pRetired = pRing->pRetired;
+				delete[] pRing->pSlots;
+				delete pRing;
+				pRing = pRetired;
+			}
+		}
+
+		WorkStealingDeque(const WorkStealingDeque &) = delete;
+		WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+	private:
+		Ring *X_Grow(Ring *pRing, std::ptrdiff_t nTop, std::ptrdiff_t nBottom){
+			const auto pNewRing = X_CreateRing((pRing->uMask + 1) * 2, pRing);
+			for(auto nIndex = nTop; nIndex < nBottom; ++nIndex){
+				const auto uIndex = static_cast<std::size_t>(nIndex);
+				pNewRing->pSlots[uIndex & pNewRing->uMask].Store(pRing->pSlots[uIndex & pRing->uMask].Load(kAtomicRelaxed), kAtomicRelaxed);
+			}
+			x_pRing.Store(pNewRing, kAtomicRelease);
+			return pNewRing;
+		}
+
+	public:
+		bool IsEmpty() const noexcept {
+			return x_nBottom.Load(kAtomicAcquire) <= x_nTop.Load(kAtomicAcquire);
+		}
+
+		void Push(Job *pJob){
+			const auto nBottom = x_nBottom.Load(kAtomicRelaxed);
+			const auto nTop = x_nTop.Load(kAtomicAcquire);
+			auto pRing = x_pRing.Load(kAtomicRelaxed);
+			if(static_cast<std::size_t>(nBottom - nTop) > pRing->uMask){
+				pRing = X_Grow(pRing, nTop, nBottom);
+			}
+			pRing->pSlots[static_cast<std::size_t>(nBottom) & pRing->uMask].Store(pJob, kAtomicRelaxed);
+			AtomicFence(kAtomicRelease);
+			x_nBottom.Store(nBottom + 1, kAtomicRelaxed);
+		}
+		Job *Pop() noexcept {
+			const auto nBottom = x_nBottom.Load(kAtomicRelaxed) - 1;
+			const auto pRing = x_pRing.Load(kAtomicRelaxed);
+			x_nBottom.Store(nBottom, kAtomicRelaxed);
+			AtomicFence(kAtomicSeqCst);
+			auto nTop = x_nTop.Load(kAtomicRelaxed);
+			if(nTop > nBottom){
+				x_nBottom.Store(nBottom + 1, kAtomicRelaxed);
+				return nullptr;
+			}
+			auto pJob = pRing->pSlots[static_cast<std::size_t>(nBottom) & pRing->uMask].Load(kAtomicRelaxed);
+			if(nTop == nBottom){
+				// 这是最后一个元素，和窃取者竞争。
+				if(!x_nTop.CompareExchange(nTop, nTop + 1, kAtomicSeqCst, kAtomicRelaxed)){
+					pJob = nullptr;
+				}
+				x_nBottom.Store(nBottom + 1, kAtomicRelaxed);
+			}
+			return pJob;
+		}
+		Job *Steal() noexcept {
+			auto nTop = x_nTop.Load(kAtomicAcquire);
+			AtomicFence(kAtomicSeqCst);
+			const auto nBottom = x_nBottom.Load(kAtomicAcquire);
+			if(nTop >= nBottom){
+				return nullptr;
+			}
+			const auto pRing = x_pRing.Load(kAtomicAcquire);
+			const auto pJob = pRing->pSlots[static_cast<std::size_t>(nTop) & pRing->uMask].Load(kAtomicRelaxed);
+			if(!x_nTop.CompareExchange(nTop, nTop + 1, kAtomicSeqCst, kAtomicRelaxed)){
+				return nullptr;
+			}
+			return pJob;
+		}
+	};
+
+	class Worker {
+	public:
+		ThreadPool *const pPool;
+		const std::size_t uIndex;
+		WorkStealingDeque vDeque;
+		std::uint32_t u32Seed;
+		IntrusivePtr<Thread> pThread;
+
+	public:
+		Worker(ThreadPool *pPool_, std::size_t uIndex_)
+			: pPool(pPool_), uIndex(uIndex_), u32Seed(::_MCFCRT_GetRandom_uint32() | 1)
+		{ }
+
+	public:
+		std::uint32_t GetNextRandom() noexcept {
+			// xorshift32
+			auto u32Seed_ = u32Seed;
+			u32Seed_ ^= u32Seed_ << 13;
+			u32Seed_ ^= u32Seed_ >> 17;
+			u32Seed_ ^= u32Seed_ << 5;
+			u32Seed = u32Seed_;
+			return u32Seed_;
+		}
+	};
+
+	class WorkerThread final : public Thread {
+	private:
+		Worker *const x_pWorker;
+
+	public:
+		explicit WorkerThread(Worker *pWorker)
+			: x_pWorker(pWorker)
+		{
+			X_Spawn(false);
+		}
+		~WorkerThread() override;
+
+	protected:
+		void X_ThreadProc() const override {
+			x_pWorker->pPool->X_WorkerProc(x_pWorker);
+		}
+	};
+
+	WorkerThread::~WorkerThread(){ }
+}
+
+namespace {
+	// 空闲的工作线程在休眠之前尝试寻找任务的次数。
+	constexpr unsigned kSpinCount = 64;
+
+	// 当前工作线程的指针保存在 CRT 的线程局部存储中。键在第一个线程池构造时分配，因此在任何工作线程启动之前就已经存在。
+	::_MCFCRT_OnceFlag g_vCurrentWorkerKeyOnce = { 0 };
+	Atomic<::_MCFCRT_TlsKeyHandle> g_hCurrentWorkerKey(nullptr);
+
+	void RequireCurrentWorkerKey(){
+		const auto eResult = ::_MCFCRT_WaitForOnceFlagForever(&g_vCurrentWorkerKeyOnce);
+		if(eResult == ::_MCFCRT_kOnceResultInitial){
+			const auto hKey = ::_MCFCRT_TlsAllocKey(sizeof(Impl_ThreadPool::Worker *), nullptr, nullptr, 0);
+			if(!hKey){
+				const auto dwErrorCode = ::_MCFCRT_GetLastError();
+				::_MCFCRT_SignalOnceFlagAsAborted(&g_vCurrentWorkerKeyOnce);
+				MCF_THROW(Exception, dwErrorCode, Rcntws::View(L"ThreadPool: _MCFCRT_TlsAllocKey() 失败。"));
+			}
+			g_hCurrentWorkerKey.Store(hKey, kAtomicRelease);
+			::_MCFCRT_SignalOnceFlagAsFinished(&g_vCurrentWorkerKeyOnce);
+		}
+	}
+	void SetCurrentWorker(Impl_ThreadPool::Worker *pWorker) noexcept {
+		const auto hKey = g_hCurrentWorkerKey.Load(kAtomicAcquire);
+		MCF_ASSERT(hKey);
+		void *pStorage;
+		if(!::_MCFCRT_TlsRequire(hKey, &pStorage)){
+			// 没有线程局部存储的工作线程仍然可以执行任务，只是它提交的任务会进入全局队列。
+			return;
+		}
+		*static_cast<Impl_ThreadPool::Worker **>(pStorage) = pWorker;
+	}
+	Impl_ThreadPool::Worker *GetCurrentWorker() noexcept {
+		const auto hKey = g_hCurrentWorkerKey.Load(kAtomicAcquire);
+		if(!hKey){
+			return nullptr;
+		}
+		void *pStorage;
+		if(!::_MCFCRT_TlsGet(hKey, &pStorage)){
+			return nullptr;
+		}
+		return *static_cast<Impl_ThreadPool::Worker **>(pStorage);
+	}
+
+	std::size_t GetProcessorCount() noexcept {
+		::SYSTEM_INFO vSystemInfo;
+		::GetSystemInfo(&vSystemInfo);
+		return vSystemInfo.dwNumberOfProcessors;
+	}
+}
+
+ThreadPool::ThreadPool(std::size_t uWorkerCount, ::_MCFCRT_ThreadPlacement ePlacement)
+	: x_uInjectedCount(0), x_uEpoch(0), x_uSleeping(0), x_bStopping(false)
+{
+	RequireCurrentWorkerKey();
+
+	if(uWorkerCount == 0){
+		uWorkerCount = ::_MCFCRT_GetThreadPlacementSlotCount(ePlacement);
+	}
+	if(uWorkerCount == 0){
+		uWorkerCount = GetProcessorCount();
+		if(uWorkerCount == 0){
+			uWorkerCount = 1;
+		}
+	}
+	// 窃取者会遍历 x_vecWorkers，因此必须在启动任何工作线程之前将其填满。
+	x_vecWorkers.Reserve(uWorkerCount);
+	for(std::size_t uIndex = 0; uIndex < uWorkerCount; ++uIndex){
+		x_vecWorkers.Push(MakeUnique<Impl_ThreadPool::Worker>(this, uIndex));
+	}
+	try {
+		for(const auto &pWorker : x_vecWorkers){
+			pWorker->pThread = MakeIntrusive<Impl_ThreadPool::WorkerThread>(pWorker.Get());
+			pWorker->pThread->Place(ePlacement, pWorker->uIndex);
+		}
+	} catch(...){
+		X_StopAndJoin();
+		throw;
+	}
+}
+ThreadPool::~ThreadPool(){
+	X_StopAndJoin();
+}
+
+UniquePtr<ThreadPool::Job> ThreadPool::X_PopInjected() noexcept {
+	if(x_uInjectedCount.Load(kAtomicAcquire) == 0){
+		return nullptr;
+	}
+	UniquePtr<Job> pJob;
+	{
+		auto vLock = x_mtxInjected.GetLock();
+		if(!x_queInjected.IsEmpty()){
+			pJob = std::move(*x_queInjected.GetFirst());
+			x_queInjected.Shift();
+			x_uInjectedCount.Decrement(kAtomicRelease);
+		}
+	}
+	return pJob;
+}
+UniquePtr<ThreadPool::Job> ThreadPool::X_FindJob(Impl_ThreadPool::Worker *pWorker) noexcept {
+	if(pWorker){
+		const auto pJob = pWorker->vDeque.Pop();
+		if(pJob){
+			return UniquePtr<Job>(pJob);
+		}
+	}
+	auto pInjected = X_PopInjected();
+	if(pInjected){
+		return pInjected;
+	}
+	const auto uWorkerCount = x_vecWorkers.GetSize();
+	const auto uStart = (pWorker ? pWorker->GetNextRandom() : ::_MCFCRT_GetRandom_uint32()) % uWorkerCount;
+	for(std::size_t uOffset = 0; uOffset < uWorkerCount; ++uOffset){
+		auto uVictim = uStart + uOffset;
+		if(uVictim >= uWorkerCount){
+			uVictim -= uWorkerCount;
+		}
+		const auto pVictim = x_vecWorkers[uVictim].Get();
+		if(pVictim == pWorker){
+			continue;
+		}
+		const auto pJob = pVictim->vDeque.Steal();
+		if(pJob){
+			return UniquePtr<Job>(pJob);
+		}
+	}
+	return nullptr;
+}
+bool ThreadPool::X_HasPendingJobs() const noexcept {
+	if(x_uInjectedCount.Load(kAtomicSeqCst) != 0){
+		return true;
+	}
+	for(const auto &pWorker : x_vecWorkers){
+		if(!pWorker->vDeque.IsEmpty()){
+			return true;
+		}
+	}
+	return false;
+}
+void ThreadPool::X_Notify() noexcept {
+	// 和 X_WorkerProc() 中休眠之前的检查配对。
+	AtomicFence(kAtomicSeqCst);
+	if(x_uSleeping.Load(kAtomicSeqCst) == 0){
+		return;
+	}
+	x_uEpoch.Increment(kAtomicSeqCst);
+	::_MCFCRT_WakeByAddressSingle(&x_uEpoch);
+}
+void ThreadPool::X_WorkerProc(Impl_ThreadPool::Worker *pWorker) noexcept {
+	SetCurrentWorker(pWorker);
+	unsigned uSpinsLeft = kSpinCount;
+	for(;;){
+		const auto pJob = X_FindJob(pWorker);
+		if(pJob){
+			(*pJob)();
+			uSpinsLeft = kSpinCount;
+			continue;
+		}
+		if(x_bStopping.Load(kAtomicAcquire)){
+			// 只有工作线程自己会向其队列中添加任务，所以这里不会遗留任何任务。
+			break;
+		}
+		if(uSpinsLeft != 0){
+			--uSpinsLeft;
+			AtomicPause();
+			continue;
+		}
+		x_uSleeping.Increment(kAtomicSeqCst);
+		const auto uEpoch = x_uEpoch.Load(kAtomicSeqCst);
+		if(!X_HasPendingJobs() && !x_bStopping.Load(kAtomicSeqCst)){
+			::_MCFCRT_WaitForAddressForever(&x_uEpoch, &uEpoch, sizeof(uEpoch));
+		}
+		x_uSleeping.Decrement(kAtomicSeqCst);
+		uSpinsLeft = kSpinCount;
+	}
+	SetCurrentWorker(nullptr);
+}
+void ThreadPool::X_StopAndJoin() noexcept {
+	x_bStopping.Store(true, kAtomicSeqCst);
+	x_uEpoch.Increment(kAtomicSeqCst);
+	::_MCFCRT_WakeByAddressAll(&x_uEpoch);
+	for(const auto &pWorker : x_vecWorkers){
+		if(pWorker->pThread){
+			pWorker->pThread->Wait();
+		}
+	}
+}
+
+std::size_t ThreadPool::GetCurrentWorkerIndex() const noexcept {
+	const auto pWorker = GetCurrentWorker();
+	if(!pWorker || (pWorker->pPool != this)){
+		return static_cast<std::size_t>(-1);
+	}
+	return pWorker->uIndex;
+}
+
+void ThreadPool::Submit(UniquePtr<Job> pJob){
+	MCF_DEBUG_CHECK(pJob);
+	MCF_DEBUG_CHECK_MSG(!x_bStopping.Load(kAtomicRelaxed), L"线程池正在被销毁。");
+
+	const auto pWorker = GetCurrentWorker();
+	if(pWorker && (pWorker->pPool == this)){
+		pWorker->vDeque.Push(pJob.Get());
+		pJob.Release();
+	} else {
+		auto vLock = x_mtxInjected.GetLock();
+		x_queInjected.Push(std::move(pJob));
+		x_uInjectedCount.Increment(kAtomicRelease);
+	}
+	X_Notify();
+}
+
+bool ThreadPool::RunOne() noexcept {
+	const auto pWorker = GetCurrentWorker();
+	const auto pJob = X_FindJob((pWorker && (pWorker->pPool == this)) ? pWorker : nullptr);
+	if(!pJob){
+		return false;
+	}
+	(*pJob)();
+	return true;
+}
+
+ThreadPool &GetDefaultThreadPool(){
+	// 在进程退出时等待工作线程可能导致死锁（例如在 DLL 被卸载时），因此这里故意不销毁它。
+	static ThreadPool *const s_pPool = new ThreadPool();
+	return *s_pPool;
+}
+
+}
@@ -0,0 +1,91 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#ifndef MCF_THREAD_THREAD_POOL_HPP_
+#define MCF_THREAD_THREAD_POOL_HPP_
+
+#include "Mutex.hpp"
+#include "../Core/Atomic.hpp"
+#include "../Function/Function.hpp"
+#include "../SmartPointers/UniquePtr.hpp"
+#include "../Containers/Vector.hpp"
+#include "../Containers/CircularQueue.hpp"
+#include <MCFCRT/env/cpu_topology.h>
+#include <type_traits>
+#include <utility>
+#include <cstddef>
+
+namespace MCF {
+
+namespace Impl_ThreadPool {
+	class Worker;
+	class WorkerThread;
+}
+
+// 工作窃取线程池。
+// 每个工作线程拥有一个 Chase-Lev 双端队列，从工作线程中提交的任务进入其自己的队列，空闲的工作线程从随机选择的其他队列中窃取任务。
+// 从其他线程中提交的任务进入一个公共队列。空闲的工作线程先自旋一段时间，然后休眠。
+// 任务不得抛出异常。析构函数等待所有已提交的任务执行完毕。
+class ThreadPool {
+	friend Impl_ThreadPool::WorkerThread;
+
+public:
+	using Job = Function<void ()>;
+
+private:
+	Vector<UniquePtr<Impl_ThreadPool::Worker>> x_vecWorkers;
+
+	Mutex x_mtxInjected;
+	CircularQueue<UniquePtr<Job>> x_queInjected;
+	Atomic<std::size_t> x_uInjectedCount;
+
+	// 事件计数。提交任务的线程递增此计数，然后唤醒一个正在休眠的工作线程。
+	Atomic<std::size_t> x_uEpoch;
+	Atomic<std::size_t> x_uSleeping;
+	Atomic<bool> x_bStopping;
+
+public:
+	// 如果 uWorkerCount 为零，则创建与处理器数目相同的工作线程；如果同时指定了 ePlacement，则创建与物理核心或 NUMA 节点数目相同的工作线程。
+	// 第 n 个工作线程按照 ePlacement 被固定到第 n 个物理核心或 NUMA 节点上。固定失败不影响线程池的运行。
+	explicit ThreadPool(std::size_t uWorkerCount = 0, ::_MCFCRT_ThreadPlacement ePlacement = ::_MCFCRT_kThreadPlacementNone);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+
+private:
+	UniquePtr<Job> X_PopInjected() noexcept;
+	UniquePtr<Job> X_FindJob(Impl_ThreadPool::Worker *pWorker) noexcept;
+	bool X_HasPendingJobs() const noexcept;
+	void X_Notify() noexcept;
+	void X_WorkerProc(Impl_ThreadPool::Worker *pWorker) noexcept;
+	void X_StopAndJoin() noexcept;
+
+public:
+	std::size_t GetWorkerCount() const noexcept {
+		return x_vecWorkers.GetSize();
+	}
+	// 如果当前线程是此线程池的工作线程，返回其序号；否则返回 -1。
+	std::size_t GetCurrentWorkerIndex() const noexcept;
+
+	void Submit(UniquePtr<Job> pJob);
+	template<typename FunctionT,
+		std::enable_if_t<
+			!std::is_convertible<FunctionT &&, UniquePtr<Job>>::value,
+			int> = 0>
+	void Submit(FunctionT &&vFunction){
+		Submit(UniquePtr<Job>(MakeFunction<void ()>(std::forward<FunctionT>(vFunction))));
+	}
+
+	// 在当前线程中执行一个待处理的任务。如果没有找到任务，返回 false。
+	// 等待其他任务完成的线程可以调用此函数以免浪费时间（并防止工作线程在等待子任务时死锁）。
+	bool RunOne() noexcept;
+};
+
+// 进程范围内共享的线程池，工作线程数目与处理器数目相同。此线程池在首次使用时创建，并且永远不会被销毁。
+extern ThreadPool &GetDefaultThreadPool();
+
+}
+
+#endif
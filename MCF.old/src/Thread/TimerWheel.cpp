@@ -0,0 +1,272 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#include "TimerWheel.hpp"
+#include "../Core/Assert.hpp"
+#include "../Core/Clocks.hpp"
+#include <MCFCRT/env/futex.h>
+
+namespace MCF {
+
+namespace Impl_TimerWheel {
+	class ExpiryThread final : public Thread {
+	private:
+		TimerWheel *const x_pOwner;
+
+	public:
+		explicit ExpiryThread(TimerWheel *pOwner)
+			: x_pOwner(pOwner)
+		{
+			X_Spawn(false);
+		}
+		~ExpiryThread() override;
+
+	protected:
+		void X_ThreadProc() const override {
+			x_pOwner->X_ThreadProc();
+		}
+	};
+
+	ExpiryThread::~ExpiryThread(){ }
+}
+
+TimerWheel::Timer::~Timer(){ }
+
+TimerWheel::TimerWheel(bool bStartExpiryThread)
+	: x_u64Current(GetFastMonoClock()), x_uPendingCount(0)
+	, x_uEpoch(0), x_bStopping(false), x_u64ThreadWakeTime(UINT64_MAX)
+{
+	for(auto &vHead : x_aRoot){
+		vHead.pPrev = &vHead;
+		vHead.pNext = &vHead;
+	}
+	for(auto &aLevel : x_aLevels){
+		for(auto &vHead : aLevel){
+			vHead.pPrev = &vHead;
+			vHead.pNext = &vHead;
+		}
+	}
+	if(bStartExpiryThread){
+		x_pExpiryThread = MakeIntrusive<Impl_TimerWheel::ExpiryThread>(this);
+	}
+}
+TimerWheel::~TimerWheel(){
+	if(x_pExpiryThread){
+		x_bStopping.Store(true, kAtomicRelease);
+		x_uEpoch.Increment(kAtomicRelease);
+		::_MCFCRT_WakeByAddressAll(&x_uEpoch);
+		x_pExpiryThread->Wait();
+	}
+
+	const auto fnDropAll = [&](Impl_TimerWheel::Link *pHead){
+		auto pLink = X_DetachAll(pHead);
+		while(pLink){
+			const auto pTimer = IntrusivePtr<Timer>(static_cast<Timer *>(pLink));
+			pLink = pLink->pNext;
+			pTimer->x_eState = Timer::kStateCancelled;
+		}
+	};
+	for(auto &vHead : x_aRoot){
+		fnDropAll(&vHead);
+	}
+	for(auto &aLevel : x_aLevels){
+		for(auto &vHead : aLevel){
+			fnDropAll(&vHead);
+		}
+	}
+}
+
+void TimerWheel::X_Unlink(Impl_TimerWheel::Link *pLink) noexcept {
+	pLink->pPrev->pNext = pLink->pNext;
+	pLink->pNext->pPrev = pLink->pPrev;
+	pLink->pPrev = nullptr;
+	pLink->pNext = nullptr;
+}
+Impl_TimerWheel::Link *TimerWheel::X_DetachAll(Impl_TimerWheel::Link *pHead) noexcept {
+	if(pHead->pNext == pHead){
+		return nullptr;
+	}
+	// 返回一个以 pNext 连接、以空指针结尾的单链表。
+	const auto pFirst = pHead->pNext;
+	pHead->pPrev->pNext = nullptr;
+	pHead->pPrev = pHead;
+	pHead->pNext = pHead;
+	return pFirst;
+}
+
+void TimerWheel::X_Insert(Timer *pTimer) noexcept {
+	auto u64DueTime = pTimer->x_u64DueTime;
+	if(u64DueTime < x_u64Current){
+		u64DueTime = x_u64Current;
+	}
+	const auto u64Delta = u64DueTime - x_u64Current;
+	Impl_TimerWheel::Link *pHead;
+	if(u64Delta < kRootSize){
+		pHead = &x_aRoot[u64DueTime & (kRootSize - 1)];
+	} else {
+		unsigned uLevel = 0;
+		unsigned uShift = kRootBits;
+		while((uLevel < kLevelCount - 1) && (u64Delta >= (1ull << (uShift + kLevelBits)))){
+			++uLevel;
+			uShift += kLevelBits;
+		}
+		const auto u64Limit = (1ull << (uShift + kLevelBits)) - 1;
+		if(u64Delta > u64Limit){
+			// 超出时间轮的范围，先放在最远的槽里，级联时再重新计算。
+			u64DueTime = x_u64Current + u64Limit;
+		}
+		pHead = &x_aLevels[uLevel][(u64DueTime >> uShift) & (kLevelSize - 1)];
+	}
+	Impl_TimerWheel::Link *const pLink = pTimer;
+	pLink->pPrev = pHead->pPrev;
+	pLink->pNext = pHead;
+	pHead->pPrev->pNext = pLink;
+	pHead->pPrev = pLink;
+}
+void TimerWheel::X_Cascade(unsigned uLevel) noexcept {
+	const auto uShift = kRootBits + uLevel * kLevelBits;
+	auto pLink = X_DetachAll(&x_aLevels[uLevel][(x_u64Current >> uShift) & (kLevelSize - 1)]);
+	while(pLink){
+		const auto pTimer = static_cast<Timer *>(pLink);
+		pLink = pLink->pNext;
+		X_Insert(pTimer);
+	}
+}
+std::uint64_t TimerWheel::X_GetNextWakeTime() const noexcept {
+	if(x_uPendingCount == 0){
+		return UINT64_MAX;
+	}
+	// 只扫描到下一次级联为止，那时可能会有定时器从上一层移下来。
+	const auto u64Boundary = (x_u64Current | (kRootSize - 1)) + 1;
+	for(auto u64Time = x_u64Current; u64Time < u64Boundary; ++u64Time){
+		const auto &vHead = x_aRoot[u64Time & (kRootSize - 1)];
+		if(vHead.pNext != &vHead){
+			return u64Time;
+		}
+	}
+	return u64Boundary;
+}
+void TimerWheel::X_ThreadProc() noexcept {
+	for(;;){
+		const auto uEpoch = x_uEpoch.Load(kAtomicAcquire);
+		if(x_bStopping.Load(kAtomicAcquire)){
+			break;
+		}
+		Pump(GetFastMonoClock());
+
+		std::uint64_t u64WakeTime;
+		{
+			const auto vLock = x_mtxGuard.GetLock();
+			u64WakeTime = X_GetNextWakeTime();
+			x_u64ThreadWakeTime = u64WakeTime;
+		}
+		if(u64WakeTime == UINT64_MAX){
+			::_MCFCRT_WaitForAddressForever(&x_uEpoch, &uEpoch, sizeof(uEpoch));
+		} else {
+			::_MCFCRT_WaitForAddress(&x_uEpoch, &uEpoch, sizeof(uEpoch), u64WakeTime);
+		}
+	}
+}
+
+std::size_t TimerWheel::GetPendingCount() const noexcept {
+	const auto vLock = x_mtxGuard.GetLock();
+	return x_uPendingCount;
+}
+std::uint64_t TimerWheel::GetNextWakeTime() const noexcept {
+	const auto vLock = x_mtxGuard.GetLock();
+	return X_GetNextWakeTime();
+}
+
+IntrusivePtr<TimerWheel::Timer> TimerWheel::Schedule(std::uint64_t u64DueTime, UniquePtr<Callback> pCallback){
+	MCF_DEBUG_CHECK(pCallback);
+
+	auto pTimer = MakeIntrusive<Timer>(u64DueTime, std::move(pCallback));
+	bool bWakeThread = false;
+	{
+		const auto vLock = x_mtxGuard.GetLock();
+		X_Insert(pTimer.Get());
+		// 这个引用由时间轮持有，在定时器到期或者被取消时释放。
+		pTimer->AddRef();
+		++x_uPendingCount;
+		if(x_pExpiryThread && (u64DueTime < x_u64ThreadWakeTime)){
+			x_u64ThreadWakeTime = u64DueTime;
+			x_uEpoch.Increment(kAtomicRelease);
+			bWakeThread = true;
+		}
+	}
+	if(bWakeThread){
+		::_MCFCRT_WakeByAddressSingle(&x_uEpoch);
+	}
+	return pTimer;
+}
+bool TimerWheel::Cancel(Timer *pTimer) noexcept {
+	MCF_DEBUG_CHECK(pTimer);
+
+	{
+		const auto vLock = x_mtxGuard.GetLock();
+		if(pTimer->x_eState != Timer::kStatePending){
+			return false;
+		}
+		X_Unlink(pTimer);
+		pTimer->x_eState = Timer::kStateCancelled;
+		--x_uPendingCount;
+	}
+	// 在锁外面释放时间轮持有的引用，因为这可能会销毁回调函数。
+	IntrusivePtr<Timer>(pTimer).Reset();
+	return true;
+}
+
+std::size_t TimerWheel::Pump(std::uint64_t u64Now) noexcept {
+	Impl_TimerWheel::Link *pExpiredFirst = nullptr;
+	Impl_TimerWheel::Link *pExpiredLast = nullptr;
+	{
+		const auto vLock = x_mtxGuard.GetLock();
+		while(x_u64Current <= u64Now){
+			if(x_uPendingCount == 0){
+				// 时间轮是空的，直接跳过中间所有的槽。
+				x_u64Current = u64Now + 1;
+				break;
+			}
+			const auto uRootIndex = static_cast<std::size_t>(x_u64Current & (kRootSize - 1));
+			if(uRootIndex == 0){
+				for(unsigned uLevel = 0; uLevel < kLevelCount; ++uLevel){
+					X_Cascade(uLevel);
+					if(((x_u64Current >> (kRootBits + uLevel * kLevelBits)) & (kLevelSize - 1)) != 0){
+						break;
+					}
+				}
+			}
+			auto pLink = X_DetachAll(&x_aRoot[uRootIndex]);
+			while(pLink){
+				const auto pTimer = static_cast<Timer *>(pLink);
+				pLink = pLink->pNext;
+				MCF_DEBUG_CHECK(pTimer->x_eState == Timer::kStatePending);
+				pTimer->x_eState = Timer::kStateFired;
+				--x_uPendingCount;
+
+				Impl_TimerWheel::Link *const pExpired = pTimer;
+				pExpired->pNext = nullptr;
+				if(pExpiredLast){
+					pExpiredLast->pNext = pExpired;
+				} else {
+					pExpiredFirst = pExpired;
+				}
+				pExpiredLast = pExpired;
+			}
+			++x_u64Current;
+		}
+	}
+
+	std::size_t uCount = 0;
+	auto pLink = pExpiredFirst;
+	while(pLink){
+		const auto pTimer = IntrusivePtr<Timer>(static_cast<Timer *>(pLink));
+		pLink = pLink->pNext;
+		(*(pTimer->x_pCallback))();
+		++uCount;
+	}
+	return uCount;
+}
+
+}
@@ -0,0 +1,136 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#ifndef MCF_THREAD_TIMER_WHEEL_HPP_
+#define MCF_THREAD_TIMER_WHEEL_HPP_
+
+#include "Mutex.hpp"
+#include "Thread.hpp"
+#include "../Core/Atomic.hpp"
+#include "../Function/Function.hpp"
+#include "../SmartPointers/UniquePtr.hpp"
+#include "../SmartPointers/IntrusivePtr.hpp"
+#include <type_traits>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+
+namespace MCF {
+
+namespace Impl_TimerWheel {
+	struct Link {
+		Link *pPrev;
+		Link *pNext;
+	};
+
+	class ExpiryThread;
+}
+
+// 分层时间轮，时间单位是 GetFastMonoClock() 的毫秒。
+// 第 0 层有 256 个槽，每个槽一毫秒；第 1 到 4 层各有 64 个槽，每个槽覆盖下一层的全部范围。超出约 49 天的定时器会被暂时放在最高层，到期前重新分配。
+// 添加和取消定时器都是 O(1) 的。到期的定时器在 Pump() 中、在不持有锁的情况下被调用。
+// 可以由调用者在自己的循环中调用 Pump()，也可以使用内部的到期线程。回调函数不得抛出异常。
+class TimerWheel {
+public:
+	using Callback = Function<void ()>;
+
+	class Timer : public IntrusiveBase<Timer>, private Impl_TimerWheel::Link {
+		friend TimerWheel;
+
+	private:
+		enum State {
+			kStatePending,
+			kStateFired,
+			kStateCancelled,
+		};
+
+	private:
+		std::uint64_t x_u64DueTime;
+		UniquePtr<Callback> x_pCallback;
+		State x_eState;
+
+	public:
+		Timer(std::uint64_t u64DueTime, UniquePtr<Callback> pCallback) noexcept
+			: Link(), x_u64DueTime(u64DueTime), x_pCallback(std::move(pCallback)), x_eState(kStatePending)
+		{ }
+		~Timer();
+
+	public:
+		std::uint64_t GetDueTime() const noexcept {
+			return x_u64DueTime;
+		}
+	};
+
+private:
+	enum : unsigned {
+		kRootBits  = 8,
+		kLevelBits = 6,
+		kLevelCount = 4,
+	};
+
+	static constexpr std::size_t kRootSize = 1u << kRootBits;
+	static constexpr std::size_t kLevelSize = 1u << kLevelBits;
+
+private:
+	mutable Mutex x_mtxGuard;
+	// 所有截止时间小于此值的定时器都已经被处理。
+	std::uint64_t x_u64Current;
+	std::size_t x_uPendingCount;
+	Impl_TimerWheel::Link x_aRoot[kRootSize];
+	Impl_TimerWheel::Link x_aLevels[kLevelCount][kLevelSize];
+
+	IntrusivePtr<Thread> x_pExpiryThread;
+	// 到期线程休眠时等待此值改变。
+	Atomic<std::size_t> x_uEpoch;
+	Atomic<bool> x_bStopping;
+	// 到期线程下一次醒来的时间，受 x_mtxGuard 保护。
+	std::uint64_t x_u64ThreadWakeTime;
+
+public:
+	// 如果 bStartExpiryThread 为 true，则创建一个线程调用 Pump()。否则调用者必须自己调用 Pump()。
+	explicit TimerWheel(bool bStartExpiryThread = false);
+	// 未到期的定时器被丢弃，其回调函数不会被调用。
+	~TimerWheel();
+
+	TimerWheel(const TimerWheel &) = delete;
+	TimerWheel &operator=(const TimerWheel &) = delete;
+
+private:
+	static void X_Unlink(Impl_TimerWheel::Link *pLink) noexcept;
+	static Impl_TimerWheel::Link *X_DetachAll(Impl_TimerWheel::Link *pHead) noexcept;
+
+	void X_Insert(Timer *pTimer) noexcept;
+	void X_Cascade(unsigned uLevel) noexcept;
+	std::uint64_t X_GetNextWakeTime() const noexcept;
+	void X_ThreadProc() noexcept;
+
+	friend Impl_TimerWheel::ExpiryThread;
+
+public:
+	std::size_t GetPendingCount() const noexcept;
+	// 返回下一次调用 Pump() 可能有定时器到期的时间。这个值可能早于实际的截止时间，但不会晚于它。如果没有定时器，返回 UINT64_MAX。
+	std::uint64_t GetNextWakeTime() const noexcept;
+
+	// 截止时间早于当前时间的定时器会在下一次 Pump() 中到期。
+	IntrusivePtr<Timer> Schedule(std::uint64_t u64DueTime, UniquePtr<Callback> pCallback);
+	template<typename FunctionT,
+		std::enable_if_t<
+			!std::is_convertible<FunctionT &&, UniquePtr<Callback>>::value,
+			int> = 0>
+	IntrusivePtr<Timer> Schedule(std::uint64_t u64DueTime, FunctionT &&vFunction){
+		return Schedule(u64DueTime, UniquePtr<Callback>(MakeFunction<void ()>(std::forward<FunctionT>(vFunction))));
+	}
+	// 如果定时器在到期之前被取消，返回 true；如果它已经到期或者已经被取消，返回 false。
+	bool Cancel(Timer *pTimer) noexcept;
+	bool Cancel(const IntrusivePtr<Timer> &pTimer) noexcept {
+		return Cancel(pTimer.Get());
+	}
+
+	// 处理截止时间不晚于 u64Now 的所有定时器，返回被调用的回调函数的数目。
+	std::size_t Pump(std::uint64_t u64Now) noexcept;
+};
+
+}
+
+#endif
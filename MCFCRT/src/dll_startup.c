@@ -5,6 +5,9 @@
 #include "mcfcrt.h"
 #include "env/_seh_top.h"
 #include "env/_fpu.h"
+#include "env/_heap_impl.h"
+#include "env/heap_profiler.h"
+#include "env/lock_profiler.h"
 
 __MCFCRT_C_STDCALL
 extern BOOL __MCFCRT_DllStartup(HINSTANCE hInstance, DWORD dwReason, LPVOID pReserved)
@@ -25,6 +28,9 @@ BOOL __MCFCRT_DllStartup(HINSTANCE hInstance, DWORD dwReason, LPVOID pReserved){
 			bRet = __MCFCRT_InitRecursive();
 			break;
 		case DLL_THREAD_DETACH:
+			__MCFCRT_HeapImplThreadCleanup();
+			__MCFCRT_HeapProfilerThreadCleanup();
+			__MCFCRT_LockProfilerThreadCleanup();
 			break;
 		case DLL_PROCESS_DETACH:
 			__MCFCRT_UninitRecursive();
@@ -0,0 +1,123 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#include "_cpu_features.h"
+#include "expect.h"
+#include <cpuid.h>
+
+// Bit 31 is set once the features have been detected. Detection is idempotent, hence no locking is required.
+#define FEATURES_VALID       0x80000000u
+
+static volatile uint32_t g_features = 0;
+// SIZE_MAX means the cache size has not been detected yet.
+static volatile size_t g_llc_size = SIZE_MAX;
+
+static uint64_t read_xcr0(void){
+	unsigned eax, edx;
+	__asm__ volatile ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((uint64_t)edx << 32) | eax;
+}
+
+static uint32_t detect_features(void){
+	uint32_t features = 0;
+	unsigned eax, ebx, ecx, edx;
+	const unsigned max_leaf = __get_cpuid_max(0, _MCFCRT_NULLPTR);
+	if(max_leaf < 1){
+		return features;
+	}
+	__cpuid(1, eax, ebx, ecx, edx);
+	// CPUID.01H:ECX[9] = SSSE3, CPUID.01H:ECX[20] = SSE4.2
+	if((ecx >> 9) & 1){
+		features |= __MCFCRT_kCpuFeatureSsse3;
+	}
+	if((ecx >> 20) & 1){
+		features |= __MCFCRT_kCpuFeatureSse42;
+	}
+	// YMM and ZMM registers can only be used if the operating system saves them on context switches.
+	// CPUID.01H:ECX[27] = OSXSAVE, XCR0[2:1] = SSE and AVX states, XCR0[7:5] = opmask and ZMM states
+	bool ymm_enabled = false, zmm_enabled = false;
+	if((ecx >> 27) & 1){
+		const uint64_t xcr0 = read_xcr0();
+		ymm_enabled = (xcr0 & 0x06) == 0x06;
+		zmm_enabled = ymm_enabled && ((xcr0 & 0xE0) == 0xE0);
+	}
+	// CPUID.01H:ECX[28] = AVX
+	if(ymm_enabled && ((ecx >> 28) & 1)){
+		features |= __MCFCRT_kCpuFeatureAvx;
+	}
+	if(max_leaf < 7){
+		return features;
+	}
+	__cpuid_count(7, 0, eax, ebx, ecx, edx);
+	// CPUID.(EAX=07H,ECX=0):EBX[5] = AVX2, EBX[8] = BMI2, EBX[9] = ERMS, EBX[16] = AVX512F, EBX[30] = AVX512BW, EDX[4] = FSRM
+	if(ymm_enabled && ((ebx >> 5) & 1)){
+		features |= __MCFCRT_kCpuFeatureAvx2;
+	}
+	if((ebx >> 8) & 1){
+		features |= __MCFCRT_kCpuFeatureBmi2;
+	}
+	if((ebx >> 9) & 1){
+		features |= __MCFCRT_kCpuFeatureErms;
+	}
+	if(zmm_enabled && ((ebx >> 16) & 1)){
+		features |= __MCFCRT_kCpuFeatureAvx512f;
+	}
+	if(zmm_enabled && ((ebx >> 16) & 1) && ((ebx >> 30) & 1)){
+		features |= __MCFCRT_kCpuFeatureAvx512bw;
+	}
+	if((edx >> 4) & 1){
+		features |= __MCFCRT_kCpuFeatureFsrm;
+	}
+	return features;
+}
+
+uint32_t __MCFCRT_GetCpuFeatures(void){
+	uint32_t features = __atomic_load_n(&g_features, __ATOMIC_RELAXED);
+	if(_MCFCRT_EXPECT_NOT(!(features & FEATURES_VALID))){
+		features = detect_features() | FEATURES_VALID;
+		__atomic_store_n(&g_features, features, __ATOMIC_RELAXED);
+	}
+	return features & ~FEATURES_VALID;
+}
+
+static size_t detect_llc_size(void){
+	size_t llc_size = 0;
+	unsigned eax, ebx, ecx, edx;
+	// Intel: CPUID.04H enumerates deterministic cache parameters, one cache per subleaf.
+	if(__get_cpuid_max(0, _MCFCRT_NULLPTR) >= 4){
+		for(unsigned subleaf = 0; subleaf < 16; ++subleaf){
+			__cpuid_count(4, subleaf, eax, ebx, ecx, edx);
+			// EAX[4:0] = cache type, where zero means there are no more caches
+			if((eax & 0x1F) == 0){
+				break;
+			}
+			// size = ways * partitions * line size * sets
+			const size_t size = (size_t)((ebx >> 22) + 1) * (((ebx >> 12) & 0x3FF) + 1) * ((ebx & 0xFFF) + 1) * (ecx + 1u);
+			if(llc_size < size){
+				llc_size = size;
+			}
+		}
+	}
+	if(llc_size != 0){
+		return llc_size;
+	}
+	// AMD: CPUID.80000006H:ECX[31:16] = L2 size in KiB, EDX[31:18] = L3 size in 512 KiB units
+	if(__get_cpuid_max(0x80000000u, _MCFCRT_NULLPTR) >= 0x80000006u){
+		__cpuid(0x80000006u, eax, ebx, ecx, edx);
+		llc_size = (size_t)(edx >> 18) * 0x80000;
+		if(llc_size == 0){
+			llc_size = (size_t)(ecx >> 16) * 0x400;
+		}
+	}
+	return llc_size;
+}
+
+size_t __MCFCRT_GetLastLevelCacheSize(void){
+	size_t llc_size = __atomic_load_n(&g_llc_size, __ATOMIC_RELAXED);
+	if(_MCFCRT_EXPECT_NOT(llc_size == SIZE_MAX)){
+		llc_size = detect_llc_size();
+		__atomic_store_n(&g_llc_size, llc_size, __ATOMIC_RELAXED);
+	}
+	return llc_size;
+}
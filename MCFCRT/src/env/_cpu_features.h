@@ -0,0 +1,37 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#ifndef __MCFCRT_ENV_CPU_FEATURES_H_
+#define __MCFCRT_ENV_CPU_FEATURES_H_
+
+#include "_crtdef.h"
+
+_MCFCRT_EXTERN_C_BEGIN
+
+// A bit is set only if the instruction set is supported by both the processor and the operating system.
+// SSE2 is always available and is not listed here.
+typedef enum __MCFCRT_tagCpuFeature {
+	__MCFCRT_kCpuFeatureSsse3    = 0x0001,
+	__MCFCRT_kCpuFeatureSse42    = 0x0002,
+	__MCFCRT_kCpuFeatureAvx      = 0x0004,
+	__MCFCRT_kCpuFeatureAvx2     = 0x0008,
+	__MCFCRT_kCpuFeatureBmi2     = 0x0010,
+	__MCFCRT_kCpuFeatureErms     = 0x0020,
+	__MCFCRT_kCpuFeatureAvx512f  = 0x0040,
+	__MCFCRT_kCpuFeatureAvx512bw = 0x0080,
+	__MCFCRT_kCpuFeatureFsrm     = 0x0100,
+} __MCFCRT_CpuFeature;
+
+// This function may be called at any time, even before the CRT has been initialized.
+// The result is computed upon the first call and cached afterwards.
+__attribute__((__pure__))
+extern _MCFCRT_STD uint32_t __MCFCRT_GetCpuFeatures(void) _MCFCRT_NOEXCEPT;
+// This function returns the size of the largest cache in bytes as reported by CPUID, or zero if it is unknown.
+// Like the function above, it neither allocates memory nor takes any locks, so it can be used by `memcpy()`.
+__attribute__((__pure__))
+extern _MCFCRT_STD size_t __MCFCRT_GetLastLevelCacheSize(void) _MCFCRT_NOEXCEPT;
+
+_MCFCRT_EXTERN_C_END
+
+#endif
@@ -0,0 +1,664 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#include "_heap_impl.h"
+#include "mcfwin.h"
+#include "mutex.h"
+#include "inline_mem.h"
+#include "xassert.h"
+#include "expect.h"
+
+#define PAGE_GRANULARITY          ((size_t)0x1000)
+// This is the allocation granularity of `VirtualAlloc()`. Regions returned by it are always aligned to this boundary.
+#define SPAN_SIZE                 ((size_t)0x10000)
+#define HEADER_SIZE               ((size_t)64)
+
+#define SMALL_SIZE_MAX            ((size_t)__MCFCRT_HEAP_IMPL_SMALL_SIZE_MAX)
+#define CLASS_COUNT               ((size_t)36)
+
+#define SIGNATURE_SMALL_SPAN      ((uintptr_t)0x4C414D53)
+#define SIGNATURE_LARGE_BLOCK     ((uintptr_t)0x4752414C)
+
+#define CACHE_LIMIT_MULTIPLIER    ((size_t)4)
+#define SPAN_POOL_SIZE_MAX        ((size_t)64)
+#define LARGE_CACHE_SIZE          ((size_t)16)
+#define LARGE_CACHE_RESERVED_MAX  ((size_t)0x100000)
+
+// When a large block is moved by reallocation, this many times of its new size is reserved, so it can grow in place later.
+#ifdef _WIN64
+#  define GROWTH_RESERVE_MULTIPLIER ((size_t)8)
+#else
+#  define GROWTH_RESERVE_MULTIPLIER ((size_t)2)
+#endif
+
+static inline size_t Min(size_t uSelf, size_t uOther){
+	return (uSelf <= uOther) ? uSelf : uOther;
+}
+static inline size_t RoundUp(size_t uSize, size_t uAlignment){
+	return (uSize + uAlignment - 1) & ~(uAlignment - 1);
+}
+
+// Sizes no larger than 256 bytes are rounded up to multiples of 16 bytes. Each power of two beyond that is split into 4 classes.
+// This yields at most 25% of internal fragmentation and 36 classes up to `SMALL_SIZE_MAX`.
+static inline size_t GetClassFromSize(size_t uSize){
+	_MCFCRT_ASSERT(uSize <= SMALL_SIZE_MAX);
+	if(uSize <= 256){
+		return (uSize - (uSize != 0)) / 16;
+	}
+	const unsigned long long ullIndex = uSize - 1;
+	const unsigned uMsb = 63u - (unsigned)__builtin_clzll(ullIndex);
+	return 16 + (uMsb - 8) * 4 + (size_t)((ullIndex >> (uMsb - 2)) & 3);
+}
+static inline size_t GetSizeOfClass(size_t uClass){
+	_MCFCRT_ASSERT(uClass < CLASS_COUNT);
+	if(uClass < 16){
+		return (uClass + 1) * 16;
+	}
+	return ((uClass - 16) % 4 + 5) << ((uClass - 16) / 4 + 6);
+}
+// This is the number of blocks that are moved between a thread cache and the central list at a time.
+static inline size_t GetBatchCountOfClass(size_t uClass){
+	const size_t uCount = 0x4000 / GetSizeOfClass(uClass);
+	return (uCount < 2) ? 2 : ((uCount > 64) ? 64 : uCount);
+}
+
+typedef struct tagFreeBlock {
+	struct tagFreeBlock *pNext;
+} FreeBlock;
+
+// Each small span is a 64KiB region that is aligned to a 64KiB boundary and holds blocks of the same class.
+// Its header can be located by masking off the low bits of the address of any block in it.
+typedef struct tagSmallSpan {
+	uintptr_t uSignature;
+	size_t uClass;
+	size_t uBlocksInUse; // This includes blocks in thread caches.
+	FreeBlock *pFreeList;
+	unsigned char *pbyUnused; // This points to the first block that has never been allocated, or is a null pointer if there are none.
+
+	struct tagSmallSpan *pPrev; // Spans that have blocks available are linked into the central list of their class.
+	struct tagSmallSpan *pNext;
+} SmallSpan;
+
+static_assert(sizeof(SmallSpan) <= HEADER_SIZE, "??");
+
+// Each large block is a region mapped directly from the system, which begins with this header.
+typedef struct tagLargeBlock {
+	uintptr_t uSignature;
+	size_t uSize;      // This is the number of bytes requested.
+	size_t uCommitted; // This is the number of bytes committed, including the header.
+	size_t uReserved;  // This is the number of bytes reserved, including the header.
+} LargeBlock;
+
+static_assert(sizeof(LargeBlock) <= HEADER_SIZE, "??");
+
+static inline void *GetRegionBase(const void *pBlock){
+	return (void *)((uintptr_t)pBlock & ~(uintptr_t)(SPAN_SIZE - 1));
+}
+
+//-----------------------------------------------------------------------------
+// Span pool
+//-----------------------------------------------------------------------------
+
+static _MCFCRT_Mutex g_mtxSpanPool      = { 0 };
+static SmallSpan *   g_pSpanPool        = _MCFCRT_NULLPTR;
+static size_t        g_uSpanPoolSize    = 0;
+
+static SmallSpan *AllocateSpan(size_t uClass){
+	SmallSpan *pSpan;
+	_MCFCRT_WaitForMutexForever(&g_mtxSpanPool, _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+	{
+		pSpan = g_pSpanPool;
+		if(pSpan){
+			g_pSpanPool = pSpan->pNext;
+			--g_uSpanPoolSize;
+		}
+	}
+	_MCFCRT_SignalMutex(&g_mtxSpanPool);
+	if(!pSpan){
+		pSpan = VirtualAlloc(_MCFCRT_NULLPTR, SPAN_SIZE, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+		if(!pSpan){
+			return _MCFCRT_NULLPTR;
+		}
+		_MCFCRT_ASSERT(GetRegionBase(pSpan) == pSpan);
+	}
+	pSpan->uSignature   = SIGNATURE_SMALL_SPAN;
+	pSpan->uClass       = uClass;
+	pSpan->uBlocksInUse = 0;
+	pSpan->pFreeList    = _MCFCRT_NULLPTR;
+	pSpan->pbyUnused    = (unsigned char *)pSpan + HEADER_SIZE;
+	pSpan->pPrev        = _MCFCRT_NULLPTR;
+	pSpan->pNext        = _MCFCRT_NULLPTR;
+	return pSpan;
+}
+static void DeallocateSpan(SmallSpan *pSpan){
+	_MCFCRT_ASSERT(pSpan->uBlocksInUse == 0);
+	pSpan->uSignature = 0;
+
+	bool bPooled = false;
+	_MCFCRT_WaitForMutexForever(&g_mtxSpanPool, _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+	{
+		if(g_uSpanPoolSize < SPAN_POOL_SIZE_MAX){
+			pSpan->pNext = g_pSpanPool;
+			g_pSpanPool = pSpan;
+			++g_uSpanPoolSize;
+			bPooled = true;
+		}
+	}
+	_MCFCRT_SignalMutex(&g_mtxSpanPool);
+	if(!bPooled){
+		const bool bSucceeded = VirtualFree(pSpan, 0, MEM_RELEASE);
+		_MCFCRT_ASSERT(bSucceeded);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Central lists
+//-----------------------------------------------------------------------------
+
+typedef struct tagCentralList {
+	alignas(64) _MCFCRT_Mutex vMutex;
+	SmallSpan *pFirst;
+} CentralList;
+
+static CentralList g_aCentralLists[CLASS_COUNT];
+
+static inline bool IsSpanExhausted(const SmallSpan *pSpan){
+	return !(pSpan->pFreeList) && !(pSpan->pbyUnused);
+}
+// The caller must have the central mutex locked!
+static inline void LinkSpanUnsafe(CentralList *restrict pList, SmallSpan *restrict pSpan){
+	SmallSpan *const pNext = pList->pFirst;
+	pSpan->pPrev = _MCFCRT_NULLPTR;
+	pSpan->pNext = pNext;
+	if(pNext){
+		pNext->pPrev = pSpan;
+	}
+	pList->pFirst = pSpan;
+}
+static inline void UnlinkSpanUnsafe(CentralList *restrict pList, SmallSpan *restrict pSpan){
+	SmallSpan *const pPrev = pSpan->pPrev;
+	SmallSpan *const pNext = pSpan->pNext;
+	if(pPrev){
+		pPrev->pNext = pNext;
+	} else {
+		pList->pFirst = pNext;
+	}
+	if(pNext){
+		pNext->pPrev = pPrev;
+	}
+}
+
+// This function takes at most `uMaxCount` blocks from the central list of `uClass` and returns the number of blocks taken.
+// Blocks taken are linked into a singly linked list, whose head is stored into `*ppHead`.
+static size_t FetchBlocksFromCentral(FreeBlock **restrict ppHead, size_t uClass, size_t uMaxCount){
+	CentralList *const pList = g_aCentralLists + uClass;
+	const size_t uBlockSize = GetSizeOfClass(uClass);
+
+	FreeBlock *pHead = _MCFCRT_NULLPTR;
+	size_t uCount = 0;
+	_MCFCRT_WaitForMutexForever(&(pList->vMutex), _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+	{
+		while(uCount < uMaxCount){
+			SmallSpan *pSpan = pList->pFirst;
+			if(!pSpan){
+				pSpan = AllocateSpan(uClass);
+				if(!pSpan){
+					break;
+				}
+				LinkSpanUnsafe(pList, pSpan);
+			}
+			do {
+				FreeBlock *pBlock = pSpan->pFreeList;
+				if(pBlock){
+					pSpan->pFreeList = pBlock->pNext;
+				} else {
+					unsigned char *const pbyUnused = pSpan->pbyUnused;
+					_MCFCRT_ASSERT(pbyUnused);
+					pBlock = (FreeBlock *)pbyUnused;
+					pSpan->pbyUnused = (pbyUnused + uBlockSize * 2 <= (unsigned char *)pSpan + SPAN_SIZE) ? (pbyUnused + uBlockSize) : _MCFCRT_NULLPTR;
+				}
+				++(pSpan->uBlocksInUse);
+				pBlock->pNext = pHead;
+				pHead = pBlock;
+				++uCount;
+			} while((uCount < uMaxCount) && !IsSpanExhausted(pSpan));
+			if(IsSpanExhausted(pSpan)){
+				UnlinkSpanUnsafe(pList, pSpan);
+			}
+		}
+	}
+	_MCFCRT_SignalMutex(&(pList->vMutex));
+
+	*ppHead = pHead;
+	return uCount;
+}
+// This function puts all blocks in the singly linked list `pHead` back into their spans.
+// A span that becomes completely free is released unless it is the only one in the central list.
+static void ReturnBlocksToCentral(size_t uClass, FreeBlock *pHead){
+	CentralList *const pList = g_aCentralLists + uClass;
+
+	SmallSpan *pSpansToFree = _MCFCRT_NULLPTR;
+	_MCFCRT_WaitForMutexForever(&(pList->vMutex), _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+	{
+		while(pHead){
+			FreeBlock *const pBlock = pHead;
+			pHead = pBlock->pNext;
+
+			SmallSpan *const pSpan = GetRegionBase(pBlock);
+			_MCFCRT_ASSERT(pSpan->uSignature == SIGNATURE_SMALL_SPAN);
+			_MCFCRT_ASSERT(pSpan->uClass == uClass);
+			const bool bWasExhausted = IsSpanExhausted(pSpan);
+			pBlock->pNext = pSpan->pFreeList;
+			pSpan->pFreeList = pBlock;
+			_MCFCRT_ASSERT(pSpan->uBlocksInUse > 0);
+			--(pSpan->uBlocksInUse);
+			if(bWasExhausted){
+				LinkSpanUnsafe(pList, pSpan);
+			} else if((pSpan->uBlocksInUse == 0) && (pSpan->pPrev || pSpan->pNext)){
+				UnlinkSpanUnsafe(pList, pSpan);
+				pSpan->pNext = pSpansToFree;
+				pSpansToFree = pSpan;
+			}
+		}
+	}
+	_MCFCRT_SignalMutex(&(pList->vMutex));
+
+	while(pSpansToFree){
+		SmallSpan *const pSpan = pSpansToFree;
+		pSpansToFree = pSpan->pNext;
+		DeallocateSpan(pSpan);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Thread caches
+//-----------------------------------------------------------------------------
+
+typedef struct tagThreadCache {
+	FreeBlock *apHeads[CLASS_COUNT];
+	size_t auCounts[CLASS_COUNT];
+} ThreadCache;
+
+static_assert(sizeof(ThreadCache) <= SMALL_SIZE_MAX, "??");
+
+// Once a thread has been cleaned up, its TLS slot is set to this value, so no cache will be created for it again.
+#define THREAD_CACHE_DEAD         ((ThreadCache *)(uintptr_t)1)
+
+static volatile DWORD g_dwTlsIndex = TLS_OUT_OF_INDEXES;
+
+static ThreadCache *GetThreadCache(void){
+	const DWORD dwTlsIndex = __atomic_load_n(&g_dwTlsIndex, __ATOMIC_RELAXED);
+	if(_MCFCRT_EXPECT_NOT(dwTlsIndex == TLS_OUT_OF_INDEXES)){
+		return _MCFCRT_NULLPTR;
+	}
+	// `TlsGetValue()` clobbers the last error code, which we must preserve.
+	const DWORD dwLastError = GetLastError();
+	ThreadCache *pCache = TlsGetValue(dwTlsIndex);
+	if(_MCFCRT_EXPECT_NOT(!pCache)){
+		FreeBlock *pBlock;
+		const size_t uClass = GetClassFromSize(sizeof(ThreadCache));
+		if(FetchBlocksFromCentral(&pBlock, uClass, 1) != 0){
+			pCache = (ThreadCache *)pBlock;
+			_MCFCRT_inline_mempset_fwd(pCache, 0, sizeof(ThreadCache));
+			if(!TlsSetValue(dwTlsIndex, pCache)){
+				pBlock->pNext = _MCFCRT_NULLPTR;
+				ReturnBlocksToCentral(uClass, pBlock);
+				pCache = _MCFCRT_NULLPTR;
+			}
+		}
+	}
+	SetLastError(dwLastError);
+	if(_MCFCRT_EXPECT_NOT(pCache == THREAD_CACHE_DEAD)){
+		return _MCFCRT_NULLPTR;
+	}
+	return pCache;
+}
+
+static void *AllocateSmall(size_t uClass){
+	FreeBlock *pBlock;
+	ThreadCache *const pCache = GetThreadCache();
+	if(_MCFCRT_EXPECT(pCache)){
+		pBlock = pCache->apHeads[uClass];
+		if(_MCFCRT_EXPECT_NOT(!pBlock)){
+			const size_t uCount = FetchBlocksFromCentral(&pBlock, uClass, GetBatchCountOfClass(uClass));
+			if(uCount == 0){
+				return _MCFCRT_NULLPTR;
+			}
+			pCache->auCounts[uClass] = uCount;
+		}
+		pCache->apHeads[uClass] = pBlock->pNext;
+		--(pCache->auCounts[uClass]);
+	} else {
+		if(FetchBlocksFromCentral(&pBlock, uClass, 1) == 0){
+			return _MCFCRT_NULLPTR;
+		}
+	}
+	return pBlock;
+}
+static void DeallocateSmall(FreeBlock *pBlock, size_t uClass){
+	ThreadCache *const pCache = GetThreadCache();
+	if(_MCFCRT_EXPECT(pCache)){
+		pBlock->pNext = pCache->apHeads[uClass];
+		pCache->apHeads[uClass] = pBlock;
+		const size_t uCount = ++(pCache->auCounts[uClass]);
+		const size_t uBatchCount = GetBatchCountOfClass(uClass);
+		if(_MCFCRT_EXPECT_NOT(uCount > uBatchCount * CACHE_LIMIT_MULTIPLIER)){
+			// Keep the most recently freed blocks, which are likely to be hot in the CPU cache, and return the others.
+			const size_t uCountToKeep = uBatchCount * (CACHE_LIMIT_MULTIPLIER / 2);
+			FreeBlock *pLastToKeep = pBlock;
+			for(size_t uIndex = 1; uIndex < uCountToKeep; ++uIndex){
+				pLastToKeep = pLastToKeep->pNext;
+			}
+			FreeBlock *const pFirstToReturn = pLastToKeep->pNext;
+			pLastToKeep->pNext = _MCFCRT_NULLPTR;
+			pCache->auCounts[uClass] = uCountToKeep;
+			ReturnBlocksToCentral(uClass, pFirstToReturn);
+		}
+	} else {
+		pBlock->pNext = _MCFCRT_NULLPTR;
+		ReturnBlocksToCentral(uClass, pBlock);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Large blocks
+//-----------------------------------------------------------------------------
+
+// Regions of freed large blocks are kept here for reuse, which saves a number of system calls for blocks of moderate sizes.
+static _MCFCRT_Mutex g_mtxLargeCache                      = { 0 };
+static LargeBlock *  g_apLargeCache[LARGE_CACHE_SIZE]     = { 0 };
+
+static LargeBlock *TakeLargeBlockFromCache(size_t uToReserve){
+	LargeBlock *pLarge = _MCFCRT_NULLPTR;
+	_MCFCRT_WaitForMutexForever(&g_mtxLargeCache, _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+	{
+		size_t uBestIndex = LARGE_CACHE_SIZE;
+		for(size_t uIndex = 0; uIndex < LARGE_CACHE_SIZE; ++uIndex){
+			LargeBlock *const pCandidate = g_apLargeCache[uIndex];
+			if(!pCandidate){
+				continue;
+			}
+			// Don't waste more than half of the region.
+			if((pCandidate->uReserved < uToReserve) || (pCandidate->uReserved / 2 > uToReserve)){
+				continue;
+			}
+			if(pLarge && (pLarge->uReserved <= pCandidate->uReserved)){
+				continue;
+			}
+			pLarge = pCandidate;
+			uBestIndex = uIndex;
+		}
+		if(pLarge){
+			g_apLargeCache[uBestIndex] = _MCFCRT_NULLPTR;
+		}
+	}
+	_MCFCRT_SignalMutex(&g_mtxLargeCache);
+	return pLarge;
+}
+static bool PutLargeBlockIntoCache(LargeBlock *pLarge){
+	bool bPooled = false;
+	_MCFCRT_WaitForMutexForever(&g_mtxLargeCache, _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+	{
+		for(size_t uIndex = 0; uIndex < LARGE_CACHE_SIZE; ++uIndex){
+			if(g_apLargeCache[uIndex]){
+				continue;
+			}
+			g_apLargeCache[uIndex] = pLarge;
+			bPooled = true;
+			break;
+		}
+	}
+	_MCFCRT_SignalMutex(&g_mtxLargeCache);
+	return bPooled;
+}
+
+// If `bGrowable` is `true`, additional address space is reserved after the block, where it can be extended later by committing more pages.
+static LargeBlock *AllocateLarge(size_t uSize, bool bFillsWithZero, bool bGrowable){
+	size_t uSizeTotal;
+	if(__builtin_add_overflow(uSize, HEADER_SIZE + SPAN_SIZE, &uSizeTotal)){
+		SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+		return _MCFCRT_NULLPTR;
+	}
+	const size_t uToCommit = RoundUp(uSize + HEADER_SIZE, PAGE_GRANULARITY);
+	const size_t uToReserve = RoundUp(uToCommit, SPAN_SIZE);
+
+	LargeBlock *pLarge = _MCFCRT_NULLPTR;
+	if(bGrowable){
+		size_t uToReserveGrowable;
+		if(!__builtin_mul_overflow(uToReserve, GROWTH_RESERVE_MULTIPLIER, &uToReserveGrowable)){
+			// This is merely an optimization. Fall back to the exact size if address space is running out.
+			pLarge = VirtualAlloc(_MCFCRT_NULLPTR, uToReserveGrowable, MEM_RESERVE, PAGE_NOACCESS);
+			if(pLarge){
+				_MCFCRT_ASSERT(GetRegionBase(pLarge) == pLarge);
+				if(VirtualAlloc(pLarge, uToCommit, MEM_COMMIT, PAGE_READWRITE)){
+					pLarge->uSignature = SIGNATURE_LARGE_BLOCK;
+					pLarge->uCommitted = uToCommit;
+					pLarge->uReserved  = uToReserveGrowable;
+				} else {
+					// Give the address space back and retry with the exact size below.
+					const bool bSucceeded = VirtualFree(pLarge, 0, MEM_RELEASE);
+					_MCFCRT_ASSERT(bSucceeded);
+					pLarge = _MCFCRT_NULLPTR;
+				}
+			}
+		}
+	} else if(uToReserve <= LARGE_CACHE_RESERVED_MAX){
+		pLarge = TakeLargeBlockFromCache(uToReserve);
+		if(pLarge){
+			const size_t uCommittedOld = pLarge->uCommitted;
+			if(uCommittedOld < uToCommit){
+				if(!VirtualAlloc((unsigned char *)pLarge + uCommittedOld, uToCommit - uCommittedOld, MEM_COMMIT, PAGE_READWRITE)){
+					const bool bSucceeded = VirtualFree(pLarge, 0, MEM_RELEASE);
+					_MCFCRT_ASSERT(bSucceeded);
+					return _MCFCRT_NULLPTR;
+				}
+				pLarge->uCommitted = uToCommit;
+			}
+			if(bFillsWithZero){
+				// Pages that have just been committed are zeroed by the system.
+				_MCFCRT_inline_mempset_fwd((unsigned char *)pLarge + HEADER_SIZE, 0, Min(uSize, uCommittedOld - HEADER_SIZE));
+			}
+		}
+	}
+	if(!pLarge){
+		pLarge = VirtualAlloc(_MCFCRT_NULLPTR, uToReserve, MEM_RESERVE, PAGE_NOACCESS);
+		if(!pLarge){
+			return _MCFCRT_NULLPTR;
+		}
+		_MCFCRT_ASSERT(GetRegionBase(pLarge) == pLarge);
+		if(!VirtualAlloc(pLarge, uToCommit, MEM_COMMIT, PAGE_READWRITE)){
+			const bool bSucceeded = VirtualFree(pLarge, 0, MEM_RELEASE);
+			_MCFCRT_ASSERT(bSucceeded);
+			return _MCFCRT_NULLPTR;
+		}
+		pLarge->uSignature = SIGNATURE_LARGE_BLOCK;
+		pLarge->uCommitted = uToCommit;
+		pLarge->uReserved  = uToReserve;
+	}
+	pLarge->uSize = uSize;
+	return pLarge;
+}
+static bool ResizeLargeInPlace(LargeBlock *pLarge, size_t uSize, bool bFillsWithZero){
+	size_t uSizeTotal;
+	if(__builtin_add_overflow(uSize, HEADER_SIZE + PAGE_GRANULARITY, &uSizeTotal)){
+		return false;
+	}
+	const size_t uToCommit = RoundUp(uSize + HEADER_SIZE, PAGE_GRANULARITY);
+	if(uToCommit > pLarge->uReserved){
+		return false;
+	}
+	const size_t uCommittedOld = pLarge->uCommitted;
+	if(uCommittedOld < uToCommit){
+		if(!VirtualAlloc((unsigned char *)pLarge + uCommittedOld, uToCommit - uCommittedOld, MEM_COMMIT, PAGE_READWRITE)){
+			return false;
+		}
+		pLarge->uCommitted = uToCommit;
+	} else if(uToCommit <= uCommittedOld / 2){
+		// Give pages back to the system only if the block has shrunk significantly, so we don't bounce around the boundary.
+		const bool bSucceeded = VirtualFree((unsigned char *)pLarge + uToCommit, uCommittedOld - uToCommit, MEM_DECOMMIT);
+		_MCFCRT_ASSERT(bSucceeded);
+		pLarge->uCommitted = uToCommit;
+	}
+	const size_t uSizeOld = pLarge->uSize;
+	if(bFillsWithZero && (uSizeOld < uSize)){
+		// Pages that have just been committed are zeroed by the system.
+		const size_t uDirtyEnd = Min(uSize, uCommittedOld - HEADER_SIZE);
+		if(uSizeOld < uDirtyEnd){
+			_MCFCRT_inline_mempset_fwd((unsigned char *)pLarge + HEADER_SIZE + uSizeOld, 0, uDirtyEnd - uSizeOld);
+		}
+	}
+	pLarge->uSize = uSize;
+	return true;
+}
+static void DeallocateLarge(LargeBlock *pLarge){
+	if((pLarge->uReserved <= LARGE_CACHE_RESERVED_MAX) && PutLargeBlockIntoCache(pLarge)){
+		return;
+	}
+	const bool bSucceeded = VirtualFree(pLarge, 0, MEM_RELEASE);
+	_MCFCRT_ASSERT(bSucceeded);
+}
+
+//-----------------------------------------------------------------------------
+// Public interfaces
+//-----------------------------------------------------------------------------
+
+bool __MCFCRT_HeapImplInit(void){
+	const DWORD dwTlsIndex = TlsAlloc();
+	if(dwTlsIndex == TLS_OUT_OF_INDEXES){
+		return false;
+	}
+	__atomic_store_n(&g_dwTlsIndex, dwTlsIndex, __ATOMIC_RELAXED);
+	return true;
+}
+void __MCFCRT_HeapImplUninit(void){
+	// Caches of threads that are still running are abandoned. Blocks in them will be reclaimed by the system.
+	const DWORD dwTlsIndex = __atomic_exchange_n(&g_dwTlsIndex, TLS_OUT_OF_INDEXES, __ATOMIC_RELAXED);
+	if(dwTlsIndex == TLS_OUT_OF_INDEXES){
+		return;
+	}
+	const bool bSucceeded = TlsFree(dwTlsIndex);
+	_MCFCRT_ASSERT(bSucceeded);
+}
+
+void __MCFCRT_HeapImplThreadCleanup(void){
+	const DWORD dwTlsIndex = __atomic_load_n(&g_dwTlsIndex, __ATOMIC_RELAXED);
+	if(dwTlsIndex == TLS_OUT_OF_INDEXES){
+		return;
+	}
+	const DWORD dwLastError = GetLastError();
+	ThreadCache *const pCache = TlsGetValue(dwTlsIndex);
+	TlsSetValue(dwTlsIndex, THREAD_CACHE_DEAD);
+	SetLastError(dwLastError);
+	if(!pCache || (pCache == THREAD_CACHE_DEAD)){
+		return;
+	}
+
+	for(size_t uClass = 0; uClass < CLASS_COUNT; ++uClass){
+		FreeBlock *const pHead = pCache->apHeads[uClass];
+		if(!pHead){
+			continue;
+		}
+		ReturnBlocksToCentral(uClass, pHead);
+	}
+	FreeBlock *const pBlock = (FreeBlock *)pCache;
+	pBlock->pNext = _MCFCRT_NULLPTR;
+	ReturnBlocksToCentral(GetClassFromSize(sizeof(ThreadCache)), pBlock);
+}
+
+void *__MCFCRT_HeapImplAlloc(size_t uSize, bool bFillsWithZero){
+	if(_MCFCRT_EXPECT(uSize <= SMALL_SIZE_MAX)){
+		const size_t uClass = GetClassFromSize(uSize);
+		void *const pBlock = AllocateSmall(uClass);
+		if(!pBlock){
+			return _MCFCRT_NULLPTR;
+		}
+		if(bFillsWithZero){
+			_MCFCRT_inline_mempset_fwd(pBlock, 0, GetSizeOfClass(uClass));
+		}
+		return pBlock;
+	}
+	LargeBlock *const pLarge = AllocateLarge(uSize, bFillsWithZero, false);
+	if(!pLarge){
+		return _MCFCRT_NULLPTR;
+	}
+	return (unsigned char *)pLarge + HEADER_SIZE;
+}
+void *__MCFCRT_HeapImplRealloc(void *pBlock, size_t uSize, bool bFillsWithZero){
+	size_t uSizeOld;
+	void *const pBase = GetRegionBase(pBlock);
+	if(*(const uintptr_t *)pBase == SIGNATURE_SMALL_SPAN){
+		SmallSpan *const pSpan = pBase;
+		const size_t uClass = pSpan->uClass;
+		if((uSize <= SMALL_SIZE_MAX) && (GetClassFromSize(uSize) == uClass)){
+			return pBlock;
+		}
+		uSizeOld = GetSizeOfClass(uClass);
+	} else {
+		LargeBlock *const pLarge = pBase;
+		_MCFCRT_ASSERT(pLarge->uSignature == SIGNATURE_LARGE_BLOCK);
+		if((uSize > SMALL_SIZE_MAX) && ResizeLargeInPlace(pLarge, uSize, bFillsWithZero)){
+			return pBlock;
+		}
+		uSizeOld = pLarge->uSize;
+	}
+	unsigned char *pbyBlockNew;
+	if((uSize > SMALL_SIZE_MAX) && (uSize > uSizeOld)){
+		// The block is growing out of its region. Move it to a new region with address space reserved after it,
+		// so it is unlikely to be copied again when it grows in the future.
+		LargeBlock *const pLarge = AllocateLarge(uSize, false, true);
+		if(!pLarge){
+			return _MCFCRT_NULLPTR;
+		}
+		pbyBlockNew = (unsigned char *)pLarge + HEADER_SIZE;
+	} else {
+		pbyBlockNew = __MCFCRT_HeapImplAlloc(uSize, false);
+		if(!pbyBlockNew){
+			return _MCFCRT_NULLPTR;
+		}
+	}
+	const size_t uSizeToCopy = Min(uSizeOld, uSize);
+	_MCFCRT_inline_mempcpy_fwd(pbyBlockNew, pBlock, uSizeToCopy);
+	if(bFillsWithZero){
+		_MCFCRT_inline_mempset_fwd(pbyBlockNew + uSizeToCopy, 0, uSize - uSizeToCopy);
+	}
+	__MCFCRT_HeapImplFree(pBlock);
+	return pbyBlockNew;
+}
+void __MCFCRT_HeapImplFree(void *pBlock){
+	void *const pBase = GetRegionBase(pBlock);
+	if(*(const uintptr_t *)pBase == SIGNATURE_SMALL_SPAN){
+		SmallSpan *const pSpan = pBase;
+		DeallocateSmall(pBlock, pSpan->uClass);
+	} else {
+		LargeBlock *const pLarge = pBase;
+		_MCFCRT_ASSERT(pLarge->uSignature == SIGNATURE_LARGE_BLOCK);
+		DeallocateLarge(pLarge);
+	}
+}
+void __MCFCRT_HeapImplFreeSized(void *pBlock, size_t uSize){
+	// A block is small if and only if the size requested is small, since reallocation never keeps a block across the boundary.
+	if(uSize <= SMALL_SIZE_MAX){
+		const size_t uClass = GetClassFromSize(uSize);
+		_MCFCRT_ASSERT(((const SmallSpan *)GetRegionBase(pBlock))->uSignature == SIGNATURE_SMALL_SPAN);
+		_MCFCRT_ASSERT(((const SmallSpan *)GetRegionBase(pBlock))->uClass == uClass);
+		DeallocateSmall(pBlock, uClass);
+	} else {
+		LargeBlock *const pLarge = GetRegionBase(pBlock);
+		_MCFCRT_ASSERT(pLarge->uSignature == SIGNATURE_LARGE_BLOCK);
+		_MCFCRT_ASSERT(pLarge->uSize == uSize);
+		DeallocateLarge(pLarge);
+	}
+}
+
+size_t __MCFCRT_HeapImplGetUsableSize(const void *pBlock){
+	const void *const pBase = GetRegionBase(pBlock);
+	if(*(const uintptr_t *)pBase == SIGNATURE_SMALL_SPAN){
+		const SmallSpan *const pSpan = pBase;
+		return GetSizeOfClass(pSpan->uClass);
+	} else {
+		const LargeBlock *const pLarge = pBase;
+		_MCFCRT_ASSERT(pLarge->uSignature == SIGNATURE_LARGE_BLOCK);
+		return pLarge->uSize;
+	}
+}
@@ -0,0 +1,46 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#ifndef __MCFCRT_ENV_HEAP_IMPL_H_
+#define __MCFCRT_ENV_HEAP_IMPL_H_
+
+#include "_crtdef.h"
+
+_MCFCRT_EXTERN_C_BEGIN
+
+// This is the allocator underneath `__MCFCRT_HeapAlloc()` and friends.
+// Blocks no larger than `__MCFCRT_HEAP_IMPL_SMALL_SIZE_MAX` bytes are carved from 64KiB spans that are dedicated to size classes. They are cached per thread and
+// returned to central free lists in batches. Larger blocks are mapped directly from the system with `VirtualAlloc()`.
+// All blocks returned by these functions are aligned to 16-byte boundaries.
+
+#define __MCFCRT_HEAP_IMPL_SMALL_SIZE_MAX   8192u
+
+extern bool __MCFCRT_HeapImplInit(void) _MCFCRT_NOEXCEPT;
+extern void __MCFCRT_HeapImplUninit(void) _MCFCRT_NOEXCEPT;
+
+// This function flushes the cache of the calling thread back to central free lists. It shall be called when a thread exits.
+// After this function returns, blocks allocated or freed by the calling thread go to central free lists directly.
+extern void __MCFCRT_HeapImplThreadCleanup(void) _MCFCRT_NOEXCEPT;
+
+__attribute__((__malloc__))
+extern void *__MCFCRT_HeapImplAlloc(_MCFCRT_STD size_t __uSize, bool __bFillsWithZero) _MCFCRT_NOEXCEPT;
+// If `__bFillsWithZero` is `true`, bytes beyond the usable size of the old block are zeroed. The usable size of a small block is the size of its class.
+// A large block is resized in place whenever its reserved address space suffices, in which case pages are committed or decommitted without touching its contents.
+// When a large block has to be moved in order to grow, spare address space is reserved after its new location, so that subsequent growth is likely to happen in place.
+__attribute__((__nonnull__(1)))
+extern void *__MCFCRT_HeapImplRealloc(void *__pBlock, _MCFCRT_STD size_t __uSize, bool __bFillsWithZero) _MCFCRT_NOEXCEPT;
+__attribute__((__nonnull__(1)))
+extern void __MCFCRT_HeapImplFree(void *__pBlock) _MCFCRT_NOEXCEPT;
+// `__uSize` shall be the size that was passed to the allocation or reallocation function which returned this block.
+// This function determines the size class from `__uSize`, so the header of the span in which a small block resides is not touched.
+__attribute__((__nonnull__(1)))
+extern void __MCFCRT_HeapImplFreeSized(void *__pBlock, _MCFCRT_STD size_t __uSize) _MCFCRT_NOEXCEPT;
+
+// This function returns the number of bytes that can be used in a block, which is no less than the size that was requested.
+__attribute__((__nonnull__(1)))
+extern _MCFCRT_STD size_t __MCFCRT_HeapImplGetUsableSize(const void *__pBlock) _MCFCRT_NOEXCEPT;
+
+_MCFCRT_EXTERN_C_END
+
+#endif
@@ -24,9 +24,6 @@ extern NTSTATUS NtDuplicateObject(HANDLE hSourceProcess, HANDLE hSource, HANDLE
 
 static const _MCFCRT_ThreadHandle g_hPseudoSelfHandle = (_MCFCRT_ThreadHandle)GetCurrentThread();
 
-static _MCFCRT_Mutex   g_mtxControl    = { 0 };
-static _MCFCRT_AvlRoot g_avlControlMap = _MCFCRT_NULLPTR;
-
 static intptr_t TerminationUnlockCallback(intptr_t nContext){
 	_MCFCRT_Mutex *const pMutex = (void *)nContext;
 
@@ -50,6 +47,7 @@ typedef enum tagMopthreadState {
 
 typedef struct tagMopthreadControl {
 	_MCFCRT_AvlNodeHeader avlhTidIndex;
+	struct tagMopthreadControl *pNextFree;
 
 	MopthreadState eState;
 	size_t uRefCount;
@@ -76,10 +74,81 @@ static inline int MopthreadControlComparatorNodes(const _MCFCRT_AvlNodeHeader *p
 }
 
 static unsigned char g_abyInitialControlStorage[sizeof(MopthreadControl) + sizeof(void *) * 3]; // XXX: This should suffice for both gthread and c11thread.
-static_assert(sizeof(g_abyInitialControlStorage) == sizeof(void *) * 17, "??");
+static_assert(sizeof(g_abyInitialControlStorage) == sizeof(void *) * 18, "??");
+
+// Control blocks are distributed into shards by thread ID, so threads that are created, joined or detached concurrently
+// seldom contend for the same mutex. Each shard also keeps a few free control blocks with small parameter blocks.
+#define SHARD_COUNT_LOG2        6u
+#define SHARD_COUNT             (1u << SHARD_COUNT_LOG2)
+
+#define POOLED_PARAMS_SIZE      (sizeof(void *) * 8)
+#define POOLED_COUNT_PER_SHARD  16u
+
+typedef struct tagControlShard {
+	alignas(64) _MCFCRT_Mutex vMutex;
+	_MCFCRT_AvlRoot avlControlMap;
+	MopthreadControl *pFirstFree;
+	size_t uFreeCount;
+} ControlShard;
+
+static ControlShard g_aShards[SHARD_COUNT];
+
+static inline ControlShard *GetShard(uintptr_t uTid){
+	// Fibonacci hashing. Thread IDs are multiples of four on Windows, so the low bits are discarded.
+#ifdef _WIN64
+	const uint64_t uHash = ((uint64_t)uTid >> 2) * 0x9E3779B97F4A7C15u;
+	return g_aShards + (size_t)(uHash >> (64 - SHARD_COUNT_LOG2));
+#else
+	const uint32_t uHash = ((uint32_t)uTid >> 2) * 0x9E3779B9u;
+	return g_aShards + (size_t)(uHash >> (32 - SHARD_COUNT_LOG2));
+#endif
+}
+
+static inline void LockShard(ControlShard *pShard){
+	_MCFCRT_WaitForMutexForever(&(pShard->vMutex), _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+}
+static inline void UnlockShard(ControlShard *pShard){
+	_MCFCRT_SignalMutex(&(pShard->vMutex));
+}
+
+static MopthreadControl *AllocateControl(size_t uSizeOfParams){
+	if(uSizeOfParams <= POOLED_PARAMS_SIZE){
+		// The shard of the calling thread is used, as the new thread does not have an ID yet.
+		ControlShard *const pShard = GetShard(_MCFCRT_GetCurrentThreadId());
+		MopthreadControl *pControl;
+		LockShard(pShard);
+		{
+			pControl = pShard->pFirstFree;
+			if(pControl){
+				pShard->pFirstFree = pControl->pNextFree;
+				--(pShard->uFreeCount);
+			}
+		}
+		UnlockShard(pShard);
+		if(pControl){
+			return pControl;
+		}
+		uSizeOfParams = POOLED_PARAMS_SIZE;
+	}
+	const size_t uSizeToAlloc = sizeof(MopthreadControl) + uSizeOfParams;
+	if(uSizeToAlloc < sizeof(MopthreadControl)){
+		return _MCFCRT_NULLPTR;
+	}
+	return _MCFCRT_malloc(uSizeToAlloc);
+}
+// The caller must have the shard mutex locked!
+static void DeallocateControlUnsafe(ControlShard *pShard, MopthreadControl *pControl){
+	if((pControl->uSizeOfParams <= POOLED_PARAMS_SIZE) && (pShard->uFreeCount < POOLED_COUNT_PER_SHARD)){
+		pControl->pNextFree = pShard->pFirstFree;
+		pShard->pFirstFree = pControl;
+		++(pShard->uFreeCount);
+		return;
+	}
+	_MCFCRT_free(pControl);
+}
 
-// The caller must have the global mutex locked!
-static inline void DropControlRefUnsafe(MopthreadControl *restrict pControl){
+// The caller must have the shard mutex locked!
+static inline void DropControlRefUnsafe(ControlShard *pShard, MopthreadControl *restrict pControl){
 	_MCFCRT_ASSERT(pControl->uRefCount > 0);
 	if(--(pControl->uRefCount) == 0){
 		_MCFCRT_ASSERT(pControl->eState == kStateJoined);
@@ -89,7 +158,7 @@ static inline void DropControlRefUnsafe(MopthreadControl *restrict pControl){
 		pControl->hThread = (HANDLE)0xDEADBEEF;
 #endif
 		if(pControl != (void *)g_abyInitialControlStorage){
-			_MCFCRT_free(pControl);
+			DeallocateControlUnsafe(pShard, pControl);
 		}
 	}
 }
@@ -113,7 +182,8 @@ static void AttachInitialThread(void){
 	pControl->uTid    = (uintptr_t)GetCurrentThreadId();
 	pControl->hThread = (HANDLE)hThread;
 
-	_MCFCRT_AvlAttach(&g_avlControlMap, (_MCFCRT_AvlNodeHeader *)pControl, &MopthreadControlComparatorNodes);
+	ControlShard *const pShard = GetShard(pControl->uTid);
+	_MCFCRT_AvlAttach(&(pShard->avlControlMap), (_MCFCRT_AvlNodeHeader *)pControl, &MopthreadControlComparatorNodes);
 }
 static void DetachInitialThread(void){
 	MopthreadControl *const restrict pControl = (void *)g_abyInitialControlStorage;
@@ -132,14 +202,14 @@ static void DetachInitialThread(void){
 	default:
 		_MCFCRT_ASSERT(false);
 	jJoinSuccess:
-		DropControlRefUnsafe(pControl);
+		DropControlRefUnsafe(GetShard(pControl->uTid), pControl);
 		// bSuccess = true;
 		break;
 	}
 }
 
 __attribute__((__noreturn__))
-static inline void SignalMutexAndExitThread(_MCFCRT_Mutex *restrict pMutex, MopthreadControl *restrict pControl, void (*pfnModifier)(void *, size_t, intptr_t), intptr_t nContext){
+static inline void UnlockShardAndExitThread(ControlShard *restrict pShard, MopthreadControl *restrict pControl, void (*pfnModifier)(void *, size_t, intptr_t), intptr_t nContext){
 	switch(pControl->eState){
 	case kStateJoinable:
 		if(pfnModifier){
@@ -164,8 +234,8 @@ static inline void SignalMutexAndExitThread(_MCFCRT_Mutex *restrict pMutex, Mopt
 	default:
 		_MCFCRT_ASSERT(false);
 	}
-	DropControlRefUnsafe(pControl);
-	_MCFCRT_SignalMutex(pMutex);
+	DropControlRefUnsafe(pShard, pControl);
+	UnlockShard(pShard);
 
 	ExitThread(0);
 	__builtin_unreachable();
@@ -190,16 +260,13 @@ static unsigned long NativeMopthreadProc(void *pParam){
 	MopthreadControl *const restrict pControl = pParam;
 	_MCFCRT_DEBUG_CHECK(pControl);
 	_MCFCRT_WrapThreadProcWithSehTop(&MopthreadProc, pControl);
-	_MCFCRT_WaitForMutexForever(&g_mtxControl, _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
-	SignalMutexAndExitThread(&g_mtxControl, pControl, _MCFCRT_NULLPTR, 0);
+	ControlShard *const pShard = GetShard(pControl->uTid);
+	LockShard(pShard);
+	UnlockShardAndExitThread(pShard, pControl, _MCFCRT_NULLPTR, 0);
 }
 
 static inline uintptr_t ReallyCreateMopthread(void (*pfnProc)(void *), const void *pParams, size_t uSizeOfParams, bool bJoinable){
-	const size_t uSizeToAlloc = sizeof(MopthreadControl) + uSizeOfParams;
-	if(uSizeToAlloc < sizeof(MopthreadControl)){
-		return 0;
-	}
-	MopthreadControl *const restrict pControl = _MCFCRT_malloc(uSizeToAlloc);
+	MopthreadControl *const restrict pControl = AllocateControl(uSizeOfParams);
 	if(!pControl){
 		return 0;
 	}
@@ -222,18 +289,24 @@ static inline uintptr_t ReallyCreateMopthread(void (*pfnProc)(void *), const voi
 	uintptr_t uTid;
 	const _MCFCRT_ThreadHandle hThread = _MCFCRT_CreateNativeThread(&NativeMopthreadProc, pControl, true, &uTid);
 	if(!hThread){
-		_MCFCRT_free(pControl);
+		ControlShard *const pShard = GetShard(_MCFCRT_GetCurrentThreadId());
+		LockShard(pShard);
+		{
+			DeallocateControlUnsafe(pShard, pControl);
+		}
+		UnlockShard(pShard);
 		return 0;
 	}
 	pControl->uTid    = uTid;
 	pControl->hThread = hThread;
 	// XXX: Note that at the moment you must attach the control block unconditionally, because the thread could call
 	//      `__MCFCRT_MopthreadExit()` which must be able to get a valid pointer to it by thread ID.
-	_MCFCRT_WaitForMutexForever(&g_mtxControl, _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+	ControlShard *const pShard = GetShard(uTid);
+	LockShard(pShard);
 	{
-		_MCFCRT_AvlAttach(&g_avlControlMap, (_MCFCRT_AvlNodeHeader *)pControl, &MopthreadControlComparatorNodes);
+		_MCFCRT_AvlAttach(&(pShard->avlControlMap), (_MCFCRT_AvlNodeHeader *)pControl, &MopthreadControlComparatorNodes);
 	}
-	_MCFCRT_SignalMutex(&g_mtxControl);
+	UnlockShard(pShard);
 
 	_MCFCRT_ResumeThread(hThread);
 	return uTid;
@@ -249,25 +322,27 @@ __attribute__((__noreturn__))
 void __MCFCRT_MopthreadExit(void (*pfnModifier)(void *, size_t, intptr_t), intptr_t nContext){
 	const uintptr_t uTid = _MCFCRT_GetCurrentThreadId();
 
-	_MCFCRT_WaitForMutexForever(&g_mtxControl, _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
-	MopthreadControl *const restrict pControl = (MopthreadControl *)_MCFCRT_AvlFind(&g_avlControlMap, (intptr_t)uTid, &MopthreadControlComparatorNodeOther);
+	ControlShard *const pShard = GetShard(uTid);
+	LockShard(pShard);
+	MopthreadControl *const restrict pControl = (MopthreadControl *)_MCFCRT_AvlFind(&(pShard->avlControlMap), (intptr_t)uTid, &MopthreadControlComparatorNodeOther);
 	if(!pControl){
 		_MCFCRT_Bail(L"Calling thread of __MCFCRT_MopthreadExit() was not created using __MCFCRT_MopthreadCreate().");
 	}
-	SignalMutexAndExitThread(&g_mtxControl, pControl, pfnModifier, nContext);
+	UnlockShardAndExitThread(pShard, pControl, pfnModifier, nContext);
 }
 bool __MCFCRT_MopthreadJoin(uintptr_t uTid, void *restrict pParams, size_t *restrict puSizeOfParams){
 	bool bSuccess = false;
 
-	_MCFCRT_WaitForMutexForever(&g_mtxControl, _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+	ControlShard *const pShard = GetShard(uTid);
+	LockShard(pShard);
 	{
-		MopthreadControl *const restrict pControl = (MopthreadControl *)_MCFCRT_AvlFind(&g_avlControlMap, (intptr_t)uTid, &MopthreadControlComparatorNodeOther);
+		MopthreadControl *const restrict pControl = (MopthreadControl *)_MCFCRT_AvlFind(&(pShard->avlControlMap), (intptr_t)uTid, &MopthreadControlComparatorNodeOther);
 		if(pControl){
 			switch(pControl->eState){
 			case kStateJoinable:
 				pControl->eState = kStateJoining;
 				do {
-					_MCFCRT_WaitForConditionVariableForever(&(pControl->condTermination), &TerminationUnlockCallback, &TerminationRelockCallback, (intptr_t)&g_mtxControl, 0);
+					_MCFCRT_WaitForConditionVariableForever(&(pControl->condTermination), &TerminationUnlockCallback, &TerminationRelockCallback, (intptr_t)&(pShard->vMutex), 0);
 				} while(pControl->eState != kStateJoined);
 				goto jJoinSuccess;
 			case kStateZombie:
@@ -286,22 +361,23 @@ bool __MCFCRT_MopthreadJoin(uintptr_t uTid, void *restrict pParams, size_t *rest
 					_MCFCRT_inline_mempcpy_fwd(pParams, pControl->abyParams, uSizeCopied);
 					*puSizeOfParams = uSizeCopied;
 				}
-				DropControlRefUnsafe(pControl);
+				DropControlRefUnsafe(pShard, pControl);
 				bSuccess = true;
 				break;
 			}
 		}
 	}
-	_MCFCRT_SignalMutex(&g_mtxControl);
+	UnlockShard(pShard);
 
 	return bSuccess;
 }
 bool __MCFCRT_MopthreadDetach(uintptr_t uTid){
 	bool bSuccess = false;
 
-	_MCFCRT_WaitForMutexForever(&g_mtxControl, _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+	ControlShard *const pShard = GetShard(uTid);
+	LockShard(pShard);
 	{
-		MopthreadControl *const restrict pControl = (MopthreadControl *)_MCFCRT_AvlFind(&g_avlControlMap, (intptr_t)uTid, &MopthreadControlComparatorNodeOther);
+		MopthreadControl *const restrict pControl = (MopthreadControl *)_MCFCRT_AvlFind(&(pShard->avlControlMap), (intptr_t)uTid, &MopthreadControlComparatorNodeOther);
 		if(pControl){
 			switch(pControl->eState){
 			case kStateJoinable:
@@ -317,13 +393,13 @@ bool __MCFCRT_MopthreadDetach(uintptr_t uTid){
 			default:
 				_MCFCRT_ASSERT(false);
 			jJoinSuccess:
-				DropControlRefUnsafe(pControl);
+				DropControlRefUnsafe(pShard, pControl);
 				bSuccess = true;
 				break;
 			}
 		}
 	}
-	_MCFCRT_SignalMutex(&g_mtxControl);
+	UnlockShard(pShard);
 
 	return bSuccess;
 }
@@ -341,9 +417,10 @@ const _MCFCRT_ThreadHandle *__MCFCRT_MopthreadLockHandle(uintptr_t uTid){
 	// Increment the reference count and return a real handle.
 	const _MCFCRT_ThreadHandle *phThread = _MCFCRT_NULLPTR;
 
-	_MCFCRT_WaitForMutexForever(&g_mtxControl, _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+	ControlShard *const pShard = GetShard(uTid);
+	LockShard(pShard);
 	{
-		MopthreadControl *const restrict pControl = (MopthreadControl *)_MCFCRT_AvlFind(&g_avlControlMap, (intptr_t)uTid, &MopthreadControlComparatorNodeOther);
+		MopthreadControl *const restrict pControl = (MopthreadControl *)_MCFCRT_AvlFind(&(pShard->avlControlMap), (intptr_t)uTid, &MopthreadControlComparatorNodeOther);
 		if(pControl){
 			switch(pControl->eState){
 			case kStateJoinable:
@@ -361,7 +438,7 @@ const _MCFCRT_ThreadHandle *__MCFCRT_MopthreadLockHandle(uintptr_t uTid){
 			}
 		}
 	}
-	_MCFCRT_SignalMutex(&g_mtxControl);
+	UnlockShard(pShard);
 
 	return phThread;
 }
@@ -375,11 +452,12 @@ void __MCFCRT_MopthreadUnlockHandle(const _MCFCRT_ThreadHandle *phThread){
 		return;
 	}
 
-	_MCFCRT_WaitForMutexForever(&g_mtxControl, _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+	MopthreadControl *const restrict pControl = (void *)((char *)phThread - __builtin_offsetof(MopthreadControl, hThread));
+	_MCFCRT_ASSERT(pControl);
+	ControlShard *const pShard = GetShard(pControl->uTid);
+	LockShard(pShard);
 	{
-		MopthreadControl *const restrict pControl = (void *)((char *)phThread - __builtin_offsetof(MopthreadControl, hThread));
-		_MCFCRT_ASSERT(pControl);
-		DropControlRefUnsafe(pControl);
+		DropControlRefUnsafe(pShard, pControl);
 	}
-	_MCFCRT_SignalMutex(&g_mtxControl);
+	UnlockShard(pShard);
 }
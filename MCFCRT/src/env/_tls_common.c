@@ -11,6 +11,7 @@
 
 typedef struct tagTlsKey {
 	uintptr_t uCounter;
+	size_t uDenseIndex;
 
 	size_t uSize;
 	_MCFCRT_TlsConstructor pfnConstructor;
@@ -18,6 +19,50 @@ typedef struct tagTlsKey {
 	intptr_t nContext;
 } TlsKey;
 
+// Each key is given a small index into per-thread arrays of object pointers, so the AVL tree need not be searched in most cases.
+// An index is recycled when its key is freed. A stale pointer left behind by a freed key is detected by comparing the key and its counter.
+// Keys that are allocated after all indices have been taken always fall back to the AVL tree.
+#define DENSE_INDEX_COUNT   1024u
+#define DENSE_INDEX_NONE    ((size_t)-1)
+
+static _MCFCRT_Mutex g_vDenseIndexMutex = { 0 };
+static size_t g_uDenseIndexHighWater = 0;
+static size_t g_uDenseIndexFreeCount = 0;
+static uint16_t g_au16FreeDenseIndices[DENSE_INDEX_COUNT];
+
+static size_t AllocDenseIndex(void){
+	size_t uIndex = DENSE_INDEX_NONE;
+	_MCFCRT_WaitForMutexForever(&g_vDenseIndexMutex, _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+	{
+		if(g_uDenseIndexFreeCount != 0){
+			uIndex = g_au16FreeDenseIndices[--g_uDenseIndexFreeCount];
+		} else if(g_uDenseIndexHighWater < DENSE_INDEX_COUNT){
+			uIndex = g_uDenseIndexHighWater++;
+		}
+	}
+	_MCFCRT_SignalMutex(&g_vDenseIndexMutex);
+	return uIndex;
+}
+static void FreeDenseIndex(size_t uIndex){
+	if(uIndex == DENSE_INDEX_NONE){
+		return;
+	}
+	_MCFCRT_WaitForMutexForever(&g_vDenseIndexMutex, _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+	{
+		_MCFCRT_ASSERT(g_uDenseIndexFreeCount < DENSE_INDEX_COUNT);
+		g_au16FreeDenseIndices[g_uDenseIndexFreeCount++] = (uint16_t)uIndex;
+	}
+	_MCFCRT_SignalMutex(&g_vDenseIndexMutex);
+}
+
+// This is the total size of objects of all keys that are alive. Each new thread map takes a slab of this size, so
+// objects of most keys can be carved from it, rather than being allocated from the heap one by one.
+static volatile size_t g_uSlabSizeHint = 0;
+
+#define SLAB_SIZE_MAX   0x10000u
+
+static size_t GetObjectSizeInSlab(size_t uSize);
+
 _MCFCRT_TlsKeyHandle _MCFCRT_TlsAllocKey(size_t uSize, _MCFCRT_TlsConstructor pfnConstructor, _MCFCRT_TlsDestructor pfnDestructor, intptr_t nContext){
 	static volatile size_t s_uKeyCounter;
 
@@ -26,11 +71,14 @@ _MCFCRT_TlsKeyHandle _MCFCRT_TlsAllocKey(size_t uSize, _MCFCRT_TlsConstructor pf
 		return _MCFCRT_NULLPTR;
 	}
 	pKey->uCounter       = __atomic_add_fetch(&s_uKeyCounter, 1, __ATOMIC_RELAXED);
+	pKey->uDenseIndex    = AllocDenseIndex();
 	pKey->uSize          = uSize;
 	pKey->pfnConstructor = pfnConstructor;
 	pKey->pfnDestructor  = pfnDestructor;
 	pKey->nContext       = nContext;
 
+	__atomic_add_fetch(&g_uSlabSizeHint, GetObjectSizeInSlab(uSize), __ATOMIC_RELAXED);
+
 	return (_MCFCRT_TlsKeyHandle)pKey;
 }
 void _MCFCRT_TlsFreeKey(_MCFCRT_TlsKeyHandle hTlsKey){
@@ -39,6 +87,9 @@ void _MCFCRT_TlsFreeKey(_MCFCRT_TlsKeyHandle hTlsKey){
 		return;
 	}
 
+	__atomic_sub_fetch(&g_uSlabSizeHint, GetObjectSizeInSlab(pKey->uSize), __ATOMIC_RELAXED);
+
+	FreeDenseIndex(pKey->uDenseIndex);
 	_MCFCRT_free(pKey);
 }
 
@@ -69,6 +120,7 @@ typedef struct tagTlsObject {
 
 	_MCFCRT_TlsDestructor pfnDestructor;
 	intptr_t nContext;
+	size_t uSize;
 
 	struct tagTlsObject *pPrev; // By thread
 	struct tagTlsObject *pNext; // By thread
@@ -92,12 +144,160 @@ static inline int TlsObjectComparatorNodes(const _MCFCRT_AvlNodeHeader *pObjSelf
 	return TlsObjectComparatorNodeKey(pObjSelf, (intptr_t)&((const TlsObject *)pObjOther)->vObjectKey);
 }
 
+static size_t GetObjectSizeInSlab(size_t uSize){
+	if(uSize > SLAB_SIZE_MAX){
+		// Such an object is never carved from a slab.
+		return 0;
+	}
+	return (sizeof(TlsObject) + uSize + alignof(TlsObject) - 1) & ~(alignof(TlsObject) - 1);
+}
+
+typedef struct tagTlsSlab {
+	struct tagTlsSlab *pNext;
+	size_t uCapacity;
+	size_t uOffset;
+
+	alignas(max_align_t) unsigned char abyData[];
+} TlsSlab;
+
+// Slabs of exited threads are kept here and handed out to new threads.
+#define SLAB_CACHE_CAPACITY   64u
+
+static _MCFCRT_Mutex g_vSlabCacheMutex = { 0 };
+static TlsSlab *g_pSlabCacheHead = _MCFCRT_NULLPTR;
+static size_t g_uSlabCacheSize = 0;
+
+static TlsSlab *AcquireSlab(void){
+	size_t uCapacity = __atomic_load_n(&g_uSlabSizeHint, __ATOMIC_RELAXED);
+	if(uCapacity == 0){
+		return _MCFCRT_NULLPTR;
+	}
+	if(uCapacity > SLAB_SIZE_MAX){
+		uCapacity = SLAB_SIZE_MAX;
+	}
+	TlsSlab *pSlab;
+	_MCFCRT_WaitForMutexForever(&g_vSlabCacheMutex, _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+	{
+		pSlab = g_pSlabCacheHead;
+		if(pSlab){
+			g_pSlabCacheHead = pSlab->pNext;
+			--g_uSlabCacheSize;
+		}
+	}
+	_MCFCRT_SignalMutex(&g_vSlabCacheMutex);
+	if(pSlab && (pSlab->uCapacity < uCapacity)){
+		// More keys have been allocated since this slab was created. Replace it with a larger one.
+		_MCFCRT_free(pSlab);
+		pSlab = _MCFCRT_NULLPTR;
+	}
+	if(!pSlab){
+		pSlab = _MCFCRT_malloc(sizeof(TlsSlab) + uCapacity);
+		if(!pSlab){
+			// Objects will be allocated from the heap.
+			return _MCFCRT_NULLPTR;
+		}
+		pSlab->uCapacity = uCapacity;
+	}
+	pSlab->pNext   = _MCFCRT_NULLPTR;
+	pSlab->uOffset = 0;
+	return pSlab;
+}
+static void ReleaseSlab(TlsSlab *pSlab){
+	if(!pSlab){
+		return;
+	}
+	bool bCached = false;
+	_MCFCRT_WaitForMutexForever(&g_vSlabCacheMutex, _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+	{
+		if(g_uSlabCacheSize < SLAB_CACHE_CAPACITY){
+			pSlab->pNext = g_pSlabCacheHead;
+			g_pSlabCacheHead = pSlab;
+			++g_uSlabCacheSize;
+			bCached = true;
+		}
+	}
+	_MCFCRT_SignalMutex(&g_vSlabCacheMutex);
+	if(bCached){
+		return;
+	}
+	_MCFCRT_free(pSlab);
+}
+
 typedef struct tagTlsThreadMap {
 	_MCFCRT_AvlRoot avlObjects;
 	struct tagTlsObject *pLast; // By thread
 	struct tagTlsObject *pFirst; // By thread
+
+	struct tagTlsObject **ppDenseObjects;
+	size_t uDenseCapacity;
+
+	struct tagTlsSlab *pSlab;
 } TlsThreadMap;
 
+static TlsObject *AllocateObject(TlsThreadMap *pThreadMap, size_t uSize){
+	TlsSlab *const pSlab = pThreadMap->pSlab;
+	const size_t uSizeInSlab = GetObjectSizeInSlab(uSize);
+	if(pSlab && (uSizeInSlab != 0) && (uSizeInSlab <= pSlab->uCapacity - pSlab->uOffset)){
+		TlsObject *const pObject = (void *)(pSlab->abyData + pSlab->uOffset);
+		pSlab->uOffset += uSizeInSlab;
+		return pObject;
+	}
+	const size_t uSizeToAlloc = sizeof(TlsObject) + uSize;
+	if(uSizeToAlloc < sizeof(TlsObject)){
+		return _MCFCRT_NULLPTR;
+	}
+	return _MCFCRT_malloc(uSizeToAlloc);
+}
+static void DeallocateObject(TlsThreadMap *pThreadMap, TlsObject *pObject, size_t uSize){
+	TlsSlab *const pSlab = pThreadMap->pSlab;
+	if(pSlab && ((unsigned char *)pObject >= pSlab->abyData) && ((unsigned char *)pObject < pSlab->abyData + pSlab->uCapacity)){
+		// Space in the slab is reclaimed only if this is the object that was carved most recently. Otherwise it is reclaimed when the thread exits.
+		const size_t uSizeInSlab = GetObjectSizeInSlab(uSize);
+		if((unsigned char *)pObject + uSizeInSlab == pSlab->abyData + pSlab->uOffset){
+			pSlab->uOffset -= uSizeInSlab;
+		}
+		return;
+	}
+	_MCFCRT_free(pObject);
+}
+
+static inline TlsObject *GetDenseObject(const TlsThreadMap *pThreadMap, const TlsObjectKey *pObjectKey){
+	const size_t uIndex = pObjectKey->pKey->uDenseIndex;
+	if(uIndex >= pThreadMap->uDenseCapacity){
+		return _MCFCRT_NULLPTR;
+	}
+	TlsObject *const pObject = pThreadMap->ppDenseObjects[uIndex];
+	if(!pObject){
+		return _MCFCRT_NULLPTR;
+	}
+	if((pObject->vObjectKey.pKey != pObjectKey->pKey) || (pObject->vObjectKey.uCounter != pObjectKey->uCounter)){
+		return _MCFCRT_NULLPTR;
+	}
+	return pObject;
+}
+static inline void SetDenseObject(TlsThreadMap *pThreadMap, TlsObject *pObject){
+	const size_t uIndex = pObject->vObjectKey.pKey->uDenseIndex;
+	if(uIndex == DENSE_INDEX_NONE){
+		return;
+	}
+	size_t uCapacity = pThreadMap->uDenseCapacity;
+	if(uIndex >= uCapacity){
+		size_t uNewCapacity = (uCapacity != 0) ? uCapacity : 16;
+		while(uIndex >= uNewCapacity){
+			uNewCapacity *= 2;
+		}
+		TlsObject **const ppNewDenseObjects = _MCFCRT_realloc(pThreadMap->ppDenseObjects, uNewCapacity * sizeof(TlsObject *));
+		if(!ppNewDenseObjects){
+			// This is only a cache, so failure is not fatal.
+			return;
+		}
+		_MCFCRT_inline_mempset_fwd(ppNewDenseObjects + uCapacity, 0, (uNewCapacity - uCapacity) * sizeof(TlsObject *));
+		pThreadMap->ppDenseObjects = ppNewDenseObjects;
+		pThreadMap->uDenseCapacity = uNewCapacity;
+	}
+	pThreadMap->ppDenseObjects[uIndex] = pObject;
+}
+
 __MCFCRT_TlsThreadMapHandle __MCFCRT_InternalTlsCreateThreadMap(void){
 	TlsThreadMap *const pThreadMap = _MCFCRT_malloc(sizeof(TlsThreadMap));
 	if(!pThreadMap){
@@ -107,6 +307,11 @@ __MCFCRT_TlsThreadMapHandle __MCFCRT_InternalTlsCreateThreadMap(void){
 	pThreadMap->pLast      = _MCFCRT_NULLPTR;
 	pThreadMap->pFirst     = _MCFCRT_NULLPTR;
 
+	pThreadMap->ppDenseObjects = _MCFCRT_NULLPTR;
+	pThreadMap->uDenseCapacity = 0;
+
+	pThreadMap->pSlab = AcquireSlab();
+
 	return (__MCFCRT_TlsThreadMapHandle)pThreadMap;
 }
 void __MCFCRT_InternalTlsDestroyThreadMap(__MCFCRT_TlsThreadMapHandle hThreadMap){
@@ -139,9 +344,11 @@ void __MCFCRT_InternalTlsDestroyThreadMap(__MCFCRT_TlsThreadMapHandle hThreadMap
 		if(pfnDestructor){
 			(*pfnDestructor)(pObject->nContext, pObject->abyStorage);
 		}
-		_MCFCRT_free(pObject);
+		DeallocateObject(pThreadMap, pObject, pObject->uSize);
 	}
 
+	ReleaseSlab(pThreadMap->pSlab);
+	_MCFCRT_free(pThreadMap->ppDenseObjects);
 	_MCFCRT_free(pThreadMap);
 }
 
@@ -152,9 +359,13 @@ unsigned long __MCFCRT_InternalTlsGet(__MCFCRT_TlsThreadMapHandle hThreadMap, _M
 	_MCFCRT_ASSERT(pKey);
 
 	const TlsObjectKey vObjectKey = { pKey, pKey->uCounter };
-	TlsObject *pObject = (TlsObject *)_MCFCRT_AvlFind(&(pThreadMap->avlObjects), (intptr_t)&vObjectKey, &TlsObjectComparatorNodeKey);
+	TlsObject *pObject = GetDenseObject(pThreadMap, &vObjectKey);
 	if(!pObject){
-		return ERROR_NOT_FOUND;
+		pObject = (TlsObject *)_MCFCRT_AvlFind(&(pThreadMap->avlObjects), (intptr_t)&vObjectKey, &TlsObjectComparatorNodeKey);
+		if(!pObject){
+			return ERROR_NOT_FOUND;
+		}
+		SetDenseObject(pThreadMap, pObject);
 	}
 	*ppStorage = pObject->abyStorage;
 	return 0;
@@ -170,13 +381,14 @@ unsigned long __MCFCRT_InternalTlsRequire(__MCFCRT_TlsThreadMapHandle hThreadMap
 #endif
 
 	const TlsObjectKey vObjectKey = { pKey, pKey->uCounter };
-	TlsObject *pObject = (TlsObject *)_MCFCRT_AvlFind(&(pThreadMap->avlObjects), (intptr_t)&vObjectKey, &TlsObjectComparatorNodeKey);
+	TlsObject *pObject = GetDenseObject(pThreadMap, &vObjectKey);
+	if(pObject){
+		*ppStorage = pObject->abyStorage;
+		return 0;
+	}
+	pObject = (TlsObject *)_MCFCRT_AvlFind(&(pThreadMap->avlObjects), (intptr_t)&vObjectKey, &TlsObjectComparatorNodeKey);
 	if(!pObject){
-		const size_t uSizeToAlloc = sizeof(TlsObject) + pKey->uSize;
-		if(uSizeToAlloc < sizeof(TlsObject)){
-			return ERROR_NOT_ENOUGH_MEMORY;
-		}
-		pObject = _MCFCRT_malloc(uSizeToAlloc);
+		pObject = AllocateObject(pThreadMap, pKey->uSize);
 		if(!pObject){
 			return ERROR_NOT_ENOUGH_MEMORY;
 		}
@@ -187,12 +399,13 @@ unsigned long __MCFCRT_InternalTlsRequire(__MCFCRT_TlsThreadMapHandle hThreadMap
 		if(pKey->pfnConstructor){
 			const unsigned long ulErrorCode = (*(pKey->pfnConstructor))(pKey->nContext, pObject->abyStorage);
 			if(ulErrorCode != 0){
-				_MCFCRT_free(pObject);
+				DeallocateObject(pThreadMap, pObject, pKey->uSize);
 				return ulErrorCode;
 			}
 		}
 		pObject->pfnDestructor = pKey->pfnDestructor;
 		pObject->nContext      = pKey->nContext;
+		pObject->uSize         = pKey->uSize;
 
 		TlsObject *const pPrev = pThreadMap->pLast;
 		TlsObject *const pNext = _MCFCRT_NULLPTR;
@@ -212,6 +425,7 @@ unsigned long __MCFCRT_InternalTlsRequire(__MCFCRT_TlsThreadMapHandle hThreadMap
 		pObject->vObjectKey = vObjectKey;
 		_MCFCRT_AvlAttach(&(pThreadMap->avlObjects), (_MCFCRT_AvlNodeHeader *)pObject, &TlsObjectComparatorNodes);
 	}
+	SetDenseObject(pThreadMap, pObject);
 	*ppStorage = pObject->abyStorage;
 	return 0;
 }
@@ -247,7 +461,7 @@ unsigned long __MCFCRT_InternalAtThreadExit(__MCFCRT_TlsThreadMapHandle hThreadM
 		pBlock = (void *)pObject->abyStorage;
 	}
 	if(!pBlock || (pBlock->uSize >= CALLBACKS_PER_BLOCK)){
-		pObject = _MCFCRT_malloc(sizeof(TlsObject) + sizeof(AtExitBlock));
+		pObject = AllocateObject(pThreadMap, sizeof(AtExitBlock));
 		if(!pObject){
 			return ERROR_NOT_ENOUGH_MEMORY;
 		}
@@ -258,6 +472,7 @@ unsigned long __MCFCRT_InternalAtThreadExit(__MCFCRT_TlsThreadMapHandle hThreadM
 		pBlock->uSize = 0;
 		pObject->pfnDestructor = &CrtAtThreadExitDestructor;
 		pObject->nContext      = 1;
+		pObject->uSize         = sizeof(AtExitBlock);
 
 		TlsObject *const pPrev = pThreadMap->pLast;
 		TlsObject *const pNext = _MCFCRT_NULLPTR;
@@ -8,6 +8,7 @@
 #include "bail.h"
 #include "once_flag.h"
 #include "xassert.h"
+#include <cpuid.h>
 
 static _MCFCRT_OnceFlag g_once;
 static uint64_t g_tz_bias;
@@ -74,3 +75,293 @@ double _MCFCRT_GetHiResMonoClock(void){
 	FetchParametersOnce();
 	return ((double)pc_cntr.QuadPart + MONO_CLOCK_OFFSET * 5) * g_pc_freq_recip;
 }
+
+// Nanoseconds are computed in two parts, so this does not overflow however long the system has been up.
+static uint64_t pc_to_ns(int64_t pc, int64_t pc_freq){
+	const uint64_t pc_biased = (uint64_t)pc + MONO_CLOCK_OFFSET * 5;
+	const uint64_t sec = pc_biased / (uint64_t)pc_freq;
+	const uint64_t rem = pc_biased % (uint64_t)pc_freq;
+	return sec * 1000000000u + rem * 1000000000u / (uint64_t)pc_freq;
+}
+
+// 0 = not checked yet, 1 = `rdtscp` is supported, 2 = it is not supported. Checking twice is harmless.
+static volatile int g_rdtscp_state;
+
+static bool is_rdtscp_supported(void){
+	int state = __atomic_load_n(&g_rdtscp_state, __ATOMIC_RELAXED);
+	if(__builtin_expect(state == 0, false)){
+		unsigned eax, ebx, ecx, edx;
+		state = 2;
+		if(__get_cpuid_max(0x80000000u, _MCFCRT_NULLPTR) >= 0x80000001u){
+			__cpuid(0x80000001u, eax, ebx, ecx, edx);
+			// CPUID.80000001H:EDX[27] = RDTSCP and IA32_TSC_AUX
+			if((edx >> 27) & 1){
+				state = 1;
+			}
+		}
+		__atomic_store_n(&g_rdtscp_state, state, __ATOMIC_RELAXED);
+	}
+	return state == 1;
+}
+static inline uint64_t read_tsc_ordered(void){
+	if(__builtin_expect(is_rdtscp_supported(), true)){
+		unsigned aux;
+		return __builtin_ia32_rdtscp(&aux);
+	}
+	// `lfence` does not let `rdtsc` execute until all previous instructions have completed locally.
+	__builtin_ia32_lfence();
+	return __builtin_ia32_rdtsc();
+}
+
+uint64_t _MCFCRT_ReadTimeStampCounter64Ordered(uint32_t *pu32Aux){
+	if(__builtin_expect(is_rdtscp_supported(), true)){
+		unsigned aux;
+		const uint64_t tsc = __builtin_ia32_rdtscp(&aux);
+		if(pu32Aux){
+			*pu32Aux = aux;
+		}
+		return tsc;
+	}
+	__builtin_ia32_lfence();
+	const uint64_t tsc = __builtin_ia32_rdtsc();
+	if(pu32Aux){
+		*pu32Aux = (uint32_t)GetCurrentProcessorNumber();
+	}
+	return tsc;
+}
+
+// The TSC is recalibrated against the performance counter after it has run for about this long since the last time.
+#define TSC_RECALIBRATION_INTERVAL_NS   1000000000u
+
+typedef struct tsc_params {
+	// This is the number of nanoseconds per tick, in 32.32 fixed point. It is zero until the clock has been calibrated, and remains zero if the TSC is not invariant.
+	uint64_t multiplier;
+	uint64_t base;
+	uint64_t ns_base;
+	// The clock is recalibrated when the TSC has run for this many ticks since `base`. As the difference is unsigned,
+	// a TSC that has gone backwards, for example after the system has resumed from hibernation, also causes a recalibration.
+	uint64_t ticks_valid;
+} tsc_params;
+
+static _MCFCRT_OnceFlag g_tsc_once;
+// The parameters are protected by a sequence lock. An odd sequence number means they are being updated.
+static volatile uint32_t g_tsc_seq;
+static tsc_params g_tsc_params;
+// The frequency is always measured from the first calibration, so its error shrinks as the process runs.
+static uint64_t g_tsc_origin;
+static int64_t g_tsc_pc_origin;
+static int64_t g_tsc_pc_freq;
+static volatile uint64_t g_tsc_freq;
+
+static bool is_tsc_invariant(void){
+	unsigned eax, ebx, ecx, edx;
+	if(__get_cpuid_max(0x80000000u, _MCFCRT_NULLPTR) < 0x80000007u){
+		return false;
+	}
+	__cpuid(0x80000007u, eax, ebx, ecx, edx);
+	// CPUID.80000007H:EDX[8] = Invariant TSC
+	return (edx >> 8) & 1;
+}
+static void sample_tsc_and_pc(uint64_t *tsc, int64_t *pc){
+	// Keep the sample where the two TSC readings around the performance counter are closest, as it is the least likely to have been interrupted.
+	uint64_t best_width = UINT64_MAX;
+	for(unsigned i = 0; i < 8; ++i){
+		const uint64_t tsc_before = __builtin_ia32_rdtsc();
+		LARGE_INTEGER pc_cntr;
+		QueryPerformanceCounter(&pc_cntr);
+		const uint64_t tsc_after = __builtin_ia32_rdtsc();
+		const uint64_t width = tsc_after - tsc_before;
+		if(width < best_width){
+			best_width = width;
+			*tsc = tsc_before + width / 2;
+			*pc = pc_cntr.QuadPart;
+		}
+	}
+}
+
+static inline uint64_t scale_tsc(uint64_t tsc, const tsc_params *params){
+	const uint64_t delta = tsc - params->base;
+	// Multiply the delta by the 32.32 multiplier, in two halves, so it does not overflow.
+	const uint64_t high = (delta >> 32) * params->multiplier;
+	const uint64_t low = ((delta & 0xFFFFFFFFu) * params->multiplier) >> 32;
+	return params->ns_base + high + low;
+}
+// The TSC is read inside the critical section of the sequence lock, so a value scaled using old parameters is never later than
+// the point where new parameters take over, and the clock does not go backwards across a recalibration.
+static inline uint64_t read_tsc_and_params(tsc_params *params, bool ordered){
+	for(;;){
+		const uint32_t seq = __atomic_load_n(&g_tsc_seq, __ATOMIC_ACQUIRE);
+		if(__builtin_expect(seq & 1, false)){
+			__builtin_ia32_pause();
+			continue;
+		}
+		params->multiplier     = __atomic_load_n(&(g_tsc_params.multiplier),     __ATOMIC_RELAXED);
+		params->base           = __atomic_load_n(&(g_tsc_params.base),           __ATOMIC_RELAXED);
+		params->ns_base        = __atomic_load_n(&(g_tsc_params.ns_base),        __ATOMIC_RELAXED);
+		params->ticks_valid    = __atomic_load_n(&(g_tsc_params.ticks_valid),    __ATOMIC_RELAXED);
+		const uint64_t tsc = ordered ? read_tsc_ordered() : __builtin_ia32_rdtsc();
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if(__builtin_expect(__atomic_load_n(&g_tsc_seq, __ATOMIC_RELAXED) == seq, true)){
+			return tsc;
+		}
+	}
+}
+static bool begin_tsc_update(void){
+	uint32_t seq = __atomic_load_n(&g_tsc_seq, __ATOMIC_RELAXED);
+	if(seq & 1){
+		return false;
+	}
+	if(!__atomic_compare_exchange_n(&g_tsc_seq, &seq, seq + 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)){
+		return false;
+	}
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	return true;
+}
+static void end_tsc_update(const tsc_params *params){
+	__atomic_store_n(&(g_tsc_params.multiplier),     params->multiplier,     __ATOMIC_RELAXED);
+	__atomic_store_n(&(g_tsc_params.base),           params->base,           __ATOMIC_RELAXED);
+	__atomic_store_n(&(g_tsc_params.ns_base),        params->ns_base,        __ATOMIC_RELAXED);
+	__atomic_store_n(&(g_tsc_params.ticks_valid),    params->ticks_valid,    __ATOMIC_RELAXED);
+	__atomic_add_fetch(&g_tsc_seq, 1, __ATOMIC_RELEASE);
+}
+
+static void CalibrateTscOnce(void){
+	const _MCFCRT_OnceResult result = _MCFCRT_WaitForOnceFlagForever(&g_tsc_once);
+	if(result == _MCFCRT_kOnceResultFinished){
+		return;
+	}
+	_MCFCRT_ASSERT(result == _MCFCRT_kOnceResultInitial);
+
+	LARGE_INTEGER pc_freq;
+	if(!QueryPerformanceFrequency(&pc_freq)){
+		_MCFCRT_Bail(L"QueryPerformanceFrequency() 失败。");
+	}
+	g_tsc_pc_freq = pc_freq.QuadPart;
+
+	if(is_tsc_invariant()){
+		// Measure the TSC against the performance counter for at least 10 milliseconds. Later recalibrations measure it over longer periods.
+		uint64_t tsc_begin, tsc_end;
+		int64_t pc_begin, pc_end;
+		sample_tsc_and_pc(&tsc_begin, &pc_begin);
+		do {
+			sample_tsc_and_pc(&tsc_end, &pc_end);
+		} while(pc_end - pc_begin < g_tsc_pc_freq / 100);
+
+		const double tsc_freq = (double)(tsc_end - tsc_begin) * (double)g_tsc_pc_freq / (double)(pc_end - pc_begin);
+		__atomic_store_n(&g_tsc_freq, (uint64_t)(tsc_freq + 0.5), __ATOMIC_RELAXED);
+		g_tsc_origin    = tsc_begin;
+		g_tsc_pc_origin = pc_begin;
+
+		tsc_params params;
+		// The base is the beginning of calibration, so a TSC that is slightly behind on another processor does not go below it.
+		params.base           = tsc_begin;
+		params.ns_base        = pc_to_ns(pc_begin, g_tsc_pc_freq);
+		params.multiplier     = (uint64_t)(1.0e9 * 0x1p32 / tsc_freq + 0.5);
+		params.ticks_valid    = (tsc_end - tsc_begin) + (uint64_t)(tsc_freq * (TSC_RECALIBRATION_INTERVAL_NS / 1.0e9));
+		const bool locked = begin_tsc_update();
+		_MCFCRT_ASSERT(locked);
+		end_tsc_update(&params);
+	}
+
+	_MCFCRT_SignalOnceFlagAsFinished(&g_tsc_once);
+}
+
+// The TSC drifts slowly against the performance counter, because the initial calibration is short, and because of spread spectrum clocking.
+// Each recalibration measures the frequency again over the whole lifetime of the clock, then slews the clock towards the performance counter
+// over the next interval. The correction is limited to 1/16 of the interval, so the clock keeps running forward at nearly the same rate.
+// If the TSC has gone backwards, the clock is restarted from the performance counter.
+__attribute__((__noinline__))
+static void recalibrate_tsc(void){
+	if(!begin_tsc_update()){
+		// Another thread is doing it.
+		return;
+	}
+	tsc_params params = g_tsc_params;
+	if(__builtin_ia32_rdtsc() - params.base < params.ticks_valid){
+		// Another thread has just done it.
+		end_tsc_update(&params);
+		return;
+	}
+	uint64_t tsc_now;
+	int64_t pc_now;
+	sample_tsc_and_pc(&tsc_now, &pc_now);
+	const uint64_t ns_pc = pc_to_ns(pc_now, g_tsc_pc_freq);
+	double tsc_freq;
+	double error_ns;
+	if((int64_t)(tsc_now - params.base) < 0){
+		g_tsc_origin    = tsc_now;
+		g_tsc_pc_origin = pc_now;
+		tsc_freq = (double)__atomic_load_n(&g_tsc_freq, __ATOMIC_RELAXED);
+		params.ns_base = (ns_pc > params.ns_base) ? ns_pc : params.ns_base;
+		error_ns = 0;
+	} else {
+		if(pc_now - g_tsc_pc_origin > 0){
+			tsc_freq = (double)(tsc_now - g_tsc_origin) * (double)g_tsc_pc_freq / (double)(pc_now - g_tsc_pc_origin);
+		} else {
+			tsc_freq = (double)__atomic_load_n(&g_tsc_freq, __ATOMIC_RELAXED);
+		}
+		const uint64_t ns_tsc = scale_tsc(tsc_now, &params);
+		params.ns_base = ns_tsc;
+		error_ns = (double)(int64_t)(ns_pc - ns_tsc);
+	}
+	const double max_error_ns = TSC_RECALIBRATION_INTERVAL_NS / 16.0;
+	if(error_ns > max_error_ns){
+		error_ns = max_error_ns;
+	} else if(error_ns < -max_error_ns){
+		error_ns = -max_error_ns;
+	}
+	__atomic_store_n(&g_tsc_freq, (uint64_t)(tsc_freq + 0.5), __ATOMIC_RELAXED);
+	const double ticks_per_interval = tsc_freq * (TSC_RECALIBRATION_INTERVAL_NS / 1.0e9);
+	params.base           = tsc_now;
+	params.multiplier     = (uint64_t)((TSC_RECALIBRATION_INTERVAL_NS + error_ns) * 0x1p32 / ticks_per_interval + 0.5);
+	params.ticks_valid    = (uint64_t)ticks_per_interval;
+	end_tsc_update(&params);
+}
+
+bool _MCFCRT_IsTscMonoClockInvariant(void){
+	CalibrateTscOnce();
+	return __atomic_load_n(&(g_tsc_params.multiplier), __ATOMIC_ACQUIRE) != 0;
+}
+uint64_t _MCFCRT_GetTscFrequency(void){
+	CalibrateTscOnce();
+	return __atomic_load_n(&g_tsc_freq, __ATOMIC_RELAXED);
+}
+
+__attribute__((__noinline__))
+static uint64_t get_tsc_mono_clock_slow(bool ordered){
+	tsc_params params;
+	uint64_t tsc = read_tsc_and_params(&params, ordered);
+	if(params.multiplier == 0){
+		CalibrateTscOnce();
+		tsc = read_tsc_and_params(&params, ordered);
+		if(params.multiplier == 0){
+			LARGE_INTEGER pc_cntr;
+			if(!QueryPerformanceCounter(&pc_cntr)){
+				_MCFCRT_Bail(L"QueryPerformanceCounter() 失败。");
+			}
+			return pc_to_ns(pc_cntr.QuadPart, g_tsc_pc_freq);
+		}
+	}
+	if(tsc - params.base >= params.ticks_valid){
+		recalibrate_tsc();
+		tsc = read_tsc_and_params(&params, ordered);
+	}
+	return scale_tsc(tsc, &params);
+}
+
+uint64_t _MCFCRT_GetTscMonoClock(void){
+	tsc_params params;
+	const uint64_t tsc = read_tsc_and_params(&params, false);
+	if(__builtin_expect((params.multiplier == 0) || (tsc - params.base >= params.ticks_valid), false)){
+		return get_tsc_mono_clock_slow(false);
+	}
+	return scale_tsc(tsc, &params);
+}
+uint64_t _MCFCRT_GetTscMonoClockOrdered(void){
+	tsc_params params;
+	const uint64_t tsc = read_tsc_and_params(&params, true);
+	if(__builtin_expect((params.multiplier == 0) || (tsc - params.base >= params.ticks_valid), false)){
+		return get_tsc_mono_clock_slow(true);
+	}
+	return scale_tsc(tsc, &params);
+}
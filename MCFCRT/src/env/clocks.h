@@ -21,6 +21,10 @@ __attribute__((__artificial__))
 __MCFCRT_CLOCKS_INLINE_OR_EXTERN _MCFCRT_STD uint64_t _MCFCRT_ReadTimeStampCounter64(void) _MCFCRT_NOEXCEPT {
 	return __builtin_ia32_rdtsc();
 }
+// This function uses `rdtscp`, which waits until all previous instructions have executed before reading the counter.
+// `*__pu32Aux` receives the value of `IA32_TSC_AUX`, which Windows sets to the number of the current processor.
+// If the processor does not support `rdtscp`, `lfence` followed by `rdtsc` is used instead, and `*__pu32Aux` receives the result of `GetCurrentProcessorNumber()`.
+extern _MCFCRT_STD uint64_t _MCFCRT_ReadTimeStampCounter64Ordered(_MCFCRT_STD uint32_t *__pu32Aux) _MCFCRT_NOEXCEPT;
 
 extern _MCFCRT_STD uint64_t _MCFCRT_GetUtcClock(void) _MCFCRT_NOEXCEPT;
 extern _MCFCRT_STD uint64_t _MCFCRT_GetLocalClock(void) _MCFCRT_NOEXCEPT;
@@ -31,6 +35,18 @@ extern _MCFCRT_STD uint64_t _MCFCRT_GetLocalClockFromUtc(_MCFCRT_STD uint64_t __
 extern _MCFCRT_STD uint64_t _MCFCRT_GetFastMonoClock(void) _MCFCRT_NOEXCEPT;
 extern double _MCFCRT_GetHiResMonoClock(void) _MCFCRT_NOEXCEPT;
 
+// The TSC clock counts nanoseconds on the same time line as `_MCFCRT_GetHiResMonoClock()`, which counts milliseconds.
+// If the processor has an invariant TSC, it is read in user mode and scaled using a frequency that is calibrated against the performance counter
+// when the clock is used for the first time. Otherwise this clock falls back to the performance counter.
+// The calibration is refined about once a second, and the clock is slewed so it does not drift away from the performance counter.
+extern bool _MCFCRT_IsTscMonoClockInvariant(void) _MCFCRT_NOEXCEPT;
+// This function returns the calibrated frequency of the TSC in Hz, or zero if the TSC is not invariant.
+extern _MCFCRT_STD uint64_t _MCFCRT_GetTscFrequency(void) _MCFCRT_NOEXCEPT;
+
+extern _MCFCRT_STD uint64_t _MCFCRT_GetTscMonoClock(void) _MCFCRT_NOEXCEPT;
+// This function is like `_MCFCRT_GetTscMonoClock()`, but it does not read the clock until all previous instructions have executed.
+extern _MCFCRT_STD uint64_t _MCFCRT_GetTscMonoClockOrdered(void) _MCFCRT_NOEXCEPT;
+
 _MCFCRT_EXTERN_C_END
 
 #endif
@@ -4,6 +4,8 @@
 
 #define __MCFCRT_CONDITION_VARIABLE_INLINE_OR_EXTERN     extern inline
 #include "condition_variable.h"
+#include "lock_profiler.h"
+#include "thread.h"
 #include "_nt_timeout.h"
 #include "xassert.h"
 #include "expect.h"
@@ -17,228 +19,292 @@ extern NTSTATUS NtReleaseKeyedEvent(HANDLE hKeyedEvent, void *pKey, BOOLEAN bAle
 __attribute__((__dllimport__, __stdcall__, __const__))
 extern BOOLEAN RtlDllShutdownInProgress(void);
 
-#ifndef __BYTE_ORDER__
-#  error Byte order is unknown.
-#endif
+// Each waiter puts a node on its own stack into a FIFO list and sleeps on the address of that node, so it can be woken up individually.
+// The control word is a pointer to the first node, with its least significant bit used as a spin lock that protects the list.
+#define MASK_LIST_LOCKED        ((uintptr_t)0x01)
+#define MASK_LIST_HEAD          ((uintptr_t)~MASK_LIST_LOCKED)
 
-#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
-#  define BSUSR(v_)             ((uintptr_t)(v_) << CHAR_BIT)
-#  define BSFB(v_)              ((uintptr_t)(v_)            )
-#else
-#  define BSUSR(v_)             ((uintptr_t)(v_)                                        )
-#  define BSFB(v_)              ((uintptr_t)(v_) << ((sizeof(uintptr_t) - 1) * CHAR_BIT))
-#endif
+#define LIST_LOCK_SPIN_COUNT    ((size_t)1000)
 
-#define MASK_THREADS_RELEASED   ((uintptr_t)( BSFB(0x03)))
-#define MASK_THREADS_SPINNING   ((uintptr_t)( BSFB(0x0C)))
-#define MASK_SPIN_FAILURE_COUNT ((uintptr_t)( BSFB(0xF0)))
-#define MASK_THREADS_TRAPPED    ((uintptr_t)(~BSFB(0xFF)))
+// A waiter that is going to sleep sets `STATE_SLEEPING`, after which it expects a release of its keyed event.
+// A waiter that has been signaled may return. A waiter that has been chained has been removed from the list, but it will be signaled by its predecessor.
+#define STATE_SLEEPING          ((uintptr_t)0x01)
+#define STATE_SIGNALED          ((uintptr_t)0x02)
+#define STATE_CHAINED           ((uintptr_t)0x04)
 
-#define THREADS_RELEASED_ONE    ((uintptr_t)(MASK_THREADS_RELEASED & -MASK_THREADS_RELEASED))
-#define THREADS_RELEASED_MAX    ((uintptr_t)(MASK_THREADS_RELEASED / THREADS_RELEASED_ONE))
+typedef struct tagWaitNode WaitNode;
 
-#define THREADS_SPINNING_ONE    ((uintptr_t)(MASK_THREADS_SPINNING & -MASK_THREADS_SPINNING))
-#define THREADS_SPINNING_MAX    ((uintptr_t)(MASK_THREADS_SPINNING / THREADS_SPINNING_ONE))
+struct tagWaitNode {
+	// For the first node in the list, `pPrev` points to the last one.
+	WaitNode *pPrev;
+	WaitNode *pNext;
+	// Waiters that are signaled by a broadcast and relock the same lock are chained. Each of them signals the next one after it has relocked.
+	WaitNode *pChainNext;
+	_MCFCRT_ConditionVariableRelockCallback pfnRelockCallback;
+	intptr_t nContext;
+	volatile uintptr_t uState;
+};
 
-#define SPIN_FAILURE_COUNT_ONE  ((uintptr_t)(MASK_SPIN_FAILURE_COUNT & -MASK_SPIN_FAILURE_COUNT))
-#define SPIN_FAILURE_COUNT_MAX  ((uintptr_t)(MASK_SPIN_FAILURE_COUNT / SPIN_FAILURE_COUNT_ONE))
+static_assert(_Alignof(WaitNode) > MASK_LIST_LOCKED, "WaitNode is not aligned enough.");
 
-#define THREADS_TRAPPED_ONE     ((uintptr_t)(MASK_THREADS_TRAPPED & -MASK_THREADS_TRAPPED))
-#define THREADS_TRAPPED_MAX     ((uintptr_t)(MASK_THREADS_TRAPPED / THREADS_TRAPPED_ONE))
+static inline void NoteLockEvents(unsigned *puEvents, unsigned uEvents){
+	if(puEvents){
+		*puEvents |= uEvents;
+	}
+}
 
-static_assert(__builtin_popcountll(MASK_THREADS_RELEASED) == __builtin_popcountll(MASK_THREADS_SPINNING), "MASK_THREADS_RELEASED must have the same number of bits set as MASK_THREADS_SPINNING.");
+static WaitNode *LockWaitList(volatile uintptr_t *puControl){
+	size_t uSpinIndex = 0;
+	uintptr_t uOld = __atomic_load_n(puControl, __ATOMIC_RELAXED);
+	for(;;){
+		if(_MCFCRT_EXPECT(!(uOld & MASK_LIST_LOCKED))){
+			if(_MCFCRT_EXPECT(__atomic_compare_exchange_n(puControl, &uOld, uOld | MASK_LIST_LOCKED, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))){
+				return (WaitNode *)(uOld & MASK_LIST_HEAD);
+			}
+			continue;
+		}
+		// The list is locked for only a few instructions, unless the owner has been preempted.
+		if(_MCFCRT_EXPECT(uSpinIndex < LIST_LOCK_SPIN_COUNT)){
+			__builtin_ia32_pause();
+			++uSpinIndex;
+		} else {
+			_MCFCRT_YieldThread();
+		}
+		uOld = __atomic_load_n(puControl, __ATOMIC_RELAXED);
+	}
+}
+static void UnlockWaitList(volatile uintptr_t *puControl, WaitNode *pHead){
+	__atomic_store_n(puControl, (uintptr_t)pHead, __ATOMIC_RELEASE);
+}
 
-#define MIN_SPIN_COUNT          ((uintptr_t)64)
-#define MAX_SPIN_MULTIPLIER     ((uintptr_t)32)
+static WaitNode *AppendWaitNode(WaitNode *pHead, WaitNode *pNode){
+	pNode->pNext = _MCFCRT_NULLPTR;
+	if(!pHead){
+		pNode->pPrev = pNode;
+		return pNode;
+	}
+	WaitNode *const pTail = pHead->pPrev;
+	pTail->pNext = pNode;
+	pNode->pPrev = pTail;
+	pHead->pPrev = pNode;
+	return pHead;
+}
+static WaitNode *RemoveWaitNode(WaitNode *pHead, WaitNode *pNode){
+	WaitNode *const pNext = pNode->pNext;
+	if(pNode == pHead){
+		if(pNext){
+			pNext->pPrev = pNode->pPrev;
+		}
+		return pNext;
+	}
+	WaitNode *const pPrev = pNode->pPrev;
+	pPrev->pNext = pNext;
+	if(pNext){
+		pNext->pPrev = pPrev;
+	} else {
+		pHead->pPrev = pPrev;
+	}
+	return pHead;
+}
 
-static inline size_t Min(size_t uSelf, size_t uOther){
-	return (uSelf <= uOther) ? uSelf : uOther;
+static void ReleaseWaitNode(WaitNode *pNode){
+	// If `RtlDllShutdownInProgress()` is `true`, other threads will have been terminated.
+	// Calling `NtReleaseKeyedEvent()` when no thread is waiting results in deadlocks. Don't do that.
+	if(_MCFCRT_EXPECT_NOT(RtlDllShutdownInProgress())){
+		return;
+	}
+	NTSTATUS lStatus = NtReleaseKeyedEvent(_MCFCRT_NULLPTR, (void *)pNode, false, _MCFCRT_NULLPTR);
+	_MCFCRT_ASSERT_MSG(NT_SUCCESS(lStatus), L"NtReleaseKeyedEvent() 失败。");
+	_MCFCRT_ASSERT(lStatus != STATUS_TIMEOUT);
+}
+// The node may be gone as soon as it is signaled, unless this function returns `true`, in which case it must be released.
+static bool SignalWaitNode(WaitNode *pNode){
+	const uintptr_t uOld = __atomic_fetch_or(&(pNode->uState), STATE_SIGNALED, __ATOMIC_ACQ_REL);
+	return (uOld & STATE_SLEEPING) != 0;
 }
 
 __attribute__((__always_inline__))
-static inline bool ReallyWaitForConditionVariable(volatile uintptr_t *puControl, _MCFCRT_ConditionVariableUnlockCallback pfnUnlockCallback, _MCFCRT_ConditionVariableRelockCallback pfnRelockCallback, intptr_t nContext, size_t uMaxSpinCountInitial, bool bMayTimeOut, uint64_t u64UntilFastMonoClock, bool bRelockIfTimeOut){
-	size_t uMaxSpinCount, uSpinMultiplier;
-	bool bSignaled, bSpinnable;
+static inline bool ReallyWaitForConditionVariable(volatile uintptr_t *puControl, _MCFCRT_ConditionVariableUnlockCallback pfnUnlockCallback, _MCFCRT_ConditionVariableRelockCallback pfnRelockCallback, intptr_t nContext, size_t uMaxSpinCount, bool bMayTimeOut, uint64_t u64UntilFastMonoClock, bool bRelockIfTimeOut, unsigned *puEvents){
+	WaitNode vNode;
+	vNode.pChainNext = _MCFCRT_NULLPTR;
+	vNode.pfnRelockCallback = pfnRelockCallback;
+	vNode.nContext = nContext;
+	vNode.uState = 0;
+	// Enqueue ourselves before unlocking, so a thread that signals the condition variable after taking the lock will see us.
+	UnlockWaitList(puControl, AppendWaitNode(LockWaitList(puControl), &vNode));
+	NoteLockEvents(puEvents, __MCFCRT_LOCK_EVENT_CONTENDED);
+	const intptr_t nUnlocked = (*pfnUnlockCallback)(nContext);
+
+	for(size_t uSpinIndex = 0; _MCFCRT_EXPECT(uSpinIndex < uMaxSpinCount); ++uSpinIndex){
+		__builtin_ia32_pause();
+		if(_MCFCRT_EXPECT_NOT(__atomic_load_n(&(vNode.uState), __ATOMIC_ACQUIRE) & STATE_SIGNALED)){
+			NoteLockEvents(puEvents, __MCFCRT_LOCK_EVENT_SPIN_SUCCEEDED);
+			goto jSignaled;
+		}
+	}
 	{
-		uintptr_t uOld, uNew;
-		uOld = __atomic_load_n(puControl, __ATOMIC_RELAXED);
+		uintptr_t uOld;
+		uOld = __atomic_load_n(&(vNode.uState), __ATOMIC_RELAXED);
 		do {
-			const size_t uSpinFailureCount = (uOld & MASK_SPIN_FAILURE_COUNT) / SPIN_FAILURE_COUNT_ONE;
-			if(uMaxSpinCountInitial > MIN_SPIN_COUNT){
-				uMaxSpinCount = (uMaxSpinCountInitial >> uSpinFailureCount) | MIN_SPIN_COUNT;
-				uSpinMultiplier = MAX_SPIN_MULTIPLIER >> uSpinFailureCount;
-			} else {
-				uMaxSpinCount = uMaxSpinCountInitial;
-				uSpinMultiplier = 0;
-			}
-			bSignaled = (uOld & MASK_THREADS_RELEASED) != 0;
-			bSpinnable = false;
-			if(!bSignaled){
+			if(_MCFCRT_EXPECT_NOT(uOld & STATE_SIGNALED)){
+				__atomic_thread_fence(__ATOMIC_ACQUIRE);
 				if(uMaxSpinCount != 0){
-					const size_t uThreadsSpinning = (uOld & MASK_THREADS_SPINNING) / THREADS_SPINNING_ONE;
-					bSpinnable = uThreadsSpinning < THREADS_SPINNING_MAX;
+					NoteLockEvents(puEvents, __MCFCRT_LOCK_EVENT_SPIN_SUCCEEDED);
 				}
-				if(!bSpinnable){
-					break;
-				}
-				uNew = uOld + THREADS_SPINNING_ONE;
-			} else {
-				const bool bSpinFailureCountDecremented = uSpinFailureCount != 0;
-				uNew = uOld - THREADS_RELEASED_ONE - bSpinFailureCountDecremented * SPIN_FAILURE_COUNT_ONE;
-			}
-		} while(_MCFCRT_EXPECT_NOT(!__atomic_compare_exchange_n(puControl, &uOld, uNew, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)));
-	}
-	if(_MCFCRT_EXPECT(bSignaled)){
-		return true;
-	}
-	intptr_t nUnlocked;
-	if(_MCFCRT_EXPECT(bSpinnable)){
-		nUnlocked = (*pfnUnlockCallback)(nContext);
-		for(size_t uSpinIndex = 0; _MCFCRT_EXPECT(uSpinIndex < uMaxSpinCount); ++uSpinIndex){
-			register size_t uMultiplierIndex = uSpinMultiplier + 1;
-			__atomic_thread_fence(__ATOMIC_SEQ_CST);
-			do {
-				__builtin_ia32_pause();
-			} while(--uMultiplierIndex != 0);
-			__atomic_thread_fence(__ATOMIC_SEQ_CST);
-			{
-				uintptr_t uOld, uNew;
-				uOld = __atomic_load_n(puControl, __ATOMIC_RELAXED);
-				do {
-					bSignaled = (uOld & MASK_THREADS_RELEASED) != 0;
-					if(!bSignaled){
-						break;
-					}
-					const size_t uSpinFailureCount = (uOld & MASK_SPIN_FAILURE_COUNT) / SPIN_FAILURE_COUNT_ONE;
-					const bool bSpinFailureCountDecremented = uSpinFailureCount != 0;
-					uNew = uOld - THREADS_SPINNING_ONE - THREADS_RELEASED_ONE - bSpinFailureCountDecremented * SPIN_FAILURE_COUNT_ONE;
-				} while(_MCFCRT_EXPECT_NOT(!__atomic_compare_exchange_n(puControl, &uOld, uNew, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)));
+				goto jSignaled;
 			}
-			if(_MCFCRT_EXPECT_NOT(bSignaled)){
-				(*pfnRelockCallback)(nContext, nUnlocked);
-				return true;
-			}
-		}
-		{
-			uintptr_t uOld, uNew;
-			uOld = __atomic_load_n(puControl, __ATOMIC_RELAXED);
-			do {
-				const size_t uSpinFailureCount = (uOld & MASK_SPIN_FAILURE_COUNT) / SPIN_FAILURE_COUNT_ONE;
-				bSignaled = (uOld & MASK_THREADS_RELEASED) != 0;
-				if(!bSignaled){
-					const bool bSpinFailureCountIncremented = uSpinFailureCount < SPIN_FAILURE_COUNT_MAX;
-					uNew = uOld - THREADS_SPINNING_ONE + THREADS_TRAPPED_ONE + bSpinFailureCountIncremented * SPIN_FAILURE_COUNT_ONE;
-				} else {
-					const bool bSpinFailureCountDecremented = uSpinFailureCount != 0;
-					uNew = uOld - THREADS_SPINNING_ONE - THREADS_RELEASED_ONE - bSpinFailureCountDecremented * SPIN_FAILURE_COUNT_ONE;
-				}
-			} while(_MCFCRT_EXPECT_NOT(!__atomic_compare_exchange_n(puControl, &uOld, uNew, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)));
-		}
-		if(_MCFCRT_EXPECT(bSignaled)){
-			(*pfnRelockCallback)(nContext, nUnlocked);
-			return true;
-		}
-	} else {
-		{
-			uintptr_t uOld, uNew;
-			uOld = __atomic_load_n(puControl, __ATOMIC_RELAXED);
-			do {
-				bSignaled = (uOld & MASK_THREADS_RELEASED) != 0;
-				if(!bSignaled){
-					uNew = uOld + THREADS_TRAPPED_ONE;
-				} else {
-					uNew = uOld - THREADS_RELEASED_ONE;
-				}
-			} while(_MCFCRT_EXPECT_NOT(!__atomic_compare_exchange_n(puControl, &uOld, uNew, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)));
-		}
-		if(_MCFCRT_EXPECT(bSignaled)){
-			return true;
-		}
-		nUnlocked = (*pfnUnlockCallback)(nContext);
+		} while(_MCFCRT_EXPECT_NOT(!__atomic_compare_exchange_n(&(vNode.uState), &uOld, uOld | STATE_SLEEPING, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)));
+	}
+	if(uMaxSpinCount != 0){
+		NoteLockEvents(puEvents, __MCFCRT_LOCK_EVENT_SPIN_FAILED);
 	}
 	if(bMayTimeOut){
 		LARGE_INTEGER liTimeout;
 		__MCFCRT_InitializeNtTimeout(&liTimeout, u64UntilFastMonoClock);
-		NTSTATUS lStatus = NtWaitForKeyedEvent(_MCFCRT_NULLPTR, (void *)puControl, false, &liTimeout);
+		NTSTATUS lStatus = NtWaitForKeyedEvent(_MCFCRT_NULLPTR, (void *)&vNode, false, &liTimeout);
 		_MCFCRT_ASSERT_MSG(NT_SUCCESS(lStatus), L"NtWaitForKeyedEvent() 失败。");
-		while(_MCFCRT_EXPECT(lStatus == STATUS_TIMEOUT)){
-			bool bDecremented;
-			{
-				uintptr_t uOld, uNew;
-				uOld = __atomic_load_n(puControl, __ATOMIC_RELAXED);
-				do {
-					const size_t uThreadsTrapped = (uOld & MASK_THREADS_TRAPPED) / THREADS_TRAPPED_ONE;
-					bDecremented = uThreadsTrapped != 0;
-					if(!bDecremented){
-						break;
-					}
-					uNew = uOld - THREADS_TRAPPED_ONE;
-				} while(_MCFCRT_EXPECT_NOT(!__atomic_compare_exchange_n(puControl, &uOld, uNew, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)));
-			}
-			if(bDecremented){
+		if(_MCFCRT_EXPECT(lStatus == STATUS_TIMEOUT)){
+			// Nodes are signaled or chained only when they are removed from the list, which is done with the list locked.
+			WaitNode *const pHead = LockWaitList(puControl);
+			const bool bStillWaiting = (__atomic_load_n(&(vNode.uState), __ATOMIC_RELAXED) & (STATE_SIGNALED | STATE_CHAINED)) == 0;
+			if(bStillWaiting){
+				UnlockWaitList(puControl, RemoveWaitNode(pHead, &vNode));
 				if(bRelockIfTimeOut){
 					(*pfnRelockCallback)(nContext, nUnlocked);
 				}
 				return false;
 			}
-			liTimeout.QuadPart = 0;
-			lStatus = NtWaitForKeyedEvent(_MCFCRT_NULLPTR, (void *)puControl, false, &liTimeout);
+			UnlockWaitList(puControl, pHead);
+			// We have been signaled, or will be. Someone is going to release us, so wait for it.
+			lStatus = NtWaitForKeyedEvent(_MCFCRT_NULLPTR, (void *)&vNode, false, _MCFCRT_NULLPTR);
 			_MCFCRT_ASSERT_MSG(NT_SUCCESS(lStatus), L"NtWaitForKeyedEvent() 失败。");
+			_MCFCRT_ASSERT(lStatus != STATUS_TIMEOUT);
 		}
 	} else {
-		NTSTATUS lStatus = NtWaitForKeyedEvent(_MCFCRT_NULLPTR, (void *)puControl, false, _MCFCRT_NULLPTR);
+		NTSTATUS lStatus = NtWaitForKeyedEvent(_MCFCRT_NULLPTR, (void *)&vNode, false, _MCFCRT_NULLPTR);
 		_MCFCRT_ASSERT_MSG(NT_SUCCESS(lStatus), L"NtWaitForKeyedEvent() 失败。");
 		_MCFCRT_ASSERT(lStatus != STATUS_TIMEOUT);
 	}
+	_MCFCRT_ASSERT(__atomic_load_n(&(vNode.uState), __ATOMIC_ACQUIRE) & STATE_SIGNALED);
+jSignaled:
 	(*pfnRelockCallback)(nContext, nUnlocked);
+	// Now that we own the lock, wake up the next thread in the chain. It will queue up for the lock, rather than racing with all the others.
+	WaitNode *const pChainNext = vNode.pChainNext;
+	if(pChainNext && SignalWaitNode(pChainNext)){
+		ReleaseWaitNode(pChainNext);
+	}
 	return true;
 }
 __attribute__((__always_inline__))
-static inline size_t ReallySignalConditionVariable(volatile uintptr_t *puControl, size_t uMaxCountToReleaseOrSignal){
-	uintptr_t uCountToRelease; // Number of threads spinning to release
-	uintptr_t uCountToSignal; // Number of threads trapped to signal
+static inline size_t ReallySignalConditionVariable(volatile uintptr_t *puControl, size_t uMaxCountToSignal){
+	if(__atomic_load_n(puControl, __ATOMIC_ACQUIRE) == 0){
+		return 0;
+	}
+	size_t uCountSignaled = 0;
+	WaitNode *pToRelease = _MCFCRT_NULLPTR;
 	{
-		uintptr_t uOld, uNew;
-		uOld = __atomic_load_n(puControl, __ATOMIC_RELAXED);
-		do {
-			const size_t uThreadsReleased = (uOld & MASK_THREADS_RELEASED) / THREADS_RELEASED_ONE;
-			const size_t uThreadsSpinning = (uOld & MASK_THREADS_SPINNING) / THREADS_SPINNING_ONE;
-			const size_t uThreadsTrapped = (uOld & MASK_THREADS_TRAPPED) / THREADS_TRAPPED_ONE;
-			uCountToRelease = Min(uThreadsSpinning - uThreadsReleased, uMaxCountToReleaseOrSignal);
-			uCountToSignal = Min(uThreadsTrapped, uMaxCountToReleaseOrSignal - uCountToRelease);
-			uNew = uOld + uCountToRelease * THREADS_RELEASED_ONE - uCountToSignal * THREADS_TRAPPED_ONE;
-			if(uNew == uOld){
-				break;
+		WaitNode *pHead = LockWaitList(puControl);
+		while(pHead && (uCountSignaled < uMaxCountToSignal)){
+			WaitNode *const pNode = pHead;
+			pHead = RemoveWaitNode(pHead, pNode);
+			// The node may go away once it is signaled, unless the waiter is sleeping. Link it before that.
+			pNode->pNext = pToRelease;
+			if(SignalWaitNode(pNode)){
+				pToRelease = pNode;
 			}
-		} while(_MCFCRT_EXPECT_NOT(!__atomic_compare_exchange_n(puControl, &uOld, uNew, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)));
+			++uCountSignaled;
+		}
+		UnlockWaitList(puControl, pHead);
 	}
-	// If `RtlDllShutdownInProgress()` is `true`, other threads will have been terminated.
-	// Calling `NtReleaseKeyedEvent()` when no thread is waiting results in deadlocks. Don't do that.
-	if(_MCFCRT_EXPECT_NOT((uCountToSignal > 0) && !RtlDllShutdownInProgress())){
-		for(size_t uIndex = 0; uIndex < uCountToSignal; ++uIndex){
-			NTSTATUS lStatus = NtReleaseKeyedEvent(_MCFCRT_NULLPTR, (void *)puControl, false, _MCFCRT_NULLPTR);
-			_MCFCRT_ASSERT_MSG(NT_SUCCESS(lStatus), L"NtReleaseKeyedEvent() 失败。");
-			_MCFCRT_ASSERT(lStatus != STATUS_TIMEOUT);
+	while(pToRelease){
+		WaitNode *const pNode = pToRelease;
+		pToRelease = pNode->pNext;
+		ReleaseWaitNode(pNode);
+	}
+	return uCountSignaled;
+}
+__attribute__((__always_inline__))
+static inline size_t ReallyBroadcastConditionVariable(volatile uintptr_t *puControl){
+	if(__atomic_load_n(puControl, __ATOMIC_ACQUIRE) == 0){
+		return 0;
+	}
+	size_t uCountSignaled = 0;
+	WaitNode *pToRelease = _MCFCRT_NULLPTR;
+	{
+		WaitNode *const pFirst = LockWaitList(puControl);
+		// Waiters that relock the same lock (that is, those with the same relock callback and context) are chained, instead of all being woken up just to contend for the lock.
+		// Chained waiters are marked before the first one in each chain is signaled, after which that chain must not be touched.
+		// The `pPrev` member of the first node in each chain is reused to link chains together.
+		if(pFirst){
+			WaitNode *pChainHead = pFirst;
+			WaitNode *pChainTail = pFirst;
+			uCountSignaled = 1;
+			for(WaitNode *pNode = pFirst->pNext; pNode; pNode = pNode->pNext){
+				if((pNode->pfnRelockCallback == pChainTail->pfnRelockCallback) && (pNode->nContext == pChainTail->nContext)){
+					__atomic_fetch_or(&(pNode->uState), STATE_CHAINED, __ATOMIC_RELAXED);
+					pChainTail->pChainNext = pNode;
+				} else {
+					pChainHead->pPrev = pNode;
+					pChainHead = pNode;
+				}
+				pChainTail = pNode;
+				++uCountSignaled;
+			}
+			pChainHead->pPrev = _MCFCRT_NULLPTR;
+		}
+		WaitNode *pNextChainHead;
+		for(WaitNode *pNode = pFirst; pNode; pNode = pNextChainHead){
+			pNextChainHead = pNode->pPrev;
+			pNode->pNext = pToRelease;
+			if(SignalWaitNode(pNode)){
+				pToRelease = pNode;
+			}
 		}
+		UnlockWaitList(puControl, _MCFCRT_NULLPTR);
+	}
+	while(pToRelease){
+		WaitNode *const pNode = pToRelease;
+		pToRelease = pNode->pNext;
+		ReleaseWaitNode(pNode);
 	}
-	return uCountToRelease + uCountToSignal;
+	return uCountSignaled;
+}
+
+__attribute__((__noinline__))
+static bool ProfiledWaitForConditionVariable(volatile uintptr_t *puControl, _MCFCRT_ConditionVariableUnlockCallback pfnUnlockCallback, _MCFCRT_ConditionVariableRelockCallback pfnRelockCallback, intptr_t nContext, size_t uMaxSpinCount, bool bMayTimeOut, uint64_t u64UntilFastMonoClock, bool bRelockIfTimeOut, const void *pCallSite){
+	unsigned uEvents = 0;
+	const int64_t n64WaitBegin = __MCFCRT_LockProfilerGetTimestamp();
+	const bool bSignaled = ReallyWaitForConditionVariable(puControl, pfnUnlockCallback, pfnRelockCallback, nContext, uMaxSpinCount, bMayTimeOut, u64UntilFastMonoClock, bRelockIfTimeOut, &uEvents);
+	__MCFCRT_LockProfilerRecordWait((const void *)puControl, _MCFCRT_kLockKindConditionVariable, pCallSite, n64WaitBegin, uEvents, bSignaled);
+	return bSignaled;
 }
 
 bool __MCFCRT_ReallyWaitForConditionVariable(_MCFCRT_ConditionVariable *pConditionVariable, _MCFCRT_ConditionVariableUnlockCallback pfnUnlockCallback, _MCFCRT_ConditionVariableRelockCallback pfnRelockCallback, intptr_t nContext, size_t uMaxSpinCount, uint64_t u64UntilFastMonoClock){
-	const bool bSignaled = ReallyWaitForConditionVariable(&(pConditionVariable->__u), pfnUnlockCallback, pfnRelockCallback, nContext, uMaxSpinCount, true, u64UntilFastMonoClock, true);
+	if(__MCFCRT_IsLockProfilerRunning()){
+		return ProfiledWaitForConditionVariable(&(pConditionVariable->__u), pfnUnlockCallback, pfnRelockCallback, nContext, uMaxSpinCount, true, u64UntilFastMonoClock, true, __builtin_return_address(0));
+	}
+	const bool bSignaled = ReallyWaitForConditionVariable(&(pConditionVariable->__u), pfnUnlockCallback, pfnRelockCallback, nContext, uMaxSpinCount, true, u64UntilFastMonoClock, true, _MCFCRT_NULLPTR);
 	return bSignaled;
 }
 bool __MCFCRT_ReallyWaitForConditionVariableOrAbandon(_MCFCRT_ConditionVariable *pConditionVariable, _MCFCRT_ConditionVariableUnlockCallback pfnUnlockCallback, _MCFCRT_ConditionVariableRelockCallback pfnRelockCallback, intptr_t nContext, size_t uMaxSpinCount, uint64_t u64UntilFastMonoClock){
-	const bool bSignaled = ReallyWaitForConditionVariable(&(pConditionVariable->__u), pfnUnlockCallback, pfnRelockCallback, nContext, uMaxSpinCount, true, u64UntilFastMonoClock, false);
+	if(__MCFCRT_IsLockProfilerRunning()){
+		return ProfiledWaitForConditionVariable(&(pConditionVariable->__u), pfnUnlockCallback, pfnRelockCallback, nContext, uMaxSpinCount, true, u64UntilFastMonoClock, false, __builtin_return_address(0));
+	}
+	const bool bSignaled = ReallyWaitForConditionVariable(&(pConditionVariable->__u), pfnUnlockCallback, pfnRelockCallback, nContext, uMaxSpinCount, true, u64UntilFastMonoClock, false, _MCFCRT_NULLPTR);
 	return bSignaled;
 }
 void __MCFCRT_ReallyWaitForConditionVariableForever(_MCFCRT_ConditionVariable *pConditionVariable, _MCFCRT_ConditionVariableUnlockCallback pfnUnlockCallback, _MCFCRT_ConditionVariableRelockCallback pfnRelockCallback, intptr_t nContext, size_t uMaxSpinCount){
-	const bool bSignaled = ReallyWaitForConditionVariable(&(pConditionVariable->__u), pfnUnlockCallback, pfnRelockCallback, nContext, uMaxSpinCount, false, UINT64_MAX, true);
+	if(__MCFCRT_IsLockProfilerRunning()){
+		const bool bSignaled = ProfiledWaitForConditionVariable(&(pConditionVariable->__u), pfnUnlockCallback, pfnRelockCallback, nContext, uMaxSpinCount, false, UINT64_MAX, true, __builtin_return_address(0));
+		_MCFCRT_ASSERT(bSignaled);
+		return;
+	}
+	const bool bSignaled = ReallyWaitForConditionVariable(&(pConditionVariable->__u), pfnUnlockCallback, pfnRelockCallback, nContext, uMaxSpinCount, false, UINT64_MAX, true, _MCFCRT_NULLPTR);
 	_MCFCRT_ASSERT(bSignaled);
 }
 size_t __MCFCRT_ReallySignalConditionVariable(_MCFCRT_ConditionVariable *pConditionVariable, size_t uMaxCountToSignal){
 	return ReallySignalConditionVariable(&(pConditionVariable->__u), uMaxCountToSignal);
 }
 size_t __MCFCRT_ReallyBroadcastConditionVariable(_MCFCRT_ConditionVariable *pConditionVariable){
-	return ReallySignalConditionVariable(&(pConditionVariable->__u), SIZE_MAX);
+	return ReallyBroadcastConditionVariable(&(pConditionVariable->__u));
 }
@@ -14,6 +14,8 @@
 _MCFCRT_EXTERN_C_BEGIN
 
 // In the case of static initialization, please initialize it with { 0 }.
+// A broadcast does not wake up all waiters at once. Waiters that passed the same relock callback and context are assumed to relock the same lock,
+// so only the first of them is woken up, and each of the others is woken up by its predecessor after that has relocked.
 typedef struct __MCFCRT_tagConditionVariable {
 	_MCFCRT_STD uintptr_t __u;
 } _MCFCRT_ConditionVariable;
@@ -0,0 +1,293 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#include "cpu_topology.h"
+#include "once_flag.h"
+#include "heap.h"
+#include "xassert.h"
+#include "mcfwin.h"
+
+typedef SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX ProcessorInformation;
+
+static inline const ProcessorInformation *GetNextInformation(const ProcessorInformation *pInfo){
+	return (const void *)((const char *)pInfo + pInfo->Size);
+}
+
+static _MCFCRT_OnceFlag g_vTopologyOnce = { 0 };
+static _MCFCRT_CpuTopology g_vTopology;
+static const _MCFCRT_CpuTopology *g_pTopology = _MCFCRT_NULLPTR;
+static DWORD g_dwTopologyErrorCode = 0;
+
+static _MCFCRT_LogicalProcessor *FindProcessor(_MCFCRT_LogicalProcessor *pProcessors, size_t uCount, unsigned uGroup, unsigned uNumber){
+	size_t uLower = 0, uUpper = uCount;
+	while(uLower < uUpper){
+		const size_t uMiddle = uLower + (uUpper - uLower) / 2;
+		_MCFCRT_LogicalProcessor *const pProcessor = pProcessors + uMiddle;
+		if((pProcessor->__u16Group < uGroup) || ((pProcessor->__u16Group == uGroup) && (pProcessor->__u8Number < uNumber))){
+			uLower = uMiddle + 1;
+		} else if((pProcessor->__u16Group > uGroup) || (pProcessor->__u8Number > uNumber)){
+			uUpper = uMiddle;
+		} else {
+			return pProcessor;
+		}
+	}
+	return _MCFCRT_NULLPTR;
+}
+// `uFieldOffset` is the offset of an `unsigned` member of `_MCFCRT_LogicalProcessor`.
+static void MarkProcessors(_MCFCRT_LogicalProcessor *pProcessors, size_t uCount, const GROUP_AFFINITY *pMask, size_t uFieldOffset, unsigned uValue){
+	for(unsigned uNumber = 0; uNumber < sizeof(pMask->Mask) * __CHAR_BIT__; ++uNumber){
+		if(((pMask->Mask >> uNumber) & 1) == 0){
+			continue;
+		}
+		_MCFCRT_LogicalProcessor *const pProcessor = FindProcessor(pProcessors, uCount, pMask->Group, uNumber);
+		if(!pProcessor){
+			continue;
+		}
+		*(unsigned *)((char *)pProcessor + uFieldOffset) = uValue;
+	}
+}
+
+static DWORD ReallyBuildTopology(_MCFCRT_CpuTopology *pTopology, const ProcessorInformation *pBegin, const ProcessorInformation *pEnd){
+	size_t uProcessorCount = 0, uCacheCount = 0, uCoreCount = 0, uPackageCount = 0, uNumaNodeCount = 0;
+	for(const ProcessorInformation *pInfo = pBegin; pInfo < pEnd; pInfo = GetNextInformation(pInfo)){
+		switch(pInfo->Relationship){
+		case RelationProcessorCore:
+			for(unsigned uIndex = 0; uIndex < pInfo->Processor.GroupCount; ++uIndex){
+				uProcessorCount += (size_t)__builtin_popcountll(pInfo->Processor.GroupMask[uIndex].Mask);
+			}
+			++uCoreCount;
+			break;
+		case RelationProcessorPackage:
+			++uPackageCount;
+			break;
+		case RelationNumaNode:
+			++uNumaNodeCount;
+			break;
+		case RelationCache:
+			++uCacheCount;
+			break;
+		default:
+			break;
+		}
+	}
+	if(uProcessorCount == 0){
+		return ERROR_NOT_SUPPORTED;
+	}
+
+	_MCFCRT_LogicalProcessor *const pProcessors = _MCFCRT_malloc(uProcessorCount * sizeof(_MCFCRT_LogicalProcessor));
+	if(!pProcessors){
+		return ERROR_NOT_ENOUGH_MEMORY;
+	}
+	_MCFCRT_CpuCache *const pCaches = _MCFCRT_malloc(uCacheCount * sizeof(_MCFCRT_CpuCache) + 1); // Never allocate zero bytes.
+	if(!pCaches){
+		_MCFCRT_free(pProcessors);
+		return ERROR_NOT_ENOUGH_MEMORY;
+	}
+
+	// Enumerate logical processors by core, then sort them, so the other relationships can look them up.
+	size_t uProcessorIndex = 0;
+	unsigned uCoreIndex = 0;
+	for(const ProcessorInformation *pInfo = pBegin; pInfo < pEnd; pInfo = GetNextInformation(pInfo)){
+		if(pInfo->Relationship != RelationProcessorCore){
+			continue;
+		}
+		for(unsigned uIndex = 0; uIndex < pInfo->Processor.GroupCount; ++uIndex){
+			const GROUP_AFFINITY *const pMask = pInfo->Processor.GroupMask + uIndex;
+			for(unsigned uNumber = 0; uNumber < sizeof(pMask->Mask) * __CHAR_BIT__; ++uNumber){
+				if(((pMask->Mask >> uNumber) & 1) == 0){
+					continue;
+				}
+				_MCFCRT_LogicalProcessor *const pProcessor = pProcessors + uProcessorIndex++;
+				pProcessor->__u16Group          = pMask->Group;
+				pProcessor->__u8Number          = (unsigned char)uNumber;
+				pProcessor->__u8EfficiencyClass = pInfo->Processor.EfficiencyClass;
+				pProcessor->__uCore             = uCoreIndex;
+				pProcessor->__uPackage          = _MCFCRT_CPU_TOPOLOGY_NONE;
+				pProcessor->__uNumaNode         = _MCFCRT_CPU_TOPOLOGY_NONE;
+				pProcessor->__uL1DataCache      = _MCFCRT_CPU_TOPOLOGY_NONE;
+				pProcessor->__uL2Cache          = _MCFCRT_CPU_TOPOLOGY_NONE;
+				pProcessor->__uL3Cache          = _MCFCRT_CPU_TOPOLOGY_NONE;
+			}
+		}
+		++uCoreIndex;
+	}
+	_MCFCRT_ASSERT(uProcessorIndex == uProcessorCount);
+	for(size_t uIndex = 1; uIndex < uProcessorCount; ++uIndex){
+		const _MCFCRT_LogicalProcessor vProcessor = pProcessors[uIndex];
+		size_t uHole = uIndex;
+		while((uHole != 0) && ((pProcessors[uHole - 1].__u16Group > vProcessor.__u16Group) ||
+			((pProcessors[uHole - 1].__u16Group == vProcessor.__u16Group) && (pProcessors[uHole - 1].__u8Number > vProcessor.__u8Number))))
+		{
+			pProcessors[uHole] = pProcessors[uHole - 1];
+			--uHole;
+		}
+		pProcessors[uHole] = vProcessor;
+	}
+
+	unsigned uPackageIndex = 0, uNumaNodeIndex = 0, uCacheIndex = 0;
+	for(const ProcessorInformation *pInfo = pBegin; pInfo < pEnd; pInfo = GetNextInformation(pInfo)){
+		switch(pInfo->Relationship){
+		case RelationProcessorPackage:
+			for(unsigned uIndex = 0; uIndex < pInfo->Processor.GroupCount; ++uIndex){
+				MarkProcessors(pProcessors, uProcessorCount, pInfo->Processor.GroupMask + uIndex, __builtin_offsetof(_MCFCRT_LogicalProcessor, __uPackage), uPackageIndex);
+			}
+			++uPackageIndex;
+			break;
+		case RelationNumaNode:
+			MarkProcessors(pProcessors, uProcessorCount, &(pInfo->NumaNode.GroupMask), __builtin_offsetof(_MCFCRT_LogicalProcessor, __uNumaNode), uNumaNodeIndex);
+			++uNumaNodeIndex;
+			break;
+		case RelationCache: {
+			const CACHE_RELATIONSHIP *const pCacheInfo = &(pInfo->Cache);
+			_MCFCRT_CpuCache *const pCache = pCaches + uCacheIndex;
+			pCache->__u8Level         = pCacheInfo->Level;
+			pCache->__u8Associativity = pCacheInfo->Associativity;
+			pCache->__u16LineSize     = pCacheInfo->LineSize;
+			pCache->__u32Size         = pCacheInfo->CacheSize;
+			pCache->__eType           = (_MCFCRT_CpuCacheType)pCacheInfo->Type;
+			pCache->__uSharingCount   = (unsigned)__builtin_popcountll(pCacheInfo->GroupMask.Mask);
+			size_t uFieldOffset = 0;
+			if((pCacheInfo->Level == 1) && ((pCacheInfo->Type == CacheData) || (pCacheInfo->Type == CacheUnified))){
+				uFieldOffset = __builtin_offsetof(_MCFCRT_LogicalProcessor, __uL1DataCache);
+			} else if(pCacheInfo->Level == 2){
+				uFieldOffset = __builtin_offsetof(_MCFCRT_LogicalProcessor, __uL2Cache);
+			} else if(pCacheInfo->Level == 3){
+				uFieldOffset = __builtin_offsetof(_MCFCRT_LogicalProcessor, __uL3Cache);
+			}
+			if(uFieldOffset != 0){
+				MarkProcessors(pProcessors, uProcessorCount, &(pCacheInfo->GroupMask), uFieldOffset, uCacheIndex);
+			}
+			++uCacheIndex;
+			break; }
+		default:
+			break;
+		}
+	}
+
+	pTopology->__pProcessors     = pProcessors;
+	pTopology->__uProcessorCount = uProcessorCount;
+	pTopology->__pCaches         = pCaches;
+	pTopology->__uCacheCount     = uCacheCount;
+	pTopology->__uCoreCount      = uCoreCount;
+	pTopology->__uPackageCount   = uPackageCount;
+	pTopology->__uNumaNodeCount  = uNumaNodeCount;
+	return 0;
+}
+static DWORD BuildTopology(_MCFCRT_CpuTopology *pTopology){
+	ProcessorInformation *pInfo = _MCFCRT_NULLPTR;
+	DWORD dwSize = 0;
+	// The size may change between the two calls if processors are hot-added.
+	while(!GetLogicalProcessorInformationEx(RelationAll, pInfo, &dwSize)){
+		const DWORD dwErrorCode = GetLastError();
+		if(dwErrorCode != ERROR_INSUFFICIENT_BUFFER){
+			_MCFCRT_free(pInfo);
+			return dwErrorCode;
+		}
+		ProcessorInformation *const pNewInfo = _MCFCRT_realloc(pInfo, dwSize);
+		if(!pNewInfo){
+			_MCFCRT_free(pInfo);
+			return ERROR_NOT_ENOUGH_MEMORY;
+		}
+		pInfo = pNewInfo;
+	}
+	const DWORD dwErrorCode = ReallyBuildTopology(pTopology, pInfo, (const void *)((const char *)pInfo + dwSize));
+	_MCFCRT_free(pInfo);
+	return dwErrorCode;
+}
+
+const _MCFCRT_CpuTopology *_MCFCRT_GetCpuTopology(void){
+	const _MCFCRT_OnceResult eResult = _MCFCRT_WaitForOnceFlagForever(&g_vTopologyOnce);
+	if(eResult == _MCFCRT_kOnceResultInitial){
+		// Failure is remembered. The topology is not going to be available later either.
+		g_dwTopologyErrorCode = BuildTopology(&g_vTopology);
+		if(g_dwTopologyErrorCode == 0){
+			g_pTopology = &g_vTopology;
+		}
+		_MCFCRT_SignalOnceFlagAsFinished(&g_vTopologyOnce);
+	}
+	if(!g_pTopology){
+		SetLastError(g_dwTopologyErrorCode);
+		return _MCFCRT_NULLPTR;
+	}
+	return g_pTopology;
+}
+
+static size_t GetSlotFieldOffset(_MCFCRT_ThreadPlacement ePlacement){
+	switch(ePlacement){
+	case _MCFCRT_kThreadPlacementOnePerCore:
+		return __builtin_offsetof(_MCFCRT_LogicalProcessor, __uCore);
+	case _MCFCRT_kThreadPlacementOnePerNode:
+		return __builtin_offsetof(_MCFCRT_LogicalProcessor, __uNumaNode);
+	default:
+		return 0;
+	}
+}
+static size_t GetSlotCount(const _MCFCRT_CpuTopology *pTopology, _MCFCRT_ThreadPlacement ePlacement){
+	switch(ePlacement){
+	case _MCFCRT_kThreadPlacementOnePerCore:
+		return pTopology->__uCoreCount;
+	case _MCFCRT_kThreadPlacementOnePerNode:
+		return pTopology->__uNumaNodeCount;
+	default:
+		return 0;
+	}
+}
+
+size_t _MCFCRT_GetThreadPlacementSlotCount(_MCFCRT_ThreadPlacement ePlacement){
+	if(ePlacement == _MCFCRT_kThreadPlacementNone){
+		return 0;
+	}
+	const _MCFCRT_CpuTopology *const pTopology = _MCFCRT_GetCpuTopology();
+	if(!pTopology){
+		return 0;
+	}
+	return GetSlotCount(pTopology, ePlacement);
+}
+bool _MCFCRT_PlaceThread(_MCFCRT_ThreadHandle hThread, _MCFCRT_ThreadPlacement ePlacement, size_t uIndex){
+	if(ePlacement == _MCFCRT_kThreadPlacementNone){
+		return true;
+	}
+	const size_t uFieldOffset = GetSlotFieldOffset(ePlacement);
+	if(uFieldOffset == 0){
+		SetLastError(ERROR_INVALID_PARAMETER);
+		return false;
+	}
+	const _MCFCRT_CpuTopology *const pTopology = _MCFCRT_GetCpuTopology();
+	if(!pTopology){
+		return false;
+	}
+	const size_t uSlotCount = GetSlotCount(pTopology, ePlacement);
+	if(uSlotCount == 0){
+		SetLastError(ERROR_NOT_SUPPORTED);
+		return false;
+	}
+	const unsigned uSlot = (unsigned)(uIndex % uSlotCount);
+
+	// A slot that spans processor groups is truncated to the group of its first processor.
+	const _MCFCRT_LogicalProcessor *pFirst = _MCFCRT_NULLPTR;
+	uint64_t u64Mask = 0;
+	for(size_t uProcessorIndex = 0; uProcessorIndex < pTopology->__uProcessorCount; ++uProcessorIndex){
+		const _MCFCRT_LogicalProcessor *const pProcessor = pTopology->__pProcessors + uProcessorIndex;
+		if(*(const unsigned *)((const char *)pProcessor + uFieldOffset) != uSlot){
+			continue;
+		}
+		if(!pFirst){
+			pFirst = pProcessor;
+		} else if(pProcessor->__u16Group != pFirst->__u16Group){
+			continue;
+		}
+		u64Mask |= (uint64_t)1 << pProcessor->__u8Number;
+	}
+	if(!pFirst){
+		SetLastError(ERROR_NOT_FOUND);
+		return false;
+	}
+	if(!_MCFCRT_SetThreadAffinity(hThread, pFirst->__u16Group, u64Mask)){
+		return false;
+	}
+	if(!_MCFCRT_SetThreadIdealProcessor(hThread, pFirst->__u16Group, pFirst->__u8Number)){
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,85 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#ifndef __MCFCRT_ENV_CPU_TOPOLOGY_H_
+#define __MCFCRT_ENV_CPU_TOPOLOGY_H_
+
+#include "_crtdef.h"
+#include "thread.h"
+
+_MCFCRT_EXTERN_C_BEGIN
+
+// The topology is queried from the system once, when it is requested for the first time, and is never updated.
+// Cores, packages and NUMA nodes are numbered densely from zero in the order in which the system reports them.
+
+#define _MCFCRT_CPU_TOPOLOGY_NONE   0xFFFFFFFFu
+
+typedef struct __MCFCRT_tagLogicalProcessor {
+	// A logical processor is identified by its processor group and its number within that group.
+	unsigned short __u16Group;
+	unsigned char __u8Number;
+	// Higher values mean higher performance but less efficiency. All processors have the same class on homogeneous systems.
+	unsigned char __u8EfficiencyClass;
+	// Logical processors that share a core are SMT siblings.
+	unsigned __uCore;
+	unsigned __uPackage;
+	unsigned __uNumaNode;
+	// These are indices into the cache array, or `_MCFCRT_CPU_TOPOLOGY_NONE` if there is no such cache.
+	unsigned __uL1DataCache;
+	unsigned __uL2Cache;
+	unsigned __uL3Cache;
+} _MCFCRT_LogicalProcessor;
+
+typedef enum __MCFCRT_tagCpuCacheType {
+	_MCFCRT_kCpuCacheUnified      = 0,
+	_MCFCRT_kCpuCacheInstruction  = 1,
+	_MCFCRT_kCpuCacheData         = 2,
+	_MCFCRT_kCpuCacheTrace        = 3,
+} _MCFCRT_CpuCacheType;
+
+typedef struct __MCFCRT_tagCpuCache {
+	unsigned char __u8Level;
+	unsigned char __u8Associativity;
+	unsigned short __u16LineSize;
+	_MCFCRT_STD uint32_t __u32Size;
+	_MCFCRT_CpuCacheType __eType;
+	// This is the number of logical processors that share this cache.
+	unsigned __uSharingCount;
+} _MCFCRT_CpuCache;
+
+typedef struct __MCFCRT_tagCpuTopology {
+	// Processors are sorted by group, then by number.
+	const _MCFCRT_LogicalProcessor *__pProcessors;
+	_MCFCRT_STD size_t __uProcessorCount;
+	const _MCFCRT_CpuCache *__pCaches;
+	_MCFCRT_STD size_t __uCacheCount;
+	_MCFCRT_STD size_t __uCoreCount;
+	_MCFCRT_STD size_t __uPackageCount;
+	_MCFCRT_STD size_t __uNumaNodeCount;
+} _MCFCRT_CpuTopology;
+
+// This function returns a null pointer on failure, in which case `GetLastError()` tells why. The result is valid until the process exits.
+extern const _MCFCRT_CpuTopology *_MCFCRT_GetCpuTopology(void) _MCFCRT_NOEXCEPT;
+
+typedef enum __MCFCRT_tagThreadPlacement {
+	// The affinity of the thread is not changed.
+	_MCFCRT_kThreadPlacementNone          = 0,
+	// The thread is restricted to all logical processors of one physical core, so threads that are placed with consecutive indices
+	// do not share cores with each other, as long as there are enough cores.
+	_MCFCRT_kThreadPlacementOnePerCore    = 1,
+	// The thread is restricted to the logical processors of one NUMA node.
+	_MCFCRT_kThreadPlacementOnePerNode    = 2,
+} _MCFCRT_ThreadPlacement;
+
+// This function returns the number of distinct slots of a placement policy, which is the number of cores or NUMA nodes.
+// It is a good number of worker threads for a thread pool that places its workers by that policy.
+// It returns zero if the policy is `_MCFCRT_kThreadPlacementNone` or the topology is not available.
+extern _MCFCRT_STD size_t _MCFCRT_GetThreadPlacementSlotCount(_MCFCRT_ThreadPlacement __ePlacement) _MCFCRT_NOEXCEPT;
+// The thread is placed into slot `__uIndex` modulo the number of slots. Its ideal processor is set to the first processor in that slot.
+// This function returns `false` on failure, in which case `GetLastError()` tells why.
+extern bool _MCFCRT_PlaceThread(_MCFCRT_ThreadHandle __hThread, _MCFCRT_ThreadPlacement __ePlacement, _MCFCRT_STD size_t __uIndex) _MCFCRT_NOEXCEPT;
+
+_MCFCRT_EXTERN_C_END
+
+#endif
@@ -0,0 +1,203 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#include "fiber.h"
+#include "mutex.h"
+#include "_seh_top.h"
+#include "xassert.h"
+#include "mcfwin.h"
+
+#define PAGE_SIZE                0x1000u
+#define ALLOCATION_GRANULARITY   0x10000u
+
+#define STACK_POOL_CAPACITY      256u
+
+enum {
+	kStateInvalid   = 0,
+	kStateCreated   = 1,
+	kStateRunning   = 2,
+	kStateSuspended = 3,
+	kStateFinished  = 4,
+};
+
+static inline size_t RoundUpStackSize(size_t uStackSize){
+	if(uStackSize < ALLOCATION_GRANULARITY){
+		return ALLOCATION_GRANULARITY;
+	}
+	return (uStackSize + ALLOCATION_GRANULARITY - 1) & ~(size_t)(ALLOCATION_GRANULARITY - 1);
+}
+
+// Free stacks of the default size are linked through the first word above their guard pages.
+static _MCFCRT_Mutex g_vStackPoolMutex = { 0 };
+static void *g_pStackPoolHead = _MCFCRT_NULLPTR;
+static size_t g_uStackPoolSize = 0;
+
+static void *AllocateStack(size_t uStackSize){
+	if(uStackSize == _MCFCRT_FIBER_DEFAULT_STACK_SIZE){
+		void *pStack = _MCFCRT_NULLPTR;
+		_MCFCRT_WaitForMutexForever(&g_vStackPoolMutex, _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+		{
+			pStack = g_pStackPoolHead;
+			if(pStack){
+				g_pStackPoolHead = *(void **)((char *)pStack + PAGE_SIZE);
+				--g_uStackPoolSize;
+			}
+		}
+		_MCFCRT_SignalMutex(&g_vStackPoolMutex);
+		if(pStack){
+			return pStack;
+		}
+	}
+	void *const pStack = VirtualAlloc(_MCFCRT_NULLPTR, uStackSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	if(!pStack){
+		return _MCFCRT_NULLPTR;
+	}
+	// A stack overflow hits this page and crashes, rather than corrupting the stack below.
+	DWORD dwOldProtect;
+	if(!VirtualProtect(pStack, PAGE_SIZE, PAGE_NOACCESS, &dwOldProtect)){
+		const DWORD dwErrorCode = GetLastError();
+		VirtualFree(pStack, 0, MEM_RELEASE);
+		SetLastError(dwErrorCode);
+		return _MCFCRT_NULLPTR;
+	}
+	return pStack;
+}
+static void FreeStack(void *pStack, size_t uStackSize){
+	if(uStackSize == _MCFCRT_FIBER_DEFAULT_STACK_SIZE){
+		bool bPooled = false;
+		_MCFCRT_WaitForMutexForever(&g_vStackPoolMutex, _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+		{
+			if(g_uStackPoolSize < STACK_POOL_CAPACITY){
+				*(void **)((char *)pStack + PAGE_SIZE) = g_pStackPoolHead;
+				g_pStackPoolHead = pStack;
+				++g_uStackPoolSize;
+				bPooled = true;
+			}
+		}
+		_MCFCRT_SignalMutex(&g_vStackPoolMutex);
+		if(bPooled){
+			return;
+		}
+	}
+	const bool bSucceeded = VirtualFree(pStack, 0, MEM_RELEASE);
+	_MCFCRT_ASSERT(bSucceeded);
+}
+
+static inline NT_TIB *GetTib(void){
+	return (NT_TIB *)NtCurrentTeb();
+}
+static inline void SaveTib(_MCFCRT_Fiber *pFiber){
+	const NT_TIB *const pTib = GetTib();
+	pFiber->__pExceptionList = pTib->ExceptionList;
+	pFiber->__pStackBase     = pTib->StackBase;
+	pFiber->__pStackLimit    = pTib->StackLimit;
+}
+static inline void LoadTib(const _MCFCRT_Fiber *pFiber){
+	NT_TIB *const pTib = GetTib();
+	pTib->ExceptionList = pFiber->__pExceptionList;
+	pTib->StackBase     = pFiber->__pStackBase;
+	pTib->StackLimit    = pFiber->__pStackLimit;
+}
+
+__attribute__((__noreturn__, __force_align_arg_pointer__, __used__))
+static void FiberTrampoline(_MCFCRT_Fiber *pFiber){
+	__MCFCRT_SEH_TOP_BEGIN
+	{
+		(*(pFiber->__pfnProc))(pFiber->__nContext);
+	}
+	__MCFCRT_SEH_TOP_END
+
+	pFiber->__uState = kStateFinished;
+	_MCFCRT_Fiber *const pCaller = pFiber->__pCaller;
+	pCaller->__uState = kStateRunning;
+	LoadTib(pCaller);
+	_MCFCRT_LONGJMP(pCaller->__vJmpBuf);
+}
+
+// The fake return address of zero terminates stack walks at the trampoline.
+__attribute__((__noreturn__, __noinline__))
+static void JumpToNewStack(void *pStackTop, _MCFCRT_Fiber *pFiber){
+#ifdef _WIN64
+	__asm__ volatile (
+		"mov rsp, %0 \n"
+		"sub rsp, 32 \n"
+		"push 0 \n"
+		"jmp rax \n"
+		: : "r"(pStackTop), "c"(pFiber), "a"(&FiberTrampoline)
+		: "memory"
+	);
+#else
+	__asm__ volatile (
+		"mov esp, %0 \n"
+		"and esp, -16 \n"
+		"sub esp, 12 \n"
+		"push ecx \n"
+		"push 0 \n"
+		"jmp eax \n"
+		: : "r"(pStackTop), "c"(pFiber), "a"(&FiberTrampoline)
+		: "memory"
+	);
+#endif
+	__builtin_unreachable();
+}
+
+void _MCFCRT_InitializeThreadFiber(_MCFCRT_Fiber *pFiber){
+	pFiber->__pStackAllocation = _MCFCRT_NULLPTR;
+	pFiber->__uStackSize       = 0;
+	pFiber->__pfnProc          = _MCFCRT_NULLPTR;
+	pFiber->__nContext         = 0;
+	pFiber->__pCaller          = _MCFCRT_NULLPTR;
+	pFiber->__uState           = kStateRunning;
+	SaveTib(pFiber);
+}
+bool _MCFCRT_CreateFiber(_MCFCRT_Fiber *pFiber, _MCFCRT_FiberProc pfnProc, intptr_t nContext, size_t uStackSize){
+	const size_t uRealStackSize = RoundUpStackSize(uStackSize);
+	void *const pStack = AllocateStack(uRealStackSize);
+	if(!pStack){
+		return false;
+	}
+	pFiber->__pExceptionList   = (void *)-1;
+	pFiber->__pStackBase       = (char *)pStack + uRealStackSize;
+	pFiber->__pStackLimit      = (char *)pStack + PAGE_SIZE;
+	pFiber->__pStackAllocation = pStack;
+	pFiber->__uStackSize       = uRealStackSize;
+	pFiber->__pfnProc          = pfnProc;
+	pFiber->__nContext         = nContext;
+	pFiber->__pCaller          = _MCFCRT_NULLPTR;
+	pFiber->__uState           = kStateCreated;
+	return true;
+}
+void _MCFCRT_DestroyFiber(_MCFCRT_Fiber *pFiber){
+	_MCFCRT_ASSERT_MSG(pFiber->__uState != kStateRunning, L"不能销毁正在运行的纤程。");
+
+	void *const pStack = pFiber->__pStackAllocation;
+	if(pStack){
+		FreeStack(pStack, pFiber->__uStackSize);
+	}
+	pFiber->__pStackAllocation = _MCFCRT_NULLPTR;
+	pFiber->__uState = kStateInvalid;
+}
+
+void _MCFCRT_SwitchToFiber(_MCFCRT_Fiber *pFrom, _MCFCRT_Fiber *pTo){
+	_MCFCRT_ASSERT_MSG(pFrom->__uState == kStateRunning, L"源纤程没有在运行。");
+	_MCFCRT_ASSERT_MSG((pTo->__uState == kStateCreated) || (pTo->__uState == kStateSuspended), L"目标纤程不能被切换到。");
+
+	SaveTib(pFrom);
+	pFrom->__uState = kStateSuspended;
+	if(_MCFCRT_SETJMP(pFrom->__vJmpBuf) != 0){
+		// Whoever switched back to us has restored our state and our TIB.
+		return;
+	}
+	const unsigned uOldState = pTo->__uState;
+	pTo->__pCaller = pFrom;
+	pTo->__uState = kStateRunning;
+	LoadTib(pTo);
+	if(uOldState == kStateCreated){
+		JumpToNewStack(pTo->__pStackBase, pTo);
+	}
+	_MCFCRT_LONGJMP(pTo->__vJmpBuf);
+}
+bool _MCFCRT_IsFiberFinished(const _MCFCRT_Fiber *pFiber){
+	return pFiber->__uState == kStateFinished;
+}
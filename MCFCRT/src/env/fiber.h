@@ -0,0 +1,52 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#ifndef __MCFCRT_ENV_FIBER_H_
+#define __MCFCRT_ENV_FIBER_H_
+
+#include "_crtdef.h"
+#include "xsetjmp.h"
+
+_MCFCRT_EXTERN_C_BEGIN
+
+// These are user-mode fibers that switch with `_MCFCRT_SETJMP()` and `_MCFCRT_LONGJMP()`. No kernel object is involved.
+// The stack bounds and the SEH chain in the TIB are switched along with the fiber, so exceptions and stack probes work on fiber stacks.
+// A suspended fiber may be resumed on a thread other than the one on which it was suspended.
+
+typedef void (*_MCFCRT_FiberProc)(_MCFCRT_STD intptr_t __nContext);
+
+typedef struct __MCFCRT_tagFiber {
+	_MCFCRT_jmp_buf __vJmpBuf;
+	void *__pExceptionList;
+	void *__pStackBase;
+	void *__pStackLimit;
+	void *__pStackAllocation;
+	_MCFCRT_STD size_t __uStackSize;
+	_MCFCRT_FiberProc __pfnProc;
+	_MCFCRT_STD intptr_t __nContext;
+	struct __MCFCRT_tagFiber *__pCaller;
+	unsigned __uState;
+} _MCFCRT_Fiber;
+
+// Stack sizes are rounded up to the allocation granularity, and include a guard page at the bottom.
+// Stacks of the default size are recycled through a process-wide pool.
+#define _MCFCRT_FIBER_DEFAULT_STACK_SIZE   0x10000u
+
+// This function makes the calling thread itself a fiber, so it can switch to other fibers. It does not allocate a stack.
+extern void _MCFCRT_InitializeThreadFiber(_MCFCRT_Fiber *__pFiber) _MCFCRT_NOEXCEPT;
+// The new fiber does not start running until it is switched to for the first time.
+// When `__pfnProc` returns, the fiber finishes, and control returns to the fiber that switched to it most recently.
+// Exceptions must not escape from `__pfnProc`.
+// This function returns `false` on failure, in which case `GetLastError()` tells why.
+extern bool _MCFCRT_CreateFiber(_MCFCRT_Fiber *__pFiber, _MCFCRT_FiberProc __pfnProc, _MCFCRT_STD intptr_t __nContext, _MCFCRT_STD size_t __uStackSize) _MCFCRT_NOEXCEPT;
+// A fiber that has been suspended before finishing may be destroyed, but objects on its stack are not destroyed.
+extern void _MCFCRT_DestroyFiber(_MCFCRT_Fiber *__pFiber) _MCFCRT_NOEXCEPT;
+
+// `__pFrom` shall be the fiber that is running on the calling thread. It is suspended until another fiber switches back to it.
+extern void _MCFCRT_SwitchToFiber(_MCFCRT_Fiber *__pFrom, _MCFCRT_Fiber *__pTo) _MCFCRT_NOEXCEPT;
+extern bool _MCFCRT_IsFiberFinished(const _MCFCRT_Fiber *__pFiber) _MCFCRT_NOEXCEPT;
+
+_MCFCRT_EXTERN_C_END
+
+#endif
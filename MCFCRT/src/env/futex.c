@@ -0,0 +1,208 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#include "futex.h"
+#include "mutex.h"
+#include "_nt_timeout.h"
+#include "xassert.h"
+#include "expect.h"
+#include <ntdef.h>
+
+__attribute__((__dllimport__, __stdcall__))
+extern NTSTATUS NtWaitForKeyedEvent(HANDLE hKeyedEvent, void *pKey, BOOLEAN bAlertable, const LARGE_INTEGER *pliTimeout);
+__attribute__((__dllimport__, __stdcall__))
+extern NTSTATUS NtReleaseKeyedEvent(HANDLE hKeyedEvent, void *pKey, BOOLEAN bAlertable, const LARGE_INTEGER *pliTimeout);
+
+__attribute__((__dllimport__, __stdcall__, __const__))
+extern BOOLEAN RtlDllShutdownInProgress(void);
+
+// Each waiting thread links a node on its own stack into a bucket, then waits on the address of the node.
+// A node may only be unlinked with its bucket locked. Once it has been unlinked by a waker, the waker will release it exactly once.
+typedef struct tagWaitNode {
+	struct tagWaitNode *pPrev;
+	struct tagWaitNode *pNext;
+	volatile void *pAddress;
+} WaitNode;
+
+typedef struct tagWaitBucket {
+	alignas(64) _MCFCRT_Mutex vMutex;
+	WaitNode *pFirst;
+	WaitNode *pLast;
+} WaitBucket;
+
+#define BUCKET_COUNT_LOG2   8u
+#define BUCKET_COUNT        (1u << BUCKET_COUNT_LOG2)
+
+static WaitBucket g_aBuckets[BUCKET_COUNT];
+
+static inline WaitBucket *GetBucket(volatile void *pAddress){
+	// Fibonacci hashing. The low bits are discarded because they are usually zero.
+#ifdef _WIN64
+	const uint64_t uHash = ((uint64_t)(uintptr_t)pAddress >> 2) * 0x9E3779B97F4A7C15u;
+	return g_aBuckets + (size_t)(uHash >> (64 - BUCKET_COUNT_LOG2));
+#else
+	const uint32_t uHash = ((uint32_t)(uintptr_t)pAddress >> 2) * 0x9E3779B9u;
+	return g_aBuckets + (size_t)(uHash >> (32 - BUCKET_COUNT_LOG2));
+#endif
+}
+
+static inline void LockBucket(WaitBucket *pBucket){
+	_MCFCRT_WaitForMutexForever(&(pBucket->vMutex), _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+}
+static inline void UnlockBucket(WaitBucket *pBucket){
+	_MCFCRT_SignalMutex(&(pBucket->vMutex));
+}
+
+static inline void AppendNode(WaitBucket *pBucket, WaitNode *pNode){
+	WaitNode *const pPrev = pBucket->pLast;
+	pNode->pPrev = pPrev;
+	pNode->pNext = _MCFCRT_NULLPTR;
+	if(pPrev){
+		pPrev->pNext = pNode;
+	} else {
+		pBucket->pFirst = pNode;
+	}
+	pBucket->pLast = pNode;
+}
+static inline void RemoveNode(WaitBucket *pBucket, WaitNode *pNode){
+	WaitNode *const pPrev = pNode->pPrev;
+	WaitNode *const pNext = pNode->pNext;
+	if(pPrev){
+		pPrev->pNext = pNext;
+	} else {
+		pBucket->pFirst = pNext;
+	}
+	if(pNext){
+		pNext->pPrev = pPrev;
+	} else {
+		pBucket->pLast = pPrev;
+	}
+	// Mark it as unlinked.
+	pNode->pAddress = _MCFCRT_NULLPTR;
+}
+
+static inline bool IsValueUndesired(volatile void *pAddress, const void *pUndesiredValue, size_t uSize){
+	switch(uSize){
+	case 1:
+		return __atomic_load_n((volatile uint8_t *)pAddress, __ATOMIC_SEQ_CST) == *(const uint8_t *)pUndesiredValue;
+	case 2:
+		return __atomic_load_n((volatile uint16_t *)pAddress, __ATOMIC_SEQ_CST) == *(const uint16_t *)pUndesiredValue;
+	case 4:
+		return __atomic_load_n((volatile uint32_t *)pAddress, __ATOMIC_SEQ_CST) == *(const uint32_t *)pUndesiredValue;
+	case 8:
+		return __atomic_load_n((volatile uint64_t *)pAddress, __ATOMIC_SEQ_CST) == *(const uint64_t *)pUndesiredValue;
+	default:
+		_MCFCRT_ASSERT_MSG(false, L"不支持的大小。");
+		__builtin_unreachable();
+	}
+}
+
+__attribute__((__always_inline__))
+static inline bool ReallyWaitForAddress(volatile void *pAddress, const void *pUndesiredValue, size_t uSize, bool bMayTimeOut, uint64_t u64UntilFastMonoClock){
+	_MCFCRT_ASSERT_MSG(pAddress, L"地址不能为空。");
+	_MCFCRT_ASSERT_MSG(((uintptr_t)pAddress & (uSize - 1)) == 0, L"地址没有对齐。");
+
+	WaitBucket *const pBucket = GetBucket(pAddress);
+	WaitNode vNode;
+	LockBucket(pBucket);
+	{
+		// A waker has to lock the bucket before it can wake us up, so this check is atomic with respect to it.
+		if(!IsValueUndesired(pAddress, pUndesiredValue, uSize)){
+			UnlockBucket(pBucket);
+			return true;
+		}
+		vNode.pAddress = pAddress;
+		AppendNode(pBucket, &vNode);
+	}
+	UnlockBucket(pBucket);
+
+	if(!bMayTimeOut){
+		NTSTATUS lStatus = NtWaitForKeyedEvent(_MCFCRT_NULLPTR, &vNode, false, _MCFCRT_NULLPTR);
+		_MCFCRT_ASSERT_MSG(NT_SUCCESS(lStatus), L"NtWaitForKeyedEvent() 失败。");
+		_MCFCRT_ASSERT(lStatus != STATUS_TIMEOUT);
+		return true;
+	}
+	LARGE_INTEGER liTimeout;
+	__MCFCRT_InitializeNtTimeout(&liTimeout, u64UntilFastMonoClock);
+	NTSTATUS lStatus = NtWaitForKeyedEvent(_MCFCRT_NULLPTR, &vNode, false, &liTimeout);
+	_MCFCRT_ASSERT_MSG(NT_SUCCESS(lStatus), L"NtWaitForKeyedEvent() 失败。");
+	if(_MCFCRT_EXPECT(lStatus == STATUS_TIMEOUT)){
+		bool bUnlinked;
+		LockBucket(pBucket);
+		{
+			bUnlinked = vNode.pAddress != _MCFCRT_NULLPTR;
+			if(bUnlinked){
+				RemoveNode(pBucket, &vNode);
+			}
+		}
+		UnlockBucket(pBucket);
+		if(bUnlinked){
+			return false;
+		}
+		// We have been unlinked by a waker, which is going to release us. Wait for it, otherwise it would block forever.
+		lStatus = NtWaitForKeyedEvent(_MCFCRT_NULLPTR, &vNode, false, _MCFCRT_NULLPTR);
+		_MCFCRT_ASSERT_MSG(NT_SUCCESS(lStatus), L"NtWaitForKeyedEvent() 失败。");
+		_MCFCRT_ASSERT(lStatus != STATUS_TIMEOUT);
+	}
+	return true;
+}
+
+__attribute__((__always_inline__))
+static inline size_t ReallyWakeByAddress(volatile void *pAddress, size_t uMaxCountToWake){
+	WaitBucket *const pBucket = GetBucket(pAddress);
+	// Nodes are collected into a singly linked list, which is then walked with the bucket unlocked.
+	WaitNode *pWakeFirst = _MCFCRT_NULLPTR;
+	WaitNode **ppWakeLast = &pWakeFirst;
+	size_t uCountToWake = 0;
+	LockBucket(pBucket);
+	{
+		WaitNode *pNext = pBucket->pFirst;
+		while(pNext && (uCountToWake < uMaxCountToWake)){
+			WaitNode *const pNode = pNext;
+			pNext = pNode->pNext;
+			if(pNode->pAddress != pAddress){
+				continue;
+			}
+			RemoveNode(pBucket, pNode);
+			// `pNode->pPrev` is no longer used by anyone other than us.
+			*ppWakeLast = pNode;
+			ppWakeLast = &(pNode->pPrev);
+			++uCountToWake;
+		}
+		*ppWakeLast = _MCFCRT_NULLPTR;
+	}
+	UnlockBucket(pBucket);
+
+	// If `RtlDllShutdownInProgress()` is `true`, other threads will have been terminated.
+	// Calling `NtReleaseKeyedEvent()` when no thread is waiting results in deadlocks. Don't do that.
+	if(RtlDllShutdownInProgress()){
+		return uCountToWake;
+	}
+	WaitNode *pNext = pWakeFirst;
+	while(pNext){
+		WaitNode *const pNode = pNext;
+		// Read the link before the node is released, as it lives on the stack of the thread being woken up.
+		pNext = pNode->pPrev;
+		NTSTATUS lStatus = NtReleaseKeyedEvent(_MCFCRT_NULLPTR, pNode, false, _MCFCRT_NULLPTR);
+		_MCFCRT_ASSERT_MSG(NT_SUCCESS(lStatus), L"NtReleaseKeyedEvent() 失败。");
+		_MCFCRT_ASSERT(lStatus != STATUS_TIMEOUT);
+	}
+	return uCountToWake;
+}
+
+bool _MCFCRT_WaitForAddress(volatile void *pAddress, const void *pUndesiredValue, size_t uSize, uint64_t u64UntilFastMonoClock){
+	const bool bWoken = ReallyWaitForAddress(pAddress, pUndesiredValue, uSize, true, u64UntilFastMonoClock);
+	return bWoken;
+}
+void _MCFCRT_WaitForAddressForever(volatile void *pAddress, const void *pUndesiredValue, size_t uSize){
+	const bool bWoken = ReallyWaitForAddress(pAddress, pUndesiredValue, uSize, false, UINT64_MAX);
+	_MCFCRT_ASSERT(bWoken);
+}
+
+size_t _MCFCRT_WakeByAddressSingle(volatile void *pAddress){
+	return ReallyWakeByAddress(pAddress, 1);
+}
+size_t _MCFCRT_WakeByAddressAll(volatile void *pAddress){
+	return ReallyWakeByAddress(pAddress, SIZE_MAX);
+}
@@ -0,0 +1,28 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#ifndef __MCFCRT_ENV_FUTEX_H_
+#define __MCFCRT_ENV_FUTEX_H_
+
+#include "_crtdef.h"
+
+_MCFCRT_EXTERN_C_BEGIN
+
+// These functions resemble `WaitOnAddress()`, `WakeByAddressSingle()` and `WakeByAddressAll()`, but are available on all versions of Windows.
+// Waiting threads are hashed by address into a fixed set of buckets, hence no resource is allocated for any address.
+// `__uSize` shall be 1, 2, 4 or 8, and `__pAddress` shall be aligned to it.
+
+// If the value at `__pAddress` does not equal `*__pUndesiredValue`, this function returns `true` immediately.
+// Otherwise the calling thread is blocked until it is woken up, in which case `true` is returned, or until it times out, in which case `false` is returned.
+// Spurious wakeups are not possible, but the value should be checked again anyway, as it might have been changed back.
+extern bool _MCFCRT_WaitForAddress(volatile void *__pAddress, const void *__pUndesiredValue, _MCFCRT_STD size_t __uSize, _MCFCRT_STD uint64_t __u64UntilFastMonoClock) _MCFCRT_NOEXCEPT;
+extern void _MCFCRT_WaitForAddressForever(volatile void *__pAddress, const void *__pUndesiredValue, _MCFCRT_STD size_t __uSize) _MCFCRT_NOEXCEPT;
+
+// These functions return the number of threads that have been woken up. Threads are woken up in the order they started waiting.
+extern _MCFCRT_STD size_t _MCFCRT_WakeByAddressSingle(volatile void *__pAddress) _MCFCRT_NOEXCEPT;
+extern _MCFCRT_STD size_t _MCFCRT_WakeByAddressAll(volatile void *__pAddress) _MCFCRT_NOEXCEPT;
+
+_MCFCRT_EXTERN_C_END
+
+#endif
@@ -4,8 +4,9 @@
 
 #include "heap.h"
 #include "mcfwin.h"
-#include "mutex.h"
+#include "_heap_impl.h"
 #include "heap_debug.h"
+#include "heap_profiler.h"
 #include "inline_mem.h"
 #include "bail.h"
 
@@ -15,13 +16,16 @@
 #endif
 
 static inline void *Underlying_malloc_zf(size_t size, bool zero_fill){
-	return LocalAlloc(zero_fill ? LPTR : LMEM_FIXED, size);
+	return __MCFCRT_HeapImplAlloc(size, zero_fill);
 }
 static inline void *Underlying_realloc_zf(void *ptr, size_t size, bool zero_fill){
-	return LocalReAlloc(ptr, size, zero_fill ? LPTR : LMEM_FIXED);
+	return __MCFCRT_HeapImplRealloc(ptr, size, zero_fill);
 }
 static inline void Underlying_free(void *ptr){
-	LocalFree(ptr);
+	__MCFCRT_HeapImplFree(ptr);
+}
+static inline void Underlying_free_sized(void *ptr, size_t size){
+	__MCFCRT_HeapImplFreeSized(ptr, size);
 }
 
 static inline void InvokeHeapCallback(void *pBlockNew, size_t uSizeNew, void *pBlockOld, const void *pRetAddrOuter, const void *pRetAddrInner){
@@ -86,6 +90,9 @@ void *__MCFCRT_HeapRealloc(void *pBlockOld, size_t uSizeNew, bool bFillsWithZero
 	pStorageOld = pBlockOld;
 	uSizeToAlloc = uSizeNew;
 #endif
+	// The old block may be freed by the reallocation, after which its address may be reused by another thread.
+	__MCFCRT_HeapProfilerSample vSample;
+	const bool bSampled = __MCFCRT_HeapProfilerRemoveSample(&vSample, pBlockOld);
 	// Perform the reallocation.
 	pStorageNew = Underlying_realloc_zf(pStorageOld, uSizeToAlloc, bFillsWithZero);
 	if(!pStorageNew){
@@ -93,6 +100,9 @@ void *__MCFCRT_HeapRealloc(void *pBlockOld, size_t uSizeNew, bool bFillsWithZero
 		// Stuff it back...
 		__MCFCRT_HeapDebugUndoUnregister(pStorageOld);
 #endif
+		if(bSampled){
+			__MCFCRT_HeapProfilerRestoreSample(&vSample, pBlockOld);
+		}
 		return _MCFCRT_NULLPTR;
 	}
 #ifdef __MCFCRT_HEAP_DEBUG
@@ -129,6 +139,112 @@ void __MCFCRT_HeapFree(void *pBlockOld, const void *pRetAddrOuter){
 	(void)uSizeOld;
 	pStorageOld = pBlockOld;
 #endif
+	// Remove the sample of the old block, if any, before its address can be reused.
+	__MCFCRT_HeapProfilerRemoveSample(_MCFCRT_NULLPTR, pBlockOld);
+	// Perform the deallocation.
+	Underlying_free(pStorageOld);
+
+	// Invoke the heap callback in the end, if any.
+	InvokeHeapCallback(_MCFCRT_NULLPTR, 0, pBlockOld, pRetAddrOuter, __builtin_return_address(0));
+}
+
+void __MCFCRT_HeapFreeSized(void *pBlockOld, size_t uSizeOld, const void *pRetAddrOuter){
+	size_t uSizeToFree;
+	void *pStorageOld;
+
+#ifdef __MCFCRT_HEAP_DEBUG
+	size_t uSizeRegistered;
+	// Clobber the per-thread error code unconditionally in debug mode.
+	SetLastError(0xDEADBEEF);
+	// Make sure the old block is not corrupted.
+	if(!__MCFCRT_HeapDebugValidateAndUnregister(&uSizeRegistered, &pStorageOld, pBlockOld)){
+		_MCFCRT_Bail(L"__MCFCRT_HeapFreeSized() 检测到堆损坏，这通常是错误的内存写入操作导致的。");
+	}
+	if(uSizeRegistered != uSizeOld){
+		_MCFCRT_Bail(L"__MCFCRT_HeapFreeSized() 检测到传入的大小与内存块的实际大小不符。");
+	}
+	if(uSizeOld > 0){
+		// If any bytes are to be freed, poison those that are to be discarded.
+		_MCFCRT_inline_mempset_fwd(pBlockOld, 0xDD, uSizeOld);
+	}
+	// Include the size of additional debug information.
+	uSizeToFree = __MCFCRT_HeapDebugCalculateSizeToAlloc(uSizeOld);
+#else
+	pStorageOld = pBlockOld;
+	uSizeToFree = uSizeOld;
+#endif
+	// Remove the sample of the old block, if any, before its address can be reused.
+	__MCFCRT_HeapProfilerRemoveSample(_MCFCRT_NULLPTR, pBlockOld);
+	// Perform the deallocation.
+	Underlying_free_sized(pStorageOld, uSizeToFree);
+
+	// Invoke the heap callback in the end, if any.
+	InvokeHeapCallback(_MCFCRT_NULLPTR, 0, pBlockOld, pRetAddrOuter, __builtin_return_address(0));
+}
+
+void *__MCFCRT_HeapAllocAligned(size_t uAlignment, size_t uSizeNew, bool bFillsWithZero, const void *pRetAddrOuter){
+	size_t uSizeToAlloc;
+	void *pStorageNew, *pBlockNew;
+
+	if((uAlignment & (uAlignment - 1)) != 0){
+		SetLastError(ERROR_INVALID_PARAMETER);
+		return _MCFCRT_NULLPTR;
+	}
+#ifdef __MCFCRT_HEAP_DEBUG
+	// Clobber the per-thread error code unconditionally in debug mode.
+	SetLastError(0xDEADBEEF);
+	// Include the size of additional debug information, as well as padding.
+	uSizeToAlloc = __MCFCRT_HeapDebugCalculateSizeToAllocAligned(uSizeNew, uAlignment);
+#else
+	// Underlying blocks are aligned to 16-byte boundaries. Reserve space for at least one pointer before the payload.
+	const size_t uEffectiveAlignment = (uAlignment < 16) ? 16 : uAlignment;
+	if(__builtin_add_overflow(uSizeNew, uEffectiveAlignment, &uSizeToAlloc)){
+		uSizeToAlloc = SIZE_MAX;
+	}
+#endif
+	// Perform the allocation.
+	pStorageNew = Underlying_malloc_zf(uSizeToAlloc, bFillsWithZero);
+	if(!pStorageNew){
+		return _MCFCRT_NULLPTR;
+	}
+#ifdef __MCFCRT_HEAP_DEBUG
+	// Register it and adjust the pointer.
+	__MCFCRT_HeapDebugRegisterAligned(&pBlockNew, uSizeNew, uAlignment, pStorageNew, pRetAddrOuter, __builtin_return_address(0));
+	if(!bFillsWithZero && (uSizeNew > 0)){
+		// If any bytes have been allocated, poison those that are considered uninitialized.
+		_MCFCRT_inline_mempset_fwd(pBlockNew, 0xCA, uSizeNew);
+	}
+#else
+	// Align the pointer and save the address of the underlying block immediately before it.
+	pBlockNew = (void *)(((uintptr_t)pStorageNew + uEffectiveAlignment) & ~(uintptr_t)(uEffectiveAlignment - 1));
+	((void **)pBlockNew)[-1] = pStorageNew;
+#endif
+
+	// Invoke the heap callback in the end, if any.
+	InvokeHeapCallback(pBlockNew, uSizeNew, _MCFCRT_NULLPTR, pRetAddrOuter, __builtin_return_address(0));
+	return pBlockNew;
+}
+void __MCFCRT_HeapFreeAligned(void *pBlockOld, const void *pRetAddrOuter){
+	size_t uSizeOld;
+	void *pStorageOld;
+
+#ifdef __MCFCRT_HEAP_DEBUG
+	// Clobber the per-thread error code unconditionally in debug mode.
+	SetLastError(0xDEADBEEF);
+	// Make sure the old block is not corrupted.
+	if(!__MCFCRT_HeapDebugValidateAndUnregisterAligned(&uSizeOld, &pStorageOld, pBlockOld)){
+		_MCFCRT_Bail(L"__MCFCRT_HeapFreeAligned() 检测到堆损坏，这通常是错误的内存写入操作导致的。");
+	}
+	if(uSizeOld > 0){
+		// If any bytes are to be freed, poison those that are to be discarded.
+		_MCFCRT_inline_mempset_fwd(pBlockOld, 0xDD, uSizeOld);
+	}
+#else
+	(void)uSizeOld;
+	pStorageOld = ((void **)pBlockOld)[-1];
+#endif
+	// Remove the sample of the old block, if any, before its address can be reused.
+	__MCFCRT_HeapProfilerRemoveSample(_MCFCRT_NULLPTR, pBlockOld);
 	// Perform the deallocation.
 	Underlying_free(pStorageOld);
 
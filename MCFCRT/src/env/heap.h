@@ -16,6 +16,17 @@ extern void *__MCFCRT_HeapRealloc(void *__pBlockOld, _MCFCRT_STD size_t __uSizeN
 __attribute__((__nonnull__(1)))
 extern void __MCFCRT_HeapFree(void *__pBlockOld, const void *__pRetAddrOuter) _MCFCRT_NOEXCEPT;
 
+// `__uSizeOld` shall be the size that was passed to the allocation or reallocation function which returned this block. The allocator need not look it up.
+__attribute__((__nonnull__(1)))
+extern void __MCFCRT_HeapFreeSized(void *__pBlockOld, _MCFCRT_STD size_t __uSizeOld, const void *__pRetAddrOuter) _MCFCRT_NOEXCEPT;
+
+// `__uAlignment` shall be a power of two. Blocks allocated this way cannot be reallocated, and shall only be freed using `__MCFCRT_HeapFreeAligned()`.
+__attribute__((__malloc__))
+extern void *__MCFCRT_HeapAllocAligned(_MCFCRT_STD size_t __uAlignment, _MCFCRT_STD size_t __uSizeNew, bool __bFillsWithZero, const void *__pRetAddrOuter) _MCFCRT_NOEXCEPT;
+__attribute__((__nonnull__(1)))
+extern void __MCFCRT_HeapFreeAligned(void *__pBlockOld, const void *__pRetAddrOuter) _MCFCRT_NOEXCEPT;
+
+// For reallocation, `__pBlockNew` equals `__pBlockOld` if the block has been resized in place, without its contents copied.
 typedef void (*_MCFCRT_HeapCallback)(void *__pBlockNew, _MCFCRT_STD size_t __uSizeNew, void *__pBlockOld, const void *__pRetAddrOuter, const void *__pRetAddrInner);
 
 extern _MCFCRT_HeapCallback _MCFCRT_GetHeapCallback(void) _MCFCRT_NOEXCEPT;
@@ -52,6 +63,28 @@ static inline void _MCFCRT_free(void *__ptr) _MCFCRT_NOEXCEPT {
 	__MCFCRT_HeapFree(__ptr,
 		__builtin_return_address(0));
 }
+__attribute__((__always_inline__))
+static inline void _MCFCRT_free_sized(void *__ptr, _MCFCRT_STD size_t __size) _MCFCRT_NOEXCEPT {
+	if(!__ptr){
+		return;
+	}
+	__MCFCRT_HeapFreeSized(__ptr, __size,
+		__builtin_return_address(0));
+}
+
+__attribute__((__always_inline__, __malloc__))
+static inline void *_MCFCRT_aligned_alloc(_MCFCRT_STD size_t __alignment, _MCFCRT_STD size_t __size) _MCFCRT_NOEXCEPT {
+	return __MCFCRT_HeapAllocAligned(__alignment, __size, false,
+		__builtin_return_address(0));
+}
+__attribute__((__always_inline__))
+static inline void _MCFCRT_aligned_free(void *__ptr) _MCFCRT_NOEXCEPT {
+	if(!__ptr){
+		return;
+	}
+	__MCFCRT_HeapFreeAligned(__ptr,
+		__builtin_return_address(0));
+}
 
 _MCFCRT_EXTERN_C_END
 
@@ -9,6 +9,7 @@
 #include "standard_streams.h"
 #include "bail.h"
 #include "clocks.h"
+#include "xassert.h"
 #include "../ext/wcpcpy.h"
 #include "../ext/itow.h"
 
@@ -18,7 +19,9 @@ typedef struct tagBlockHeader {
 	const void *pRetAddrOuter;
 	const void *pRetAddrInner;
 	uintptr_t uCookie;
-	uintptr_t uReserved;
+	// For blocks allocated with an alignment, the most significant bit that is set is the alignment and the others make up the offset of this header
+	// from the beginning of the underlying storage. This is zero for other blocks.
+	uintptr_t uAlignmentOffset;
 	unsigned char abySentry[16];
 } BlockHeader;
 
@@ -67,31 +70,71 @@ static bool CheckSentry(uintptr_t uCookie, const unsigned char *pbyData, size_t
 	return true;
 }
 
-static _MCFCRT_Mutex g_vMutex = { 0 };
-static _MCFCRT_AvlRoot g_avlBlocks = _MCFCRT_NULLPTR;
+// Blocks are distributed into shards by the hash of their addresses. Each shard has its own mutex, so threads allocating concurrently rarely contend.
+#define SHARD_COUNT   64u
+
+typedef struct tagRegistryShard {
+	alignas(64) _MCFCRT_Mutex vMutex;
+	_MCFCRT_AvlRoot avlBlocks;
+} RegistryShard;
+
+static RegistryShard g_aShards[SHARD_COUNT];
+
+static inline RegistryShard *GetShard(const BlockHeader *pHeader){
+	// Headers are aligned to 16-byte boundaries, so the low bits carry no information.
+	uint32_t u32Hash = (uint32_t)((uintptr_t)pHeader >> 4);
+#ifdef _WIN64
+	u32Hash ^= (uint32_t)((uintptr_t)pHeader >> 36);
+#endif
+	// Fibonacci hashing.
+	u32Hash *= 0x9E3779B9u;
+	static_assert((SHARD_COUNT & (SHARD_COUNT - 1)) == 0, "SHARD_COUNT must be a power of two.");
+	return g_aShards + (u32Hash >> (32 - __builtin_ctz(SHARD_COUNT)));
+}
+
+static inline void AttachBlock(BlockHeader *pHeader){
+	RegistryShard *const pShard = GetShard(pHeader);
+	_MCFCRT_WaitForMutexForever(&(pShard->vMutex), _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+	_MCFCRT_AvlAttach(&(pShard->avlBlocks), (_MCFCRT_AvlNodeHeader *)pHeader, &BlockHeaderComparatorNodes);
+	_MCFCRT_SignalMutex(&(pShard->vMutex));
+}
+static inline bool FindAndDetachBlock(BlockHeader *pHeader){
+	RegistryShard *const pShard = GetShard(pHeader);
+	_MCFCRT_WaitForMutexForever(&(pShard->vMutex), _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+	BlockHeader *const pHeaderFound = (BlockHeader *)_MCFCRT_AvlFind(&(pShard->avlBlocks), (intptr_t)pHeader, &BlockHeaderComparatorNodeHeader);
+	if(pHeaderFound != pHeader){
+		_MCFCRT_SignalMutex(&(pShard->vMutex));
+		return false;
+	}
+	_MCFCRT_AvlDetach((_MCFCRT_AvlNodeHeader *)pHeader);
+	_MCFCRT_SignalMutex(&(pShard->vMutex));
+	return true;
+}
 
 static void CheckForMemoryLeaksUnlocked(void){
 	wchar_t awcLine[1024];
 	uintptr_t uCount = 0;
-	const BlockHeader *pHeader = (BlockHeader *)_MCFCRT_AvlFront(&g_avlBlocks);
-	while(pHeader){
-		++uCount;
-		if(uCount <= 9999){
-			wchar_t *pwcWrite = awcLine;
-			pwcWrite = _MCFCRT_wcpcpy(pwcWrite, L"*** Memory leak ");
-			pwcWrite = _MCFCRT_itow0u(pwcWrite, uCount, 4);
-			pwcWrite = _MCFCRT_wcpcpy(pwcWrite, L": address = 0x");
-			pwcWrite = _MCFCRT_itow0X(pwcWrite, (uintptr_t)((char *)pHeader + sizeof(BlockHeader)), sizeof(void *) * 2);
-			pwcWrite = _MCFCRT_wcpcpy(pwcWrite, L", size = 0x");
-			pwcWrite = _MCFCRT_itow0X(pwcWrite, (uintptr_t)(pHeader->uSize), sizeof(size_t) * 2);
-			pwcWrite = _MCFCRT_wcpcpy(pwcWrite, L", allocated from 0x");
-			pwcWrite = _MCFCRT_itow0X(pwcWrite, (uintptr_t)(pHeader->pRetAddrInner), sizeof(void *) * 2);
-			pwcWrite = _MCFCRT_wcpcpy(pwcWrite, L" inside 0x");
-			pwcWrite = _MCFCRT_itow0X(pwcWrite, (uintptr_t)(pHeader->pRetAddrOuter), sizeof(void *) * 2);
-			pwcWrite = _MCFCRT_wcpcpy(pwcWrite, L" ***");
-			_MCFCRT_WriteStandardErrorText(awcLine, (size_t)(pwcWrite - awcLine), true);
+	for(size_t uShardIndex = 0; uShardIndex < SHARD_COUNT; ++uShardIndex){
+		const BlockHeader *pHeader = (BlockHeader *)_MCFCRT_AvlFront(&(g_aShards[uShardIndex].avlBlocks));
+		while(pHeader){
+			++uCount;
+			if(uCount <= 9999){
+				wchar_t *pwcWrite = awcLine;
+				pwcWrite = _MCFCRT_wcpcpy(pwcWrite, L"*** Memory leak ");
+				pwcWrite = _MCFCRT_itow0u(pwcWrite, uCount, 4);
+				pwcWrite = _MCFCRT_wcpcpy(pwcWrite, L": address = 0x");
+				pwcWrite = _MCFCRT_itow0X(pwcWrite, (uintptr_t)((char *)pHeader + sizeof(BlockHeader)), sizeof(void *) * 2);
+				pwcWrite = _MCFCRT_wcpcpy(pwcWrite, L", size = 0x");
+				pwcWrite = _MCFCRT_itow0X(pwcWrite, (uintptr_t)(pHeader->uSize), sizeof(size_t) * 2);
+				pwcWrite = _MCFCRT_wcpcpy(pwcWrite, L", allocated from 0x");
+				pwcWrite = _MCFCRT_itow0X(pwcWrite, (uintptr_t)(pHeader->pRetAddrInner), sizeof(void *) * 2);
+				pwcWrite = _MCFCRT_wcpcpy(pwcWrite, L" inside 0x");
+				pwcWrite = _MCFCRT_itow0X(pwcWrite, (uintptr_t)(pHeader->pRetAddrOuter), sizeof(void *) * 2);
+				pwcWrite = _MCFCRT_wcpcpy(pwcWrite, L" ***");
+				_MCFCRT_WriteStandardErrorText(awcLine, (size_t)(pwcWrite - awcLine), true);
+			}
+			pHeader = (BlockHeader *)_MCFCRT_AvlNext((_MCFCRT_AvlNodeHeader *)pHeader);
 		}
-		pHeader = (BlockHeader *)_MCFCRT_AvlNext((_MCFCRT_AvlNodeHeader *)pHeader);
 	}
 	if(uCount > 9999){
 		wchar_t *pwcWrite = awcLine;
@@ -114,6 +157,11 @@ void __MCFCRT_HeapDebugUninit(void){
 	CheckForMemoryLeaksUnlocked();
 }
 
+static inline size_t GetEffectiveAlignment(size_t uAlignment){
+	// The underlying storage is always aligned to 16-byte boundaries, and so are headers.
+	return (uAlignment < 16) ? 16 : uAlignment;
+}
+
 size_t __MCFCRT_HeapDebugCalculateSizeToAlloc(size_t uSize){
 	size_t uSizeToAlloc;
 	if(__builtin_add_overflow(uSize, sizeof(BlockHeader) + sizeof(BlockTrailer), &uSizeToAlloc)){
@@ -121,9 +169,16 @@ size_t __MCFCRT_HeapDebugCalculateSizeToAlloc(size_t uSize){
 	}
 	return uSizeToAlloc;
 }
-void __MCFCRT_HeapDebugRegister(void **restrict ppBlock, size_t uSize, void *pStorage, const void *pRetAddrOuter, const void *pRetAddrInner){
-	BlockHeader *const pHeader = pStorage;
-	void *const pBlock = (char *)pHeader + sizeof(BlockHeader);
+size_t __MCFCRT_HeapDebugCalculateSizeToAllocAligned(size_t uSize, size_t uAlignment){
+	_MCFCRT_ASSERT((uAlignment & (uAlignment - 1)) == 0);
+	size_t uSizeToAlloc;
+	if(__builtin_add_overflow(__MCFCRT_HeapDebugCalculateSizeToAlloc(uSize), GetEffectiveAlignment(uAlignment) - 16, &uSizeToAlloc)){
+		return SIZE_MAX;
+	}
+	return uSizeToAlloc;
+}
+
+static void RegisterBlock(BlockHeader *pHeader, size_t uSize, uintptr_t uAlignmentOffset, const void *pRetAddrOuter, const void *pRetAddrInner){
 	BlockTrailer *const pTrailer = (void *)((char *)pHeader + sizeof(BlockHeader) + uSize);
 
 	// Initialize the header.
@@ -131,21 +186,34 @@ void __MCFCRT_HeapDebugRegister(void **restrict ppBlock, size_t uSize, void *pSt
 	pHeader->pRetAddrOuter = pRetAddrOuter;
 	pHeader->pRetAddrInner = pRetAddrInner;
 	pHeader->uCookie = (uintptr_t)_MCFCRT_GetFastMonoClock();
-	pHeader->uReserved = 0;
+	pHeader->uAlignmentOffset = uAlignmentOffset;
 	MakeSentry(pHeader->abySentry, sizeof(pHeader->abySentry), pHeader->uCookie);
 	// Initialize the trailer.
 	MakeSentry(pTrailer->abySentry, sizeof(pTrailer->abySentry), pHeader->uCookie);
 
 	// Register it.
-	_MCFCRT_WaitForMutexForever(&g_vMutex, _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
-	_MCFCRT_AvlAttach(&g_avlBlocks, (_MCFCRT_AvlNodeHeader *)pStorage, &BlockHeaderComparatorNodes);
-	_MCFCRT_SignalMutex(&g_vMutex);
-
-	*ppBlock = pBlock;
+	AttachBlock(pHeader);
 }
-bool __MCFCRT_HeapDebugValidateAndUnregister(size_t *restrict puSize, void **restrict ppStorage, void *pBlock){
-	void *const pStorage = (char *)pBlock - sizeof(BlockHeader);
+void __MCFCRT_HeapDebugRegister(void **restrict ppBlock, size_t uSize, void *pStorage, const void *pRetAddrOuter, const void *pRetAddrInner){
 	BlockHeader *const pHeader = pStorage;
+	RegisterBlock(pHeader, uSize, 0, pRetAddrOuter, pRetAddrInner);
+
+	*ppBlock = (char *)pHeader + sizeof(BlockHeader);
+}
+void __MCFCRT_HeapDebugRegisterAligned(void **restrict ppBlock, size_t uSize, size_t uAlignment, void *pStorage, const void *pRetAddrOuter, const void *pRetAddrInner){
+	const size_t uEffectiveAlignment = GetEffectiveAlignment(uAlignment);
+	// Place the header such that the payload is aligned as requested. The offset is always less than the alignment.
+	const uintptr_t uPayload = ((uintptr_t)pStorage + sizeof(BlockHeader) + uEffectiveAlignment - 1) & ~(uintptr_t)(uEffectiveAlignment - 1);
+	BlockHeader *const pHeader = (void *)(uPayload - sizeof(BlockHeader));
+	const uintptr_t uOffset = (uintptr_t)pHeader - (uintptr_t)pStorage;
+	_MCFCRT_ASSERT(uOffset < uEffectiveAlignment);
+	RegisterBlock(pHeader, uSize, uEffectiveAlignment | uOffset, pRetAddrOuter, pRetAddrInner);
+
+	*ppBlock = (void *)uPayload;
+}
+
+static bool ValidateAndUnregisterBlock(size_t *restrict puSize, void **restrict ppStorage, void *pBlock, bool bAligned){
+	BlockHeader *const pHeader = (void *)((char *)pBlock - sizeof(BlockHeader));
 	const size_t uSize = pHeader->uSize;
 	BlockTrailer *const pTrailer = (void *)((char *)pHeader + sizeof(BlockHeader) + uSize);
 
@@ -153,20 +221,28 @@ bool __MCFCRT_HeapDebugValidateAndUnregister(size_t *restrict puSize, void **res
 	if(!CheckSentry(pHeader->uCookie, pHeader->abySentry, sizeof(pHeader->abySentry))){
 		return false;
 	}
+	// Blocks allocated with an alignment must not be freed as normal blocks, and vice versa.
+	const uintptr_t uAlignmentOffset = pHeader->uAlignmentOffset;
+	if((uAlignmentOffset != 0) != bAligned){
+		return false;
+	}
+	void *pStorage = pHeader;
+	if(uAlignmentOffset != 0){
+		const uintptr_t uAlignment = (uintptr_t)1 << (63 - __builtin_clzll(uAlignmentOffset));
+		if(((uintptr_t)pBlock & (uAlignment - 1)) != 0){
+			return false;
+		}
+		pStorage = (char *)pHeader - (uAlignmentOffset & ~uAlignment);
+	}
 	// Check the trailer.
 	if(!CheckSentry(pHeader->uCookie, pTrailer->abySentry, sizeof(pTrailer->abySentry))){
 		return false;
 	}
 
 	// Search for it in all registered blocks. Detach it if one is found.
-	_MCFCRT_WaitForMutexForever(&g_vMutex, _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
-	BlockHeader *const pHeaderFound = (BlockHeader *)_MCFCRT_AvlFind(&g_avlBlocks, (intptr_t)pHeader, &BlockHeaderComparatorNodeHeader);
-	if(pHeaderFound != pHeader){
-		_MCFCRT_SignalMutex(&g_vMutex);
+	if(!FindAndDetachBlock(pHeader)){
 		return false;
 	}
-	_MCFCRT_AvlDetach((_MCFCRT_AvlNodeHeader *)pStorage);
-	_MCFCRT_SignalMutex(&g_vMutex);
 
 	// Leave the header alone in order to enable the unregistration to be reverted.
 	// Zero out the trailer so the storage can be passed to `HeapReAlloc()` with the `HEAP_ZERO_MEMORY` option without causing confusion.
@@ -176,20 +252,24 @@ bool __MCFCRT_HeapDebugValidateAndUnregister(size_t *restrict puSize, void **res
 	*puSize = uSize;
 	return true;
 }
+bool __MCFCRT_HeapDebugValidateAndUnregister(size_t *restrict puSize, void **restrict ppStorage, void *pBlock){
+	return ValidateAndUnregisterBlock(puSize, ppStorage, pBlock, false);
+}
+bool __MCFCRT_HeapDebugValidateAndUnregisterAligned(size_t *restrict puSize, void **restrict ppStorage, void *pBlock){
+	return ValidateAndUnregisterBlock(puSize, ppStorage, pBlock, true);
+}
 void __MCFCRT_HeapDebugUndoUnregister(void *pStorage){
 	BlockHeader *const pHeader = pStorage;
 	const size_t uSize = pHeader->uSize;
 
 	// Generate a new cookie and update the header sentry.
 	pHeader->uCookie = (uintptr_t)_MCFCRT_GetFastMonoClock();
-	pHeader->uReserved = 0;
+	pHeader->uAlignmentOffset = 0;
 	MakeSentry(pHeader->abySentry, sizeof(pHeader->abySentry), pHeader->uCookie);
 	// Reinitialize the trailer.
 	BlockTrailer *const pTrailer = (void *)((char *)pHeader + sizeof(BlockHeader) + uSize);
 	MakeSentry(pTrailer->abySentry, sizeof(pTrailer->abySentry), pHeader->uCookie);
 
 	// Re-register it.
-	_MCFCRT_WaitForMutexForever(&g_vMutex, _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
-	_MCFCRT_AvlAttach(&g_avlBlocks, (_MCFCRT_AvlNodeHeader *)pStorage, &BlockHeaderComparatorNodes);
-	_MCFCRT_SignalMutex(&g_vMutex);
+	AttachBlock(pHeader);
 }
@@ -0,0 +1,559 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#include "heap_profiler.h"
+#include "heap.h"
+#include "mcfwin.h"
+#include "mutex.h"
+#include "expect.h"
+#include "../ext/itoa.h"
+#include "../ext/stpcpy.h"
+#include "../ext/random.h"
+#include "../ext/utf.h"
+
+// Call sites in each thread are kept in an open-addressing hash table. Those that don't fit go into the overflow record.
+#define SITE_TABLE_SIZE       1024u
+#define SITE_PROBE_MAX        16u
+// Sampled blocks that are still alive are kept in a global open-addressing hash table, so they can be accounted for when they are freed.
+#define SAMPLE_MAP_SIZE       0x10000u
+#define SAMPLE_PROBE_MAX      64u
+
+typedef struct tagSiteRecord {
+	const void *pRetAddrOuter;
+	const void *pRetAddrInner;
+	volatile bool bInUse;
+	// These are raw numbers of samples and bytes that they requested.
+	volatile uint64_t u64AllocCount;
+	volatile uint64_t u64AllocBytes;
+	volatile uint64_t u64LiveCount;
+	volatile uint64_t u64LiveBytes;
+} SiteRecord;
+
+// Each table is only written by the thread that owns it, except that the live counts may be decremented by any thread that frees a sampled block.
+// Tables are never deallocated, since sampled blocks refer to their records.
+typedef struct tagThreadTable {
+	struct tagThreadTable *pNextAll;
+	struct tagThreadTable *pNextFree;
+	int64_t n64BytesUntilSample;
+	SiteRecord vOverflow;
+	SiteRecord aSites[SITE_TABLE_SIZE];
+} ThreadTable;
+
+#define THREAD_TABLE_DEAD   ((ThreadTable *)1)
+
+typedef struct tagSampleEntry {
+	void *volatile pBlock;
+	SiteRecord *pSite;
+	size_t uSize;
+} SampleEntry;
+
+#define SAMPLE_ENTRY_BUSY        ((void *)1)
+#define SAMPLE_ENTRY_TOMBSTONE   ((void *)2)
+
+static _MCFCRT_Mutex                  g_mtxControl          = { 0 };
+static volatile bool                  g_bRunning            = false;
+static _MCFCRT_HeapCallback           g_pfnPrevCallback     = _MCFCRT_NULLPTR;
+static volatile size_t                g_uSamplingInterval   = _MCFCRT_HEAP_PROFILER_DEFAULT_SAMPLING_INTERVAL;
+static volatile DWORD                 g_dwTlsIndex          = TLS_OUT_OF_INDEXES;
+static SampleEntry *                  g_pSampleMap          = _MCFCRT_NULLPTR;
+static volatile size_t                g_uLiveSamples        = 0;
+
+static ThreadTable *volatile          g_pAllTables          = _MCFCRT_NULLPTR;
+static _MCFCRT_Mutex                  g_mtxFreeTables       = { 0 };
+static ThreadTable *                  g_pFreeTables         = _MCFCRT_NULLPTR;
+
+static int64_t GetNextSamplingDistance(void){
+	// Intervals between samples follow an exponential distribution, which is what pprof assumes when it unsamples `heap_v2` profiles.
+	const double dUniform = ((double)_MCFCRT_GetRandom_uint32() + 0.5) / 0x1p32;
+	const double dDistance = -__builtin_log(dUniform) * (double)__atomic_load_n(&g_uSamplingInterval, __ATOMIC_RELAXED);
+	if(dDistance < 1){
+		return 1;
+	}
+	if(dDistance > 0x1p62){
+		return INT64_MAX;
+	}
+	return (int64_t)dDistance;
+}
+
+static ThreadTable *AcquireThreadTable(void){
+	ThreadTable *pTable;
+	_MCFCRT_WaitForMutexForever(&g_mtxFreeTables, _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+	{
+		pTable = g_pFreeTables;
+		if(pTable){
+			g_pFreeTables = pTable->pNextFree;
+		}
+	}
+	_MCFCRT_SignalMutex(&g_mtxFreeTables);
+	if(pTable){
+		return pTable;
+	}
+	// Use `VirtualAlloc()` instead of the heap, which we are being called from.
+	pTable = VirtualAlloc(_MCFCRT_NULLPTR, sizeof(ThreadTable), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	if(!pTable){
+		return _MCFCRT_NULLPTR;
+	}
+	pTable->n64BytesUntilSample = GetNextSamplingDistance();
+	ThreadTable *pOldFirst = __atomic_load_n(&g_pAllTables, __ATOMIC_RELAXED);
+	do {
+		pTable->pNextAll = pOldFirst;
+	} while(!__atomic_compare_exchange_n(&g_pAllTables, &pOldFirst, pTable, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+	return pTable;
+}
+static void ReleaseThreadTable(ThreadTable *pTable){
+	_MCFCRT_WaitForMutexForever(&g_mtxFreeTables, _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+	{
+		pTable->pNextFree = g_pFreeTables;
+		g_pFreeTables = pTable;
+	}
+	_MCFCRT_SignalMutex(&g_mtxFreeTables);
+}
+
+static inline ThreadTable *GetThreadTable(DWORD dwTlsIndex){
+	// Preserve the last error, as we are called from allocation functions.
+	const DWORD dwLastError = GetLastError();
+	ThreadTable *pTable = TlsGetValue(dwTlsIndex);
+	if(_MCFCRT_EXPECT_NOT(!pTable)){
+		pTable = AcquireThreadTable();
+		// If we are out of memory, stop sampling on this thread.
+		TlsSetValue(dwTlsIndex, pTable ? pTable : THREAD_TABLE_DEAD);
+	}
+	SetLastError(dwLastError);
+	if(pTable == THREAD_TABLE_DEAD){
+		return _MCFCRT_NULLPTR;
+	}
+	return pTable;
+}
+
+static SiteRecord *RequireSiteRecord(ThreadTable *pTable, const void *pRetAddrOuter, const void *pRetAddrInner){
+	uint32_t u32Hash = (uint32_t)((uintptr_t)pRetAddrOuter * 3 + (uintptr_t)pRetAddrInner);
+	u32Hash *= 0x9E3779B9u;
+	static_assert((SITE_TABLE_SIZE & (SITE_TABLE_SIZE - 1)) == 0, "SITE_TABLE_SIZE must be a power of two.");
+	const size_t uStart = u32Hash >> (32 - __builtin_ctz(SITE_TABLE_SIZE));
+	for(size_t uProbe = 0; uProbe < SITE_PROBE_MAX; ++uProbe){
+		SiteRecord *const pSite = pTable->aSites + (uStart + uProbe) % SITE_TABLE_SIZE;
+		if(!pSite->bInUse){
+			// Only the owner thread adds records, so this can't race with other writers. Readers see the record after the flag is set.
+			pSite->pRetAddrOuter = pRetAddrOuter;
+			pSite->pRetAddrInner = pRetAddrInner;
+			__atomic_store_n(&(pSite->bInUse), true, __ATOMIC_RELEASE);
+			return pSite;
+		}
+		if((pSite->pRetAddrOuter == pRetAddrOuter) && (pSite->pRetAddrInner == pRetAddrInner)){
+			return pSite;
+		}
+	}
+	return &(pTable->vOverflow);
+}
+
+static inline size_t GetSampleMapStart(const void *pBlock){
+	uint32_t u32Hash = (uint32_t)((uintptr_t)pBlock >> 4);
+	u32Hash *= 0x9E3779B9u;
+	static_assert((SAMPLE_MAP_SIZE & (SAMPLE_MAP_SIZE - 1)) == 0, "SAMPLE_MAP_SIZE must be a power of two.");
+	return u32Hash >> (32 - __builtin_ctz(SAMPLE_MAP_SIZE));
+}
+static bool InsertSample(void *pBlock, SiteRecord *pSite, size_t uSize){
+	const size_t uStart = GetSampleMapStart(pBlock);
+	for(size_t uProbe = 0; uProbe < SAMPLE_PROBE_MAX; ++uProbe){
+		SampleEntry *const pEntry = g_pSampleMap + (uStart + uProbe) % SAMPLE_MAP_SIZE;
+		void *pOld = __atomic_load_n(&(pEntry->pBlock), __ATOMIC_RELAXED);
+		if((pOld != _MCFCRT_NULLPTR) && (pOld != SAMPLE_ENTRY_TOMBSTONE)){
+			continue;
+		}
+		if(!__atomic_compare_exchange_n(&(pEntry->pBlock), &pOld, SAMPLE_ENTRY_BUSY, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)){
+			continue;
+		}
+		pEntry->pSite = pSite;
+		pEntry->uSize = uSize;
+		__atomic_store_n(&(pEntry->pBlock), pBlock, __ATOMIC_RELEASE);
+		__atomic_add_fetch(&g_uLiveSamples, 1, __ATOMIC_RELAXED);
+		return true;
+	}
+	// The map is crowded. Drop this sample.
+	return false;
+}
+bool __MCFCRT_HeapProfilerRemoveSample(__MCFCRT_HeapProfilerSample *pSample, void *pBlock){
+	// This is the fast path, which is taken if the profiler has never been started, or if all samples have been freed.
+	if(__atomic_load_n(&g_uLiveSamples, __ATOMIC_RELAXED) == 0){
+		return false;
+	}
+	const size_t uStart = GetSampleMapStart(pBlock);
+	for(size_t uProbe = 0; uProbe < SAMPLE_PROBE_MAX; ++uProbe){
+		SampleEntry *const pEntry = g_pSampleMap + (uStart + uProbe) % SAMPLE_MAP_SIZE;
+		void *pOld = __atomic_load_n(&(pEntry->pBlock), __ATOMIC_ACQUIRE);
+		if(pOld == _MCFCRT_NULLPTR){
+			// Entries never go back to null, so the block can't be further in the map.
+			return false;
+		}
+		if(pOld != pBlock){
+			continue;
+		}
+		SiteRecord *const pSite = pEntry->pSite;
+		const size_t uSize = pEntry->uSize;
+		if(!__atomic_compare_exchange_n(&(pEntry->pBlock), &pOld, SAMPLE_ENTRY_TOMBSTONE, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)){
+			continue;
+		}
+		__atomic_sub_fetch(&g_uLiveSamples, 1, __ATOMIC_RELAXED);
+		__atomic_sub_fetch(&(pSite->u64LiveCount), 1, __ATOMIC_RELAXED);
+		__atomic_sub_fetch(&(pSite->u64LiveBytes), uSize, __ATOMIC_RELAXED);
+		if(pSample){
+			pSample->__pSite = pSite;
+			pSample->__uSize = uSize;
+		}
+		return true;
+	}
+	return false;
+}
+void __MCFCRT_HeapProfilerRestoreSample(const __MCFCRT_HeapProfilerSample *pSample, void *pBlock){
+	SiteRecord *const pSite = pSample->__pSite;
+	const size_t uSize = pSample->__uSize;
+	// The block has not been freed, so no other thread can have it removed in the meantime.
+	__atomic_add_fetch(&(pSite->u64LiveCount), 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&(pSite->u64LiveBytes), uSize, __ATOMIC_RELAXED);
+	if(!InsertSample(pBlock, pSite, uSize)){
+		__atomic_sub_fetch(&(pSite->u64LiveCount), 1, __ATOMIC_RELAXED);
+		__atomic_sub_fetch(&(pSite->u64LiveBytes), uSize, __ATOMIC_RELAXED);
+	}
+}
+
+static void RecordAllocation(void *pBlock, size_t uSize, const void *pRetAddrOuter, const void *pRetAddrInner){
+	const DWORD dwTlsIndex = __atomic_load_n(&g_dwTlsIndex, __ATOMIC_RELAXED);
+	ThreadTable *const pTable = GetThreadTable(dwTlsIndex);
+	if(!pTable){
+		return;
+	}
+	// This is the fast path, which is taken by the vast majority of allocations.
+	const int64_t n64BytesUntilSample = pTable->n64BytesUntilSample - (int64_t)uSize;
+	if(_MCFCRT_EXPECT(n64BytesUntilSample > 0)){
+		pTable->n64BytesUntilSample = n64BytesUntilSample;
+		return;
+	}
+	pTable->n64BytesUntilSample = GetNextSamplingDistance();
+
+	SiteRecord *const pSite = RequireSiteRecord(pTable, pRetAddrOuter, pRetAddrInner);
+	__atomic_add_fetch(&(pSite->u64AllocCount), 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&(pSite->u64AllocBytes), uSize, __ATOMIC_RELAXED);
+	// Account for the live block before it is published, as it may be freed by another thread as soon as we return.
+	__atomic_add_fetch(&(pSite->u64LiveCount), 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&(pSite->u64LiveBytes), uSize, __ATOMIC_RELAXED);
+	if(!InsertSample(pBlock, pSite, uSize)){
+		__atomic_sub_fetch(&(pSite->u64LiveCount), 1, __ATOMIC_RELAXED);
+		__atomic_sub_fetch(&(pSite->u64LiveBytes), uSize, __ATOMIC_RELAXED);
+	}
+}
+
+static void ProfilerHeapCallback(void *pBlockNew, size_t uSizeNew, void *pBlockOld, const void *pRetAddrOuter, const void *pRetAddrInner){
+	const _MCFCRT_HeapCallback pfnPrevCallback = g_pfnPrevCallback;
+	if(pfnPrevCallback){
+		(*pfnPrevCallback)(pBlockNew, uSizeNew, pBlockOld, pRetAddrOuter, pRetAddrInner);
+	}
+	// A reallocation is accounted for as a deallocation followed by an allocation.
+	// The sample of the old block, if any, has been removed by the heap before the block was returned to the underlying allocator.
+	(void)pBlockOld;
+	if(pBlockNew){
+		RecordAllocation(pBlockNew, uSizeNew, pRetAddrOuter, pRetAddrInner);
+	}
+}
+
+bool _MCFCRT_StartHeapProfiler(size_t uSamplingInterval){
+	if(uSamplingInterval == 0){
+		SetLastError(ERROR_INVALID_PARAMETER);
+		return false;
+	}
+	bool bSucceeded = false;
+	_MCFCRT_WaitForMutexForever(&g_mtxControl, _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+	{
+		if(g_bRunning){
+			SetLastError(ERROR_ALREADY_INITIALIZED);
+			goto jDone;
+		}
+		// The TLS index and the sample map are allocated the first time the profiler is started. They are never freed.
+		if(g_dwTlsIndex == TLS_OUT_OF_INDEXES){
+			const DWORD dwTlsIndex = TlsAlloc();
+			if(dwTlsIndex == TLS_OUT_OF_INDEXES){
+				goto jDone;
+			}
+			__atomic_store_n(&g_dwTlsIndex, dwTlsIndex, __ATOMIC_RELAXED);
+		}
+		if(!g_pSampleMap){
+			SampleEntry *const pSampleMap = VirtualAlloc(_MCFCRT_NULLPTR, sizeof(SampleEntry) * SAMPLE_MAP_SIZE, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+			if(!pSampleMap){
+				goto jDone;
+			}
+			g_pSampleMap = pSampleMap;
+		}
+		__atomic_store_n(&g_uSamplingInterval, uSamplingInterval, __ATOMIC_RELAXED);
+		g_pfnPrevCallback = _MCFCRT_GetHeapCallback();
+		// Publish everything above along with the callback.
+		_MCFCRT_SetHeapCallback(&ProfilerHeapCallback);
+		g_bRunning = true;
+		bSucceeded = true;
+	}
+jDone:
+	_MCFCRT_SignalMutex(&g_mtxControl);
+	return bSucceeded;
+}
+bool _MCFCRT_StopHeapProfiler(void){
+	bool bSucceeded = false;
+	_MCFCRT_WaitForMutexForever(&g_mtxControl, _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+	{
+		if(!g_bRunning){
+			goto jDone;
+		}
+		// Don't clobber a callback that has been installed over ours.
+		if(_MCFCRT_GetHeapCallback() != &ProfilerHeapCallback){
+			goto jDone;
+		}
+		_MCFCRT_SetHeapCallback(g_pfnPrevCallback);
+		g_bRunning = false;
+		bSucceeded = true;
+	}
+jDone:
+	_MCFCRT_SignalMutex(&g_mtxControl);
+	return bSucceeded;
+}
+
+void __MCFCRT_HeapProfilerThreadCleanup(void){
+	const DWORD dwTlsIndex = __atomic_load_n(&g_dwTlsIndex, __ATOMIC_RELAXED);
+	if(dwTlsIndex == TLS_OUT_OF_INDEXES){
+		return;
+	}
+	ThreadTable *const pTable = TlsGetValue(dwTlsIndex);
+	TlsSetValue(dwTlsIndex, THREAD_TABLE_DEAD);
+	if(pTable && (pTable != THREAD_TABLE_DEAD)){
+		ReleaseThreadTable(pTable);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Dumping
+//-----------------------------------------------------------------------------
+
+typedef struct tagSiteTotals {
+	uint64_t u64AllocCount;
+	uint64_t u64AllocBytes;
+	uint64_t u64LiveCount;
+	uint64_t u64LiveBytes;
+} SiteTotals;
+
+static inline void LoadSiteTotals(SiteTotals *restrict pTotals, const SiteRecord *restrict pSite){
+	pTotals->u64AllocCount = __atomic_load_n(&(pSite->u64AllocCount), __ATOMIC_RELAXED);
+	pTotals->u64AllocBytes = __atomic_load_n(&(pSite->u64AllocBytes), __ATOMIC_RELAXED);
+	pTotals->u64LiveCount  = __atomic_load_n(&(pSite->u64LiveCount),  __ATOMIC_RELAXED);
+	pTotals->u64LiveBytes  = __atomic_load_n(&(pSite->u64LiveBytes),  __ATOMIC_RELAXED);
+	// Counters are updated separately, so make sure they don't look absurd.
+	if((int64_t)pTotals->u64LiveCount < 0){
+		pTotals->u64LiveCount = 0;
+	}
+	if((int64_t)pTotals->u64LiveBytes < 0){
+		pTotals->u64LiveBytes = 0;
+	}
+}
+
+// This function returns the record after `pSite` in `*ppTable`, moving to the next table as needed, or a null pointer if there are no more.
+static const SiteRecord *GetNextSiteRecord(const ThreadTable **ppTable, const SiteRecord *pSite){
+	const ThreadTable *pTable = *ppTable;
+	for(;;){
+		if(!pTable){
+			return _MCFCRT_NULLPTR;
+		}
+		if(!pSite){
+			pSite = &(pTable->vOverflow);
+		} else if(pSite == &(pTable->vOverflow)){
+			pSite = pTable->aSites;
+		} else {
+			++pSite;
+		}
+		while(pSite != pTable->aSites + SITE_TABLE_SIZE){
+			if(((pSite == &(pTable->vOverflow)) || __atomic_load_n(&(pSite->bInUse), __ATOMIC_ACQUIRE)) && (__atomic_load_n(&(pSite->u64AllocCount), __ATOMIC_RELAXED) != 0)){
+				*ppTable = pTable;
+				return pSite;
+			}
+			if(pSite == &(pTable->vOverflow)){
+				pSite = pTable->aSites;
+			} else {
+				++pSite;
+			}
+		}
+		pTable = pTable->pNextAll;
+		pSite = _MCFCRT_NULLPTR;
+	}
+}
+
+static char *FormatUint64(char *pchWrite, uint64_t u64Value, unsigned uMinWidth){
+	char achTemp[24];
+	char *pchTemp = achTemp + sizeof(achTemp);
+	do {
+		*--pchTemp = (char)('0' + u64Value % 10);
+		u64Value /= 10;
+	} while(u64Value != 0);
+	unsigned uWidth = (unsigned)(achTemp + sizeof(achTemp) - pchTemp);
+	while(uWidth < uMinWidth){
+		*(pchWrite++) = ' ';
+		++uWidth;
+	}
+	while(pchTemp != achTemp + sizeof(achTemp)){
+		*(pchWrite++) = *(pchTemp++);
+	}
+	return pchWrite;
+}
+static char *FormatAddress(char *pchWrite, const void *pAddress){
+	pchWrite = _MCFCRT_stpcpy(pchWrite, "0x");
+	pchWrite = _MCFCRT_itoa0x(pchWrite, (uintptr_t)pAddress, sizeof(void *) * 2);
+	return pchWrite;
+}
+// This is how pprof estimates real numbers from samples that are taken with exponentially distributed intervals.
+static uint64_t Unsample(uint64_t u64Value, const SiteTotals *pTotals, size_t uSamplingInterval){
+	if(pTotals->u64LiveCount == 0){
+		return 0;
+	}
+	const double dAverageSize = (double)pTotals->u64LiveBytes / (double)pTotals->u64LiveCount;
+	const double dProbability = 1 - __builtin_exp(-dAverageSize / (double)uSamplingInterval);
+	if(dProbability <= 0){
+		return u64Value;
+	}
+	return (uint64_t)((double)u64Value / dProbability + 0.5);
+}
+
+// pprof reads this section in the format of `/proc/self/maps`. Only address ranges and paths matter to it.
+// Images are found by walking the address space, so nothing is allocated from the heap.
+static bool DumpMappedLibraries(_MCFCRT_HeapProfileWriteCallback pfnWriteCallback, intptr_t nContext){
+	static const char kHeader[] = "\nMAPPED_LIBRARIES:\n";
+	if(!(*pfnWriteCallback)(nContext, kHeader, sizeof(kHeader) - 1)){
+		return false;
+	}
+	wchar_t awcPath[1024];
+	char achLine[sizeof(awcPath) / sizeof(wchar_t) * 3 + 64];
+	char *pchWrite;
+
+	MEMORY_BASIC_INFORMATION vInfo;
+	const unsigned char *pbyCursor = _MCFCRT_NULLPTR;
+	while(VirtualQuery(pbyCursor, &vInfo, sizeof(vInfo)) == sizeof(vInfo)){
+		const unsigned char *const pbyBase = vInfo.BaseAddress;
+		pbyCursor = pbyBase + vInfo.RegionSize;
+		if((vInfo.Type != MEM_IMAGE) || (vInfo.AllocationBase != vInfo.BaseAddress)){
+			continue;
+		}
+		// An image consists of all regions that are allocated along with its first one.
+		while((VirtualQuery(pbyCursor, &vInfo, sizeof(vInfo)) == sizeof(vInfo)) && (vInfo.AllocationBase == pbyBase)){
+			pbyCursor = (const unsigned char *)vInfo.BaseAddress + vInfo.RegionSize;
+		}
+		const DWORD dwPathLength = GetModuleFileNameW((HMODULE)pbyBase, awcPath, sizeof(awcPath) / sizeof(wchar_t));
+		if((dwPathLength == 0) || (dwPathLength >= sizeof(awcPath) / sizeof(wchar_t))){
+			continue;
+		}
+		pchWrite = achLine;
+		pchWrite = _MCFCRT_itoa0x(pchWrite, (uintptr_t)pbyBase, sizeof(void *) * 2);
+		pchWrite = _MCFCRT_stpcpy(pchWrite, "-");
+		pchWrite = _MCFCRT_itoa0x(pchWrite, (uintptr_t)pbyCursor, sizeof(void *) * 2);
+		pchWrite = _MCFCRT_stpcpy(pchWrite, " r-xp 00000000 00:00 0 ");
+		const char16_t *pc16Read = (const char16_t *)awcPath;
+		const char16_t *const pc16ReadEnd = pc16Read + dwPathLength;
+		for(;;){
+			const char32_t c32CodePoint = _MCFCRT_DecodeUtf16(&pc16Read, pc16ReadEnd, true);
+			if(!_MCFCRT_UTF_SUCCESS(c32CodePoint)){
+				break;
+			}
+			_MCFCRT_UncheckedEncodeUtf8(&pchWrite, c32CodePoint, true);
+		}
+		pchWrite = _MCFCRT_stpcpy(pchWrite, "\n");
+		if(!(*pfnWriteCallback)(nContext, achLine, (size_t)(pchWrite - achLine))){
+			return false;
+		}
+	}
+	return true;
+}
+
+bool _MCFCRT_DumpHeapProfile(_MCFCRT_HeapProfileFormat eFormat, _MCFCRT_HeapProfileWriteCallback pfnWriteCallback, intptr_t nContext){
+	const size_t uSamplingInterval = __atomic_load_n(&g_uSamplingInterval, __ATOMIC_RELAXED);
+	const ThreadTable *const pFirstTable = __atomic_load_n(&g_pAllTables, __ATOMIC_ACQUIRE);
+
+	char achLine[256];
+	char *pchWrite;
+	const ThreadTable *pTable;
+	const SiteRecord *pSite;
+	SiteTotals vTotals;
+
+	switch(eFormat){
+	case _MCFCRT_kHeapProfileFormatPprof: {
+		SiteTotals vSum = { 0 };
+		pTable = pFirstTable;
+		pSite = _MCFCRT_NULLPTR;
+		while((pSite = GetNextSiteRecord(&pTable, pSite)) != _MCFCRT_NULLPTR){
+			LoadSiteTotals(&vTotals, pSite);
+			vSum.u64AllocCount += vTotals.u64AllocCount;
+			vSum.u64AllocBytes += vTotals.u64AllocBytes;
+			vSum.u64LiveCount  += vTotals.u64LiveCount;
+			vSum.u64LiveBytes  += vTotals.u64LiveBytes;
+		}
+		pchWrite = achLine;
+		pchWrite = _MCFCRT_stpcpy(pchWrite, "heap profile: ");
+		pchWrite = FormatUint64(pchWrite, vSum.u64LiveCount, 6);
+		pchWrite = _MCFCRT_stpcpy(pchWrite, ": ");
+		pchWrite = FormatUint64(pchWrite, vSum.u64LiveBytes, 8);
+		pchWrite = _MCFCRT_stpcpy(pchWrite, " [");
+		pchWrite = FormatUint64(pchWrite, vSum.u64AllocCount, 6);
+		pchWrite = _MCFCRT_stpcpy(pchWrite, ": ");
+		pchWrite = FormatUint64(pchWrite, vSum.u64AllocBytes, 8);
+		pchWrite = _MCFCRT_stpcpy(pchWrite, "] @ heap_v2/");
+		pchWrite = FormatUint64(pchWrite, uSamplingInterval, 0);
+		pchWrite = _MCFCRT_stpcpy(pchWrite, "\n");
+		if(!(*pfnWriteCallback)(nContext, achLine, (size_t)(pchWrite - achLine))){
+			return false;
+		}
+		// Raw samples are written. pprof unsamples them according to the interval in the header.
+		pTable = pFirstTable;
+		pSite = _MCFCRT_NULLPTR;
+		while((pSite = GetNextSiteRecord(&pTable, pSite)) != _MCFCRT_NULLPTR){
+			LoadSiteTotals(&vTotals, pSite);
+			pchWrite = achLine;
+			pchWrite = FormatUint64(pchWrite, vTotals.u64LiveCount, 6);
+			pchWrite = _MCFCRT_stpcpy(pchWrite, ": ");
+			pchWrite = FormatUint64(pchWrite, vTotals.u64LiveBytes, 8);
+			pchWrite = _MCFCRT_stpcpy(pchWrite, " [");
+			pchWrite = FormatUint64(pchWrite, vTotals.u64AllocCount, 6);
+			pchWrite = _MCFCRT_stpcpy(pchWrite, ": ");
+			pchWrite = FormatUint64(pchWrite, vTotals.u64AllocBytes, 8);
+			pchWrite = _MCFCRT_stpcpy(pchWrite, "] @ ");
+			pchWrite = FormatAddress(pchWrite, pSite->pRetAddrInner);
+			pchWrite = _MCFCRT_stpcpy(pchWrite, " ");
+			pchWrite = FormatAddress(pchWrite, pSite->pRetAddrOuter);
+			pchWrite = _MCFCRT_stpcpy(pchWrite, "\n");
+			if(!(*pfnWriteCallback)(nContext, achLine, (size_t)(pchWrite - achLine))){
+				return false;
+			}
+		}
+		if(!DumpMappedLibraries(pfnWriteCallback, nContext)){
+			return false;
+		}
+		break; }
+
+	case _MCFCRT_kHeapProfileFormatCollapsed:
+		// Estimated bytes in use are written. Frames go from the outermost to the innermost.
+		pTable = pFirstTable;
+		pSite = _MCFCRT_NULLPTR;
+		while((pSite = GetNextSiteRecord(&pTable, pSite)) != _MCFCRT_NULLPTR){
+			LoadSiteTotals(&vTotals, pSite);
+			if(vTotals.u64LiveBytes == 0){
+				continue;
+			}
+			pchWrite = achLine;
+			pchWrite = FormatAddress(pchWrite, pSite->pRetAddrOuter);
+			pchWrite = _MCFCRT_stpcpy(pchWrite, ";");
+			pchWrite = FormatAddress(pchWrite, pSite->pRetAddrInner);
+			pchWrite = _MCFCRT_stpcpy(pchWrite, " ");
+			pchWrite = FormatUint64(pchWrite, Unsample(vTotals.u64LiveBytes, &vTotals, uSamplingInterval), 0);
+			pchWrite = _MCFCRT_stpcpy(pchWrite, "\n");
+			if(!(*pfnWriteCallback)(nContext, achLine, (size_t)(pchWrite - achLine))){
+				return false;
+			}
+		}
+		break;
+
+	default:
+		SetLastError(ERROR_INVALID_PARAMETER);
+		return false;
+	}
+	return true;
+}
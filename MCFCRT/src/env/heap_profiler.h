@@ -0,0 +1,55 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#ifndef __MCFCRT_ENV_HEAP_PROFILER_H_
+#define __MCFCRT_ENV_HEAP_PROFILER_H_
+
+#include "_crtdef.h"
+
+_MCFCRT_EXTERN_C_BEGIN
+
+// The heap profiler is a heap callback that samples allocations by bytes. On average one sample is taken every `__uSamplingInterval` bytes allocated.
+// Samples are aggregated by call site (a pair of return addresses, as passed to the heap callback) into per-thread tables, which are updated without locking.
+// Statistics are retained after the profiler is stopped, and accumulate if it is started again.
+
+#define _MCFCRT_HEAP_PROFILER_DEFAULT_SAMPLING_INTERVAL   0x80000u
+
+// This function returns `false` if the profiler has already been started, or if it could not be started, in which case `GetLastError()` tells why.
+// The heap callback that was installed before is chained.
+extern bool _MCFCRT_StartHeapProfiler(_MCFCRT_STD size_t __uSamplingInterval) _MCFCRT_NOEXCEPT;
+// This function returns `false` if the profiler is not running, or if another heap callback has been installed over it, in which case it is not stopped.
+extern bool _MCFCRT_StopHeapProfiler(void) _MCFCRT_NOEXCEPT;
+
+// This function shall be called when a thread exits, so its table can be reused by other threads.
+extern void __MCFCRT_HeapProfilerThreadCleanup(void) _MCFCRT_NOEXCEPT;
+
+typedef struct __MCFCRT_tagHeapProfilerSample {
+	void *__pSite;
+	_MCFCRT_STD size_t __uSize;
+} __MCFCRT_HeapProfilerSample;
+
+// These functions are called by the heap itself. A sample must be removed before its block is returned to the underlying allocator.
+// Otherwise, another thread could allocate a block at the same address and have it sampled, and then the sample of the new block would be removed instead.
+// The sample is stored into `*__pSample` if it is not a null pointer. If a reallocation fails, the sample shall be restored.
+extern bool __MCFCRT_HeapProfilerRemoveSample(__MCFCRT_HeapProfilerSample *__pSample, void *__pBlock) _MCFCRT_NOEXCEPT;
+extern void __MCFCRT_HeapProfilerRestoreSample(const __MCFCRT_HeapProfilerSample *__pSample, void *__pBlock) _MCFCRT_NOEXCEPT;
+
+typedef enum __MCFCRT_tagHeapProfileFormat {
+	// This is the legacy text format that can be read by `pprof --text`, with the header `heap profile: ... @ heap_v2/<sampling interval>`.
+	// Loaded modules are listed in the `MAPPED_LIBRARIES:` section in the end, so pprof can symbolize addresses.
+	_MCFCRT_kHeapProfileFormatPprof     = 1,
+	// This is the format used by flame graph tools. Each line is `<outer>;<inner> <bytes>`, where bytes are those still in use.
+	_MCFCRT_kHeapProfileFormatCollapsed = 2,
+} _MCFCRT_HeapProfileFormat;
+
+// This callback shall return `false` to abort the dump.
+typedef bool (*_MCFCRT_HeapProfileWriteCallback)(_MCFCRT_STD intptr_t __nContext, const char *__pchData, _MCFCRT_STD size_t __uSize);
+
+// Statistics are scaled by the sampling interval to estimate the real ones. Records that are updated concurrently might be slightly inconsistent.
+// This function does not allocate memory from the heap, so it may be called from any context.
+extern bool _MCFCRT_DumpHeapProfile(_MCFCRT_HeapProfileFormat __eFormat, _MCFCRT_HeapProfileWriteCallback __pfnWriteCallback, _MCFCRT_STD intptr_t __nContext) _MCFCRT_NOEXCEPT;
+
+_MCFCRT_EXTERN_C_END
+
+#endif
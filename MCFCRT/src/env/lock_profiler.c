@@ -0,0 +1,288 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#include "lock_profiler.h"
+#include "mcfwin.h"
+#include "mutex.h"
+#include "expect.h"
+
+// Records are kept in a global open-addressing hash table, keyed by lock, call site and kind. Those that don't fit go into the overflow record.
+// Records are never removed, so a key that has been published never changes.
+#define RECORD_TABLE_SIZE     0x2000u
+#define RECORD_PROBE_MAX      32u
+// Each thread remembers the locks that it holds, so hold times can be measured.
+#define HELD_LOCK_COUNT_MAX   32u
+
+typedef struct tagLockRecord {
+	const void *volatile pLock;
+	const void *pCallSite;
+	_MCFCRT_LockKind eKind;
+	volatile uint64_t u64Acquisitions;
+	volatile uint64_t u64ContendedAcquisitions;
+	volatile uint64_t u64SpinSuccesses;
+	volatile uint64_t u64SpinFailures;
+	// These are raw performance counter ticks.
+	volatile uint64_t u64WaitTicks;
+	volatile uint64_t u64HoldTicks;
+} LockRecord;
+
+#define LOCK_RECORD_BUSY   ((const void *)1)
+
+typedef struct tagHeldLock {
+	const void *pLock;
+	LockRecord *pRecord;
+	int64_t n64Acquired;
+} HeldLock;
+
+typedef struct tagThreadState {
+	// If this doesn't match `g_uGeneration`, `aHeld` contains locks acquired before the profiler was restarted, which are discarded.
+	size_t uGeneration;
+	size_t uHeldCount;
+	HeldLock aHeld[HELD_LOCK_COUNT_MAX];
+} ThreadState;
+
+#define THREAD_STATE_DEAD   ((ThreadState *)1)
+
+static volatile bool      g_bRunning         = false;
+static _MCFCRT_Mutex      g_mtxControl       = { 0 };
+static volatile size_t    g_uGeneration      = 0;
+static volatile DWORD     g_dwTlsIndex       = TLS_OUT_OF_INDEXES;
+static double             g_dNsPerTick       = 0;
+static LockRecord *       g_pRecordTable     = _MCFCRT_NULLPTR;
+static LockRecord         g_vOverflow        = { 0 };
+
+static inline size_t GetRecordTableStart(const void *pLock, const void *pCallSite, _MCFCRT_LockKind eKind){
+	uint32_t u32Hash = (uint32_t)((uintptr_t)pLock * 5 + (uintptr_t)pCallSite * 3 + (uintptr_t)eKind);
+	u32Hash *= 0x9E3779B9u;
+	static_assert((RECORD_TABLE_SIZE & (RECORD_TABLE_SIZE - 1)) == 0, "RECORD_TABLE_SIZE must be a power of two.");
+	return u32Hash >> (32 - __builtin_ctz(RECORD_TABLE_SIZE));
+}
+static LockRecord *RequireLockRecord(const void *pLock, const void *pCallSite, _MCFCRT_LockKind eKind){
+	LockRecord *const pRecordTable = __atomic_load_n(&g_pRecordTable, __ATOMIC_ACQUIRE);
+	if(!pRecordTable){
+		return &g_vOverflow;
+	}
+	const size_t uStart = GetRecordTableStart(pLock, pCallSite, eKind);
+	for(size_t uProbe = 0; uProbe < RECORD_PROBE_MAX; ++uProbe){
+		LockRecord *const pRecord = pRecordTable + (uStart + uProbe) % RECORD_TABLE_SIZE;
+		const void *pOld = __atomic_load_n(&(pRecord->pLock), __ATOMIC_ACQUIRE);
+		if(!pOld){
+			if(__atomic_compare_exchange_n(&(pRecord->pLock), &pOld, LOCK_RECORD_BUSY, false, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)){
+				pRecord->pCallSite = pCallSite;
+				pRecord->eKind = eKind;
+				__atomic_store_n(&(pRecord->pLock), pLock, __ATOMIC_RELEASE);
+				return pRecord;
+			}
+		}
+		// Another thread is filling in this record. It takes only a few instructions.
+		while(_MCFCRT_EXPECT_NOT(pOld == LOCK_RECORD_BUSY)){
+			__builtin_ia32_pause();
+			pOld = __atomic_load_n(&(pRecord->pLock), __ATOMIC_ACQUIRE);
+		}
+		if((pOld == pLock) && (pRecord->pCallSite == pCallSite) && (pRecord->eKind == eKind)){
+			return pRecord;
+		}
+	}
+	return &g_vOverflow;
+}
+
+static ThreadState *GetThreadState(void){
+	const DWORD dwTlsIndex = __atomic_load_n(&g_dwTlsIndex, __ATOMIC_RELAXED);
+	// Preserve the last error, as we are called from lock functions.
+	const DWORD dwLastError = GetLastError();
+	ThreadState *pState = TlsGetValue(dwTlsIndex);
+	if(_MCFCRT_EXPECT_NOT(!pState)){
+		// Don't use our heap, which is protected by our locks.
+		pState = HeapAlloc(GetProcessHeap(), 0, sizeof(ThreadState));
+		if(pState){
+			pState->uGeneration = 0;
+			pState->uHeldCount = 0;
+		}
+		TlsSetValue(dwTlsIndex, pState ? pState : THREAD_STATE_DEAD);
+	}
+	SetLastError(dwLastError);
+	if(pState == THREAD_STATE_DEAD){
+		return _MCFCRT_NULLPTR;
+	}
+	const size_t uGeneration = __atomic_load_n(&g_uGeneration, __ATOMIC_RELAXED);
+	if(_MCFCRT_EXPECT_NOT(pState->uGeneration != uGeneration)){
+		pState->uGeneration = uGeneration;
+		pState->uHeldCount = 0;
+	}
+	return pState;
+}
+
+int64_t __MCFCRT_LockProfilerGetTimestamp(void){
+	LARGE_INTEGER liCounter;
+	QueryPerformanceCounter(&liCounter);
+	return liCounter.QuadPart;
+}
+
+void __MCFCRT_LockProfilerRecordWait(const void *pLock, _MCFCRT_LockKind eKind, const void *pCallSite, int64_t n64WaitBegin, unsigned uEvents, bool bAcquired){
+	const int64_t n64Now = __MCFCRT_LockProfilerGetTimestamp();
+	LockRecord *const pRecord = RequireLockRecord(pLock, pCallSite, eKind);
+	if(bAcquired){
+		__atomic_add_fetch(&(pRecord->u64Acquisitions), 1, __ATOMIC_RELAXED);
+	}
+	if(uEvents & __MCFCRT_LOCK_EVENT_CONTENDED){
+		__atomic_add_fetch(&(pRecord->u64ContendedAcquisitions), 1, __ATOMIC_RELAXED);
+		// Uncontended acquisitions take no time worth mentioning. Don't let the overhead of the timer accumulate.
+		__atomic_add_fetch(&(pRecord->u64WaitTicks), (uint64_t)(n64Now - n64WaitBegin), __ATOMIC_RELAXED);
+	}
+	if(uEvents & __MCFCRT_LOCK_EVENT_SPIN_SUCCEEDED){
+		__atomic_add_fetch(&(pRecord->u64SpinSuccesses), 1, __ATOMIC_RELAXED);
+	}
+	if(uEvents & __MCFCRT_LOCK_EVENT_SPIN_FAILED){
+		__atomic_add_fetch(&(pRecord->u64SpinFailures), 1, __ATOMIC_RELAXED);
+	}
+	if(!bAcquired || (eKind == _MCFCRT_kLockKindConditionVariable)){
+		return;
+	}
+	ThreadState *const pState = GetThreadState();
+	if(!pState){
+		return;
+	}
+	const size_t uHeldCount = pState->uHeldCount;
+	if(uHeldCount >= HELD_LOCK_COUNT_MAX){
+		// Too many locks are held. Don't measure the hold time of this one.
+		return;
+	}
+	HeldLock *const pHeld = pState->aHeld + uHeldCount;
+	pHeld->pLock = pLock;
+	pHeld->pRecord = pRecord;
+	pHeld->n64Acquired = n64Now;
+	pState->uHeldCount = uHeldCount + 1;
+}
+void __MCFCRT_LockProfilerRecordRelease(const void *pLock){
+	ThreadState *const pState = GetThreadState();
+	if(!pState){
+		return;
+	}
+	// Locks are usually released in the reverse order in which they were acquired.
+	size_t uIndex = pState->uHeldCount;
+	for(;;){
+		if(uIndex == 0){
+			// This lock was not acquired by this thread, or it was acquired before the profiler was started.
+			return;
+		}
+		--uIndex;
+		if(pState->aHeld[uIndex].pLock == pLock){
+			break;
+		}
+	}
+	const HeldLock vHeld = pState->aHeld[uIndex];
+	pState->aHeld[uIndex] = pState->aHeld[pState->uHeldCount - 1];
+	pState->uHeldCount -= 1;
+	const int64_t n64Now = __MCFCRT_LockProfilerGetTimestamp();
+	__atomic_add_fetch(&(vHeld.pRecord->u64HoldTicks), (uint64_t)(n64Now - vHeld.n64Acquired), __ATOMIC_RELAXED);
+}
+
+bool __MCFCRT_IsLockProfilerRunning(void){
+	return __atomic_load_n(&g_bRunning, __ATOMIC_ACQUIRE);
+}
+
+bool _MCFCRT_StartLockProfiler(void){
+	bool bSucceeded = false;
+	_MCFCRT_WaitForMutexForever(&g_mtxControl, _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+	{
+		if(g_bRunning){
+			SetLastError(ERROR_ALREADY_INITIALIZED);
+			goto jDone;
+		}
+		// The TLS index and the record table are allocated the first time the profiler is started. They are never freed.
+		if(g_dwTlsIndex == TLS_OUT_OF_INDEXES){
+			const DWORD dwTlsIndex = TlsAlloc();
+			if(dwTlsIndex == TLS_OUT_OF_INDEXES){
+				goto jDone;
+			}
+			__atomic_store_n(&g_dwTlsIndex, dwTlsIndex, __ATOMIC_RELAXED);
+		}
+		if(!g_pRecordTable){
+			LockRecord *const pRecordTable = VirtualAlloc(_MCFCRT_NULLPTR, sizeof(LockRecord) * RECORD_TABLE_SIZE, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+			if(!pRecordTable){
+				goto jDone;
+			}
+			__atomic_store_n(&g_pRecordTable, pRecordTable, __ATOMIC_RELEASE);
+		}
+		LARGE_INTEGER liFrequency;
+		if(!QueryPerformanceFrequency(&liFrequency)){
+			goto jDone;
+		}
+		g_dNsPerTick = 1.0e9 / (double)liFrequency.QuadPart;
+		__atomic_add_fetch(&g_uGeneration, 1, __ATOMIC_RELAXED);
+		// Publish everything above along with the flag.
+		__atomic_store_n(&g_bRunning, true, __ATOMIC_RELEASE);
+		bSucceeded = true;
+	}
+jDone:
+	_MCFCRT_SignalMutex(&g_mtxControl);
+	return bSucceeded;
+}
+bool _MCFCRT_StopLockProfiler(void){
+	bool bSucceeded = false;
+	_MCFCRT_WaitForMutexForever(&g_mtxControl, _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+	{
+		if(!g_bRunning){
+			goto jDone;
+		}
+		__atomic_store_n(&g_bRunning, false, __ATOMIC_RELAXED);
+		bSucceeded = true;
+	}
+jDone:
+	_MCFCRT_SignalMutex(&g_mtxControl);
+	return bSucceeded;
+}
+
+static inline uint64_t TicksToNs(uint64_t u64Ticks){
+	return (uint64_t)((double)u64Ticks * g_dNsPerTick + 0.5);
+}
+static void LoadLockRecord(_MCFCRT_LockProfileRecord *restrict pOut, const LockRecord *restrict pRecord){
+	pOut->__pLock                   = (pRecord == &g_vOverflow) ? _MCFCRT_NULLPTR : pRecord->pLock;
+	pOut->__pCallSite               = pRecord->pCallSite;
+	pOut->__eKind                   = pRecord->eKind;
+	pOut->__u64Acquisitions         = __atomic_load_n(&(pRecord->u64Acquisitions),         __ATOMIC_RELAXED);
+	pOut->__u64ContendedAcquisitions = __atomic_load_n(&(pRecord->u64ContendedAcquisitions), __ATOMIC_RELAXED);
+	pOut->__u64SpinSuccesses        = __atomic_load_n(&(pRecord->u64SpinSuccesses),        __ATOMIC_RELAXED);
+	pOut->__u64SpinFailures         = __atomic_load_n(&(pRecord->u64SpinFailures),         __ATOMIC_RELAXED);
+	pOut->__u64WaitTimeNs           = TicksToNs(__atomic_load_n(&(pRecord->u64WaitTicks),   __ATOMIC_RELAXED));
+	pOut->__u64HoldTimeNs           = TicksToNs(__atomic_load_n(&(pRecord->u64HoldTicks),   __ATOMIC_RELAXED));
+}
+
+size_t _MCFCRT_SnapshotLockProfile(_MCFCRT_LockProfileRecord *pRecords, size_t uMaxCount){
+	size_t uCount = 0;
+	const LockRecord *const pRecordTable = __atomic_load_n(&g_pRecordTable, __ATOMIC_ACQUIRE);
+	if(!pRecordTable){
+		return 0;
+	}
+	for(size_t uIndex = 0; uIndex < RECORD_TABLE_SIZE; ++uIndex){
+		const LockRecord *const pRecord = pRecordTable + uIndex;
+		const void *const pLock = __atomic_load_n(&(pRecord->pLock), __ATOMIC_ACQUIRE);
+		if(!pLock || (pLock == LOCK_RECORD_BUSY)){
+			continue;
+		}
+		if(uCount < uMaxCount){
+			LoadLockRecord(pRecords + uCount, pRecord);
+		}
+		++uCount;
+	}
+	if(__atomic_load_n(&(g_vOverflow.u64Acquisitions), __ATOMIC_RELAXED) != 0){
+		if(uCount < uMaxCount){
+			LoadLockRecord(pRecords + uCount, &g_vOverflow);
+		}
+		++uCount;
+	}
+	return uCount;
+}
+
+void __MCFCRT_LockProfilerThreadCleanup(void){
+	const DWORD dwTlsIndex = __atomic_load_n(&g_dwTlsIndex, __ATOMIC_RELAXED);
+	if(dwTlsIndex == TLS_OUT_OF_INDEXES){
+		return;
+	}
+	ThreadState *const pState = TlsGetValue(dwTlsIndex);
+	TlsSetValue(dwTlsIndex, THREAD_STATE_DEAD);
+	if(pState && (pState != THREAD_STATE_DEAD)){
+		HeapFree(GetProcessHeap(), 0, pState);
+	}
+}
@@ -0,0 +1,67 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#ifndef __MCFCRT_ENV_LOCK_PROFILER_H_
+#define __MCFCRT_ENV_LOCK_PROFILER_H_
+
+#include "_crtdef.h"
+
+_MCFCRT_EXTERN_C_BEGIN
+
+// The lock profiler collects contention statistics of `_MCFCRT_Mutex`, `_MCFCRT_ConditionVariable` and `_MCFCRT_RwLock`, aggregated by lock and call site.
+// When it is not running, the only overhead is a call to `__MCFCRT_IsLockProfilerRunning()` per acquisition and per release.
+// Statistics are retained after the profiler is stopped, and accumulate if it is started again.
+
+typedef enum __MCFCRT_tagLockKind {
+	_MCFCRT_kLockKindMutex              = 1,
+	// Each wait is counted as an acquisition if the condition variable is signaled. There is no hold time.
+	_MCFCRT_kLockKindConditionVariable  = 2,
+	_MCFCRT_kLockKindRwLockShared       = 3,
+	_MCFCRT_kLockKindRwLockExclusive    = 4,
+} _MCFCRT_LockKind;
+
+typedef struct __MCFCRT_tagLockProfileRecord {
+	// `__pLock` is a null pointer for the overflow record, which collects statistics that don't fit in the table.
+	const void *__pLock;
+	// This is the return address of the function that acquired the lock. C++ wrappers in MCF pass the return addresses of their callers.
+	const void *__pCallSite;
+	_MCFCRT_LockKind __eKind;
+	_MCFCRT_STD uint64_t __u64Acquisitions;
+	// An acquisition is contended if the lock was not available at the first attempt.
+	_MCFCRT_STD uint64_t __u64ContendedAcquisitions;
+	_MCFCRT_STD uint64_t __u64SpinSuccesses;
+	_MCFCRT_STD uint64_t __u64SpinFailures;
+	// Times are in nanoseconds. Hold times are only measured if a lock is released by the thread that acquired it.
+	_MCFCRT_STD uint64_t __u64WaitTimeNs;
+	_MCFCRT_STD uint64_t __u64HoldTimeNs;
+} _MCFCRT_LockProfileRecord;
+
+// This function returns `false` if the profiler has already been started, or if it could not be started, in which case `GetLastError()` tells why.
+extern bool _MCFCRT_StartLockProfiler(void) _MCFCRT_NOEXCEPT;
+// This function returns `false` if the profiler is not running.
+extern bool _MCFCRT_StopLockProfiler(void) _MCFCRT_NOEXCEPT;
+
+// This function copies at most `__uMaxCount` records into `__pRecords`, and returns the number of records that exist, which may be greater than `__uMaxCount`.
+// It does not lock anything or allocate memory. Records that are updated concurrently might be slightly inconsistent.
+extern _MCFCRT_STD size_t _MCFCRT_SnapshotLockProfile(_MCFCRT_LockProfileRecord *__pRecords, _MCFCRT_STD size_t __uMaxCount) _MCFCRT_NOEXCEPT;
+
+// This function shall be called when a thread exits.
+extern void __MCFCRT_LockProfilerThreadCleanup(void) _MCFCRT_NOEXCEPT;
+
+// Below are hooks for lock implementations. They shall only be called if `__MCFCRT_IsLockProfilerRunning()` returns `true`.
+__attribute__((__pure__))
+extern bool __MCFCRT_IsLockProfilerRunning(void) _MCFCRT_NOEXCEPT;
+
+#define __MCFCRT_LOCK_EVENT_CONTENDED        0x01u
+#define __MCFCRT_LOCK_EVENT_SPIN_SUCCEEDED   0x02u
+#define __MCFCRT_LOCK_EVENT_SPIN_FAILED      0x04u
+
+extern _MCFCRT_STD int64_t __MCFCRT_LockProfilerGetTimestamp(void) _MCFCRT_NOEXCEPT;
+// `__uEvents` is a combination of `__MCFCRT_LOCK_EVENT_*` that occurred during the wait. If `__bAcquired` is `false`, the wait has timed out.
+extern void __MCFCRT_LockProfilerRecordWait(const void *__pLock, _MCFCRT_LockKind __eKind, const void *__pCallSite, _MCFCRT_STD int64_t __n64WaitBegin, unsigned __uEvents, bool __bAcquired) _MCFCRT_NOEXCEPT;
+extern void __MCFCRT_LockProfilerRecordRelease(const void *__pLock) _MCFCRT_NOEXCEPT;
+
+_MCFCRT_EXTERN_C_END
+
+#endif
@@ -4,6 +4,7 @@
 
 #define __MCFCRT_MUTEX_INLINE_OR_EXTERN     extern inline
 #include "mutex.h"
+#include "lock_profiler.h"
 #include "_nt_timeout.h"
 #include "xassert.h"
 #include "expect.h"
@@ -46,8 +47,14 @@ extern BOOLEAN RtlDllShutdownInProgress(void);
 #define MIN_SPIN_COUNT          ((uintptr_t)16)
 #define MAX_SPIN_MULTIPLIER     ((uintptr_t)32)
 
+static inline void NoteLockEvents(unsigned *puEvents, unsigned uEvents){
+	if(puEvents){
+		*puEvents |= uEvents;
+	}
+}
+
 __attribute__((__always_inline__))
-static inline bool ReallyWaitForMutex(volatile uintptr_t *puControl, size_t uMaxSpinCountInitial, bool bMayTimeOut, uint64_t u64UntilFastMonoClock){
+static inline bool ReallyWaitForMutex(volatile uintptr_t *puControl, size_t uMaxSpinCountInitial, bool bMayTimeOut, uint64_t u64UntilFastMonoClock, unsigned *puEvents){
 	for(;;){
 		size_t uMaxSpinCount, uSpinMultiplier;
 		bool bTaken, bSpinnable;
@@ -83,6 +90,7 @@ static inline bool ReallyWaitForMutex(volatile uintptr_t *puControl, size_t uMax
 		if(_MCFCRT_EXPECT(bTaken)){
 			return true;
 		}
+		NoteLockEvents(puEvents, __MCFCRT_LOCK_EVENT_CONTENDED);
 		if(_MCFCRT_EXPECT(bSpinnable)){
 			for(size_t uSpinIndex = 0; _MCFCRT_EXPECT(uSpinIndex < uMaxSpinCount); ++uSpinIndex){
 				register size_t uMultiplierIndex = uSpinMultiplier + 1;
@@ -105,6 +113,7 @@ static inline bool ReallyWaitForMutex(volatile uintptr_t *puControl, size_t uMax
 					} while(_MCFCRT_EXPECT_NOT(!__atomic_compare_exchange_n(puControl, &uOld, uNew, false, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)));
 				}
 				if(_MCFCRT_EXPECT_NOT(bTaken)){
+					NoteLockEvents(puEvents, __MCFCRT_LOCK_EVENT_SPIN_SUCCEEDED);
 					return true;
 				}
 			}
@@ -124,8 +133,10 @@ static inline bool ReallyWaitForMutex(volatile uintptr_t *puControl, size_t uMax
 				} while(_MCFCRT_EXPECT_NOT(!__atomic_compare_exchange_n(puControl, &uOld, uNew, false, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)));
 			}
 			if(_MCFCRT_EXPECT(bTaken)){
+				NoteLockEvents(puEvents, __MCFCRT_LOCK_EVENT_SPIN_SUCCEEDED);
 				return true;
 			}
+			NoteLockEvents(puEvents, __MCFCRT_LOCK_EVENT_SPIN_FAILED);
 		} else {
 			{
 				uintptr_t uOld, uNew;
@@ -197,14 +208,34 @@ static inline void ReallySignalMutex(volatile uintptr_t *puControl){
 	}
 }
 
-bool __MCFCRT_ReallyWaitForMutex(_MCFCRT_Mutex *pMutex, size_t uMaxSpinCount, uint64_t u64UntilFastMonoClock){
-	const bool bLocked = ReallyWaitForMutex(&(pMutex->__u), uMaxSpinCount, true, u64UntilFastMonoClock);
+__attribute__((__noinline__))
+static bool ProfiledWaitForMutex(volatile uintptr_t *puControl, size_t uMaxSpinCount, bool bMayTimeOut, uint64_t u64UntilFastMonoClock, const void *pCallSite){
+	unsigned uEvents = 0;
+	const int64_t n64WaitBegin = __MCFCRT_LockProfilerGetTimestamp();
+	const bool bLocked = ReallyWaitForMutex(puControl, uMaxSpinCount, bMayTimeOut, u64UntilFastMonoClock, &uEvents);
+	__MCFCRT_LockProfilerRecordWait((const void *)puControl, _MCFCRT_kLockKindMutex, pCallSite, n64WaitBegin, uEvents, bLocked);
 	return bLocked;
 }
-void __MCFCRT_ReallyWaitForMutexForever(_MCFCRT_Mutex *pMutex, size_t uMaxSpinCount){
-	const bool bLocked = ReallyWaitForMutex(&(pMutex->__u), uMaxSpinCount, false, UINT64_MAX);
+
+bool __MCFCRT_ReallyWaitForMutex(_MCFCRT_Mutex *pMutex, size_t uMaxSpinCount, uint64_t u64UntilFastMonoClock, const void *pRetAddrOuter){
+	if(__MCFCRT_IsLockProfilerRunning()){
+		return ProfiledWaitForMutex(&(pMutex->__u), uMaxSpinCount, true, u64UntilFastMonoClock, pRetAddrOuter);
+	}
+	const bool bLocked = ReallyWaitForMutex(&(pMutex->__u), uMaxSpinCount, true, u64UntilFastMonoClock, _MCFCRT_NULLPTR);
+	return bLocked;
+}
+void __MCFCRT_ReallyWaitForMutexForever(_MCFCRT_Mutex *pMutex, size_t uMaxSpinCount, const void *pRetAddrOuter){
+	if(__MCFCRT_IsLockProfilerRunning()){
+		const bool bLocked = ProfiledWaitForMutex(&(pMutex->__u), uMaxSpinCount, false, UINT64_MAX, pRetAddrOuter);
+		_MCFCRT_ASSERT(bLocked);
+		return;
+	}
+	const bool bLocked = ReallyWaitForMutex(&(pMutex->__u), uMaxSpinCount, false, UINT64_MAX, _MCFCRT_NULLPTR);
 	_MCFCRT_ASSERT(bLocked);
 }
 void __MCFCRT_ReallySignalMutex(_MCFCRT_Mutex *pMutex){
+	if(__MCFCRT_IsLockProfilerRunning()){
+		__MCFCRT_LockProfilerRecordRelease((const void *)&(pMutex->__u));
+	}
 	ReallySignalMutex(&(pMutex->__u));
 }
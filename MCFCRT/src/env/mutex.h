@@ -6,6 +6,7 @@
 #define __MCFCRT_ENV_MUTEX_H_
 
 #include "_crtdef.h"
+#include "lock_profiler.h"
 
 #ifndef __MCFCRT_MUTEX_INLINE_OR_EXTERN
 #  define __MCFCRT_MUTEX_INLINE_OR_EXTERN     __attribute__((__gnu_inline__)) extern inline
@@ -24,25 +25,58 @@ __MCFCRT_MUTEX_INLINE_OR_EXTERN void _MCFCRT_InitializeMutex(_MCFCRT_Mutex *__pM
 	__atomic_store_n(&(__pMutex->__u), 0, __ATOMIC_RELEASE);
 }
 
-extern bool __MCFCRT_ReallyWaitForMutex(_MCFCRT_Mutex *__pMutex, _MCFCRT_STD size_t __uMaxSpinCount, _MCFCRT_STD uint64_t __u64UntilFastMonoClock) _MCFCRT_NOEXCEPT;
-extern void __MCFCRT_ReallyWaitForMutexForever(_MCFCRT_Mutex *__pMutex, _MCFCRT_STD size_t __uMaxSpinCount) _MCFCRT_NOEXCEPT;
+extern bool __MCFCRT_ReallyWaitForMutex(_MCFCRT_Mutex *__pMutex, _MCFCRT_STD size_t __uMaxSpinCount, _MCFCRT_STD uint64_t __u64UntilFastMonoClock, const void *__pRetAddrOuter) _MCFCRT_NOEXCEPT;
+extern void __MCFCRT_ReallyWaitForMutexForever(_MCFCRT_Mutex *__pMutex, _MCFCRT_STD size_t __uMaxSpinCount, const void *__pRetAddrOuter) _MCFCRT_NOEXCEPT;
 extern void __MCFCRT_ReallySignalMutex(_MCFCRT_Mutex *__pMutex) _MCFCRT_NOEXCEPT;
 
-__MCFCRT_MUTEX_INLINE_OR_EXTERN bool _MCFCRT_WaitForMutex(_MCFCRT_Mutex *__pMutex, _MCFCRT_STD size_t __uMaxSpinCount, _MCFCRT_STD uint64_t __u64UntilFastMonoClock) _MCFCRT_NOEXCEPT {
+// Acquisitions on the fast path are counted by the lock profiler, too. When it is not running, this costs a function call.
+__MCFCRT_MUTEX_INLINE_OR_EXTERN void __MCFCRT_ProfileUncontendedMutex(_MCFCRT_Mutex *__pMutex, const void *__pRetAddrOuter) _MCFCRT_NOEXCEPT {
+	if(__builtin_expect(__MCFCRT_IsLockProfilerRunning(), false)){
+		__MCFCRT_LockProfilerRecordWait(&(__pMutex->__u), _MCFCRT_kLockKindMutex, __pRetAddrOuter, 0, 0, true);
+	}
+}
+
+// `__pRetAddrOuter` is the call site that is reported to the lock profiler. Code that wraps these functions shall pass its own return address.
+__MCFCRT_MUTEX_INLINE_OR_EXTERN bool __MCFCRT_TryMutex(_MCFCRT_Mutex *__pMutex, const void *__pRetAddrOuter) _MCFCRT_NOEXCEPT {
+	unsigned char *const __pbyGuard = (unsigned char *)(void *)&(__pMutex->__u);
+	unsigned char __byLockFlag = __atomic_load_n(__pbyGuard, __ATOMIC_RELAXED);
+	if((__byLockFlag == 0) && __atomic_compare_exchange_n(__pbyGuard, &__byLockFlag, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)){
+		__MCFCRT_ProfileUncontendedMutex(__pMutex, __pRetAddrOuter);
+		return true;
+	}
+	return false;
+}
+__MCFCRT_MUTEX_INLINE_OR_EXTERN bool __MCFCRT_WaitForMutex(_MCFCRT_Mutex *__pMutex, _MCFCRT_STD size_t __uMaxSpinCount, _MCFCRT_STD uint64_t __u64UntilFastMonoClock, const void *__pRetAddrOuter) _MCFCRT_NOEXCEPT {
 	unsigned char *const __pbyGuard = (unsigned char *)(void *)&(__pMutex->__u);
 	unsigned char __byLockFlag = __atomic_load_n(__pbyGuard, __ATOMIC_RELAXED);
 	if(__builtin_expect((__byLockFlag == 0) && __atomic_compare_exchange_n(__pbyGuard, &__byLockFlag, 1, true, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE), true)){
+		__MCFCRT_ProfileUncontendedMutex(__pMutex, __pRetAddrOuter);
 		return true;
 	}
-	return __MCFCRT_ReallyWaitForMutex(__pMutex, __uMaxSpinCount, __u64UntilFastMonoClock);
+	return __MCFCRT_ReallyWaitForMutex(__pMutex, __uMaxSpinCount, __u64UntilFastMonoClock, __pRetAddrOuter);
 }
-__MCFCRT_MUTEX_INLINE_OR_EXTERN void _MCFCRT_WaitForMutexForever(_MCFCRT_Mutex *__pMutex, _MCFCRT_STD size_t __uMaxSpinCount) _MCFCRT_NOEXCEPT {
+__MCFCRT_MUTEX_INLINE_OR_EXTERN void __MCFCRT_WaitForMutexForever(_MCFCRT_Mutex *__pMutex, _MCFCRT_STD size_t __uMaxSpinCount, const void *__pRetAddrOuter) _MCFCRT_NOEXCEPT {
 	unsigned char *const __pbyGuard = (unsigned char *)(void *)&(__pMutex->__u);
 	unsigned char __byLockFlag = __atomic_load_n(__pbyGuard, __ATOMIC_RELAXED);
 	if(__builtin_expect((__byLockFlag == 0) && __atomic_compare_exchange_n(__pbyGuard, &__byLockFlag, 1, true, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE), true)){
+		__MCFCRT_ProfileUncontendedMutex(__pMutex, __pRetAddrOuter);
 		return;
 	}
-	__MCFCRT_ReallyWaitForMutexForever(__pMutex, __uMaxSpinCount);
+	__MCFCRT_ReallyWaitForMutexForever(__pMutex, __uMaxSpinCount, __pRetAddrOuter);
+}
+
+// This function makes a single attempt without spinning or entering the kernel. A failure is not counted as a timed-out wait.
+__MCFCRT_MUTEX_INLINE_OR_EXTERN bool _MCFCRT_TryMutex(_MCFCRT_Mutex *__pMutex) _MCFCRT_NOEXCEPT {
+	return __MCFCRT_TryMutex(__pMutex,
+		__builtin_return_address(0));
+}
+__MCFCRT_MUTEX_INLINE_OR_EXTERN bool _MCFCRT_WaitForMutex(_MCFCRT_Mutex *__pMutex, _MCFCRT_STD size_t __uMaxSpinCount, _MCFCRT_STD uint64_t __u64UntilFastMonoClock) _MCFCRT_NOEXCEPT {
+	return __MCFCRT_WaitForMutex(__pMutex, __uMaxSpinCount, __u64UntilFastMonoClock,
+		__builtin_return_address(0));
+}
+__MCFCRT_MUTEX_INLINE_OR_EXTERN void _MCFCRT_WaitForMutexForever(_MCFCRT_Mutex *__pMutex, _MCFCRT_STD size_t __uMaxSpinCount) _MCFCRT_NOEXCEPT {
+	__MCFCRT_WaitForMutexForever(__pMutex, __uMaxSpinCount,
+		__builtin_return_address(0));
 }
 __MCFCRT_MUTEX_INLINE_OR_EXTERN void _MCFCRT_SignalMutex(_MCFCRT_Mutex *__pMutex) _MCFCRT_NOEXCEPT {
 	__MCFCRT_ReallySignalMutex(__pMutex);
@@ -0,0 +1,332 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#define __MCFCRT_RWLOCK_INLINE_OR_EXTERN     extern inline
+#include "rwlock.h"
+#include "lock_profiler.h"
+#include "_nt_timeout.h"
+#include "xassert.h"
+#include "expect.h"
+#include <ntdef.h>
+
+__attribute__((__dllimport__, __stdcall__))
+extern NTSTATUS NtWaitForKeyedEvent(HANDLE hKeyedEvent, void *pKey, BOOLEAN bAlertable, const LARGE_INTEGER *pliTimeout);
+__attribute__((__dllimport__, __stdcall__))
+extern NTSTATUS NtReleaseKeyedEvent(HANDLE hKeyedEvent, void *pKey, BOOLEAN bAlertable, const LARGE_INTEGER *pliTimeout);
+
+__attribute__((__dllimport__, __stdcall__, __const__))
+extern BOOLEAN RtlDllShutdownInProgress(void);
+
+// The lock is handed off to waiting threads directly, i.e. a thread that has been woken up owns the lock already.
+// Writers wait on the address of the control word. Readers wait on that address plus two, which is not the address of any other control word.
+#define MASK_WRITER_LOCKED      ((uintptr_t)0x01)
+#ifdef _WIN64
+#  define MASK_READERS_ACTIVE   ((uintptr_t)0x00000000003FFFFE)
+#  define MASK_WRITERS_WAITING  ((uintptr_t)0x000007FFFFC00000)
+#  define MASK_READERS_WAITING  ((uintptr_t)0xFFFFF80000000000)
+#else
+#  define MASK_READERS_ACTIVE   ((uintptr_t)0x00000FFE)
+#  define MASK_WRITERS_WAITING  ((uintptr_t)0x003FF000)
+#  define MASK_READERS_WAITING  ((uintptr_t)0xFFC00000)
+#endif
+
+#define READERS_ACTIVE_ONE      ((uintptr_t)(MASK_READERS_ACTIVE & -MASK_READERS_ACTIVE))
+#define WRITERS_WAITING_ONE     ((uintptr_t)(MASK_WRITERS_WAITING & -MASK_WRITERS_WAITING))
+#define READERS_WAITING_ONE     ((uintptr_t)(MASK_READERS_WAITING & -MASK_READERS_WAITING))
+
+static_assert((MASK_WRITER_LOCKED ^ MASK_READERS_ACTIVE ^ MASK_WRITERS_WAITING ^ MASK_READERS_WAITING) == UINTPTR_MAX, "Masks must cover all bits.");
+
+static inline void *GetWriterKey(volatile uintptr_t *puControl){
+	return (void *)puControl;
+}
+static inline void *GetReaderKey(volatile uintptr_t *puControl){
+	return (unsigned char *)puControl + 2;
+}
+
+static inline bool IsSharedAcquirable(uintptr_t uControl){
+	return !(uControl & (MASK_WRITER_LOCKED | MASK_WRITERS_WAITING));
+}
+static inline bool IsExclusiveAcquirable(uintptr_t uControl){
+	return !(uControl & (MASK_WRITER_LOCKED | MASK_READERS_ACTIVE));
+}
+
+// If the lock is neither locked exclusively nor wanted by any writer, nothing blocks the readers that are waiting, so let them all in.
+// This function returns the number of readers that have been converted from waiting to active. The caller shall release them on the reader key.
+static inline size_t AdmitWaitingReaders(uintptr_t *puNew){
+	const uintptr_t uNew = *puNew;
+	if(uNew & (MASK_WRITER_LOCKED | MASK_WRITERS_WAITING)){
+		return 0;
+	}
+	const size_t uReadersToRelease = (uNew & MASK_READERS_WAITING) / READERS_WAITING_ONE;
+	*puNew = (uNew & ~MASK_READERS_WAITING) + uReadersToRelease * READERS_ACTIVE_ONE;
+	return uReadersToRelease;
+}
+
+static inline void NoteLockEvents(unsigned *puEvents, unsigned uEvents){
+	if(puEvents){
+		*puEvents |= uEvents;
+	}
+}
+
+static void ReleaseWaiters(void *pKey, size_t uCount){
+	// If `RtlDllShutdownInProgress()` is `true`, other threads will have been terminated.
+	// Calling `NtReleaseKeyedEvent()` when no thread is waiting results in deadlocks. Don't do that.
+	if(RtlDllShutdownInProgress()){
+		return;
+	}
+	for(size_t uIndex = 0; uIndex < uCount; ++uIndex){
+		NTSTATUS lStatus = NtReleaseKeyedEvent(_MCFCRT_NULLPTR, pKey, false, _MCFCRT_NULLPTR);
+		_MCFCRT_ASSERT_MSG(NT_SUCCESS(lStatus), L"NtReleaseKeyedEvent() 失败。");
+		_MCFCRT_ASSERT(lStatus != STATUS_TIMEOUT);
+	}
+}
+
+// This function returns `true` if the lock has been handed off to the calling thread, or `false` if it has timed out.
+// `uMaskWaiting` selects the counter that the calling thread has incremented before.
+__attribute__((__always_inline__))
+static inline bool WaitForHandoff(volatile uintptr_t *puControl, void *pKey, uintptr_t uMaskWaiting, bool bMayTimeOut, uint64_t u64UntilFastMonoClock){
+	if(!bMayTimeOut){
+		NTSTATUS lStatus = NtWaitForKeyedEvent(_MCFCRT_NULLPTR, pKey, false, _MCFCRT_NULLPTR);
+		_MCFCRT_ASSERT_MSG(NT_SUCCESS(lStatus), L"NtWaitForKeyedEvent() 失败。");
+		_MCFCRT_ASSERT(lStatus != STATUS_TIMEOUT);
+		return true;
+	}
+	LARGE_INTEGER liTimeout;
+	__MCFCRT_InitializeNtTimeout(&liTimeout, u64UntilFastMonoClock);
+	NTSTATUS lStatus = NtWaitForKeyedEvent(_MCFCRT_NULLPTR, pKey, false, &liTimeout);
+	_MCFCRT_ASSERT_MSG(NT_SUCCESS(lStatus), L"NtWaitForKeyedEvent() 失败。");
+	while(_MCFCRT_EXPECT(lStatus == STATUS_TIMEOUT)){
+		bool bDecremented;
+		size_t uReadersToRelease;
+		{
+			uintptr_t uOld, uNew;
+			uOld = __atomic_load_n(puControl, __ATOMIC_RELAXED);
+			do {
+				uReadersToRelease = 0;
+				bDecremented = (uOld & uMaskWaiting) != 0;
+				if(!bDecremented){
+					break;
+				}
+				uNew = uOld - (uMaskWaiting & -uMaskWaiting);
+				// If we were the last waiting writer, readers that have been queued behind us would otherwise wait forever.
+				uReadersToRelease = AdmitWaitingReaders(&uNew);
+			} while(_MCFCRT_EXPECT_NOT(!__atomic_compare_exchange_n(puControl, &uOld, uNew, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)));
+		}
+		if(bDecremented){
+			if(_MCFCRT_EXPECT_NOT(uReadersToRelease != 0)){
+				ReleaseWaiters(GetReaderKey(puControl), uReadersToRelease);
+			}
+			return false;
+		}
+		// Someone is handing the lock off to us. Wait for it.
+		liTimeout.QuadPart = 0;
+		lStatus = NtWaitForKeyedEvent(_MCFCRT_NULLPTR, pKey, false, &liTimeout);
+		_MCFCRT_ASSERT_MSG(NT_SUCCESS(lStatus), L"NtWaitForKeyedEvent() 失败。");
+	}
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return true;
+}
+
+__attribute__((__always_inline__))
+static inline void ReallySignalRwLockShared(volatile uintptr_t *puControl){
+	bool bHandoff;
+	size_t uReadersToRelease;
+	{
+		uintptr_t uOld, uNew;
+		uOld = __atomic_load_n(puControl, __ATOMIC_RELAXED);
+		do {
+			_MCFCRT_ASSERT_MSG(uOld & MASK_READERS_ACTIVE, L"读写锁没有被任何线程以共享方式锁定。");
+			uNew = uOld - READERS_ACTIVE_ONE;
+			uReadersToRelease = 0;
+			// If we are the last reader and writers are waiting, hand the lock off to one of them.
+			bHandoff = !(uNew & (MASK_WRITER_LOCKED | MASK_READERS_ACTIVE)) && (uNew & MASK_WRITERS_WAITING);
+			if(bHandoff){
+				uNew = uNew - WRITERS_WAITING_ONE + MASK_WRITER_LOCKED;
+			} else {
+				// Readers that have been queued behind a writer which has since timed out are let in here.
+				uReadersToRelease = AdmitWaitingReaders(&uNew);
+			}
+		} while(_MCFCRT_EXPECT_NOT(!__atomic_compare_exchange_n(puControl, &uOld, uNew, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED)));
+	}
+	if(_MCFCRT_EXPECT_NOT(bHandoff)){
+		ReleaseWaiters(GetWriterKey(puControl), 1);
+	}
+	if(_MCFCRT_EXPECT_NOT(uReadersToRelease != 0)){
+		ReleaseWaiters(GetReaderKey(puControl), uReadersToRelease);
+	}
+}
+
+__attribute__((__always_inline__))
+static inline bool ReallyWaitForRwLockShared(volatile uintptr_t *puControl, size_t uMaxSpinCount, bool bMayTimeOut, uint64_t u64UntilFastMonoClock, unsigned *puEvents){
+	// Try the fast path first. If we have incremented the count without being allowed to, undo it.
+	const uintptr_t uOptimistic = __atomic_fetch_add(puControl, READERS_ACTIVE_ONE, __ATOMIC_ACQUIRE);
+	if(_MCFCRT_EXPECT(IsSharedAcquirable(uOptimistic))){
+		return true;
+	}
+	ReallySignalRwLockShared(puControl);
+	NoteLockEvents(puEvents, __MCFCRT_LOCK_EVENT_CONTENDED);
+
+	for(size_t uSpinIndex = 0; uSpinIndex < uMaxSpinCount; ++uSpinIndex){
+		__builtin_ia32_pause();
+		uintptr_t uOld = __atomic_load_n(puControl, __ATOMIC_RELAXED);
+		if(!IsSharedAcquirable(uOld)){
+			continue;
+		}
+		if(__atomic_compare_exchange_n(puControl, &uOld, uOld + READERS_ACTIVE_ONE, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)){
+			NoteLockEvents(puEvents, __MCFCRT_LOCK_EVENT_SPIN_SUCCEEDED);
+			return true;
+		}
+	}
+	bool bTaken;
+	{
+		uintptr_t uOld, uNew;
+		uOld = __atomic_load_n(puControl, __ATOMIC_RELAXED);
+		do {
+			bTaken = IsSharedAcquirable(uOld);
+			if(bTaken){
+				uNew = uOld + READERS_ACTIVE_ONE;
+			} else {
+				uNew = uOld + READERS_WAITING_ONE;
+			}
+		} while(_MCFCRT_EXPECT_NOT(!__atomic_compare_exchange_n(puControl, &uOld, uNew, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)));
+	}
+	if(bTaken){
+		return true;
+	}
+	if(uMaxSpinCount != 0){
+		NoteLockEvents(puEvents, __MCFCRT_LOCK_EVENT_SPIN_FAILED);
+	}
+	return WaitForHandoff(puControl, GetReaderKey(puControl), MASK_READERS_WAITING, bMayTimeOut, u64UntilFastMonoClock);
+}
+
+__attribute__((__always_inline__))
+static inline bool ReallyWaitForRwLockExclusive(volatile uintptr_t *puControl, size_t uMaxSpinCount, bool bMayTimeOut, uint64_t u64UntilFastMonoClock, unsigned *puEvents){
+	uintptr_t uExpected = 0;
+	if(_MCFCRT_EXPECT(__atomic_compare_exchange_n(puControl, &uExpected, MASK_WRITER_LOCKED, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))){
+		return true;
+	}
+	NoteLockEvents(puEvents, __MCFCRT_LOCK_EVENT_CONTENDED);
+
+	for(size_t uSpinIndex = 0; uSpinIndex < uMaxSpinCount; ++uSpinIndex){
+		__builtin_ia32_pause();
+		uintptr_t uOld = __atomic_load_n(puControl, __ATOMIC_RELAXED);
+		if(!IsExclusiveAcquirable(uOld)){
+			continue;
+		}
+		if(__atomic_compare_exchange_n(puControl, &uOld, uOld | MASK_WRITER_LOCKED, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)){
+			NoteLockEvents(puEvents, __MCFCRT_LOCK_EVENT_SPIN_SUCCEEDED);
+			return true;
+		}
+	}
+	bool bTaken;
+	{
+		uintptr_t uOld, uNew;
+		uOld = __atomic_load_n(puControl, __ATOMIC_RELAXED);
+		do {
+			bTaken = IsExclusiveAcquirable(uOld);
+			if(bTaken){
+				uNew = uOld | MASK_WRITER_LOCKED;
+			} else {
+				uNew = uOld + WRITERS_WAITING_ONE;
+			}
+		} while(_MCFCRT_EXPECT_NOT(!__atomic_compare_exchange_n(puControl, &uOld, uNew, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)));
+	}
+	if(bTaken){
+		return true;
+	}
+	if(uMaxSpinCount != 0){
+		NoteLockEvents(puEvents, __MCFCRT_LOCK_EVENT_SPIN_FAILED);
+	}
+	return WaitForHandoff(puControl, GetWriterKey(puControl), MASK_WRITERS_WAITING, bMayTimeOut, u64UntilFastMonoClock);
+}
+__attribute__((__always_inline__))
+static inline void ReallySignalRwLockExclusive(volatile uintptr_t *puControl){
+	size_t uWritersToRelease, uReadersToRelease;
+	{
+		uintptr_t uOld, uNew;
+		uOld = __atomic_load_n(puControl, __ATOMIC_RELAXED);
+		do {
+			_MCFCRT_ASSERT_MSG(uOld & MASK_WRITER_LOCKED, L"读写锁没有被任何线程以独占方式锁定。");
+			uWritersToRelease = 0;
+			uReadersToRelease = 0;
+			if(uOld & MASK_WRITERS_WAITING){
+				// Writers are preferred. Keep the lock locked and hand it off to one of them.
+				uWritersToRelease = 1;
+				uNew = uOld - WRITERS_WAITING_ONE;
+			} else if(uOld & MASK_READERS_WAITING){
+				// Let all readers in at once.
+				uReadersToRelease = (uOld & MASK_READERS_WAITING) / READERS_WAITING_ONE;
+				uNew = (uOld & ~(MASK_WRITER_LOCKED | MASK_READERS_WAITING)) + uReadersToRelease * READERS_ACTIVE_ONE;
+			} else {
+				uNew = uOld & ~MASK_WRITER_LOCKED;
+			}
+		} while(_MCFCRT_EXPECT_NOT(!__atomic_compare_exchange_n(puControl, &uOld, uNew, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED)));
+	}
+	if(_MCFCRT_EXPECT_NOT(uWritersToRelease != 0)){
+		ReleaseWaiters(GetWriterKey(puControl), uWritersToRelease);
+	}
+	if(_MCFCRT_EXPECT_NOT(uReadersToRelease != 0)){
+		ReleaseWaiters(GetReaderKey(puControl), uReadersToRelease);
+	}
+}
+
+__attribute__((__noinline__))
+static bool ProfiledWaitForRwLock(volatile uintptr_t *puControl, bool bExclusive, size_t uMaxSpinCount, bool bMayTimeOut, uint64_t u64UntilFastMonoClock, const void *pCallSite){
+	unsigned uEvents = 0;
+	const int64_t n64WaitBegin = __MCFCRT_LockProfilerGetTimestamp();
+	bool bLocked;
+	if(bExclusive){
+		bLocked = ReallyWaitForRwLockExclusive(puControl, uMaxSpinCount, bMayTimeOut, u64UntilFastMonoClock, &uEvents);
+	} else {
+		bLocked = ReallyWaitForRwLockShared(puControl, uMaxSpinCount, bMayTimeOut, u64UntilFastMonoClock, &uEvents);
+	}
+	__MCFCRT_LockProfilerRecordWait((const void *)puControl, bExclusive ? _MCFCRT_kLockKindRwLockExclusive : _MCFCRT_kLockKindRwLockShared, pCallSite, n64WaitBegin, uEvents, bLocked);
+	return bLocked;
+}
+
+bool __MCFCRT_WaitForRwLockShared(_MCFCRT_RwLock *pRwLock, size_t uMaxSpinCount, uint64_t u64UntilFastMonoClock, const void *pRetAddrOuter){
+	if(__MCFCRT_IsLockProfilerRunning()){
+		return ProfiledWaitForRwLock(&(pRwLock->__u), false, uMaxSpinCount, true, u64UntilFastMonoClock, pRetAddrOuter);
+	}
+	const bool bLocked = ReallyWaitForRwLockShared(&(pRwLock->__u), uMaxSpinCount, true, u64UntilFastMonoClock, _MCFCRT_NULLPTR);
+	return bLocked;
+}
+void __MCFCRT_WaitForRwLockSharedForever(_MCFCRT_RwLock *pRwLock, size_t uMaxSpinCount, const void *pRetAddrOuter){
+	if(__MCFCRT_IsLockProfilerRunning()){
+		const bool bLocked = ProfiledWaitForRwLock(&(pRwLock->__u), false, uMaxSpinCount, false, UINT64_MAX, pRetAddrOuter);
+		_MCFCRT_ASSERT(bLocked);
+		return;
+	}
+	const bool bLocked = ReallyWaitForRwLockShared(&(pRwLock->__u), uMaxSpinCount, false, UINT64_MAX, _MCFCRT_NULLPTR);
+	_MCFCRT_ASSERT(bLocked);
+}
+void _MCFCRT_SignalRwLockShared(_MCFCRT_RwLock *pRwLock){
+	if(__MCFCRT_IsLockProfilerRunning()){
+		__MCFCRT_LockProfilerRecordRelease((const void *)&(pRwLock->__u));
+	}
+	ReallySignalRwLockShared(&(pRwLock->__u));
+}
+
+bool __MCFCRT_WaitForRwLockExclusive(_MCFCRT_RwLock *pRwLock, size_t uMaxSpinCount, uint64_t u64UntilFastMonoClock, const void *pRetAddrOuter){
+	if(__MCFCRT_IsLockProfilerRunning()){
+		return ProfiledWaitForRwLock(&(pRwLock->__u), true, uMaxSpinCount, true, u64UntilFastMonoClock, pRetAddrOuter);
+	}
+	const bool bLocked = ReallyWaitForRwLockExclusive(&(pRwLock->__u), uMaxSpinCount, true, u64UntilFastMonoClock, _MCFCRT_NULLPTR);
+	return bLocked;
+}
+void __MCFCRT_WaitForRwLockExclusiveForever(_MCFCRT_RwLock *pRwLock, size_t uMaxSpinCount, const void *pRetAddrOuter){
+	if(__MCFCRT_IsLockProfilerRunning()){
+		const bool bLocked = ProfiledWaitForRwLock(&(pRwLock->__u), true, uMaxSpinCount, false, UINT64_MAX, pRetAddrOuter);
+		_MCFCRT_ASSERT(bLocked);
+		return;
+	}
+	const bool bLocked = ReallyWaitForRwLockExclusive(&(pRwLock->__u), uMaxSpinCount, false, UINT64_MAX, _MCFCRT_NULLPTR);
+	_MCFCRT_ASSERT(bLocked);
+}
+void _MCFCRT_SignalRwLockExclusive(_MCFCRT_RwLock *pRwLock){
+	if(__MCFCRT_IsLockProfilerRunning()){
+		__MCFCRT_LockProfilerRecordRelease((const void *)&(pRwLock->__u));
+	}
+	ReallySignalRwLockExclusive(&(pRwLock->__u));
+}
@@ -0,0 +1,58 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#ifndef __MCFCRT_ENV_RWLOCK_H_
+#define __MCFCRT_ENV_RWLOCK_H_
+
+#include "_crtdef.h"
+
+#ifndef __MCFCRT_RWLOCK_INLINE_OR_EXTERN
+#  define __MCFCRT_RWLOCK_INLINE_OR_EXTERN     __attribute__((__gnu_inline__)) extern inline
+#endif
+
+_MCFCRT_EXTERN_C_BEGIN
+
+// This is a readers-writer lock that prefers writers: Once a writer starts waiting, no more readers may enter until it has been granted the lock.
+// Like `_MCFCRT_Mutex`, it may be unlocked by a thread other than the one that locked it.
+// In the case of static initialization, please initialize it with { 0 }.
+typedef struct __MCFCRT_tagRwLock {
+	_MCFCRT_STD uintptr_t __u;
+} _MCFCRT_RwLock;
+
+#define _MCFCRT_RWLOCK_SUGGESTED_SPIN_COUNT   100u
+
+__MCFCRT_RWLOCK_INLINE_OR_EXTERN void _MCFCRT_InitializeRwLock(_MCFCRT_RwLock *__pRwLock) _MCFCRT_NOEXCEPT {
+	__atomic_store_n(&(__pRwLock->__u), 0, __ATOMIC_RELEASE);
+}
+
+// `__pRetAddrOuter` is the call site that is reported to the lock profiler. Code that wraps these functions shall pass its own return address.
+extern bool __MCFCRT_WaitForRwLockShared(_MCFCRT_RwLock *__pRwLock, _MCFCRT_STD size_t __uMaxSpinCount, _MCFCRT_STD uint64_t __u64UntilFastMonoClock, const void *__pRetAddrOuter) _MCFCRT_NOEXCEPT;
+extern void __MCFCRT_WaitForRwLockSharedForever(_MCFCRT_RwLock *__pRwLock, _MCFCRT_STD size_t __uMaxSpinCount, const void *__pRetAddrOuter) _MCFCRT_NOEXCEPT;
+extern bool __MCFCRT_WaitForRwLockExclusive(_MCFCRT_RwLock *__pRwLock, _MCFCRT_STD size_t __uMaxSpinCount, _MCFCRT_STD uint64_t __u64UntilFastMonoClock, const void *__pRetAddrOuter) _MCFCRT_NOEXCEPT;
+extern void __MCFCRT_WaitForRwLockExclusiveForever(_MCFCRT_RwLock *__pRwLock, _MCFCRT_STD size_t __uMaxSpinCount, const void *__pRetAddrOuter) _MCFCRT_NOEXCEPT;
+
+// Readers that don't contend with writers enter with a single atomic addition.
+__MCFCRT_RWLOCK_INLINE_OR_EXTERN bool _MCFCRT_WaitForRwLockShared(_MCFCRT_RwLock *__pRwLock, _MCFCRT_STD size_t __uMaxSpinCount, _MCFCRT_STD uint64_t __u64UntilFastMonoClock) _MCFCRT_NOEXCEPT {
+	return __MCFCRT_WaitForRwLockShared(__pRwLock, __uMaxSpinCount, __u64UntilFastMonoClock,
+		__builtin_return_address(0));
+}
+__MCFCRT_RWLOCK_INLINE_OR_EXTERN void _MCFCRT_WaitForRwLockSharedForever(_MCFCRT_RwLock *__pRwLock, _MCFCRT_STD size_t __uMaxSpinCount) _MCFCRT_NOEXCEPT {
+	__MCFCRT_WaitForRwLockSharedForever(__pRwLock, __uMaxSpinCount,
+		__builtin_return_address(0));
+}
+extern void _MCFCRT_SignalRwLockShared(_MCFCRT_RwLock *__pRwLock) _MCFCRT_NOEXCEPT;
+
+__MCFCRT_RWLOCK_INLINE_OR_EXTERN bool _MCFCRT_WaitForRwLockExclusive(_MCFCRT_RwLock *__pRwLock, _MCFCRT_STD size_t __uMaxSpinCount, _MCFCRT_STD uint64_t __u64UntilFastMonoClock) _MCFCRT_NOEXCEPT {
+	return __MCFCRT_WaitForRwLockExclusive(__pRwLock, __uMaxSpinCount, __u64UntilFastMonoClock,
+		__builtin_return_address(0));
+}
+__MCFCRT_RWLOCK_INLINE_OR_EXTERN void _MCFCRT_WaitForRwLockExclusiveForever(_MCFCRT_RwLock *__pRwLock, _MCFCRT_STD size_t __uMaxSpinCount) _MCFCRT_NOEXCEPT {
+	__MCFCRT_WaitForRwLockExclusiveForever(__pRwLock, __uMaxSpinCount,
+		__builtin_return_address(0));
+}
+extern void _MCFCRT_SignalRwLockExclusive(_MCFCRT_RwLock *__pRwLock) _MCFCRT_NOEXCEPT;
+
+_MCFCRT_EXTERN_C_END
+
+#endif
@@ -4,7 +4,9 @@
 
 #include "standard_streams.h"
 #include "../ext/utf.h"
+#include "../ext/utf_bulk.h"
 #include "mutex.h"
+#include "xassert.h"
 #include "mcfwin.h"
 
 static_assert(sizeof (wchar_t) == sizeof (char16_t), "What?");
@@ -130,13 +132,9 @@ static DWORD UnlockedConvertBinaryToText(Stream *restrict pStream, bool bExhaust
 		const char *pchRead = (void *)(pStream->pbyBuffer + pStream->uBinaryBegin);
 		const char *const pchReadEnd = (void *)(pStream->pbyBuffer + pStream->uBinaryEnd);
 		wchar_t *pwcWrite = (void *)(pStream->pbyBuffer + pStream->uTextEnd);
-		for(;;){
-			char32_t c32CodePoint = _MCFCRT_DecodeUtf8(&pchRead, pchReadEnd, true);
-			if(!_MCFCRT_UTF_SUCCESS(c32CodePoint)){
-				break;
-			}
-			_MCFCRT_UncheckedEncodeUtf16(&pwcWrite, c32CodePoint, true);
-		}
+		wchar_t *const pwcWriteEnd = (void *)(pStream->pbyBuffer + pStream->uTextEnd + uTextSizeAdd);
+		const char32_t c32Result = _MCFCRT_ConvertUtf8ToUtf16(&pwcWrite, pwcWriteEnd, &pchRead, pchReadEnd, true);
+		_MCFCRT_ASSERT(c32Result != _MCFCRT_UTF_BUFFER_TOO_SMALL);
 		if(bExhaust){
 			while(pchRead != pchReadEnd){
 				_MCFCRT_UncheckedEncodeUtf16(&pwcWrite, (uint8_t)*(pchRead++), true);
@@ -162,13 +160,9 @@ static DWORD UnlockedConvertTextToBinary(Stream *restrict pStream, bool bExhaust
 		const wchar_t *pwcRead = (void *)(pStream->pbyBuffer + pStream->uTextBegin);
 		const wchar_t *const pwcReadEnd = (void *)(pStream->pbyBuffer + pStream->uTextEnd);
 		char *pchWrite = (void *)(pStream->pbyBuffer + pStream->uBinaryEnd);
-		for(;;){
-			char32_t c32CodePoint = _MCFCRT_DecodeUtf16(&pwcRead, pwcReadEnd, true);
-			if(!_MCFCRT_UTF_SUCCESS(c32CodePoint)){
-				break;
-			}
-			_MCFCRT_UncheckedEncodeUtf8(&pchWrite, c32CodePoint, true);
-		}
+		char *const pchWriteEnd = (void *)(pStream->pbyBuffer + pStream->uBinaryEnd + uBinarySizeAdd);
+		const char32_t c32Result = _MCFCRT_ConvertUtf16ToUtf8(&pchWrite, pchWriteEnd, &pwcRead, pwcReadEnd, true);
+		_MCFCRT_ASSERT(c32Result != _MCFCRT_UTF_BUFFER_TOO_SMALL);
 		if(bExhaust){
 			while(pwcRead != pwcReadEnd){
 				_MCFCRT_UncheckedEncodeUtf8(&pchWrite, (uint16_t)*(pwcRead++), true);
@@ -112,6 +112,23 @@ long _MCFCRT_ResumeThread(_MCFCRT_ThreadHandle hThread){
 	return lPrevCount;
 }
 
+bool _MCFCRT_SetThreadAffinity(_MCFCRT_ThreadHandle hThread, unsigned short u16Group, uint64_t u64Mask){
+	GROUP_AFFINITY vAffinity = { 0 };
+	vAffinity.Mask  = (KAFFINITY)u64Mask;
+	vAffinity.Group = u16Group;
+	if((uint64_t)vAffinity.Mask != u64Mask){
+		SetLastError(ERROR_INVALID_PARAMETER);
+		return false;
+	}
+	return SetThreadGroupAffinity((HANDLE)hThread, &vAffinity, _MCFCRT_NULLPTR);
+}
+bool _MCFCRT_SetThreadIdealProcessor(_MCFCRT_ThreadHandle hThread, unsigned short u16Group, unsigned char u8Number){
+	PROCESSOR_NUMBER vNumber = { 0 };
+	vNumber.Group  = u16Group;
+	vNumber.Number = u8Number;
+	return SetThreadIdealProcessorEx((HANDLE)hThread, &vNumber, _MCFCRT_NULLPTR);
+}
+
 bool _MCFCRT_WaitForThread(_MCFCRT_ThreadHandle hThread, uint64_t u64UntilFastMonoClock){
 	LARGE_INTEGER liTimeout;
 	__MCFCRT_InitializeNtTimeout(&liTimeout, u64UntilFastMonoClock);
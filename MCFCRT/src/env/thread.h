@@ -29,6 +29,12 @@ extern void _MCFCRT_YieldThread(void) _MCFCRT_NOEXCEPT;
 extern long _MCFCRT_SuspendThread(_MCFCRT_ThreadHandle __hThread) _MCFCRT_NOEXCEPT;
 extern long _MCFCRT_ResumeThread(_MCFCRT_ThreadHandle __hThread) _MCFCRT_NOEXCEPT;
 
+// `__u64Mask` is a set of logical processors in the processor group `__u16Group`. A thread can only run in one group at a time.
+// These functions return `false` on failure, in which case `GetLastError()` tells why.
+extern bool _MCFCRT_SetThreadAffinity(_MCFCRT_ThreadHandle __hThread, unsigned short __u16Group, _MCFCRT_STD uint64_t __u64Mask) _MCFCRT_NOEXCEPT;
+// The ideal processor is only a hint to the scheduler. It shall be within the affinity of the thread.
+extern bool _MCFCRT_SetThreadIdealProcessor(_MCFCRT_ThreadHandle __hThread, unsigned short __u16Group, unsigned char __u8Number) _MCFCRT_NOEXCEPT;
+
 // _MCFCRT_WaitForThread() returns true if the other thread has terminated and false if the current thread has timed out.
 extern bool _MCFCRT_WaitForThread(_MCFCRT_ThreadHandle __hThread, _MCFCRT_STD uint64_t __u64UntilFastMonoClock) _MCFCRT_NOEXCEPT;
 extern void _MCFCRT_WaitForThreadForever(_MCFCRT_ThreadHandle __hThread) _MCFCRT_NOEXCEPT;
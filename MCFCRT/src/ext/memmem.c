@@ -0,0 +1,196 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#include "memmem.h"
+#include "../env/expect.h"
+#include "../env/xassert.h"
+#include "../env/_cpu_features.h"
+#include "../stdc/string/_sse2.h"
+#include "../stdc/string/_avx2.h"
+
+// 不超过这个长度的模式串使用首尾字节过滤，验证每个候选位置的代价有上界，因此总的时间仍然是线性的。
+#define FILTER_MAX_NEEDLE    32u
+
+// 对于每个候选位置，先同时比较其首字节和尾字节，只有都相等的才逐字节比较中间的部分。
+// 所有读取都在 [s, s + n) 之内，因此可以使用非对齐的读取。
+static const unsigned char *filter_sse2(const unsigned char *s, size_t n, const unsigned char *p, size_t m){
+	_MCFCRT_ASSERT(m >= 2);
+	_MCFCRT_ASSERT(m <= n);
+
+	const __m128i xf = _mm_set1_epi8((char)p[0]);
+	const __m128i xl = _mm_set1_epi8((char)p[m - 1]);
+	const unsigned char *rp = s;
+	const unsigned char *const end = s + n - m + 1;
+	while(_MCFCRT_EXPECT((size_t)(end - rp) >= 16)){
+		const __m128i tf = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)rp), xf);
+		const __m128i tl = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(rp + m - 1)), xl);
+		uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_and_si128(tf, tl));
+		while(_MCFCRT_EXPECT_NOT(mask != 0)){
+			const unsigned i = (unsigned)__builtin_ctzl(mask);
+			if(memcmp(rp + i + 1, p + 1, m - 2) == 0){
+				return rp + i;
+			}
+			mask &= mask - 1;
+		}
+		rp += 16;
+	}
+	while(rp != end){
+		if((rp[0] == p[0]) && (rp[m - 1] == p[m - 1]) && (memcmp(rp + 1, p + 1, m - 2) == 0)){
+			return rp;
+		}
+		++rp;
+	}
+	return _MCFCRT_NULLPTR;
+}
+
+__attribute__((__target__("avx2")))
+static const unsigned char *filter_avx2(const unsigned char *s, size_t n, const unsigned char *p, size_t m){
+	_MCFCRT_ASSERT(m >= 2);
+	_MCFCRT_ASSERT(m <= n);
+
+	// 同上，但是每次处理 32 个候选位置。
+	const __m256i yf = _mm256_set1_epi8((char)p[0]);
+	const __m256i yl = _mm256_set1_epi8((char)p[m - 1]);
+	const unsigned char *rp = s;
+	const unsigned char *const end = s + n - m + 1;
+	while(_MCFCRT_EXPECT((size_t)(end - rp) >= 32)){
+		const __m256i tf = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)rp), yf);
+		const __m256i tl = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(rp + m - 1)), yl);
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(tf, tl));
+		while(_MCFCRT_EXPECT_NOT(mask != 0)){
+			const unsigned i = (unsigned)__builtin_ctzl(mask);
+			if(memcmp(rp + i + 1, p + 1, m - 2) == 0){
+				return rp + i;
+			}
+			mask &= mask - 1;
+		}
+		rp += 32;
+	}
+	if(rp == end){
+		return _MCFCRT_NULLPTR;
+	}
+	return filter_sse2(rp, (size_t)(end - rp) + m - 1, p, m);
+}
+
+// https://en.wikipedia.org/wiki/Two-way_string-matching_algorithm
+// 临界分解由两种字典序下的最大后缀中较长的一个给出。此外，根据窗口的尾字节使用坏字符规则跳过不可能匹配的位置。
+static size_t maximal_suffix(const unsigned char *p, size_t m, size_t *period, bool reversed){
+	size_t ip = (size_t)-1, jp = 0, k = 1, per = 1;
+	while(jp + k < m){
+		const unsigned char a = p[ip + k];
+		const unsigned char b = p[jp + k];
+		if(a == b){
+			if(k == per){
+				jp += per;
+				k = 1;
+			} else {
+				++k;
+			}
+		} else if(reversed ? (a < b) : (a > b)){
+			jp += k;
+			k = 1;
+			per = jp - ip;
+		} else {
+			ip = jp++;
+			k = per = 1;
+		}
+	}
+	*period = per;
+	return ip;
+}
+
+static const unsigned char *two_way(const unsigned char *s, size_t n, const unsigned char *p, size_t m){
+	_MCFCRT_ASSERT(m <= n);
+
+	// shift[c] 是 c 在模式串中最后一次出现的位置加一，没有出现的为零。
+	size_t shift[256] = { 0 };
+	for(size_t i = 0; i < m; ++i){
+		shift[p[i]] = i + 1;
+	}
+
+	size_t per, per_rev;
+	size_t ms = maximal_suffix(p, m, &per, false);
+	const size_t ms_rev = maximal_suffix(p, m, &per_rev, true);
+	if(ms_rev + 1 > ms + 1){
+		ms = ms_rev;
+		per = per_rev;
+	}
+	// 如果模式串是周期的，匹配失败后左半部分中已经匹配的长度可以被记住，这样每个字节最多比较常数次。
+	size_t mem0;
+	if(memcmp(p, p + per, ms + 1) == 0){
+		mem0 = m - per;
+	} else {
+		mem0 = 0;
+		per = ((ms > m - ms - 1) ? ms : m - ms - 1) + 1;
+	}
+	size_t mem = 0;
+
+	const unsigned char *rp = s;
+	const unsigned char *const end = s + n;
+	while((size_t)(end - rp) >= m){
+		size_t bad = m - shift[rp[m - 1]];
+		if(bad != 0){
+			if(bad < mem){
+				bad = mem;
+			}
+			rp += bad;
+			mem = 0;
+			continue;
+		}
+		size_t k = (ms + 1 > mem) ? ms + 1 : mem;
+		while((k < m) && (p[k] == rp[k])){
+			++k;
+		}
+		if(k < m){
+			rp += k - ms;
+			mem = 0;
+			continue;
+		}
+		k = ms + 1;
+		while((k > mem) && (p[k - 1] == rp[k - 1])){
+			--k;
+		}
+		if(k <= mem){
+			return rp;
+		}
+		rp += per;
+		mem = mem0;
+	}
+	return _MCFCRT_NULLPTR;
+}
+
+typedef const unsigned char *(*filter_impl)(const unsigned char *, size_t, const unsigned char *, size_t);
+
+static const unsigned char *filter_select(const unsigned char *s, size_t n, const unsigned char *p, size_t m);
+
+// 第一次调用时选择实现，之后直接调用选中的实现。选择的结果总是相同的，因此不需要加锁。
+static filter_impl g_filter = &filter_select;
+
+static const unsigned char *filter_select(const unsigned char *s, size_t n, const unsigned char *p, size_t m){
+	filter_impl impl = &filter_sse2;
+	if(__MCFCRT_GetCpuFeatures() & __MCFCRT_kCpuFeatureAvx2){
+		impl = &filter_avx2;
+	}
+	__atomic_store_n(&g_filter, impl, __ATOMIC_RELAXED);
+	return (*impl)(s, n, p, m);
+}
+
+void *_MCFCRT_memmem(const void *s, size_t n, const void *p, size_t m){
+	if(_MCFCRT_EXPECT_NOT(m == 0)){
+		return (void *)s;
+	}
+	if(_MCFCRT_EXPECT_NOT(m > n)){
+		return _MCFCRT_NULLPTR;
+	}
+	if(m == 1){
+		return memchr(s, *(const unsigned char *)p, n);
+	}
+	const unsigned char *r;
+	if(m <= FILTER_MAX_NEEDLE){
+		r = (*__atomic_load_n(&g_filter, __ATOMIC_RELAXED))(s, n, p, m);
+	} else {
+		r = two_way(s, n, p, m);
+	}
+	return (void *)r;
+}
@@ -4,9 +4,11 @@
 
 #include "rawmemchr.h"
 #include "../env/expect.h"
+#include "../env/_cpu_features.h"
 #include "../stdc/string/_sse2.h"
+#include "../stdc/string/_avx2.h"
 
-void *_MCFCRT_rawmemchr(const void *s, int c){
+static void *rawmemchr_sse2(const void *s, int c){
 	// 如果 arp 是对齐到字的，就不用考虑越界的问题。
 	// 因为内存按页分配的，也自然对齐到页，并且也对齐到字。
 	// 每个字内的字节的权限必然一致。
@@ -33,7 +35,62 @@ void *_MCFCRT_rawmemchr(const void *s, int c){
 		END
 		BEGIN
 	}
+#undef BEGIN
+#undef END
 end:
 	arp = arp - 32 + (unsigned)__builtin_ctzl(mask);
 	return (char *)arp;
 }
+
+__attribute__((__target__("avx2")))
+static void *rawmemchr_avx2(const void *s, int c){
+	// 同上，但是每次处理 64 字节。
+	const char *arp = (const char *)((uintptr_t)s & (uintptr_t)-64);
+	__m256i yc[1];
+	__MCFCRT_ymmsetb(yc, (uint8_t)c);
+
+	__m256i yw[2];
+	uint64_t mask;
+	ptrdiff_t dist;
+//=============================================================================
+#define BEGIN	\
+	arp = __MCFCRT_ymmload_2(yw, arp);	\
+	mask = __MCFCRT_ymmcmp_21b(yw, yc);
+#define END	\
+	if(_MCFCRT_EXPECT_NOT(mask != 0)){	\
+		goto end;	\
+	}
+//=============================================================================
+	BEGIN
+	dist = (const char *)s - (arp - 64);
+	mask &= (uint64_t)-1 << dist;
+	for(;;){
+		END
+		BEGIN
+	}
+#undef BEGIN
+#undef END
+end:
+	arp = arp - 64 + (unsigned)__builtin_ctzll(mask);
+	return (char *)arp;
+}
+
+typedef void *(*rawmemchr_impl)(const void *, int);
+
+static void *rawmemchr_select(const void *s, int c);
+
+// 第一次调用时选择实现，之后直接调用选中的实现。选择的结果总是相同的，因此不需要加锁。
+static rawmemchr_impl g_impl = &rawmemchr_select;
+
+static void *rawmemchr_select(const void *s, int c){
+	rawmemchr_impl impl = &rawmemchr_sse2;
+	if(__MCFCRT_GetCpuFeatures() & __MCFCRT_kCpuFeatureAvx2){
+		impl = &rawmemchr_avx2;
+	}
+	__atomic_store_n(&g_impl, impl, __ATOMIC_RELAXED);
+	return (*impl)(s, c);
+}
+
+void *_MCFCRT_rawmemchr(const void *s, int c){
+	return (*__atomic_load_n(&g_impl, __ATOMIC_RELAXED))(s, c);
+}
@@ -0,0 +1,591 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#include "utf_bulk.h"
+#include "../env/expect.h"
+#include "../env/_cpu_features.h"
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <immintrin.h>
+
+// 下面的函数处理 [s, s + n) 中的字符，返回从开头起连续可以成块处理的字符数，并把这些字符转换后写入 [d, d + n)。
+// 只有完整的块会被读取。写入的字符可能比返回值多，但是不会超过 n 个，多写入的部分会被调用者覆盖。
+
+static size_t ascii_8_sse2(const char *s, size_t n){
+	size_t i = 0;
+	while(_MCFCRT_EXPECT(n - i >= 16)){
+		const __m128i x = _mm_loadu_si128((const __m128i *)(s + i));
+		const uint32_t mask = (uint32_t)_mm_movemask_epi8(x);
+		if(mask != 0){
+			return i + (unsigned)__builtin_ctz(mask);
+		}
+		i += 16;
+	}
+	return i;
+}
+static size_t widen_8_16_sse2(char16_t *d, const char *s, size_t n){
+	const __m128i z = _mm_setzero_si128();
+	size_t i = 0;
+	while(_MCFCRT_EXPECT(n - i >= 16)){
+		const __m128i x = _mm_loadu_si128((const __m128i *)(s + i));
+		_mm_storeu_si128((__m128i *)(d + i    ), _mm_unpacklo_epi8(x, z));
+		_mm_storeu_si128((__m128i *)(d + i + 8), _mm_unpackhi_epi8(x, z));
+		const uint32_t mask = (uint32_t)_mm_movemask_epi8(x);
+		if(mask != 0){
+			return i + (unsigned)__builtin_ctz(mask);
+		}
+		i += 16;
+	}
+	return i;
+}
+static size_t widen_8_32_sse2(char32_t *d, const char *s, size_t n){
+	const __m128i z = _mm_setzero_si128();
+	size_t i = 0;
+	while(_MCFCRT_EXPECT(n - i >= 16)){
+		const __m128i x = _mm_loadu_si128((const __m128i *)(s + i));
+		const __m128i lo = _mm_unpacklo_epi8(x, z);
+		const __m128i hi = _mm_unpackhi_epi8(x, z);
+		_mm_storeu_si128((__m128i *)(d + i     ), _mm_unpacklo_epi16(lo, z));
+		_mm_storeu_si128((__m128i *)(d + i +  4), _mm_unpackhi_epi16(lo, z));
+		_mm_storeu_si128((__m128i *)(d + i +  8), _mm_unpacklo_epi16(hi, z));
+		_mm_storeu_si128((__m128i *)(d + i + 12), _mm_unpackhi_epi16(hi, z));
+		const uint32_t mask = (uint32_t)_mm_movemask_epi8(x);
+		if(mask != 0){
+			return i + (unsigned)__builtin_ctz(mask);
+		}
+		i += 16;
+	}
+	return i;
+}
+static size_t narrow_16_8_sse2(char *d, const char16_t *s, size_t n){
+	const __m128i z = _mm_setzero_si128();
+	const __m128i hm = _mm_set1_epi16((short)0xFF80);
+	size_t i = 0;
+	while(_MCFCRT_EXPECT(n - i >= 16)){
+		const __m128i x0 = _mm_loadu_si128((const __m128i *)(s + i    ));
+		const __m128i x1 = _mm_loadu_si128((const __m128i *)(s + i + 8));
+		_mm_storeu_si128((__m128i *)(d + i), _mm_packus_epi16(x0, x1));
+		// 每个 ASCII 字符对应的字节为 0xFF。
+		const __m128i t = _mm_packs_epi16(_mm_cmpeq_epi16(_mm_and_si128(x0, hm), z), _mm_cmpeq_epi16(_mm_and_si128(x1, hm), z));
+		const uint32_t mask = (uint32_t)_mm_movemask_epi8(t) ^ 0xFFFFu;
+		if(mask != 0){
+			return i + (unsigned)__builtin_ctz(mask);
+		}
+		i += 16;
+	}
+	return i;
+}
+static size_t narrow_32_8_sse2(char *d, const char32_t *s, size_t n){
+	const __m128i z = _mm_setzero_si128();
+	const __m128i hm = _mm_set1_epi32((int)0xFFFFFF80);
+	size_t i = 0;
+	while(_MCFCRT_EXPECT(n - i >= 16)){
+		const __m128i x0 = _mm_loadu_si128((const __m128i *)(s + i     ));
+		const __m128i x1 = _mm_loadu_si128((const __m128i *)(s + i +  4));
+		const __m128i x2 = _mm_loadu_si128((const __m128i *)(s + i +  8));
+		const __m128i x3 = _mm_loadu_si128((const __m128i *)(s + i + 12));
+		_mm_storeu_si128((__m128i *)(d + i), _mm_packus_epi16(_mm_packs_epi32(x0, x1), _mm_packs_epi32(x2, x3)));
+		const __m128i t01 = _mm_packs_epi32(_mm_cmpeq_epi32(_mm_and_si128(x0, hm), z), _mm_cmpeq_epi32(_mm_and_si128(x1, hm), z));
+		const __m128i t23 = _mm_packs_epi32(_mm_cmpeq_epi32(_mm_and_si128(x2, hm), z), _mm_cmpeq_epi32(_mm_and_si128(x3, hm), z));
+		const uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_packs_epi16(t01, t23)) ^ 0xFFFFu;
+		if(mask != 0){
+			return i + (unsigned)__builtin_ctz(mask);
+		}
+		i += 16;
+	}
+	return i;
+}
+static size_t widen_16_32_sse2(char32_t *d, const char16_t *s, size_t n){
+	const __m128i z = _mm_setzero_si128();
+	const __m128i sm = _mm_set1_epi16((short)0xF800);
+	const __m128i sv = _mm_set1_epi16((short)0xD800);
+	size_t i = 0;
+	while(_MCFCRT_EXPECT(n - i >= 8)){
+		const __m128i x = _mm_loadu_si128((const __m128i *)(s + i));
+		_mm_storeu_si128((__m128i *)(d + i    ), _mm_unpacklo_epi16(x, z));
+		_mm_storeu_si128((__m128i *)(d + i + 4), _mm_unpackhi_epi16(x, z));
+		// 每个代理字符对应两个位。
+		const uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(x, sm), sv));
+		if(mask != 0){
+			return i + (unsigned)__builtin_ctz(mask) / 2;
+		}
+		i += 8;
+	}
+	return i;
+}
+static size_t narrow_32_16_sse2(char16_t *d, const char32_t *s, size_t n){
+	const __m128i z = _mm_setzero_si128();
+	const __m128i sm = _mm_set1_epi32(0xF800);
+	const __m128i sv = _mm_set1_epi32(0xD800);
+	const __m128i bias32 = _mm_set1_epi32(0x8000);
+	const __m128i bias16 = _mm_set1_epi16((short)0x8000);
+	size_t i = 0;
+	while(_MCFCRT_EXPECT(n - i >= 8)){
+		const __m128i x0 = _mm_loadu_si128((const __m128i *)(s + i    ));
+		const __m128i x1 = _mm_loadu_si128((const __m128i *)(s + i + 4));
+		// SSE2 没有无符号饱和的 32 位打包指令，因此先减去 0x8000 使用有符号饱和打包，然后再加回来。
+		const __m128i y = _mm_add_epi16(_mm_packs_epi32(_mm_sub_epi32(x0, bias32), _mm_sub_epi32(x1, bias32)), bias16);
+		_mm_storeu_si128((__m128i *)(d + i), y);
+		// 小于 0x10000 并且不是代理字符的字符对应的两个字节为 0xFF。
+		const __m128i g0 = _mm_andnot_si128(_mm_cmpeq_epi32(_mm_and_si128(x0, sm), sv), _mm_cmpeq_epi32(_mm_srli_epi32(x0, 16), z));
+		const __m128i g1 = _mm_andnot_si128(_mm_cmpeq_epi32(_mm_and_si128(x1, sm), sv), _mm_cmpeq_epi32(_mm_srli_epi32(x1, 16), z));
+		const uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_packs_epi32(g0, g1)) ^ 0xFFFFu;
+		if(mask != 0){
+			return i + (unsigned)__builtin_ctz(mask) / 2;
+		}
+		i += 8;
+	}
+	return i;
+}
+static size_t measure_16_8_sse2(size_t *size, const char16_t *s, size_t n){
+	const __m128i z = _mm_setzero_si128();
+	const __m128i am = _mm_set1_epi16((short)0xFF80);
+	const __m128i bm = _mm_set1_epi16((short)0xF800);
+	const __m128i sv = _mm_set1_epi16((short)0xD800);
+	size_t i = 0;
+	size_t total = 0;
+	while(_MCFCRT_EXPECT(n - i >= 8)){
+		const __m128i x = _mm_loadu_si128((const __m128i *)(s + i));
+		// 每个字符对应两个位。非代理字符在 UTF-8 中占 3 个字节，小于 0x800 的少一个字节，小于 0x80 的再少一个字节。
+		const uint32_t ascii = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(x, am), z));
+		const uint32_t small = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(x, bm), z));
+		const uint32_t surr  = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(x, bm), sv));
+		const unsigned bits = (surr != 0) ? (unsigned)__builtin_ctz(surr) : 16;
+		const uint32_t lim = (uint32_t)((1ull << bits) - 1);
+		total += bits / 2 * 3 - (unsigned)__builtin_popcount(ascii & lim) / 2 - (unsigned)__builtin_popcount(small & lim) / 2;
+		if(surr != 0){
+			i += bits / 2;
+			break;
+		}
+		i += 8;
+	}
+	*size += total;
+	return i;
+}
+
+// 下面两个函数处理 UTF-8 中占 3 个字节的码点，即 [0x800, 0xD800) 和 [0xE000, 0x10000) 中的码点，CJK 字符都在这个范围内。
+// 参数 n 和返回值都以码点为单位。SSSE3 是这个库的最低要求，因此不需要根据处理器特性选择实现。
+
+static size_t bmp3_8_16_ssse3(char16_t *d, const char *s, size_t n){
+	// 每次处理 8 个码点，即 24 个字节。前 4 个码点从第一次读取的 16 个字节中取出，后 4 个从第二次读取的 16 个字节中取出。
+	// 每个 16 位的 lm 中高字节为首字节，低字节为第二个字节；每个 16 位的 t 中低字节为第三个字节。
+	const __m128i lm_lo = _mm_setr_epi8( 1,  0,  4,  3,  7,  6, 10,  9, -1, -1, -1, -1, -1, -1, -1, -1);
+	const __m128i lm_hi = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1,  5,  4,  8,  7, 11, 10, 14, 13);
+	const __m128i t_lo  = _mm_setr_epi8( 2, -1,  5, -1,  8, -1, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+	const __m128i t_hi  = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1,  6, -1,  9, -1, 12, -1, 15, -1);
+	const __m128i z = _mm_setzero_si128();
+	size_t i = 0;
+	while(_MCFCRT_EXPECT(n - i >= 8)){
+		const __m128i x0 = _mm_loadu_si128((const __m128i *)(s + i * 3    ));
+		const __m128i x1 = _mm_loadu_si128((const __m128i *)(s + i * 3 + 8));
+		const __m128i lm = _mm_or_si128(_mm_shuffle_epi8(x0, lm_lo), _mm_shuffle_epi8(x1, lm_hi));
+		const __m128i t  = _mm_or_si128(_mm_shuffle_epi8(x0, t_lo ), _mm_shuffle_epi8(x1, t_hi ));
+		const __m128i c = _mm_or_si128(_mm_or_si128(
+			_mm_slli_epi16(_mm_and_si128(lm, _mm_set1_epi16(0x0F00)), 4),
+			_mm_slli_epi16(_mm_and_si128(lm, _mm_set1_epi16(0x003F)), 6)),
+			_mm_and_si128(t, _mm_set1_epi16(0x003F)));
+		_mm_storeu_si128((__m128i *)(d + i), c);
+		// 首字节必须是 1110xxxx，后两个字节必须是 10xxxxxx，并且结果不能小于 0x800，也不能是代理字符。
+		const __m128i f = _mm_and_si128(c, _mm_set1_epi16((short)0xF800));
+		__m128i g = _mm_cmpeq_epi16(_mm_and_si128(lm, _mm_set1_epi16((short)0xF0C0)), _mm_set1_epi16((short)0xE080));
+		g = _mm_and_si128(g, _mm_cmpeq_epi16(_mm_and_si128(t, _mm_set1_epi16(0x00C0)), _mm_set1_epi16(0x0080)));
+		g = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi16(f, z), _mm_cmpeq_epi16(f, _mm_set1_epi16((short)0xD800))), g);
+		const uint32_t mask = (uint32_t)_mm_movemask_epi8(g) ^ 0xFFFFu;
+		if(mask != 0){
+			return i + (unsigned)__builtin_ctz(mask) / 2;
+		}
+		i += 8;
+	}
+	return i;
+}
+static size_t bmp3_16_8_ssse3(char *d, const char16_t *s, size_t n){
+	// 每次处理 8 个码点。每个 16 位的 lm 中低字节为首字节，高字节为第二个字节；b 的低 8 个字节为第三个字节。
+	const __m128i o0_lm = _mm_setr_epi8( 0,  1, -1,  2,  3, -1,  4,  5, -1,  6,  7, -1,  8,  9, -1, 10);
+	const __m128i o0_b  = _mm_setr_epi8(-1, -1,  0, -1, -1,  1, -1, -1,  2, -1, -1,  3, -1, -1,  4, -1);
+	const __m128i o1_lm = _mm_setr_epi8(11, -1, 12, 13, -1, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+	const __m128i o1_b  = _mm_setr_epi8(-1,  5, -1, -1,  6, -1, -1,  7, -1, -1, -1, -1, -1, -1, -1, -1);
+	const __m128i z = _mm_setzero_si128();
+	size_t i = 0;
+	while(_MCFCRT_EXPECT(n - i >= 8)){
+		const __m128i x = _mm_loadu_si128((const __m128i *)(s + i));
+		const __m128i l = _mm_or_si128(_mm_srli_epi16(x, 12), _mm_set1_epi16(0x00E0));
+		const __m128i m = _mm_or_si128(_mm_and_si128(_mm_slli_epi16(x, 2), _mm_set1_epi16(0x3F00)), _mm_set1_epi16((short)0x8000));
+		const __m128i lm = _mm_or_si128(l, m);
+		const __m128i t = _mm_or_si128(_mm_and_si128(x, _mm_set1_epi16(0x003F)), _mm_set1_epi16(0x0080));
+		const __m128i b = _mm_packus_epi16(t, t);
+		_mm_storeu_si128((__m128i *)(d + i * 3), _mm_or_si128(_mm_shuffle_epi8(lm, o0_lm), _mm_shuffle_epi8(b, o0_b)));
+		_mm_storel_epi64((__m128i *)(d + i * 3 + 16), _mm_or_si128(_mm_shuffle_epi8(lm, o1_lm), _mm_shuffle_epi8(b, o1_b)));
+		const __m128i f = _mm_and_si128(x, _mm_set1_epi16((short)0xF800));
+		const uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi16(f, z), _mm_cmpeq_epi16(f, _mm_set1_epi16((short)0xD800))));
+		if(mask != 0){
+			return i + (unsigned)__builtin_ctz(mask) / 2;
+		}
+		i += 8;
+	}
+	return i;
+}
+
+__attribute__((__target__("avx2")))
+static size_t ascii_8_avx2(const char *s, size_t n){
+	// 同上，但是每次处理 32 个字符。
+	size_t i = 0;
+	while(_MCFCRT_EXPECT(n - i >= 32)){
+		const __m256i x = _mm256_loadu_si256((const __m256i *)(s + i));
+		const uint32_t mask = (uint32_t)_mm256_movemask_epi8(x);
+		if(mask != 0){
+			return i + (unsigned)__builtin_ctz(mask);
+		}
+		i += 32;
+	}
+	return i + ascii_8_sse2(s + i, n - i);
+}
+__attribute__((__target__("avx2")))
+static size_t widen_8_16_avx2(char16_t *d, const char *s, size_t n){
+	size_t i = 0;
+	while(_MCFCRT_EXPECT(n - i >= 32)){
+		const __m256i x = _mm256_loadu_si256((const __m256i *)(s + i));
+		_mm256_storeu_si256((__m256i *)(d + i     ), _mm256_cvtepu8_epi16(_mm256_castsi256_si128(x)));
+		_mm256_storeu_si256((__m256i *)(d + i + 16), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(x, 1)));
+		const uint32_t mask = (uint32_t)_mm256_movemask_epi8(x);
+		if(mask != 0){
+			return i + (unsigned)__builtin_ctz(mask);
+		}
+		i += 32;
+	}
+	return i + widen_8_16_sse2(d + i, s + i, n - i);
+}
+__attribute__((__target__("avx2")))
+static size_t widen_8_32_avx2(char32_t *d, const char *s, size_t n){
+	size_t i = 0;
+	while(_MCFCRT_EXPECT(n - i >= 32)){
+		const __m256i x = _mm256_loadu_si256((const __m256i *)(s + i));
+		const __m128i lo = _mm256_castsi256_si128(x);
+		const __m128i hi = _mm256_extracti128_si256(x, 1);
+		_mm256_storeu_si256((__m256i *)(d + i     ), _mm256_cvtepu8_epi32(lo));
+		_mm256_storeu_si256((__m256i *)(d + i +  8), _mm256_cvtepu8_epi32(_mm_srli_si128(lo, 8)));
+		_mm256_storeu_si256((__m256i *)(d + i + 16), _mm256_cvtepu8_epi32(hi));
+		_mm256_storeu_si256((__m256i *)(d + i + 24), _mm256_cvtepu8_epi32(_mm_srli_si128(hi, 8)));
+		const uint32_t mask = (uint32_t)_mm256_movemask_epi8(x);
+		if(mask != 0){
+			return i + (unsigned)__builtin_ctz(mask);
+		}
+		i += 32;
+	}
+	return i + widen_8_32_sse2(d + i, s + i, n - i);
+}
+__attribute__((__target__("avx2")))
+static size_t narrow_16_8_avx2(char *d, const char16_t *s, size_t n){
+	const __m256i z = _mm256_setzero_si256();
+	const __m256i hm = _mm256_set1_epi16((short)0xFF80);
+	size_t i = 0;
+	while(_MCFCRT_EXPECT(n - i >= 32)){
+		const __m256i x0 = _mm256_loadu_si256((const __m256i *)(s + i     ));
+		const __m256i x1 = _mm256_loadu_si256((const __m256i *)(s + i + 16));
+		// 打包指令在两个 128 位的半边内分别进行，需要重新排列 64 位的四个部分。
+		_mm256_storeu_si256((__m256i *)(d + i), _mm256_permute4x64_epi64(_mm256_packus_epi16(x0, x1), 0xD8));
+		const __m256i t = _mm256_packs_epi16(_mm256_cmpeq_epi16(_mm256_and_si256(x0, hm), z), _mm256_cmpeq_epi16(_mm256_and_si256(x1, hm), z));
+		const uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(_mm256_permute4x64_epi64(t, 0xD8));
+		if(mask != 0){
+			return i + (unsigned)__builtin_ctz(mask);
+		}
+		i += 32;
+	}
+	return i + narrow_16_8_sse2(d + i, s + i, n - i);
+}
+__attribute__((__target__("avx2")))
+static size_t narrow_32_8_avx2(char *d, const char32_t *s, size_t n){
+	const __m256i z = _mm256_setzero_si256();
+	const __m256i hm = _mm256_set1_epi32((int)0xFFFFFF80);
+	const __m256i perm = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	size_t i = 0;
+	while(_MCFCRT_EXPECT(n - i >= 32)){
+		const __m256i x0 = _mm256_loadu_si256((const __m256i *)(s + i     ));
+		const __m256i x1 = _mm256_loadu_si256((const __m256i *)(s + i +  8));
+		const __m256i x2 = _mm256_loadu_si256((const __m256i *)(s + i + 16));
+		const __m256i x3 = _mm256_loadu_si256((const __m256i *)(s + i + 24));
+		// 两次打包之后每个 128 位的半边中依次是四个输入的各四个字符，需要按 32 位重新排列。
+		const __m256i y = _mm256_packus_epi16(_mm256_packs_epi32(x0, x1), _mm256_packs_epi32(x2, x3));
+		_mm256_storeu_si256((__m256i *)(d + i), _mm256_permutevar8x32_epi32(y, perm));
+		const __m256i t01 = _mm256_packs_epi32(_mm256_cmpeq_epi32(_mm256_and_si256(x0, hm), z), _mm256_cmpeq_epi32(_mm256_and_si256(x1, hm), z));
+		const __m256i t23 = _mm256_packs_epi32(_mm256_cmpeq_epi32(_mm256_and_si256(x2, hm), z), _mm256_cmpeq_epi32(_mm256_and_si256(x3, hm), z));
+		const uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(_mm256_permutevar8x32_epi32(_mm256_packs_epi16(t01, t23), perm));
+		if(mask != 0){
+			return i + (unsigned)__builtin_ctz(mask);
+		}
+		i += 32;
+	}
+	return i + narrow_32_8_sse2(d + i, s + i, n - i);
+}
+__attribute__((__target__("avx2")))
+static size_t widen_16_32_avx2(char32_t *d, const char16_t *s, size_t n){
+	const __m256i sm = _mm256_set1_epi16((short)0xF800);
+	const __m256i sv = _mm256_set1_epi16((short)0xD800);
+	size_t i = 0;
+	while(_MCFCRT_EXPECT(n - i >= 16)){
+		const __m256i x = _mm256_loadu_si256((const __m256i *)(s + i));
+		_mm256_storeu_si256((__m256i *)(d + i    ), _mm256_cvtepu16_epi32(_mm256_castsi256_si128(x)));
+		_mm256_storeu_si256((__m256i *)(d + i + 8), _mm256_cvtepu16_epi32(_mm256_extracti128_si256(x, 1)));
+		const uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_and_si256(x, sm), sv));
+		if(mask != 0){
+			return i + (unsigned)__builtin_ctz(mask) / 2;
+		}
+		i += 16;
+	}
+	return i + widen_16_32_sse2(d + i, s + i, n - i);
+}
+__attribute__((__target__("avx2")))
+static size_t narrow_32_16_avx2(char16_t *d, const char32_t *s, size_t n){
+	const __m256i z = _mm256_setzero_si256();
+	const __m256i sm = _mm256_set1_epi32(0xF800);
+	const __m256i sv = _mm256_set1_epi32(0xD800);
+	size_t i = 0;
+	while(_MCFCRT_EXPECT(n - i >= 16)){
+		const __m256i x0 = _mm256_loadu_si256((const __m256i *)(s + i    ));
+		const __m256i x1 = _mm256_loadu_si256((const __m256i *)(s + i + 8));
+		_mm256_storeu_si256((__m256i *)(d + i), _mm256_permute4x64_epi64(_mm256_packus_epi32(x0, x1), 0xD8));
+		const __m256i g0 = _mm256_andnot_si256(_mm256_cmpeq_epi32(_mm256_and_si256(x0, sm), sv), _mm256_cmpeq_epi32(_mm256_srli_epi32(x0, 16), z));
+		const __m256i g1 = _mm256_andnot_si256(_mm256_cmpeq_epi32(_mm256_and_si256(x1, sm), sv), _mm256_cmpeq_epi32(_mm256_srli_epi32(x1, 16), z));
+		const uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(_mm256_permute4x64_epi64(_mm256_packs_epi32(g0, g1), 0xD8));
+		if(mask != 0){
+			return i + (unsigned)__builtin_ctz(mask) / 2;
+		}
+		i += 16;
+	}
+	return i + narrow_32_16_sse2(d + i, s + i, n - i);
+}
+__attribute__((__target__("avx2")))
+static size_t measure_16_8_avx2(size_t *size, const char16_t *s, size_t n){
+	const __m256i z = _mm256_setzero_si256();
+	const __m256i am = _mm256_set1_epi16((short)0xFF80);
+	const __m256i bm = _mm256_set1_epi16((short)0xF800);
+	const __m256i sv = _mm256_set1_epi16((short)0xD800);
+	size_t i = 0;
+	size_t total = 0;
+	while(_MCFCRT_EXPECT(n - i >= 16)){
+		const __m256i x = _mm256_loadu_si256((const __m256i *)(s + i));
+		const uint32_t ascii = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_and_si256(x, am), z));
+		const uint32_t small = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_and_si256(x, bm), z));
+		const uint32_t surr  = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_and_si256(x, bm), sv));
+		const unsigned bits = (surr != 0) ? (unsigned)__builtin_ctz(surr) : 32;
+		const uint32_t lim = (uint32_t)((1ull << bits) - 1);
+		total += bits / 2 * 3 - (unsigned)__builtin_popcount(ascii & lim) / 2 - (unsigned)__builtin_popcount(small & lim) / 2;
+		if(surr != 0){
+			*size += total;
+			return i + bits / 2;
+		}
+		i += 16;
+	}
+	*size += total;
+	return i + measure_16_8_sse2(size, s + i, n - i);
+}
+
+typedef struct kernel_table {
+	size_t (*ascii_8)(const char *, size_t);
+	size_t (*widen_8_16)(char16_t *, const char *, size_t);
+	size_t (*widen_8_32)(char32_t *, const char *, size_t);
+	size_t (*narrow_16_8)(char *, const char16_t *, size_t);
+	size_t (*narrow_32_8)(char *, const char32_t *, size_t);
+	size_t (*widen_16_32)(char32_t *, const char16_t *, size_t);
+	size_t (*narrow_32_16)(char16_t *, const char32_t *, size_t);
+	size_t (*measure_16_8)(size_t *, const char16_t *, size_t);
+} kernel_table;
+
+static const kernel_table g_kernels_sse2 = { &ascii_8_sse2, &widen_8_16_sse2, &widen_8_32_sse2, &narrow_16_8_sse2, &narrow_32_8_sse2, &widen_16_32_sse2, &narrow_32_16_sse2, &measure_16_8_sse2 };
+static const kernel_table g_kernels_avx2 = { &ascii_8_avx2, &widen_8_16_avx2, &widen_8_32_avx2, &narrow_16_8_avx2, &narrow_32_8_avx2, &widen_16_32_avx2, &narrow_32_16_avx2, &measure_16_8_avx2 };
+
+// 第一次调用时选择实现，之后直接使用选中的实现。选择的结果总是相同的，因此不需要加锁。
+static const kernel_table *g_kernels = _MCFCRT_NULLPTR;
+
+static inline const kernel_table *get_kernels(void){
+	const kernel_table *k = __atomic_load_n(&g_kernels, __ATOMIC_RELAXED);
+	if(_MCFCRT_EXPECT_NOT(!k)){
+		k = &g_kernels_sse2;
+		if(__MCFCRT_GetCpuFeatures() & __MCFCRT_kCpuFeatureAvx2){
+			k = &g_kernels_avx2;
+		}
+		__atomic_store_n(&g_kernels, k, __ATOMIC_RELAXED);
+	}
+	return k;
+}
+
+static inline size_t min_size(size_t a, size_t b){
+	return (a < b) ? a : b;
+}
+
+char32_t _MCFCRT_ValidateUtf8(const char **ppchRead, const char *pchReadEnd){
+	const kernel_table *const k = get_kernels();
+	const char *rp = *ppchRead;
+	char32_t c32;
+	for(;;){
+		if((rp != pchReadEnd) && ((uint8_t)*rp < 0x80)){
+			rp += (*(k->ascii_8))(rp, (size_t)(pchReadEnd - rp));
+		}
+		c32 = _MCFCRT_DecodeUtf8(&rp, pchReadEnd, false);
+		if(!_MCFCRT_UTF_SUCCESS(c32)){
+			break;
+		}
+	}
+	*ppchRead = rp;
+	return c32;
+}
+
+// 解码失败时读指针不会被更新。ASCII 字符在两种编码中的长度都是 1。
+#define MEASURE_UTF8_(decode_, size_of_)	\
+	const kernel_table *const k = get_kernels();	\
+	const char *rp = *ppchRead;	\
+	size_t size = 0;	\
+	char32_t c32;	\
+	for(;;){	\
+		if((rp != pchReadEnd) && ((uint8_t)*rp < 0x80)){	\
+			const size_t done = (*(k->ascii_8))(rp, (size_t)(pchReadEnd - rp));	\
+			rp += done;	\
+			size += done;	\
+		}	\
+		c32 = decode_(&rp, pchReadEnd, bPermissive);	\
+		if(!_MCFCRT_UTF_SUCCESS(c32)){	\
+			break;	\
+		}	\
+		size += (size_of_);	\
+	}	\
+	*puSize = size;	\
+	*ppchRead = rp;	\
+	return c32;
+
+char32_t _MCFCRT_MeasureUtf8AsUtf16(size_t *puSize, const char **ppchRead, const char *pchReadEnd, bool bPermissive){
+	MEASURE_UTF8_(_MCFCRT_DecodeUtf8, 1u + (c32 >= 0x10000))
+}
+char32_t _MCFCRT_MeasureUtf8AsUtf32(size_t *puSize, const char **ppchRead, const char *pchReadEnd, bool bPermissive){
+	MEASURE_UTF8_(_MCFCRT_DecodeUtf8, 1u)
+}
+
+#undef MEASURE_UTF8_
+
+char32_t _MCFCRT_MeasureUtf16AsUtf8(size_t *puSize, const char16_t **ppc16Read, const char16_t *pc16ReadEnd, bool bPermissive){
+	const kernel_table *const k = get_kernels();
+	const char16_t *rp = *ppc16Read;
+	size_t size = 0;
+	char32_t c32;
+	for(;;){
+		if((rp != pc16ReadEnd) && ((uint16_t)*rp - 0xD800u >= 0x800)){
+			rp += (*(k->measure_16_8))(&size, rp, (size_t)(pc16ReadEnd - rp));
+		}
+		c32 = _MCFCRT_DecodeUtf16(&rp, pc16ReadEnd, bPermissive);
+		if(!_MCFCRT_UTF_SUCCESS(c32)){
+			break;
+		}
+		size += 1u + (c32 >= 0x80) + (c32 >= 0x800) + (c32 >= 0x10000);
+	}
+	*puSize = size;
+	*ppc16Read = rp;
+	return c32;
+}
+
+// 每次循环先尝试成块转换，然后逐码点转换一个字符。
+// 如果输出缓冲区中剩余的字符数不小于一个码点编码之后的最大长度 max_，就不需要检查输出缓冲区的大小。输出缓冲区太小时读指针不会被更新。
+#define CONVERT_(dst_t_, src_t_, fast_, decode_, encode_, unchecked_encode_, max_)	\
+	const kernel_table *const k = get_kernels();	\
+	dst_t_ *wp = *ppWrite;	\
+	const src_t_ *rp = *ppRead;	\
+	char32_t c32;	\
+	for(;;){	\
+		if(rp != pReadEnd){	\
+			fast_	\
+		}	\
+		if(_MCFCRT_EXPECT((size_t)(pWriteEnd - wp) >= (max_))){	\
+			c32 = decode_(&rp, pReadEnd, bPermissive);	\
+			if(!_MCFCRT_UTF_SUCCESS(c32)){	\
+				break;	\
+			}	\
+			unchecked_encode_(&wp, c32, true);	\
+		} else {	\
+			const src_t_ *rp_next = rp;	\
+			c32 = decode_(&rp_next, pReadEnd, bPermissive);	\
+			if(!_MCFCRT_UTF_SUCCESS(c32)){	\
+				break;	\
+			}	\
+			c32 = encode_(&wp, pWriteEnd, c32, true);	\
+			if(!_MCFCRT_UTF_SUCCESS(c32)){	\
+				break;	\
+			}	\
+			rp = rp_next;	\
+		}	\
+	}	\
+	*ppWrite = wp;	\
+	*ppRead = rp;	\
+	return c32;
+
+// 如果 test_ 对当前的输入字符成立，调用 kernel_ 成块转换。每个输入字符都对应一个输出字符，因此可以处理的字符数不超过输入和输出中剩余的字符数中的较小者。
+#define FAST_1_1_(test_, kernel_)	\
+	if(test_){	\
+		const size_t done = (*(k->kernel_))(wp, rp, min_size((size_t)(pReadEnd - rp), (size_t)(pWriteEnd - wp)));	\
+		wp += done;	\
+		rp += done;	\
+	}
+// 同上，但是每个码点在输入中占 3 个字符，在输出中占 1 个字符。
+#define FAST_3_1_(test_, kernel_)	\
+	if(test_){	\
+		const size_t done = kernel_(wp, rp, min_size((size_t)(pReadEnd - rp) / 3, (size_t)(pWriteEnd - wp)));	\
+		wp += done;	\
+		rp += done * 3;	\
+	}
+// 同上，但是每个码点在输入中占 1 个字符，在输出中占 3 个字符。
+#define FAST_1_3_(test_, kernel_)	\
+	if(test_){	\
+		const size_t done = kernel_(wp, rp, min_size((size_t)(pReadEnd - rp), (size_t)(pWriteEnd - wp) / 3));	\
+		wp += done * 3;	\
+		rp += done;	\
+	}
+
+#define IS_ASCII_8_      ((uint8_t)*rp < 0x80)
+#define IS_ASCII_16_     ((uint16_t)*rp < 0x80)
+#define IS_ASCII_32_     ((uint32_t)*rp < 0x80)
+#define IS_LEAD3_8_      ((uint8_t)*rp - 0xE0u < 0x10)
+#define IS_BMP3_16_      (((uint16_t)*rp - 0x800u < 0xD000) || ((uint16_t)*rp >= 0xE000))
+#define IS_NOT_SURR_16_  ((uint16_t)*rp - 0xD800u >= 0x800)
+#define IS_NOT_SURR_32_  (((uint32_t)*rp < 0x10000) && ((uint32_t)*rp - 0xD800u >= 0x800))
+
+char32_t _MCFCRT_ConvertUtf8ToUtf16(char16_t **ppWrite, char16_t *pWriteEnd, const char **ppRead, const char *pReadEnd, bool bPermissive){
+	CONVERT_(char16_t, char, FAST_1_1_(IS_ASCII_8_, widen_8_16) else FAST_3_1_(IS_LEAD3_8_, bmp3_8_16_ssse3), _MCFCRT_DecodeUtf8, _MCFCRT_EncodeUtf16, _MCFCRT_UncheckedEncodeUtf16, 2)
+}
+char32_t _MCFCRT_ConvertUtf8ToUtf32(char32_t **ppWrite, char32_t *pWriteEnd, const char **ppRead, const char *pReadEnd, bool bPermissive){
+	CONVERT_(char32_t, char, FAST_1_1_(IS_ASCII_8_, widen_8_32), _MCFCRT_DecodeUtf8, _MCFCRT_EncodeUtf32, _MCFCRT_UncheckedEncodeUtf32, 1)
+}
+char32_t _MCFCRT_ConvertUtf16ToUtf8(char **ppWrite, char *pWriteEnd, const char16_t **ppRead, const char16_t *pReadEnd, bool bPermissive){
+	CONVERT_(char, char16_t, FAST_1_1_(IS_ASCII_16_, narrow_16_8) else FAST_1_3_(IS_BMP3_16_, bmp3_16_8_ssse3), _MCFCRT_DecodeUtf16, _MCFCRT_EncodeUtf8, _MCFCRT_UncheckedEncodeUtf8, 4)
+}
+char32_t _MCFCRT_ConvertUtf16ToUtf32(char32_t **ppWrite, char32_t *pWriteEnd, const char16_t **ppRead, const char16_t *pReadEnd, bool bPermissive){
+	CONVERT_(char32_t, char16_t, FAST_1_1_(IS_NOT_SURR_16_, widen_16_32), _MCFCRT_DecodeUtf16, _MCFCRT_EncodeUtf32, _MCFCRT_UncheckedEncodeUtf32, 1)
+}
+char32_t _MCFCRT_ConvertUtf32ToUtf8(char **ppWrite, char *pWriteEnd, const char32_t **ppRead, const char32_t *pReadEnd, bool bPermissive){
+	CONVERT_(char, char32_t, FAST_1_1_(IS_ASCII_32_, narrow_32_8), _MCFCRT_DecodeUtf32, _MCFCRT_EncodeUtf8, _MCFCRT_UncheckedEncodeUtf8, 4)
+}
+char32_t _MCFCRT_ConvertUtf32ToUtf16(char16_t **ppWrite, char16_t *pWriteEnd, const char32_t **ppRead, const char32_t *pReadEnd, bool bPermissive){
+	CONVERT_(char16_t, char32_t, FAST_1_1_(IS_NOT_SURR_32_, narrow_32_16), _MCFCRT_DecodeUtf32, _MCFCRT_EncodeUtf16, _MCFCRT_UncheckedEncodeUtf16, 2)
+}
+// CESU-8 和 UTF-8 的区别只在于增补平面的字符，因此可以使用相同的成块转换。
+char32_t _MCFCRT_ConvertCesu8ToUtf16(char16_t **ppWrite, char16_t *pWriteEnd, const char **ppRead, const char *pReadEnd, bool bPermissive){
+	CONVERT_(char16_t, char, FAST_1_1_(IS_ASCII_8_, widen_8_16) else FAST_3_1_(IS_LEAD3_8_, bmp3_8_16_ssse3), _MCFCRT_DecodeCesu8, _MCFCRT_EncodeUtf16, _MCFCRT_UncheckedEncodeUtf16, 2)
+}
+char32_t _MCFCRT_ConvertCesu8ToUtf32(char32_t **ppWrite, char32_t *pWriteEnd, const char **ppRead, const char *pReadEnd, bool bPermissive){
+	CONVERT_(char32_t, char, FAST_1_1_(IS_ASCII_8_, widen_8_32), _MCFCRT_DecodeCesu8, _MCFCRT_EncodeUtf32, _MCFCRT_UncheckedEncodeUtf32, 1)
+}
+char32_t _MCFCRT_ConvertUtf16ToCesu8(char **ppWrite, char *pWriteEnd, const char16_t **ppRead, const char16_t *pReadEnd, bool bPermissive){
+	CONVERT_(char, char16_t, FAST_1_1_(IS_ASCII_16_, narrow_16_8) else FAST_1_3_(IS_BMP3_16_, bmp3_16_8_ssse3), _MCFCRT_DecodeUtf16, _MCFCRT_EncodeCesu8, _MCFCRT_UncheckedEncodeCesu8, 6)
+}
+char32_t _MCFCRT_ConvertUtf32ToCesu8(char **ppWrite, char *pWriteEnd, const char32_t **ppRead, const char32_t *pReadEnd, bool bPermissive){
+	CONVERT_(char, char32_t, FAST_1_1_(IS_ASCII_32_, narrow_32_8), _MCFCRT_DecodeUtf32, _MCFCRT_EncodeCesu8, _MCFCRT_UncheckedEncodeCesu8, 6)
+}
+
+#undef IS_ASCII_8_
+#undef IS_ASCII_16_
+#undef IS_ASCII_32_
+#undef IS_LEAD3_8_
+#undef IS_BMP3_16_
+#undef IS_NOT_SURR_16_
+#undef IS_NOT_SURR_32_
+
+#undef FAST_1_1_
+#undef FAST_3_1_
+#undef FAST_1_3_
+#undef CONVERT_
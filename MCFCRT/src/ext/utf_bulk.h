@@ -0,0 +1,39 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#ifndef __MCFCRT_EXT_UTF_BULK_H_
+#define __MCFCRT_EXT_UTF_BULK_H_
+
+#include "../env/_crtdef.h"
+#include "utf.h"
+
+_MCFCRT_EXTERN_C_BEGIN
+
+// 这些函数一次处理整个缓冲区，结果与循环调用 utf.h 中逐码点的函数相同，但是对于 ASCII 字符（以及 UTF-16 和 UTF-32 之间的非代理字符）使用 SIMD 成块处理。
+// 这些函数并不对字符串结束符进行特殊处理（字符串结束符被当作普通字符）。
+// 读指针和写指针被更新为第一个没有处理的码点的位置。如果所有输入都被处理，返回 _MCFCRT_UTF_NO_DATA；
+// 否则返回使处理停止的错误，即 _MCFCRT_UTF_INVALID_INPUT、_MCFCRT_UTF_PARTIAL_DATA 或 _MCFCRT_UTF_BUFFER_TOO_SMALL。
+
+// 检查输入是否为合法的 UTF-8 序列。
+extern char32_t _MCFCRT_ValidateUtf8(const char **__ppchRead, const char *__pchReadEnd) _MCFCRT_NOEXCEPT;
+
+// 计算已经处理的输入转换之后的长度（以输出的字符为单位），保存到 *__puSize 中。
+extern char32_t _MCFCRT_MeasureUtf8AsUtf16(_MCFCRT_STD size_t *__puSize, const char **__ppchRead, const char *__pchReadEnd, bool __bPermissive) _MCFCRT_NOEXCEPT;
+extern char32_t _MCFCRT_MeasureUtf8AsUtf32(_MCFCRT_STD size_t *__puSize, const char **__ppchRead, const char *__pchReadEnd, bool __bPermissive) _MCFCRT_NOEXCEPT;
+extern char32_t _MCFCRT_MeasureUtf16AsUtf8(_MCFCRT_STD size_t *__puSize, const char16_t **__ppc16Read, const char16_t *__pc16ReadEnd, bool __bPermissive) _MCFCRT_NOEXCEPT;
+
+extern char32_t _MCFCRT_ConvertUtf8ToUtf16(char16_t **__ppc16Write, char16_t *__pc16WriteEnd, const char **__ppchRead, const char *__pchReadEnd, bool __bPermissive) _MCFCRT_NOEXCEPT;
+extern char32_t _MCFCRT_ConvertUtf8ToUtf32(char32_t **__ppc32Write, char32_t *__pc32WriteEnd, const char **__ppchRead, const char *__pchReadEnd, bool __bPermissive) _MCFCRT_NOEXCEPT;
+extern char32_t _MCFCRT_ConvertUtf16ToUtf8(char **__ppchWrite, char *__pchWriteEnd, const char16_t **__ppc16Read, const char16_t *__pc16ReadEnd, bool __bPermissive) _MCFCRT_NOEXCEPT;
+extern char32_t _MCFCRT_ConvertUtf16ToUtf32(char32_t **__ppc32Write, char32_t *__pc32WriteEnd, const char16_t **__ppc16Read, const char16_t *__pc16ReadEnd, bool __bPermissive) _MCFCRT_NOEXCEPT;
+extern char32_t _MCFCRT_ConvertUtf32ToUtf8(char **__ppchWrite, char *__pchWriteEnd, const char32_t **__ppc32Read, const char32_t *__pc32ReadEnd, bool __bPermissive) _MCFCRT_NOEXCEPT;
+extern char32_t _MCFCRT_ConvertUtf32ToUtf16(char16_t **__ppc16Write, char16_t *__pc16WriteEnd, const char32_t **__ppc32Read, const char32_t *__pc32ReadEnd, bool __bPermissive) _MCFCRT_NOEXCEPT;
+extern char32_t _MCFCRT_ConvertCesu8ToUtf16(char16_t **__ppc16Write, char16_t *__pc16WriteEnd, const char **__ppchRead, const char *__pchReadEnd, bool __bPermissive) _MCFCRT_NOEXCEPT;
+extern char32_t _MCFCRT_ConvertCesu8ToUtf32(char32_t **__ppc32Write, char32_t *__pc32WriteEnd, const char **__ppchRead, const char *__pchReadEnd, bool __bPermissive) _MCFCRT_NOEXCEPT;
+extern char32_t _MCFCRT_ConvertUtf16ToCesu8(char **__ppchWrite, char *__pchWriteEnd, const char16_t **__ppc16Read, const char16_t *__pc16ReadEnd, bool __bPermissive) _MCFCRT_NOEXCEPT;
+extern char32_t _MCFCRT_ConvertUtf32ToCesu8(char **__ppchWrite, char *__pchWriteEnd, const char32_t **__ppc32Read, const char32_t *__pc32ReadEnd, bool __bPermissive) _MCFCRT_NOEXCEPT;
+
+_MCFCRT_EXTERN_C_END
+
+#endif
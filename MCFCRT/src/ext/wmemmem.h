@@ -0,0 +1,18 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#ifndef __MCFCRT_EXT_WMEMMEM_H_
+#define __MCFCRT_EXT_WMEMMEM_H_
+
+#include "../env/_crtdef.h"
+
+_MCFCRT_EXTERN_C_BEGIN
+
+// 在 `__s` 开始的 `__n` 个宽字符中查找 `__p` 开始的 `__m` 个宽字符。空的模式串匹配 `__s`。
+// 返回第一个匹配的位置，如果没有找到则返回空指针。这个函数的时间复杂度是线性的。
+extern wchar_t *_MCFCRT_wmemmem(const wchar_t *__s, _MCFCRT_STD size_t __n, const wchar_t *__p, _MCFCRT_STD size_t __m) _MCFCRT_NOEXCEPT;
+
+_MCFCRT_EXTERN_C_END
+
+#endif
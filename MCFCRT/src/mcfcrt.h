@@ -13,17 +13,23 @@
 #  include "env/bail.h"
 #  include "env/clocks.h"
 #  include "env/condition_variable.h"
+#  include "env/cpu_topology.h"
 #  include "env/xassert.h"
 #  include "env/crt_module.h"
 #  include "env/expect.h"
+#  include "env/fiber.h"
+#  include "env/futex.h"
 #  include "env/heap.h"
 #  include "env/heap_debug.h"
+#  include "env/heap_profiler.h"
 #  include "env/inline_mem.h"
 #  include "env/last_error.h"
+#  include "env/lock_profiler.h"
 #  include "env/mutex.h"
 #  include "env/offset_of.h"
 #  include "env/once_flag.h"
 #  include "env/pp.h"
+#  include "env/rwlock.h"
 #  include "env/standard_streams.h"
 #  include "env/thread.h"
 // ------------------------------ ext ------------------------------
@@ -35,6 +41,8 @@
 #  include "ext/random.h"
 #  include "ext/rawmemchr.h"
 #  include "ext/rawwmemchr.h"
+#  include "ext/memmem.h"
+#  include "ext/wmemmem.h"
 #  include "ext/rep_movs.h"
 #  include "ext/rep_stos.h"
 #  include "ext/rep_cmps.h"
@@ -44,6 +52,7 @@
 #  include "ext/wcpcpy.h"
 #  include "ext/wcppcpy.h"
 #  include "ext/utf.h"
+#  include "ext/utf_bulk.h"
 // ------------------------------ pre ------------------------------
 #  include "pre/module.h"
 #  include "pre/exe.h"
@@ -12,6 +12,9 @@
 #include "../env/bail.h"
 #include "../env/_seh_top.h"
 #include "../env/_fpu.h"
+#include "../env/_heap_impl.h"
+#include "../env/heap_profiler.h"
+#include "../env/lock_profiler.h"
 
 __attribute__((__weak__))
 extern bool _MCFCRT_OnDllProcessAttach(void *pInstance, bool bDynamic);
@@ -65,6 +68,10 @@ BOOL __MCFCRT_DllStartup(HINSTANCE hInstance, DWORD dwReason, LPVOID pReserved){
 				_MCFCRT_OnDllThreadDetach(hInstance);
 			}
 			__MCFCRT_TlsCleanup();
+			// Blocks freed by TLS destructors go into the thread cache, so it must be flushed afterwards.
+			__MCFCRT_HeapImplThreadCleanup();
+			__MCFCRT_HeapProfilerThreadCleanup();
+			__MCFCRT_LockProfilerThreadCleanup();
 			break;
 		case DLL_PROCESS_DETACH:
 			if(_MCFCRT_OnDllProcessDetach){
@@ -12,6 +12,9 @@
 #include "../env/bail.h"
 #include "../env/_seh_top.h"
 #include "../env/_fpu.h"
+#include "../env/_heap_impl.h"
+#include "../env/heap_profiler.h"
+#include "../env/lock_profiler.h"
 #include <winnt.h>
 
 extern unsigned _MCFCRT_Main(void);
@@ -64,6 +67,10 @@ void __MCFCRT_ExeTlsCallback(PVOID hInstance, DWORD dwReason, LPVOID pReserved){
 			break;
 		case DLL_THREAD_DETACH:
 			__MCFCRT_TlsCleanup();
+			// Blocks freed by TLS destructors go into the thread cache, so it must be flushed afterwards.
+			__MCFCRT_HeapImplThreadCleanup();
+			__MCFCRT_HeapProfilerThreadCleanup();
+			__MCFCRT_LockProfilerThreadCleanup();
 			break;
 		case DLL_PROCESS_DETACH:
 			SetConsoleCtrlHandler(&CtrlHandler, false);
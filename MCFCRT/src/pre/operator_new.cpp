@@ -0,0 +1,144 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#include "../env/heap.h"
+#include <new>
+
+// These replace the global allocation and deallocation functions in libsupc++, so that sized and aligned deallocation reach our heap directly.
+// All forms are replaced together, otherwise a block allocated by libsupc++ (which allocates one byte for a request of zero bytes) might be freed here
+// with a different size.
+
+namespace {
+
+__attribute__((__always_inline__))
+inline void *AllocateOrThrow(std::size_t uSize, std::size_t uAlignment, const void *pRetAddr){
+	for(;;){
+		const auto pBlock = (uAlignment == 0) ? ::__MCFCRT_HeapAlloc(uSize, false, pRetAddr)
+		                                      : ::__MCFCRT_HeapAllocAligned(uAlignment, uSize, false, pRetAddr);
+		if(pBlock){
+			return pBlock;
+		}
+		const auto pfnHandler = std::get_new_handler();
+		if(!pfnHandler){
+			throw std::bad_alloc();
+		}
+		(*pfnHandler)();
+	}
+}
+__attribute__((__always_inline__))
+inline void *AllocateOrNull(std::size_t uSize, std::size_t uAlignment, const void *pRetAddr) noexcept {
+	try {
+		return AllocateOrThrow(uSize, uAlignment, pRetAddr);
+	} catch(std::bad_alloc &){
+		return nullptr;
+	}
+}
+
+}
+
+void *operator new(std::size_t uSize){
+	return AllocateOrThrow(uSize, 0, __builtin_return_address(0));
+}
+void *operator new[](std::size_t uSize){
+	return AllocateOrThrow(uSize, 0, __builtin_return_address(0));
+}
+void *operator new(std::size_t uSize, const std::nothrow_t &) noexcept {
+	return AllocateOrNull(uSize, 0, __builtin_return_address(0));
+}
+void *operator new[](std::size_t uSize, const std::nothrow_t &) noexcept {
+	return AllocateOrNull(uSize, 0, __builtin_return_address(0));
+}
+void *operator new(std::size_t uSize, std::align_val_t eAlignment){
+	return AllocateOrThrow(uSize, static_cast<std::size_t>(eAlignment), __builtin_return_address(0));
+}
+void *operator new[](std::size_t uSize, std::align_val_t eAlignment){
+	return AllocateOrThrow(uSize, static_cast<std::size_t>(eAlignment), __builtin_return_address(0));
+}
+void *operator new(std::size_t uSize, std::align_val_t eAlignment, const std::nothrow_t &) noexcept {
+	return AllocateOrNull(uSize, static_cast<std::size_t>(eAlignment), __builtin_return_address(0));
+}
+void *operator new[](std::size_t uSize, std::align_val_t eAlignment, const std::nothrow_t &) noexcept {
+	return AllocateOrNull(uSize, static_cast<std::size_t>(eAlignment), __builtin_return_address(0));
+}
+
+void operator delete(void *pBlock) noexcept {
+	if(!pBlock){
+		return;
+	}
+	::__MCFCRT_HeapFree(pBlock, __builtin_return_address(0));
+}
+void operator delete[](void *pBlock) noexcept {
+	if(!pBlock){
+		return;
+	}
+	::__MCFCRT_HeapFree(pBlock, __builtin_return_address(0));
+}
+void operator delete(void *pBlock, const std::nothrow_t &) noexcept {
+	if(!pBlock){
+		return;
+	}
+	::__MCFCRT_HeapFree(pBlock, __builtin_return_address(0));
+}
+void operator delete[](void *pBlock, const std::nothrow_t &) noexcept {
+	if(!pBlock){
+		return;
+	}
+	::__MCFCRT_HeapFree(pBlock, __builtin_return_address(0));
+}
+void operator delete(void *pBlock, std::size_t uSize) noexcept {
+	if(!pBlock){
+		return;
+	}
+	::__MCFCRT_HeapFreeSized(pBlock, uSize, __builtin_return_address(0));
+}
+void operator delete[](void *pBlock, std::size_t uSize) noexcept {
+	if(!pBlock){
+		return;
+	}
+	::__MCFCRT_HeapFreeSized(pBlock, uSize, __builtin_return_address(0));
+}
+void operator delete(void *pBlock, std::align_val_t eAlignment) noexcept {
+	static_cast<void>(eAlignment);
+	if(!pBlock){
+		return;
+	}
+	::__MCFCRT_HeapFreeAligned(pBlock, __builtin_return_address(0));
+}
+void operator delete[](void *pBlock, std::align_val_t eAlignment) noexcept {
+	static_cast<void>(eAlignment);
+	if(!pBlock){
+		return;
+	}
+	::__MCFCRT_HeapFreeAligned(pBlock, __builtin_return_address(0));
+}
+void operator delete(void *pBlock, std::align_val_t eAlignment, const std::nothrow_t &) noexcept {
+	static_cast<void>(eAlignment);
+	if(!pBlock){
+		return;
+	}
+	::__MCFCRT_HeapFreeAligned(pBlock, __builtin_return_address(0));
+}
+void operator delete[](void *pBlock, std::align_val_t eAlignment, const std::nothrow_t &) noexcept {
+	static_cast<void>(eAlignment);
+	if(!pBlock){
+		return;
+	}
+	::__MCFCRT_HeapFreeAligned(pBlock, __builtin_return_address(0));
+}
+void operator delete(void *pBlock, std::size_t uSize, std::align_val_t eAlignment) noexcept {
+	static_cast<void>(uSize);
+	static_cast<void>(eAlignment);
+	if(!pBlock){
+		return;
+	}
+	::__MCFCRT_HeapFreeAligned(pBlock, __builtin_return_address(0));
+}
+void operator delete[](void *pBlock, std::size_t uSize, std::align_val_t eAlignment) noexcept {
+	static_cast<void>(uSize);
+	static_cast<void>(eAlignment);
+	if(!pBlock){
+		return;
+	}
+	::__MCFCRT_HeapFreeAligned(pBlock, __builtin_return_address(0));
+}
@@ -0,0 +1,110 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#ifndef __MCFCRT_STDC_STRING_AVX2_H_
+#define __MCFCRT_STDC_STRING_AVX2_H_
+
+#include "../../env/_crtdef.h"
+#include <immintrin.h>
+
+_MCFCRT_EXTERN_C_BEGIN
+
+// 这些函数只能在 __target__("avx2") 的函数中使用，并且只有在 __MCFCRT_GetCpuFeatures() 报告支持 AVX2 时才能调用。
+
+__attribute__((__always_inline__, __target__("avx2")))
+static inline void __MCFCRT_ymmsetz(__m256i *__word) _MCFCRT_NOEXCEPT {
+	*__word = _mm256_setzero_si256();
+}
+__attribute__((__always_inline__, __target__("avx2")))
+static inline void __MCFCRT_ymmsetb(__m256i *__word, _MCFCRT_STD uint8_t __val) _MCFCRT_NOEXCEPT {
+	*__word = _mm256_set1_epi8((char)__val);
+}
+__attribute__((__always_inline__, __target__("avx2")))
+static inline void __MCFCRT_ymmsetw(__m256i *__word, _MCFCRT_STD uint16_t __val) _MCFCRT_NOEXCEPT {
+	*__word = _mm256_set1_epi16((short)__val);
+}
+
+__attribute__((__always_inline__, __target__("avx2")))
+static inline const void *__MCFCRT_ymmload_1(__m256i *_MCFCRT_RESTRICT __words, const void *_MCFCRT_RESTRICT __src) _MCFCRT_NOEXCEPT {
+	const __m256i *__rp = (const __m256i *)__src;
+	*__words = _mm256_load_si256(__rp++);
+	return __rp;
+}
+__attribute__((__always_inline__, __target__("avx2")))
+static inline const void *__MCFCRT_ymmload_2(__m256i *_MCFCRT_RESTRICT __words, const void *_MCFCRT_RESTRICT __src) _MCFCRT_NOEXCEPT {
+	__m256i *__wp = __words;
+	const __m256i *__rp = (const __m256i *)__src;
+	for(unsigned __i = 0; __i < 2; ++__i){
+		*(__wp++) = _mm256_load_si256(__rp++);
+	}
+	return __rp;
+}
+__attribute__((__always_inline__, __target__("avx2")))
+static inline const void *__MCFCRT_ymmload_4(__m256i *_MCFCRT_RESTRICT __words, const void *_MCFCRT_RESTRICT __src) _MCFCRT_NOEXCEPT {
+	__m256i *__wp = __words;
+	const __m256i *__rp = (const __m256i *)__src;
+	for(unsigned __i = 0; __i < 4; ++__i){
+		*(__wp++) = _mm256_load_si256(__rp++);
+	}
+	return __rp;
+}
+__attribute__((__always_inline__, __target__("avx2")))
+static inline void __MCFCRT_ymmloadu_1(__m256i *_MCFCRT_RESTRICT __words, const void *_MCFCRT_RESTRICT __src) _MCFCRT_NOEXCEPT {
+	*__words = _mm256_loadu_si256((const __m256i *)__src);
+}
+
+__attribute__((__always_inline__, __target__("avx2")))
+static inline _MCFCRT_STD uint64_t __MCFCRT_ymmcmp_21b(const __m256i *__lhs, const __m256i *__rhs) _MCFCRT_NOEXCEPT {
+	_MCFCRT_STD uint64_t __mask = 0;
+	for(unsigned __i = 0; __i < 2; ++__i){
+		const __m256i __t = _mm256_cmpeq_epi8(__lhs[__i], __rhs[0]);
+		__mask += (_MCFCRT_STD uint64_t)(_MCFCRT_STD uint32_t)_mm256_movemask_epi8(__t) << __i * 32;
+	}
+	return __mask;
+}
+__attribute__((__always_inline__, __target__("avx2")))
+static inline _MCFCRT_STD uint32_t __MCFCRT_ymmcmp_11b(const __m256i *__lhs, const __m256i *__rhs) _MCFCRT_NOEXCEPT {
+	const __m256i __t = _mm256_cmpeq_epi8(__lhs[0], __rhs[0]);
+	return (_MCFCRT_STD uint32_t)_mm256_movemask_epi8(__t);
+}
+__attribute__((__always_inline__, __target__("avx2")))
+static inline _MCFCRT_STD uint32_t __MCFCRT_ymmcmpandn_111b(const __m256i *__lhs, const __m256i *__rhs, const __m256i *__third) _MCFCRT_NOEXCEPT {
+	const __m256i __t = _mm256_andnot_si256(_mm256_cmpeq_epi8(__lhs[0], __third[0]), _mm256_cmpeq_epi8(__lhs[0], __rhs[0]));
+	return (_MCFCRT_STD uint32_t)_mm256_movemask_epi8(__t);
+}
+
+// _mm256_packs_epi16() 在每个 128 位的通道内分别打包，因此需要重新排列四字才能使得掩码的每一位依次对应一个元素。
+__attribute__((__always_inline__, __target__("avx2")))
+static inline _MCFCRT_STD uint32_t __MCFCRT_ymmpackmask_w(__m256i __lo, __m256i __hi) _MCFCRT_NOEXCEPT {
+	const __m256i __t = _mm256_permute4x64_epi64(_mm256_packs_epi16(__lo, __hi), 0xD8);
+	return (_MCFCRT_STD uint32_t)_mm256_movemask_epi8(__t);
+}
+
+__attribute__((__always_inline__, __target__("avx2")))
+static inline _MCFCRT_STD uint64_t __MCFCRT_ymmcmp_41w(const __m256i *__lhs, const __m256i *__rhs) _MCFCRT_NOEXCEPT {
+	_MCFCRT_STD uint64_t __mask = 0;
+	for(unsigned __i = 0; __i < 2; ++__i){
+		__mask += (_MCFCRT_STD uint64_t)__MCFCRT_ymmpackmask_w(_mm256_cmpeq_epi16(__lhs[__i * 2 + 0], __rhs[0]),
+		                                                      _mm256_cmpeq_epi16(__lhs[__i * 2 + 1], __rhs[0])) << __i * 32;
+	}
+	return __mask;
+}
+__attribute__((__always_inline__, __target__("avx2")))
+static inline _MCFCRT_STD uint64_t __MCFCRT_ymmcmpor_411w(const __m256i *__lhs, const __m256i *__rhs, const __m256i *__third) _MCFCRT_NOEXCEPT {
+	_MCFCRT_STD uint64_t __mask = 0;
+	for(unsigned __i = 0; __i < 2; ++__i){
+		__mask += (_MCFCRT_STD uint64_t)__MCFCRT_ymmpackmask_w(_mm256_or_si256(_mm256_cmpeq_epi16(__lhs[__i * 2 + 0], __third[0]), _mm256_cmpeq_epi16(__lhs[__i * 2 + 0], __rhs[0])),
+		                                                      _mm256_or_si256(_mm256_cmpeq_epi16(__lhs[__i * 2 + 1], __third[0]), _mm256_cmpeq_epi16(__lhs[__i * 2 + 1], __rhs[0]))) << __i * 32;
+	}
+	return __mask;
+}
+__attribute__((__always_inline__, __target__("avx2")))
+static inline _MCFCRT_STD uint32_t __MCFCRT_ymmcmpandn_111w(const __m256i *__lhs, const __m256i *__rhs, const __m256i *__third) _MCFCRT_NOEXCEPT {
+	const __m256i __t = _mm256_andnot_si256(_mm256_cmpeq_epi16(__lhs[0], __third[0]), _mm256_cmpeq_epi16(__lhs[0], __rhs[0]));
+	return __MCFCRT_ymmpackmask_w(__t, _mm256_setzero_si256()) & 0xFFFF;
+}
+
+_MCFCRT_EXTERN_C_END
+
+#endif
@@ -4,8 +4,104 @@
 
 #include "_memcpy_impl.h"
 #include "../../env/xassert.h"
+#include "../../env/_cpu_features.h"
+#include "../../ext/rep_movs.h"
+#include <immintrin.h>
 
-void __MCFCRT_memcpy_large_fwd(void *s1, const void *s2, size_t n){
+typedef struct tag_copy_tiers {
+	// Copies of at least this many bytes use `rep movsb`. This is `SIZE_MAX` if `rep movsb` is not fast.
+	size_t erms_threshold;
+	// Copies of at least this many bytes bypass the cache.
+	size_t nt_threshold;
+	bool avx2;
+} copy_tiers;
+
+// These are determined upon the first large copy. Determination is idempotent, hence no locking is required.
+static copy_tiers g_tiers;
+static volatile bool g_tiers_valid = false;
+
+static const copy_tiers *get_tiers(void){
+	if(_MCFCRT_EXPECT(__atomic_load_n(&g_tiers_valid, __ATOMIC_ACQUIRE))){
+		return &g_tiers;
+	}
+	const uint32_t features = __MCFCRT_GetCpuFeatures();
+	// With FSRM `rep movsb` beats vector loops at all sizes. With ERMS alone it has a startup cost which only pays off for longer copies.
+	if(features & __MCFCRT_kCpuFeatureFsrm){
+		g_tiers.erms_threshold = 0;
+	} else if(features & __MCFCRT_kCpuFeatureErms){
+		g_tiers.erms_threshold = 2048;
+	} else {
+		g_tiers.erms_threshold = SIZE_MAX;
+	}
+	// A copy of a quarter of the last level cache would evict a considerable part of the working set of all other threads.
+	const size_t llc_size = __MCFCRT_GetLastLevelCacheSize();
+	if(llc_size != 0){
+		g_tiers.nt_threshold = llc_size / 4;
+	} else {
+		g_tiers.nt_threshold = 0x100000;
+	}
+	g_tiers.avx2 = !!(features & __MCFCRT_kCpuFeatureAvx2);
+	__atomic_store_n(&g_tiers_valid, true, __ATOMIC_RELEASE);
+	return &g_tiers;
+}
+
+__attribute__((__target__("avx2")))
+static void large_fwd_avx2(void *s1, const void *s2, size_t n, bool nt){
+	_MCFCRT_ASSERT(n >= 32);
+
+	// The first and the last words are copied with unaligned loads and stores, and the rest is aligned to the destination.
+	// Both of them are loaded before anything is stored, so this works if the destination overlaps and precedes the source.
+	unsigned char *wp = (unsigned char *)s1;
+	const unsigned char *rp = (const unsigned char *)s2;
+	const __m256i head_w = _mm256_loadu_si256((const __m256i *)rp);
+	const __m256i tail_w = _mm256_loadu_si256((const __m256i *)(rp + n - 32));
+	unsigned char *const tail_wp = wp + n - 32;
+	const size_t off = -(uintptr_t)wp % 32;
+	wp += off;
+	rp += off;
+	if(nt){
+		while(_MCFCRT_EXPECT((size_t)(tail_wp - wp) >= 128)){
+			const __m256i w0 = _mm256_loadu_si256((const __m256i *)rp + 0);
+			const __m256i w1 = _mm256_loadu_si256((const __m256i *)rp + 1);
+			const __m256i w2 = _mm256_loadu_si256((const __m256i *)rp + 2);
+			const __m256i w3 = _mm256_loadu_si256((const __m256i *)rp + 3);
+			_mm256_stream_si256((__m256i *)wp + 0, w0);
+			_mm256_stream_si256((__m256i *)wp + 1, w1);
+			_mm256_stream_si256((__m256i *)wp + 2, w2);
+			_mm256_stream_si256((__m256i *)wp + 3, w3);
+			wp += 128;
+			rp += 128;
+		}
+		while(wp < tail_wp){
+			_mm256_stream_si256((__m256i *)wp, _mm256_loadu_si256((const __m256i *)rp));
+			wp += 32;
+			rp += 32;
+		}
+		_mm_sfence();
+	} else {
+		while(_MCFCRT_EXPECT((size_t)(tail_wp - wp) >= 128)){
+			const __m256i w0 = _mm256_loadu_si256((const __m256i *)rp + 0);
+			const __m256i w1 = _mm256_loadu_si256((const __m256i *)rp + 1);
+			const __m256i w2 = _mm256_loadu_si256((const __m256i *)rp + 2);
+			const __m256i w3 = _mm256_loadu_si256((const __m256i *)rp + 3);
+			_mm256_store_si256((__m256i *)wp + 0, w0);
+			_mm256_store_si256((__m256i *)wp + 1, w1);
+			_mm256_store_si256((__m256i *)wp + 2, w2);
+			_mm256_store_si256((__m256i *)wp + 3, w3);
+			wp += 128;
+			rp += 128;
+		}
+		while(wp < tail_wp){
+			_mm256_store_si256((__m256i *)wp, _mm256_loadu_si256((const __m256i *)rp));
+			wp += 32;
+			rp += 32;
+		}
+	}
+	_mm256_storeu_si256((__m256i *)tail_wp, tail_w);
+	_mm256_storeu_si256((__m256i *)s1, head_w);
+}
+
+static void large_fwd_sse2(void *s1, const void *s2, size_t n, bool nt_wanted){
 	_MCFCRT_ASSERT(n >= 16);
 
 	unsigned char *wp = (unsigned char *)s1;
@@ -19,7 +115,7 @@ void __MCFCRT_memcpy_large_fwd(void *s1, const void *s2, size_t n){
 	}
 	size_t rem = (n - off) / 16;
 	if(_MCFCRT_EXPECT(rem != 0)){
-		const size_t nt = !!(n >> 20) << 4;
+		const size_t nt = (size_t)nt_wanted << 4;
 		const size_t ur = !!((uintptr_t)rp % 16) << 3;
 		switch((rem - 1) % 8 + nt + ur){
 #define STEP(k_, store_, load_)	\
@@ -106,6 +202,26 @@ void __MCFCRT_memcpy_large_fwd(void *s1, const void *s2, size_t n){
 	}
 }
 
+void __MCFCRT_memcpy_large_fwd(void *s1, const void *s2, size_t n){
+	_MCFCRT_ASSERT(n >= 16);
+
+	const copy_tiers *const tiers = get_tiers();
+	if(_MCFCRT_EXPECT_NOT(n >= tiers->nt_threshold)){
+		if(tiers->avx2){
+			large_fwd_avx2(s1, s2, n, true);
+		} else {
+			large_fwd_sse2(s1, s2, n, true);
+		}
+	} else if(n >= tiers->erms_threshold){
+		// `rep movsb` copies forwards byte by byte by definition, which is also correct if the destination precedes the source.
+		_MCFCRT_rep_movsb(_MCFCRT_NULLPTR, s1, s2, n);
+	} else if(tiers->avx2 && (n >= 32)){
+		large_fwd_avx2(s1, s2, n, false);
+	} else {
+		large_fwd_sse2(s1, s2, n, false);
+	}
+}
+
 void __MCFCRT_memcpy_large_bwd(size_t n, void *s1, const void *s2){
 	_MCFCRT_ASSERT(n >= 16);
 
@@ -120,7 +236,7 @@ void __MCFCRT_memcpy_large_bwd(size_t n, void *s1, const void *s2){
 	}
 	size_t rem = (n - off) / 16;
 	if(_MCFCRT_EXPECT(rem != 0)){
-		const size_t nt = !!(n >> 20) << 4;
+		const size_t nt = (size_t)(n >= get_tiers()->nt_threshold) << 4;
 		const size_t ur = !!((uintptr_t)rp % 16) << 3;
 		switch((rem - 1) % 8 + nt + ur){
 #define STEP(k_, store_, load_)	\
@@ -4,11 +4,13 @@
 
 #include "../../env/_crtdef.h"
 #include "../../env/expect.h"
+#include "../../env/_cpu_features.h"
 #include "_sse2.h"
+#include "_avx2.h"
 
 #undef memchr
 
-void *memchr(const void *s, int c, size_t n){
+static void *memchr_sse2(const void *s, int c, size_t n){
 	// 如果 arp 是对齐到字的，就不用考虑越界的问题。
 	// 因为内存按页分配的，也自然对齐到页，并且也对齐到字。
 	// 每个字内的字节的权限必然一致。
@@ -43,6 +45,8 @@ void *memchr(const void *s, int c, size_t n){
 		END
 		BEGIN
 	}
+#undef BEGIN
+#undef END
 end_trunc:
 	mask |= ~((uint32_t)-1 >> dist);
 end:
@@ -53,3 +57,70 @@ end:
 end_null:
 	return _MCFCRT_NULLPTR;
 }
+
+__attribute__((__target__("avx2")))
+static void *memchr_avx2(const void *s, int c, size_t n){
+	// 同上，但是每次处理 64 字节。
+	const unsigned char *arp = (const unsigned char *)((uintptr_t)s & (uintptr_t)-64);
+	__m256i yc[1];
+	__MCFCRT_ymmsetb(yc, (uint8_t)c);
+
+	__m256i yw[2];
+	uint64_t mask;
+	ptrdiff_t dist;
+//=============================================================================
+#define BEGIN	\
+	arp = __MCFCRT_ymmload_2(yw, arp);	\
+	mask = __MCFCRT_ymmcmp_21b(yw, yc);
+#define END	\
+	dist = arp - ((const unsigned char *)s + n);	\
+	if(_MCFCRT_EXPECT_NOT(dist >= 0)){	\
+		goto end_trunc;	\
+	}	\
+	dist = 0;	\
+	if(_MCFCRT_EXPECT_NOT(mask != 0)){	\
+		goto end;	\
+	}
+//=============================================================================
+	if(_MCFCRT_EXPECT_NOT(n == 0)){
+		goto end_null;
+	}
+	BEGIN
+	dist = (const unsigned char *)s - (arp - 64);
+	mask &= (uint64_t)-1 << dist;
+	for(;;){
+		END
+		BEGIN
+	}
+#undef BEGIN
+#undef END
+end_trunc:
+	mask |= ~((uint64_t)-1 >> dist);
+end:
+	if((mask << dist) != 0){
+		arp = arp - 64 + (unsigned)__builtin_ctzll(mask);
+		return (unsigned char *)arp;
+	}
+end_null:
+	return _MCFCRT_NULLPTR;
+}
+
+typedef void *(*memchr_impl)(const void *, int, size_t);
+
+static void *memchr_select(const void *s, int c, size_t n);
+
+// 第一次调用时选择实现，之后直接调用选中的实现。选择的结果总是相同的，因此不需要加锁。
+static memchr_impl g_impl = &memchr_select;
+
+static void *memchr_select(const void *s, int c, size_t n){
+	memchr_impl impl = &memchr_sse2;
+	if(__MCFCRT_GetCpuFeatures() & __MCFCRT_kCpuFeatureAvx2){
+		impl = &memchr_avx2;
+	}
+	__atomic_store_n(&g_impl, impl, __ATOMIC_RELAXED);
+	return (*impl)(s, c, n);
+}
+
+void *memchr(const void *s, int c, size_t n){
+	return (*__atomic_load_n(&g_impl, __ATOMIC_RELAXED))(s, c, n);
+}
@@ -4,6 +4,8 @@
 
 #include "../../env/_crtdef.h"
 #include "../../env/expect.h"
+#include "../../env/_cpu_features.h"
+#include "_avx2.h"
 
 #undef memcmp
 
@@ -17,7 +19,7 @@ static inline uintptr_t bswap_ptr(uintptr_t w){
 #endif
 }
 
-int memcmp(const void *s1, const void *s2, size_t n){
+static int memcmp_generic(const void *s1, const void *s2, size_t n){
 	const unsigned char *rp1 = s1;
 	const unsigned char *rp2 = s2;
 	size_t rem = n / sizeof(uintptr_t);
@@ -61,3 +63,56 @@ int memcmp(const void *s1, const void *s2, size_t n){
 	}
 	return 0;
 }
+
+__attribute__((__target__("avx2")))
+static int memcmp_avx2(const void *s1, const void *s2, size_t n){
+	// 所有读取都在 [s1, s1 + n) 和 [s2, s2 + n) 之内，因此可以使用非对齐的读取。
+	// 最后一个不完整的字与前一个字重叠，重叠的部分已知是相等的。
+	if(n < 32){
+		return memcmp_generic(s1, s2, n);
+	}
+	const unsigned char *rp1 = s1;
+	const unsigned char *rp2 = s2;
+	const unsigned char *const end1 = rp1 + n;
+	__m256i yw[1], yc[1];
+	uint32_t mask;
+	for(;;){
+		__MCFCRT_ymmloadu_1(yw, rp1);
+		__MCFCRT_ymmloadu_1(yc, rp2);
+		mask = ~__MCFCRT_ymmcmp_11b(yw, yc);
+		if(_MCFCRT_EXPECT_NOT(mask != 0)){
+			const unsigned i = (unsigned)__builtin_ctzl(mask);
+			return (rp1[i] < rp2[i]) ? -1 : 1;
+		}
+		rp1 += 32;
+		rp2 += 32;
+		const size_t rem = (size_t)(end1 - rp1);
+		if(rem == 0){
+			return 0;
+		}
+		if(rem < 32){
+			rp1 -= 32 - rem;
+			rp2 -= 32 - rem;
+		}
+	}
+}
+
+typedef int (*memcmp_impl)(const void *, const void *, size_t);
+
+static int memcmp_select(const void *s1, const void *s2, size_t n);
+
+// 第一次调用时选择实现，之后直接调用选中的实现。选择的结果总是相同的，因此不需要加锁。
+static memcmp_impl g_impl = &memcmp_select;
+
+static int memcmp_select(const void *s1, const void *s2, size_t n){
+	memcmp_impl impl = &memcmp_generic;
+	if(__MCFCRT_GetCpuFeatures() & __MCFCRT_kCpuFeatureAvx2){
+		impl = &memcmp_avx2;
+	}
+	__atomic_store_n(&g_impl, impl, __ATOMIC_RELAXED);
+	return (*impl)(s1, s2, n);
+}
+
+int memcmp(const void *s1, const void *s2, size_t n){
+	return (*__atomic_load_n(&g_impl, __ATOMIC_RELAXED))(s1, s2, n);
+}
@@ -4,12 +4,14 @@
 
 #include "../../env/_crtdef.h"
 #include "../../env/expect.h"
+#include "../../env/_cpu_features.h"
 #include "_sse2.h"
 #include "_ssse3.h"
+#include "_avx2.h"
 
 #undef strcmp
 
-int strcmp(const char *s1, const char *s2){
+static int strcmp_sse2(const char *s1, const char *s2){
 	// 如果 arp1 和 arp2 是对齐到字的，就不用考虑越界的问题。
 	// 因为内存按页分配的，也自然对齐到页，并且也对齐到字。
 	// 每个字内的字节的权限必然一致。
@@ -55,6 +57,8 @@ int strcmp(const char *s1, const char *s2){
 		END
 		BEGIN
 	}
+#undef BEGIN
+#undef END
 end:
 	arp1 = arp1 - 32 + (unsigned)__builtin_ctzl(mask);
 	arp2 = arp1 - (const unsigned char *)s1 + (const unsigned char *)s2;
@@ -65,3 +69,65 @@ end:
 end_equal:
 	return 0;
 }
+
+__attribute__((__target__("avx2")))
+static int strcmp_avx2(const char *s1, const char *s2){
+	// arp1 总是对齐到字的，但是 s2 中对应的位置不一定。
+	// 如果非对齐的读取没有跨越页的边界，那么它读取的页中必然有 s2 的有效字节，因此这样读取是安全的；
+	// 否则就逐字节比较这个字，以免读取下一页。
+	const unsigned char *arp1 = (const unsigned char *)((uintptr_t)s1 & (uintptr_t)-32);
+	const ptrdiff_t delta = (const unsigned char *)s2 - (const unsigned char *)s1;
+	__m256i yz[1];
+	__MCFCRT_ymmsetz(yz);
+
+	__m256i yw[1], yc[1];
+	uint32_t mask;
+	ptrdiff_t dist = (const unsigned char *)s1 - arp1;
+	for(;;){
+		const uintptr_t rp2 = (uintptr_t)(arp1 + delta);
+		if(_MCFCRT_EXPECT_NOT(((rp2 ^ (rp2 + 31)) & (uintptr_t)-0x1000) != 0)){
+			for(const unsigned char *rp1 = arp1 + dist; rp1 != arp1 + 32; ++rp1){
+				if(rp1[0] != rp1[delta]){
+					return (rp1[0] < rp1[delta]) ? -1 : 1;
+				}
+				if(rp1[0] == 0){
+					return 0;
+				}
+			}
+		} else {
+			__MCFCRT_ymmload_1(yw, arp1);
+			__MCFCRT_ymmloadu_1(yc, arp1 + delta);
+			mask = ~__MCFCRT_ymmcmpandn_111b(yw, yc, yz);
+			mask &= (uint32_t)-1 << dist;
+			if(_MCFCRT_EXPECT_NOT(mask != 0)){
+				arp1 = arp1 + (unsigned)__builtin_ctzl(mask);
+				if(arp1[0] == arp1[delta]){
+					return 0;
+				}
+				return (arp1[0] < arp1[delta]) ? -1 : 1;
+			}
+		}
+		arp1 += 32;
+		dist = 0;
+	}
+}
+
+typedef int (*strcmp_impl)(const char *, const char *);
+
+static int strcmp_select(const char *s1, const char *s2);
+
+// 第一次调用时选择实现，之后直接调用选中的实现。选择的结果总是相同的，因此不需要加锁。
+static strcmp_impl g_impl = &strcmp_select;
+
+static int strcmp_select(const char *s1, const char *s2){
+	strcmp_impl impl = &strcmp_sse2;
+	if(__MCFCRT_GetCpuFeatures() & __MCFCRT_kCpuFeatureAvx2){
+		impl = &strcmp_avx2;
+	}
+	__atomic_store_n(&g_impl, impl, __ATOMIC_RELAXED);
+	return (*impl)(s1, s2);
+}
+
+int strcmp(const char *s1, const char *s2){
+	return (*__atomic_load_n(&g_impl, __ATOMIC_RELAXED))(s1, s2);
+}
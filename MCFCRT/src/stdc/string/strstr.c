@@ -0,0 +1,18 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#include "../../env/_crtdef.h"
+#include "../../ext/memmem.h"
+
+#undef strstr
+
+char *strstr(const char *s1, const char *s2){
+	// strlen() 是向量化的，先求出两个字符串的长度再搜索，总的时间仍然是线性的。
+	const size_t m = strlen(s2);
+	if(m == 0){
+		return (char *)s1;
+	}
+	const size_t n = strlen(s1);
+	return _MCFCRT_memmem(s1, n, s2, m);
+}
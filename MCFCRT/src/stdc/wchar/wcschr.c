@@ -4,11 +4,13 @@
 
 #include "../../env/_crtdef.h"
 #include "../../env/expect.h"
+#include "../../env/_cpu_features.h"
 #include "../string/_sse2.h"
+#include "../string/_avx2.h"
 
 #undef wcschr
 
-wchar_t *wcschr(const wchar_t *s, wchar_t c){
+static wchar_t *wcschr_sse2(const wchar_t *s, wchar_t c){
 	// 如果 arp 是对齐到字的，就不用考虑越界的问题。
 	// 因为内存按页分配的，也自然对齐到页，并且也对齐到字。
 	// 每个字内的字节的权限必然一致。
@@ -37,6 +39,8 @@ wchar_t *wcschr(const wchar_t *s, wchar_t c){
 		END
 		BEGIN
 	}
+#undef BEGIN
+#undef END
 end:
 	arp = arp - 32 + (unsigned)__builtin_ctzl(mask);
 	if(*arp == (wchar_t)c){
@@ -44,3 +48,61 @@ end:
 	}
 	return _MCFCRT_NULLPTR;
 }
+
+__attribute__((__target__("avx2")))
+static wchar_t *wcschr_avx2(const wchar_t *s, wchar_t c){
+	// 同上，但是每次处理 64 个字符。
+	const wchar_t *arp = (const wchar_t *)((uintptr_t)s & (uintptr_t)-128);
+	__m256i yc[1];
+	__MCFCRT_ymmsetw(yc, (uint16_t)c);
+	__m256i yz[1];
+	__MCFCRT_ymmsetz(yz);
+
+	__m256i yw[4];
+	uint64_t mask;
+	ptrdiff_t dist;
+//=============================================================================
+#define BEGIN	\
+	arp = __MCFCRT_ymmload_4(yw, arp);	\
+	mask = __MCFCRT_ymmcmpor_411w(yw, yc, yz);
+#define END	\
+	if(_MCFCRT_EXPECT_NOT(mask != 0)){	\
+		goto end;	\
+	}
+//=============================================================================
+	BEGIN
+	dist = (const wchar_t *)s - (arp - 64);
+	mask &= (uint64_t)-1 << dist;
+	for(;;){
+		END
+		BEGIN
+	}
+#undef BEGIN
+#undef END
+end:
+	arp = arp - 64 + (unsigned)__builtin_ctzll(mask);
+	if(*arp == (wchar_t)c){
+		return (wchar_t *)arp;
+	}
+	return _MCFCRT_NULLPTR;
+}
+
+typedef wchar_t *(*wcschr_impl)(const wchar_t *, wchar_t);
+
+static wchar_t *wcschr_select(const wchar_t *s, wchar_t c);
+
+// 第一次调用时选择实现，之后直接调用选中的实现。选择的结果总是相同的，因此不需要加锁。
+static wcschr_impl g_impl = &wcschr_select;
+
+static wchar_t *wcschr_select(const wchar_t *s, wchar_t c){
+	wcschr_impl impl = &wcschr_sse2;
+	if(__MCFCRT_GetCpuFeatures() & __MCFCRT_kCpuFeatureAvx2){
+		impl = &wcschr_avx2;
+	}
+	__atomic_store_n(&g_impl, impl, __ATOMIC_RELAXED);
+	return (*impl)(s, c);
+}
+
+wchar_t *wcschr(const wchar_t *s, wchar_t c){
+	return (*__atomic_load_n(&g_impl, __ATOMIC_RELAXED))(s, c);
+}
@@ -4,12 +4,14 @@
 
 #include "../../env/_crtdef.h"
 #include "../../env/expect.h"
+#include "../../env/_cpu_features.h"
 #include "../string/_sse2.h"
 #include "../string/_ssse3.h"
+#include "../string/_avx2.h"
 
 #undef wcscmp
 
-int wcscmp(const wchar_t *s1, const wchar_t *s2){
+static int wcscmp_sse2(const wchar_t *s1, const wchar_t *s2){
 	// 如果 arp1 和 arp2 是对齐到字的，就不用考虑越界的问题。
 	// 因为内存按页分配的，也自然对齐到页，并且也对齐到字。
 	// 每个字内的字节的权限必然一致。
@@ -55,6 +57,8 @@ int wcscmp(const wchar_t *s1, const wchar_t *s2){
 		END
 		BEGIN
 	}
+#undef BEGIN
+#undef END
 end:
 	arp1 = arp1 - 32 + (unsigned)__builtin_ctzl(mask);
 	arp2 = arp1 - (const wchar_t *)s1 + (const wchar_t *)s2;
@@ -65,3 +69,65 @@ end:
 end_equal:
 	return 0;
 }
+
+__attribute__((__target__("avx2")))
+static int wcscmp_avx2(const wchar_t *s1, const wchar_t *s2){
+	// arp1 总是对齐到字的，但是 s2 中对应的位置不一定。
+	// 如果非对齐的读取没有跨越页的边界，那么它读取的页中必然有 s2 的有效字符，因此这样读取是安全的；
+	// 否则就逐个字符比较这个字，以免读取下一页。
+	const wchar_t *arp1 = (const wchar_t *)((uintptr_t)s1 & (uintptr_t)-32);
+	const ptrdiff_t delta = s2 - s1;
+	__m256i yz[1];
+	__MCFCRT_ymmsetz(yz);
+
+	__m256i yw[1], yc[1];
+	uint32_t mask;
+	ptrdiff_t dist = s1 - arp1;
+	for(;;){
+		const uintptr_t rp2 = (uintptr_t)(arp1 + delta);
+		if(_MCFCRT_EXPECT_NOT(((rp2 ^ (rp2 + 31)) & (uintptr_t)-0x1000) != 0)){
+			for(const wchar_t *rp1 = arp1 + dist; rp1 != arp1 + 16; ++rp1){
+				if(rp1[0] != rp1[delta]){
+					return (rp1[0] < rp1[delta]) ? -1 : 1;
+				}
+				if(rp1[0] == 0){
+					return 0;
+				}
+			}
+		} else {
+			__MCFCRT_ymmload_1(yw, arp1);
+			__MCFCRT_ymmloadu_1(yc, arp1 + delta);
+			mask = ~__MCFCRT_ymmcmpandn_111w(yw, yc, yz) & 0xFFFF;
+			mask &= (uint32_t)-1 << dist;
+			if(_MCFCRT_EXPECT_NOT(mask != 0)){
+				arp1 = arp1 + (unsigned)__builtin_ctzl(mask);
+				if(arp1[0] == arp1[delta]){
+					return 0;
+				}
+				return (arp1[0] < arp1[delta]) ? -1 : 1;
+			}
+		}
+		arp1 += 16;
+		dist = 0;
+	}
+}
+
+typedef int (*wcscmp_impl)(const wchar_t *, const wchar_t *);
+
+static int wcscmp_select(const wchar_t *s1, const wchar_t *s2);
+
+// 第一次调用时选择实现，之后直接调用选中的实现。选择的结果总是相同的，因此不需要加锁。
+static wcscmp_impl g_impl = &wcscmp_select;
+
+static int wcscmp_select(const wchar_t *s1, const wchar_t *s2){
+	wcscmp_impl impl = &wcscmp_sse2;
+	if(__MCFCRT_GetCpuFeatures() & __MCFCRT_kCpuFeatureAvx2){
+		impl = &wcscmp_avx2;
+	}
+	__atomic_store_n(&g_impl, impl, __ATOMIC_RELAXED);
+	return (*impl)(s1, s2);
+}
+
+int wcscmp(const wchar_t *s1, const wchar_t *s2){
+	return (*__atomic_load_n(&g_impl, __ATOMIC_RELAXED))(s1, s2);
+}
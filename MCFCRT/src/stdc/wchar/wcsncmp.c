@@ -4,12 +4,14 @@
 
 #include "../../env/_crtdef.h"
 #include "../../env/expect.h"
+#include "../../env/_cpu_features.h"
 #include "../string/_sse2.h"
 #include "../string/_ssse3.h"
+#include "../string/_avx2.h"
 
 #undef wcsncmp
 
-int wcsncmp(const wchar_t *s1, const wchar_t *s2, size_t n){
+static int wcsncmp_sse2(const wchar_t *s1, const wchar_t *s2, size_t n){
 	// 如果 arp1 和 arp2 是对齐到字的，就不用考虑越界的问题。
 	// 因为内存按页分配的，也自然对齐到页，并且也对齐到字。
 	// 每个字内的字节的权限必然一致。
@@ -63,6 +65,8 @@ int wcsncmp(const wchar_t *s1, const wchar_t *s2, size_t n){
 		END
 		BEGIN
 	}
+#undef BEGIN
+#undef END
 end_trunc:
 	mask |= ~((uint32_t)-1 >> dist);
 end:
@@ -77,3 +81,78 @@ end:
 end_equal:
 	return 0;
 }
+
+__attribute__((__target__("avx2")))
+static int wcsncmp_avx2(const wchar_t *s1, const wchar_t *s2, size_t n){
+	// 同 wcscmp()，但是只比较前 n 个字符。
+	// 每个字只有在其中至少有一个需要比较的字符时才会被读取。
+	const wchar_t *arp1 = (const wchar_t *)((uintptr_t)s1 & (uintptr_t)-32);
+	const ptrdiff_t delta = s2 - s1;
+	__m256i yz[1];
+	__MCFCRT_ymmsetz(yz);
+
+	__m256i yw[1], yc[1];
+	uint32_t mask;
+	size_t dist = (size_t)(s1 - arp1);
+	size_t rem = n;
+	while(_MCFCRT_EXPECT(rem != 0)){
+		const uintptr_t rp2 = (uintptr_t)(arp1 + delta);
+		if(_MCFCRT_EXPECT_NOT(((rp2 ^ (rp2 + 31)) & (uintptr_t)-0x1000) != 0)){
+			for(const wchar_t *rp1 = arp1 + dist; rp1 != arp1 + 16; ++rp1){
+				if(rem == 0){
+					return 0;
+				}
+				if(rp1[0] != rp1[delta]){
+					return (rp1[0] < rp1[delta]) ? -1 : 1;
+				}
+				if(rp1[0] == 0){
+					return 0;
+				}
+				--rem;
+			}
+		} else {
+			__MCFCRT_ymmload_1(yw, arp1);
+			__MCFCRT_ymmloadu_1(yc, arp1 + delta);
+			mask = ~__MCFCRT_ymmcmpandn_111w(yw, yc, yz) & 0xFFFF;
+			mask &= (uint32_t)-1 << dist;
+			if(_MCFCRT_EXPECT_NOT(mask != 0)){
+				const size_t index = (unsigned)__builtin_ctzl(mask);
+				if(index - dist >= rem){
+					return 0;
+				}
+				arp1 = arp1 + index;
+				if(arp1[0] == arp1[delta]){
+					return 0;
+				}
+				return (arp1[0] < arp1[delta]) ? -1 : 1;
+			}
+			if(rem <= 16 - dist){
+				return 0;
+			}
+			rem -= 16 - dist;
+		}
+		arp1 += 16;
+		dist = 0;
+	}
+	return 0;
+}
+
+typedef int (*wcsncmp_impl)(const wchar_t *, const wchar_t *, size_t);
+
+static int wcsncmp_select(const wchar_t *s1, const wchar_t *s2, size_t n);
+
+// 第一次调用时选择实现，之后直接调用选中的实现。选择的结果总是相同的，因此不需要加锁。
+static wcsncmp_impl g_impl = &wcsncmp_select;
+
+static int wcsncmp_select(const wchar_t *s1, const wchar_t *s2, size_t n){
+	wcsncmp_impl impl = &wcsncmp_sse2;
+	if(__MCFCRT_GetCpuFeatures() & __MCFCRT_kCpuFeatureAvx2){
+		impl = &wcsncmp_avx2;
+	}
+	__atomic_store_n(&g_impl, impl, __ATOMIC_RELAXED);
+	return (*impl)(s1, s2, n);
+}
+
+int wcsncmp(const wchar_t *s1, const wchar_t *s2, size_t n){
+	return (*__atomic_load_n(&g_impl, __ATOMIC_RELAXED))(s1, s2, n);
+}
@@ -0,0 +1,19 @@
+// 这个文件是 MCF 的一部分。
+// 有关具体授权说明，请参阅 MCFLicense.txt。
+// Copyleft 2013 - 2018, LH_Mouse. All wrongs reserved.
+
+#include "../../env/_crtdef.h"
+#include "../../ext/wmemmem.h"
+#include <wchar.h>
+
+#undef wcsstr
+
+wchar_t *wcsstr(const wchar_t *s1, const wchar_t *s2){
+	// wcslen() 是向量化的，先求出两个字符串的长度再搜索，总的时间仍然是线性的。
+	const size_t m = wcslen(s2);
+	if(m == 0){
+		return (wchar_t *)s1;
+	}
+	const size_t n = wcslen(s1);
+	return _MCFCRT_wmemmem(s1, n, s2, m);
+}
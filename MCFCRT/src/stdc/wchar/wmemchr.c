@@ -4,11 +4,13 @@
 
 #include "../../env/_crtdef.h"
 #include "../../env/expect.h"
+#include "../../env/_cpu_features.h"
 #include "../string/_sse2.h"
+#include "../string/_avx2.h"
 
 #undef wmemchr
 
-wchar_t *wmemchr(const wchar_t *s, wchar_t c, size_t n){
+static wchar_t *wmemchr_sse2(const wchar_t *s, wchar_t c, size_t n){
 	// 如果 arp 是对齐到字的，就不用考虑越界的问题。
 	// 因为内存按页分配的，也自然对齐到页，并且也对齐到字。
 	// 每个字内的字节的权限必然一致。
@@ -43,6 +45,8 @@ wchar_t *wmemchr(const wchar_t *s, wchar_t c, size_t n){
 		END
 		BEGIN
 	}
+#undef BEGIN
+#undef END
 end_trunc:
 	mask |= ~((uint32_t)-1 >> dist);
 end:
@@ -53,3 +57,70 @@ end:
 end_null:
 	return _MCFCRT_NULLPTR;
 }
+
+__attribute__((__target__("avx2")))
+static wchar_t *wmemchr_avx2(const wchar_t *s, wchar_t c, size_t n){
+	// 同上，但是每次处理 64 个字符。
+	const wchar_t *arp = (const wchar_t *)((uintptr_t)s & (uintptr_t)-128);
+	__m256i yc[1];
+	__MCFCRT_ymmsetw(yc, (uint16_t)c);
+
+	__m256i yw[4];
+	uint64_t mask;
+	ptrdiff_t dist;
+//=============================================================================
+#define BEGIN	\
+	arp = __MCFCRT_ymmload_4(yw, arp);	\
+	mask = __MCFCRT_ymmcmp_41w(yw, yc);
+#define END	\
+	dist = arp - ((const wchar_t *)s + n);	\
+	if(_MCFCRT_EXPECT_NOT(dist >= 0)){	\
+		goto end_trunc;	\
+	}	\
+	dist = 0;	\
+	if(_MCFCRT_EXPECT_NOT(mask != 0)){	\
+		goto end;	\
+	}
+//=============================================================================
+	if(_MCFCRT_EXPECT_NOT(n == 0)){
+		goto end_null;
+	}
+	BEGIN
+	dist = (const wchar_t *)s - (arp - 64);
+	mask &= (uint64_t)-1 << dist;
+	for(;;){
+		END
+		BEGIN
+	}
+#undef BEGIN
+#undef END
+end_trunc:
+	mask |= ~((uint64_t)-1 >> dist);
+end:
+	if((mask << dist) != 0){
+		arp = arp - 64 + (unsigned)__builtin_ctzll(mask);
+		return (wchar_t *)arp;
+	}
+end_null:
+	return _MCFCRT_NULLPTR;
+}
+
+typedef wchar_t *(*wmemchr_impl)(const wchar_t *, wchar_t, size_t);
+
+static wchar_t *wmemchr_select(const wchar_t *s, wchar_t c, size_t n);
+
+// 第一次调用时选择实现，之后直接调用选中的实现。选择的结果总是相同的，因此不需要加锁。
+static wmemchr_impl g_impl = &wmemchr_select;
+
+static wchar_t *wmemchr_select(const wchar_t *s, wchar_t c, size_t n){
+	wmemchr_impl impl = &wmemchr_sse2;
+	if(__MCFCRT_GetCpuFeatures() & __MCFCRT_kCpuFeatureAvx2){
+		impl = &wmemchr_avx2;
+	}
+	__atomic_store_n(&g_impl, impl, __ATOMIC_RELAXED);
+	return (*impl)(s, c, n);
+}
+
+wchar_t *wmemchr(const wchar_t *s, wchar_t c, size_t n){
+	return (*__atomic_load_n(&g_impl, __ATOMIC_RELAXED))(s, c, n);
+}
@@ -0,0 +1,111 @@
+#include "Harness.hpp"
+#include <MCF/Core/Clocks.hpp>
+
+using namespace MCF;
+
+namespace {
+
+// GetHiResMonoClock() 的单位是毫秒，TSC 时钟的单位是纳秒，二者在同一条时间线上。
+double GetTscOffsetFromHiResInMicroseconds(){
+	const auto dHiResBefore = GetHiResMonoClock();
+	const auto u64Tsc = GetTscMonoClock();
+	const auto dHiResAfter = GetHiResMonoClock();
+	return static_cast<double>(u64Tsc) / 1.0e3 - (dHiResBefore + dHiResAfter) / 2 * 1.0e3;
+}
+
+}
+
+HARNESS_TEST(TscClockIsMonotonicAcrossRecalibrations){
+	// 时钟大约每秒重新校准一次，这里运行三秒，至少跨过两次。
+	const auto u64Deadline = GetFastMonoClock() + 3000;
+	Harness::RunInThreads(4, [&](unsigned uIndex){
+		std::uint64_t u64Last = 0;
+		std::uint64_t u64Reads = 0;
+		while(GetFastMonoClock() < u64Deadline){
+			for(unsigned uInner = 0; uInner < 1000; ++uInner){
+				const auto u64Now = (uInner % 2 == 0) ? GetTscMonoClock() : GetTscMonoClockOrdered();
+				HARNESS_CHECK(u64Now >= u64Last);
+				u64Last = u64Now;
+			}
+			u64Reads += 1000;
+		}
+		std::printf("  thread %u: %llu reads\n", uIndex, static_cast<unsigned long long>(u64Reads));
+	});
+	// 无论 TSC 是否可用，这个时钟都不应该偏离性能计数器太远。
+	HARNESS_CHECK(__builtin_fabs(GetTscOffsetFromHiResInMicroseconds()) < 1000);
+}
+
+HARNESS_TEST(TscOrderedReadReportsProcessor){
+	std::uint32_t u32Aux = UINT32_MAX;
+	const auto u64First = ReadTimeStampCounter64Ordered(&u32Aux);
+	HARNESS_CHECK(u32Aux != UINT32_MAX);
+	HARNESS_CHECK(ReadTimeStampCounter64Ordered() >= u64First);
+}
+
+HARNESS_TEST(TscClockRunsAtTheRightRate){
+	// 在不同长度的间隔上比较两个时钟经过的时间。校准误差会随间隔线性增长，因此用相对误差衡量。
+	static constexpr unsigned kIntervals[] = { 10, 100, 500, 1500 };
+	for(const auto uInterval : kIntervals){
+		const auto dHiResBegin = GetHiResMonoClock();
+		const auto u64TscBegin = GetTscMonoClockOrdered();
+		Sleep(GetFastMonoClock() + uInterval);
+		const auto u64TscEnd = GetTscMonoClockOrdered();
+		const auto dHiResEnd = GetHiResMonoClock();
+		const auto dTscElapsed = static_cast<double>(u64TscEnd - u64TscBegin) / 1.0e6;
+		const auto dHiResElapsed = dHiResEnd - dHiResBegin;
+		std::printf("  %4u ms: TSC %10.4f ms, QPC %10.4f ms\n", uInterval, dTscElapsed, dHiResElapsed);
+		// 两次读取之间相差不到几微秒，其余的都是频率误差。
+		HARNESS_CHECK(__builtin_fabs(dTscElapsed - dHiResElapsed) < 0.05 + dHiResElapsed * 0.001);
+	}
+}
+
+HARNESS_BENCH(TscClockCallCost){
+	// 单位是纳秒每次调用。
+	constexpr std::uint64_t kIterations = 10000000;
+	std::printf("  invariant TSC = %s, frequency = %llu Hz\n", IsTscMonoClockInvariant() ? "yes" : "no", static_cast<unsigned long long>(GetTscFrequency()));
+	std::printf("  ReadTimeStampCounter64()        : %6.2f ns\n", Harness::Measure(kIterations, []{ Harness::DoNotOptimize(ReadTimeStampCounter64()); }));
+	std::printf("  ReadTimeStampCounter64Ordered() : %6.2f ns\n", Harness::Measure(kIterations, []{ Harness::DoNotOptimize(ReadTimeStampCounter64Ordered()); }));
+	std::printf("  GetTscMonoClock()               : %6.2f ns\n", Harness::Measure(kIterations, []{ Harness::DoNotOptimize(GetTscMonoClock()); }));
+	std::printf("  GetTscMonoClockOrdered()        : %6.2f ns\n", Harness::Measure(kIterations, []{ Harness::DoNotOptimize(GetTscMonoClockOrdered()); }));
+	std::printf("  GetHiResMonoClock()             : %6.2f ns\n", Harness::Measure(kIterations, []{ Harness::DoNotOptimize(GetHiResMonoClock()); }));
+	std::printf("  GetFastMonoClock()              : %6.2f ns\n", Harness::Measure(kIterations, []{ Harness::DoNotOptimize(GetFastMonoClock()); }));
+}
+
+HARNESS_BENCH(TscClockDrift){
+	// 每秒打印一次 TSC 时钟相对于性能计数器的偏差，单位是微秒。偏差应该保持在几微秒之内，而不是随时间增长。
+	for(unsigned uSecond = 0; uSecond <= 30; ++uSecond){
+		std::printf("  t = %2u s : offset = %+9.3f us, frequency = %llu Hz\n", uSecond, GetTscOffsetFromHiResInMicroseconds(), static_cast<unsigned long long>(GetTscFrequency()));
+		std::fflush(stdout);
+		Sleep(GetFastMonoClock() + 1000);
+	}
+}
+
+HARNESS_BENCH(TscClockCallCostUnderContention){
+	// 所有线程同时读取时钟，校准参数是共享的。单位是纳秒每次调用，按墙上时间计算，即每个线程看到的开销。
+	constexpr std::uint64_t kIterations = 5000000;
+	static constexpr unsigned kThreadCounts[] = { 1, 2, 4, 8, 16 };
+	std::printf("  threads | GetTscMonoClock() | GetTscMonoClockOrdered() | GetHiResMonoClock()\n");
+	for(const auto uThreads : kThreadCounts){
+		double adTotals[3] = { };
+		for(unsigned uKind = 0; uKind < 3; ++uKind){
+			const auto dTotal = Harness::RunInThreads(uThreads, [&](unsigned){
+				for(std::uint64_t u64Index = 0; u64Index < kIterations; ++u64Index){
+					switch(uKind){
+					case 0:
+						Harness::DoNotOptimize(GetTscMonoClock());
+						break;
+					case 1:
+						Harness::DoNotOptimize(GetTscMonoClockOrdered());
+						break;
+					default:
+						Harness::DoNotOptimize(GetHiResMonoClock());
+						break;
+					}
+				}
+			});
+			adTotals[uKind] = dTotal / static_cast<double>(kIterations);
+		}
+		std::printf("  %7u | %17.2f | %24.2f | %19.2f\n", uThreads, adTotals[0], adTotals[1], adTotals[2]);
+		std::fflush(stdout);
+	}
+}
@@ -0,0 +1,209 @@
+#include "Harness.hpp"
+#include <MCF/Thread/Mutex.hpp>
+#include <MCF/Thread/ConditionVariable.hpp>
+
+using namespace MCF;
+
+namespace {
+
+struct WaiterGroup {
+	Mutex vMutex;
+	unsigned uWaiting = 0;
+	unsigned uGeneration = 0;
+};
+
+// 所有等待者都开始等待之后才广播，否则它们会错过这一轮。
+void WaitUntilAllWaiting(WaiterGroup &vGroup, unsigned uCount){
+	for(;;){
+		{
+			const auto vLock = vGroup.vMutex.GetLock();
+			if(vGroup.uWaiting == uCount){
+				return;
+			}
+		}
+		YieldThread();
+	}
+}
+
+}
+
+HARNESS_TEST(ConditionVariableBroadcastWakesEveryWaiter){
+	// 两组线程使用不同的互斥锁等待同一个条件变量，所以广播时会形成两条链。每组中有一半线程使用很短的超时反复等待。
+	constexpr unsigned kWaitersPerGroup = 8;
+	constexpr unsigned kRounds = 2000;
+	ConditionVariable vCond;
+	WaiterGroup avGroups[2];
+	Atomic<unsigned> auWoken[2];
+	Harness::RunInThreads(kWaitersPerGroup * 2 + 1, [&](unsigned uIndex){
+		if(uIndex == 0){
+			for(unsigned uRound = 0; uRound < kRounds; ++uRound){
+				for(auto &vGroup : avGroups){
+					WaitUntilAllWaiting(vGroup, kWaitersPerGroup);
+				}
+				for(auto &vGroup : avGroups){
+					const auto vLock = vGroup.vMutex.GetLock();
+					vGroup.uWaiting = 0;
+					++vGroup.uGeneration;
+				}
+				HARNESS_CHECK(vCond.Broadcast() <= kWaitersPerGroup * 2);
+			}
+			return;
+		}
+		const auto uGroup = uIndex % 2;
+		auto &vGroup = avGroups[uGroup];
+		const bool bTimed = (uIndex / 2) % 2 == 0;
+		for(unsigned uRound = 0; uRound < kRounds; ++uRound){
+			auto vLock = vGroup.vMutex.GetLock();
+			const auto uGeneration = vGroup.uGeneration;
+			++vGroup.uWaiting;
+			while(vGroup.uGeneration == uGeneration){
+				if(bTimed){
+					vCond.Wait(vLock, GetFastMonoClock() + 1);
+				} else {
+					vCond.Wait(vLock);
+				}
+				HARNESS_CHECK(vLock.GetMutex() == &(vGroup.vMutex));
+			}
+			auWoken[uGroup].FetchAdd(1, kAtomicRelaxed);
+		}
+	});
+	HARNESS_CHECK(auWoken[0].Load(kAtomicRelaxed) == kWaitersPerGroup * kRounds);
+	HARNESS_CHECK(auWoken[1].Load(kAtomicRelaxed) == kWaitersPerGroup * kRounds);
+}
+
+HARNESS_TEST(ConditionVariableTimedWaitersDoNotLoseSignals){
+	// 每生产一个元素只唤醒一个消费者。如果超时的等待者吞掉了信号，剩下的元素就会一直没人处理，直到生产者结束后的广播。
+	constexpr unsigned kConsumers = 8;
+	constexpr unsigned kItems = 200000;
+	Mutex vMutex;
+	ConditionVariable vCond;
+	unsigned uQueued = 0;
+	unsigned uProduced = 0;
+	bool bDone = false;
+	Atomic<unsigned> uConsumed(0);
+	Atomic<unsigned> uTimeouts(0);
+	Harness::RunInThreads(kConsumers + 1, [&](unsigned uIndex){
+		if(uIndex == 0){
+			while(uProduced < kItems){
+				{
+					const auto vLock = vMutex.GetLock();
+					++uQueued;
+					++uProduced;
+				}
+				vCond.Signal();
+			}
+			{
+				const auto vLock = vMutex.GetLock();
+				bDone = true;
+			}
+			vCond.Broadcast();
+			return;
+		}
+		auto vLock = vMutex.GetLock();
+		for(;;){
+			if(uQueued != 0){
+				--uQueued;
+				uConsumed.FetchAdd(1, kAtomicRelaxed);
+				continue;
+			}
+			if(bDone){
+				break;
+			}
+			if(!vCond.Wait(vLock, GetFastMonoClock() + 1)){
+				uTimeouts.FetchAdd(1, kAtomicRelaxed);
+			}
+		}
+	});
+	HARNESS_CHECK(uConsumed.Load(kAtomicRelaxed) == kItems);
+	std::printf("  %u timed-out waits\n", uTimeouts.Load(kAtomicRelaxed));
+}
+
+HARNESS_TEST(ConditionVariableSignalCountsWaiters){
+	constexpr unsigned kWaiters = 6;
+	WaiterGroup vGroup;
+	ConditionVariable vCond;
+	Atomic<unsigned> uWoken(0);
+	HARNESS_CHECK(vCond.Signal(3) == 0);
+	HARNESS_CHECK(vCond.Broadcast() == 0);
+	Harness::RunInThreads(kWaiters + 1, [&](unsigned uIndex){
+		if(uIndex == 0){
+			WaitUntilAllWaiting(vGroup, kWaiters);
+			{
+				const auto vLock = vGroup.vMutex.GetLock();
+				vGroup.uGeneration = 1;
+			}
+			// 所有等待者都已经在等待了，所以信号一定会被计入。
+			HARNESS_CHECK(vCond.Signal(2) == 2);
+			HARNESS_CHECK(vCond.Broadcast() == kWaiters - 2);
+			HARNESS_CHECK(vCond.Broadcast() == 0);
+			return;
+		}
+		auto vLock = vGroup.vMutex.GetLock();
+		++vGroup.uWaiting;
+		do {
+			vCond.Wait(vLock);
+		} while(vGroup.uGeneration == 0);
+		uWoken.FetchAdd(1, kAtomicRelaxed);
+	});
+	HARNESS_CHECK(uWoken.Load(kAtomicRelaxed) == kWaiters);
+}
+
+HARNESS_BENCH(ConditionVariableWakeToRunLatency){
+	// 从通知到每个等待者重新获得互斥锁的时间，单位是微秒。每个等待者在锁内工作 1 微秒。
+	// Signal(SIZE_MAX) 同时唤醒所有等待者，相当于原来的广播；Broadcast() 把它们串起来逐个唤醒。
+	constexpr unsigned kRounds = 200;
+	static constexpr unsigned kWaiterCounts[] = { 1, 2, 4, 8, 16, 32, 64 };
+	std::printf("  waiters | Signal(SIZE_MAX) mean / last | Broadcast() mean / last\n");
+	for(const auto uWaiters : kWaiterCounts){
+		double adMean[2], adLast[2];
+		for(unsigned uMode = 0; uMode < 2; ++uMode){
+			WaiterGroup vGroup;
+			ConditionVariable vCond;
+			double dNotifiedAt = 0;
+			double dLatencySum = 0;
+			double adRoundLast[kRounds] = { };
+			Harness::RunInThreads(uWaiters + 1, [&](unsigned uIndex){
+				if(uIndex == 0){
+					for(unsigned uRound = 0; uRound < kRounds; ++uRound){
+						WaitUntilAllWaiting(vGroup, uWaiters);
+						{
+							const auto vLock = vGroup.vMutex.GetLock();
+							vGroup.uWaiting = 0;
+							++vGroup.uGeneration;
+							dNotifiedAt = GetHiResMonoClock();
+						}
+						if(uMode == 0){
+							vCond.Signal(SIZE_MAX);
+						} else {
+							vCond.Broadcast();
+						}
+					}
+					return;
+				}
+				for(unsigned uRound = 0; uRound < kRounds; ++uRound){
+					auto vLock = vGroup.vMutex.GetLock();
+					const auto uGeneration = vGroup.uGeneration;
+					++vGroup.uWaiting;
+					while(vGroup.uGeneration == uGeneration){
+						vCond.Wait(vLock);
+					}
+					const auto dLatency = (GetHiResMonoClock() - dNotifiedAt) * 1000;
+					dLatencySum += dLatency;
+					if(adRoundLast[uRound] < dLatency){
+						adRoundLast[uRound] = dLatency;
+					}
+				// 在持有互斥锁时做一点工作，让线程们确实需要争夺锁。
+				Harness::SpinFor(1);
+				}
+			});
+			adMean[uMode] = dLatencySum / (uWaiters * kRounds);
+			double dLastSum = 0;
+			for(const auto dLast : adRoundLast){
+				dLastSum += dLast;
+			}
+			adLast[uMode] = dLastSum / kRounds;
+		}
+		std::printf("  %7u | %12.2f / %11.2f | %11.2f / %11.2f\n", uWaiters, adMean[0], adLast[0], adMean[1], adLast[1]);
+		std::fflush(stdout);
+	}
+}
@@ -0,0 +1,317 @@
+#include "Harness.hpp"
+#include <MCF/Thread/FiberScheduler.hpp>
+#include <MCF/Thread/FiberMutex.hpp>
+#include <MCF/Thread/FiberConditionVariable.hpp>
+#include <MCF/Thread/Mutex.hpp>
+#include <MCF/Thread/ConditionVariable.hpp>
+
+using namespace MCF;
+
+namespace {
+
+// 让出执行权，直到条件成立。只能在纤程中使用。
+template<typename PredicateT>
+void YieldUntil(const PredicateT &fnPredicate){
+	while(!fnPredicate()){
+		FiberScheduler::YieldFiber();
+	}
+}
+
+// 同时存在的纤程数目。每个纤程的栈都要占用 64KiB 的地址空间，32 位的进程放不下太多。
+#ifdef _WIN64
+constexpr unsigned kSessionCount = 100000;
+#else
+constexpr unsigned kSessionCount = 10000;
+#endif
+
+}
+
+HARNESS_TEST(FiberMutexExcludesOtherFibers){
+	// 纤程在临界区中让出执行权，所以锁的所有者经常被挂起，其他纤程必须被挂起等待，而不是进入临界区。
+	constexpr unsigned kFibers = 1000;
+	constexpr unsigned kIncrements = 100;
+	FiberMutex vMutex;
+	unsigned uInside = 0;
+	std::uint64_t u64Counter = 0;
+	HARNESS_CHECK(!FiberScheduler::GetCurrentFiber());
+	{
+		FiberScheduler vScheduler(4);
+		for(unsigned uFiber = 0; uFiber < kFibers; ++uFiber){
+			vScheduler.Spawn([&]{
+				HARNESS_CHECK(FiberScheduler::GetCurrentFiber());
+				for(unsigned uIncrement = 0; uIncrement < kIncrements; ++uIncrement){
+					const auto vLock = vMutex.GetLock();
+					HARNESS_CHECK(++uInside == 1);
+					const auto u64Old = u64Counter;
+					FiberScheduler::YieldFiber();
+					u64Counter = u64Old + 1;
+					HARNESS_CHECK(--uInside == 0);
+				}
+			});
+		}
+		// 析构函数等待所有纤程结束。
+	}
+	HARNESS_CHECK(u64Counter == kFibers * kIncrements);
+}
+
+HARNESS_TEST(FiberMutexHandsOffInArrivalOrder){
+	// 只有一个工作线程，就绪队列是先进先出的，所以纤程开始等待的顺序是确定的。
+	constexpr unsigned kWaiters = 4;
+	FiberMutex vMutex;
+	Atomic<unsigned> uArrived(0);
+	unsigned auOrder[kWaiters] = { };
+	unsigned uNext = 0;
+	bool bOwnerDone = false;
+	{
+		FiberScheduler vScheduler(1);
+		vScheduler.Spawn([&]{
+			vMutex.Lock();
+			YieldUntil([&]{ return uArrived.Load(kAtomicAcquire) == kWaiters; });
+			// 等待者已经排队，但是锁仍然属于当前纤程。
+			FiberScheduler::YieldFiber();
+			HARNESS_CHECK(uNext == 0);
+			vMutex.Unlock();
+			// 所有权已经直接交给了第一个等待者，即使它还没有开始运行。
+			HARNESS_CHECK(!vMutex.Try());
+			bOwnerDone = true;
+		});
+		for(unsigned uIndex = 0; uIndex < kWaiters; ++uIndex){
+			vScheduler.Spawn([&, uIndex]{
+				uArrived.Increment(kAtomicRelease);
+				vMutex.Lock();
+				HARNESS_CHECK(bOwnerDone);
+				auOrder[uNext++] = uIndex;
+				FiberScheduler::YieldFiber();
+				vMutex.Unlock();
+			});
+		}
+	}
+	for(unsigned uIndex = 0; uIndex < kWaiters; ++uIndex){
+		HARNESS_CHECK(auOrder[uIndex] == uIndex);
+	}
+	HARNESS_CHECK(vMutex.Try());
+}
+
+HARNESS_TEST(FiberMutexTimedTryYieldsInsteadOfBlocking){
+	// 只有一个工作线程。如果等待锁时阻塞了线程，持有锁的纤程和另一个纤程都无法运行。
+	FiberMutex vMutex;
+	Atomic<bool> bHolding(false), bRelease(false);
+	Atomic<unsigned> uProgress(0);
+	{
+		FiberScheduler vScheduler(1);
+		vScheduler.Spawn([&]{
+			vMutex.Lock();
+			bHolding.Store(true, kAtomicRelease);
+			YieldUntil([&]{ return bRelease.Load(kAtomicAcquire); });
+			vMutex.Unlock();
+		});
+		vScheduler.Spawn([&]{
+			YieldUntil([&]{ return bHolding.Load(kAtomicAcquire); });
+			const auto u64Begin = GetFastMonoClock();
+			HARNESS_CHECK(!vMutex.Try(u64Begin + 50));
+			HARNESS_CHECK(GetFastMonoClock() >= u64Begin + 50);
+			// 在等待期间，另一个纤程一直在运行。
+			HARNESS_CHECK(uProgress.Load(kAtomicAcquire) > 0);
+			bRelease.Store(true, kAtomicRelease);
+			HARNESS_CHECK(vMutex.Try(GetFastMonoClock() + 10000));
+			vMutex.Unlock();
+		});
+		vScheduler.Spawn([&]{
+			while(!bRelease.Load(kAtomicAcquire)){
+				uProgress.Increment(kAtomicRelease);
+				FiberScheduler::YieldFiber();
+			}
+		});
+	}
+}
+
+HARNESS_TEST(FiberConditionVariableSignalsAndBroadcasts){
+	constexpr unsigned kWaiters = 3;
+	FiberMutex vMutex;
+	FiberConditionVariable vCond;
+	unsigned uTickets = 0, uWoken = 0, uWaiting = 0;
+	{
+		FiberScheduler vScheduler(1);
+		for(unsigned uIndex = 0; uIndex < kWaiters; ++uIndex){
+			vScheduler.Spawn([&]{
+				auto vLock = vMutex.GetLock();
+				++uWaiting;
+				while(uTickets == 0){
+					vCond.Wait(vLock);
+				}
+				--uTickets;
+				++uWoken;
+			});
+		}
+		vScheduler.Spawn([&]{
+			YieldUntil([&]{ const auto vLock = vMutex.GetLock(); return uWaiting == kWaiters; });
+			{
+				const auto vLock = vMutex.GetLock();
+				uTickets = kWaiters;
+			}
+			// 返回值是被唤醒的纤程数目。
+			HARNESS_CHECK(vCond.Signal() == 1);
+			YieldUntil([&]{ const auto vLock = vMutex.GetLock(); return uWoken == 1; });
+			HARNESS_CHECK(vCond.Broadcast() == kWaiters - 1);
+			HARNESS_CHECK(vCond.Signal() == 0);
+			HARNESS_CHECK(vCond.Broadcast() == 0);
+		});
+	}
+	HARNESS_CHECK(uWoken == kWaiters);
+	HARNESS_CHECK(uTickets == 0);
+}
+
+HARNESS_TEST(FiberConditionVariableBoundedQueue){
+	// 生产者和消费者通过一个容量很小的队列交换数据，两边都经常需要等待。
+	// 纤程的数目远多于工作线程，如果等待阻塞了线程就会死锁。
+	constexpr unsigned kProducers = 16;
+	constexpr unsigned kConsumers = 16;
+	constexpr unsigned kItemsPerProducer = 5000;
+	constexpr unsigned kCapacity = 4;
+	static constexpr std::size_t kWorkerCounts[] = { 1, 4 };
+	for(const auto uWorkers : kWorkerCounts){
+		FiberMutex vMutex;
+		FiberConditionVariable vNotEmpty, vNotFull;
+		std::uint64_t au64Ring[kCapacity];
+		unsigned uHead = 0, uCount = 0, uProducersLeft = kProducers;
+		Atomic<std::uint64_t> u64Sum(0);
+		{
+			FiberScheduler vScheduler(uWorkers);
+			for(unsigned uIndex = 0; uIndex < kConsumers; ++uIndex){
+				vScheduler.Spawn([&]{
+					auto vLock = vMutex.GetLock();
+					for(;;){
+						while((uCount == 0) && (uProducersLeft != 0)){
+							vNotEmpty.Wait(vLock);
+						}
+						if(uCount == 0){
+							break;
+						}
+						const auto u64Item = au64Ring[uHead];
+						uHead = (uHead + 1) % kCapacity;
+						--uCount;
+						vNotFull.Signal();
+						u64Sum.FetchAdd(u64Item, kAtomicRelaxed);
+					}
+				});
+			}
+			for(unsigned uIndex = 0; uIndex < kProducers; ++uIndex){
+				vScheduler.Spawn([&, uIndex]{
+					auto vLock = vMutex.GetLock();
+					for(unsigned uItem = 0; uItem < kItemsPerProducer; ++uItem){
+						while(uCount == kCapacity){
+							vNotFull.Wait(vLock);
+						}
+						au64Ring[(uHead + uCount) % kCapacity] = uIndex * kItemsPerProducer + uItem;
+						++uCount;
+						vNotEmpty.Signal();
+					}
+					if(--uProducersLeft == 0){
+						vNotEmpty.Broadcast();
+					}
+				});
+			}
+		}
+		constexpr std::uint64_t kItems = kProducers * kItemsPerProducer;
+		HARNESS_CHECK(u64Sum.Load(kAtomicRelaxed) == kItems * (kItems - 1) / 2);
+	}
+}
+
+HARNESS_BENCH(FiberSwitchingAndSessions){
+	// 单位是纳秒。
+	{
+		// 两个纤程在一个工作线程上轮流让出执行权，测量一次切换的开销。
+		constexpr unsigned kYields = 1000000;
+		double dTotal;
+		{
+			FiberScheduler vScheduler(1);
+			const auto dBegin = GetHiResMonoClock();
+			for(unsigned uIndex = 0; uIndex < 2; ++uIndex){
+				vScheduler.Spawn([&]{
+					for(unsigned uYield = 0; uYield < kYields; ++uYield){
+						FiberScheduler::YieldFiber();
+					}
+				});
+			}
+			while(vScheduler.GetFiberCount() != 0){
+				Sleep(GetFastMonoClock() + 1);
+			}
+			dTotal = (GetHiResMonoClock() - dBegin) * 1.0e6;
+		}
+		std::printf("  YieldFiber(), one worker                        : %10.2f ns per yield\n", dTotal / (2.0 * kYields));
+	}
+	{
+		// 两方轮流修改一个变量并唤醒对方，和 FutexPingPong 中的协议相同。
+		constexpr unsigned kRoundTrips = 200000;
+		static constexpr std::size_t kWorkerCounts[] = { 1, 2 };
+		for(const auto uWorkers : kWorkerCounts){
+			FiberMutex vMutex;
+			FiberConditionVariable vCond;
+			unsigned uTurn = 0;
+			const auto dBegin = GetHiResMonoClock();
+			{
+				FiberScheduler vScheduler(uWorkers);
+				for(unsigned uIndex = 0; uIndex < 2; ++uIndex){
+					vScheduler.Spawn([&, uIndex]{
+						for(unsigned uRound = 0; uRound < kRoundTrips; ++uRound){
+							auto vLock = vMutex.GetLock();
+							while(uTurn != uIndex){
+								vCond.Wait(vLock);
+							}
+							uTurn = 1 - uIndex;
+							vCond.Signal();
+						}
+					});
+				}
+			}
+			const auto dTotal = (GetHiResMonoClock() - dBegin) * 1.0e6;
+			std::printf("  FiberMutex + FiberConditionVariable, %zu worker(s) : %10.2f ns per round trip\n", uWorkers, dTotal / kRoundTrips);
+		}
+		Mutex vMutex;
+		ConditionVariable vCond;
+		unsigned uTurn = 0;
+		const auto dTotal = Harness::RunInThreads(2, [&](unsigned uIndex){
+			for(unsigned uRound = 0; uRound < kRoundTrips; ++uRound){
+				auto vLock = vMutex.GetLock();
+				while(uTurn != uIndex){
+					vCond.Wait(vLock);
+				}
+				uTurn = 1 - uIndex;
+				vCond.Signal();
+			}
+		});
+		std::printf("  Mutex + ConditionVariable, two threads          : %10.2f ns per round trip\n", dTotal / kRoundTrips);
+	}
+	{
+		// 每个会话是一个纤程，先等待一个信号，然后结束。测量从创建到全部结束的时间，由所有会话平摊。
+		FiberMutex vMutex;
+		FiberConditionVariable vCond;
+		bool bGo = false;
+		Atomic<unsigned> uWaiting(0);
+		const auto dBegin = GetHiResMonoClock();
+		{
+			FiberScheduler vScheduler;
+			for(unsigned uIndex = 0; uIndex < kSessionCount; ++uIndex){
+				vScheduler.Spawn([&]{
+					auto vLock = vMutex.GetLock();
+					uWaiting.Increment(kAtomicRelaxed);
+					while(!bGo){
+						vCond.Wait(vLock);
+					}
+				});
+			}
+			while(uWaiting.Load(kAtomicRelaxed) != kSessionCount){
+				Sleep(GetFastMonoClock() + 1);
+			}
+			vScheduler.Spawn([&]{
+				{
+					const auto vLock = vMutex.GetLock();
+					bGo = true;
+				}
+				vCond.Broadcast();
+			});
+		}
+		const auto dTotal = (GetHiResMonoClock() - dBegin) * 1.0e6;
+		std::printf("  %u concurrent fiber sessions                : %10.2f ns per session\n", kSessionCount, dTotal / kSessionCount);
+	}
+}
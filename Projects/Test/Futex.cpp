@@ -0,0 +1,170 @@
+#include "Harness.hpp"
+#include <MCF/Thread/Mutex.hpp>
+#include <MCF/Thread/ConditionVariable.hpp>
+#include <MCFCRT/env/futex.h>
+
+using namespace MCF;
+
+namespace {
+
+// 等待 vWord 的值不再是 u32Undesired。
+bool WaitWhileEquals(volatile std::uint32_t &vWord, std::uint32_t u32Undesired, std::uint64_t u64UntilFastMonoClock){
+	return ::_MCFCRT_WaitForAddress(&vWord, &u32Undesired, sizeof(vWord), u64UntilFastMonoClock);
+}
+void WaitWhileEquals(volatile std::uint32_t &vWord, std::uint32_t u32Undesired){
+	::_MCFCRT_WaitForAddressForever(&vWord, &u32Undesired, sizeof(vWord));
+}
+
+}
+
+HARNESS_TEST(FutexReturnsImmediatelyOnMismatch){
+	volatile std::uint8_t u8Byte = 1;
+	volatile std::uint16_t u16Word = 2;
+	volatile std::uint32_t u32Word = 3;
+	volatile std::uint64_t u64Word = 4;
+	const std::uint64_t u64Other = 5;
+	// 即使超时时间已经过去，值不匹配时也返回 true。
+	HARNESS_CHECK(::_MCFCRT_WaitForAddress(&u8Byte, &u64Other, 1, 0));
+	HARNESS_CHECK(::_MCFCRT_WaitForAddress(&u16Word, &u64Other, 2, 0));
+	HARNESS_CHECK(::_MCFCRT_WaitForAddress(&u32Word, &u64Other, 4, 0));
+	HARNESS_CHECK(::_MCFCRT_WaitForAddress(&u64Word, &u64Other, 8, 0));
+	// 只比较指定大小的字节。
+	const std::uint16_t u16Undesired = 0x0301;
+	HARNESS_CHECK(!::_MCFCRT_WaitForAddress(&u8Byte, &u16Undesired, 1, 0));
+	HARNESS_CHECK(::_MCFCRT_WakeByAddressSingle(&u32Word) == 0);
+	HARNESS_CHECK(::_MCFCRT_WakeByAddressAll(&u32Word) == 0);
+}
+
+HARNESS_TEST(FutexTimesOut){
+	volatile std::uint32_t u32Word = 0;
+	// 超时时间已经过去时立即返回 false。
+	HARNESS_CHECK(!WaitWhileEquals(u32Word, 0, 0));
+	HARNESS_CHECK(!WaitWhileEquals(u32Word, 0, GetFastMonoClock()));
+
+	static constexpr std::uint64_t kTimeouts[] = { 1, 20, 100, 300 };
+	for(const auto u64Timeout : kTimeouts){
+		const auto u64Begin = GetFastMonoClock();
+		HARNESS_CHECK(!WaitWhileEquals(u32Word, 0, u64Begin + u64Timeout));
+		const auto u64Elapsed = GetFastMonoClock() - u64Begin;
+		std::printf("  timeout = %3llu ms, elapsed = %3llu ms\n", static_cast<unsigned long long>(u64Timeout), static_cast<unsigned long long>(u64Elapsed));
+		// 快速时钟的精度大约是一个时间片。
+		HARNESS_CHECK(u64Elapsed + 20 >= u64Timeout);
+		HARNESS_CHECK(u64Elapsed < u64Timeout + 1000);
+	}
+	// 超时的等待者已经离开，不会被计入唤醒数。
+	HARNESS_CHECK(::_MCFCRT_WakeByAddressAll(&u32Word) == 0);
+}
+
+HARNESS_TEST(FutexWakesInOrderAndOnlyTheAddress){
+	// 等待者依次开始等待，间隔足够长，所以唤醒的顺序就是开始等待的顺序。
+	constexpr unsigned kWaiters = 4;
+	static volatile std::uint32_t s_au32Words[2];
+	Atomic<unsigned> uNextWoken(0);
+	unsigned auWokenOrder[kWaiters] = { };
+	Atomic<bool> bOtherWoken(false);
+
+	const auto fnOther = [&]{
+		HARNESS_CHECK(WaitWhileEquals(s_au32Words[1], 0, GetFastMonoClock() + 10000));
+		bOtherWoken.Store(true, kAtomicRelease);
+	};
+	const auto pOther = MakeThread(fnOther);
+	Vector<IntrusivePtr<Thread>> vecWaiters;
+	for(unsigned uIndex = 0; uIndex < kWaiters; ++uIndex){
+		const auto fnWaiter = [&, uIndex]{
+			HARNESS_CHECK(WaitWhileEquals(s_au32Words[0], 0, GetFastMonoClock() + 10000));
+			auWokenOrder[uNextWoken.FetchAdd(1, kAtomicAcqRel)] = uIndex;
+		};
+		vecWaiters.Push(MakeThread(fnWaiter));
+		Sleep(GetFastMonoClock() + 50);
+	}
+
+	for(unsigned uIndex = 0; uIndex < kWaiters - 1; ++uIndex){
+		HARNESS_CHECK(::_MCFCRT_WakeByAddressSingle(&s_au32Words[0]) == 1);
+		vecWaiters[uIndex]->Wait();
+		HARNESS_CHECK(uNextWoken.Load(kAtomicAcquire) == uIndex + 1);
+		HARNESS_CHECK(auWokenOrder[uIndex] == uIndex);
+	}
+	// 唤醒另一个地址的等待者之前，它必须一直等待。
+	HARNESS_CHECK(::_MCFCRT_WakeByAddressAll(&s_au32Words[0]) == 1);
+	vecWaiters[kWaiters - 1]->Wait();
+	HARNESS_CHECK(!bOtherWoken.Load(kAtomicAcquire));
+	HARNESS_CHECK(::_MCFCRT_WakeByAddressAll(&s_au32Words[1]) == 1);
+	pOther->Wait();
+	HARNESS_CHECK(bOtherWoken.Load(kAtomicAcquire));
+}
+
+HARNESS_TEST(FutexTimedWaitersAreNotCountedAsWoken){
+	// 值一直不变，所以等待函数返回 true 当且仅当等待者被唤醒。
+	// 如果超时的等待者被计入唤醒数，或者唤醒被超时的等待者吞掉，两边的计数就会不相等。
+	constexpr unsigned kWaiters = 8;
+	constexpr unsigned kWaitsPerThread = 20000;
+	static volatile std::uint32_t s_u32Word;
+	Atomic<std::size_t> uWakeCount(0);
+	Atomic<std::size_t> uWokenCount(0);
+	Atomic<unsigned> uWaitersLeft(kWaiters);
+	Harness::RunInThreads(kWaiters + 1, [&](unsigned uIndex){
+		if(uIndex == 0){
+			// 每唤醒八次单个等待者就唤醒一次所有等待者。
+			for(unsigned uRound = 0; uWaitersLeft.Load(kAtomicAcquire) != 0; ++uRound){
+				if(uRound % 8 == 0){
+					uWakeCount.FetchAdd(::_MCFCRT_WakeByAddressAll(&s_u32Word), kAtomicRelaxed);
+				} else {
+					uWakeCount.FetchAdd(::_MCFCRT_WakeByAddressSingle(&s_u32Word), kAtomicRelaxed);
+				}
+			}
+			return;
+		}
+		for(unsigned uWait = 0; uWait < kWaitsPerThread; ++uWait){
+			// 一半的等待者使用已经过去或很短的超时，另一半一直等待。
+			if(uIndex % 2 == 0){
+				if(WaitWhileEquals(s_u32Word, 0, GetFastMonoClock() + uWait % 2)){
+					uWokenCount.FetchAdd(1, kAtomicRelaxed);
+				}
+			} else {
+				WaitWhileEquals(s_u32Word, 0);
+				uWokenCount.FetchAdd(1, kAtomicRelaxed);
+			}
+		}
+		uWaitersLeft.FetchSub(1, kAtomicRelease);
+	});
+	std::printf("  %zu wakeups\n", uWokenCount.Load(kAtomicRelaxed));
+	HARNESS_CHECK(uWakeCount.Load(kAtomicRelaxed) == uWokenCount.Load(kAtomicRelaxed));
+}
+
+HARNESS_BENCH(FutexPingPong){
+	// 两个线程轮流修改一个字并唤醒对方，单位是纳秒每次往返。用互斥锁和条件变量实现同样的协议作为比较。
+	constexpr unsigned kRoundTrips = 200000;
+	{
+		static volatile std::uint32_t s_u32Turn;
+		const auto dTotal = Harness::RunInThreads(2, [&](unsigned uIndex){
+			for(unsigned uRound = 0; uRound < kRoundTrips; ++uRound){
+				while(s_u32Turn != uIndex){
+					WaitWhileEquals(s_u32Turn, 1 - uIndex);
+				}
+				s_u32Turn = 1 - uIndex;
+				::_MCFCRT_WakeByAddressSingle(&s_u32Turn);
+			}
+		});
+		std::printf("  WaitForAddress / WakeByAddressSingle : %8.2f ns\n", dTotal / kRoundTrips);
+	}
+	{
+		Mutex vMutex;
+		ConditionVariable vCond;
+		unsigned uTurn = 0;
+		const auto dTotal = Harness::RunInThreads(2, [&](unsigned uIndex){
+			for(unsigned uRound = 0; uRound < kRoundTrips; ++uRound){
+				auto vLock = vMutex.GetLock();
+				while(uTurn != uIndex){
+					vCond.Wait(vLock);
+				}
+				uTurn = 1 - uIndex;
+				vCond.Signal();
+			}
+		});
+		std::printf("  Mutex + ConditionVariable            : %8.2f ns\n", dTotal / kRoundTrips);
+	}
+	std::printf("  WaitForAddress on mismatch           : %8.2f ns\n", Harness::Measure(10000000, []{
+		static volatile std::uint32_t s_u32Word = 1;
+		Harness::DoNotOptimize(WaitWhileEquals(s_u32Word, 0, 0));
+	}));
+}
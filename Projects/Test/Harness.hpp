@@ -0,0 +1,205 @@
+#ifndef TEST_HARNESS_HPP_
+#define TEST_HARNESS_HPP_
+
+#include <MCF/StdMCF.hpp>
+#include <MCF/Core/Clocks.hpp>
+#include <MCF/Core/Atomic.hpp>
+#include <MCF/Containers/Vector.hpp>
+#include <MCF/Thread/Thread.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+// 每个 .cpp 文件用 HARNESS_TEST() 和 HARNESS_BENCH() 注册用例，由 main.cpp 按命令行参数运行：
+//   Test.exe test          运行所有正确性测试
+//   Test.exe bench         运行所有性能测试
+//   Test.exe <名字>        运行名字以该参数开头的所有用例
+// 正确性测试失败时打印位置并调用 abort()，因此进程的退出码可以直接用于判断结果。
+// 性能测试只打印结果，数值没有统一的单位，每个用例自己说明。
+
+namespace Harness {
+
+enum Kind {
+	kKindTest,
+	kKindBench,
+};
+
+struct Case {
+	Kind eKind;
+	const char *pszName;
+	void (*pfnProc)();
+	const Case *pNext;
+};
+
+inline const Case *g_pFirstCase = nullptr;
+
+class Registrar {
+public:
+	explicit Registrar(Case &vCase) noexcept {
+		vCase.pNext = g_pFirstCase;
+		g_pFirstCase = &vCase;
+	}
+};
+
+[[noreturn]] inline void Fail(const char *pszFile, unsigned long ulLine, const char *pszExpression){
+	std::printf("%s:%lu: 检查失败：%s\n", pszFile, ulLine, pszExpression);
+	std::fflush(stdout);
+	std::abort();
+}
+
+// 防止编译器把被测量的计算优化掉。
+template<typename T>
+inline void DoNotOptimize(const T &vValue) noexcept {
+	__asm__ volatile ("" : : "g"(&vValue) : "memory");
+}
+
+// 忙等待一段时间，单位是微秒，用来模拟一段计算或者在持有锁时做一点工作。
+inline void SpinFor(double dMicroseconds) noexcept {
+	const auto dUntil = MCF::GetHiResMonoClock() + dMicroseconds / 1000;
+	while(MCF::GetHiResMonoClock() < dUntil){
+		__builtin_ia32_pause();
+	}
+}
+
+// 返回 vProc() 每次调用的平均时间，单位是纳秒。
+template<typename ProcT>
+double Measure(std::uint64_t u64Iterations, ProcT &&vProc){
+	const auto dBegin = MCF::GetHiResMonoClock();
+	for(std::uint64_t u64Index = 0; u64Index < u64Iterations; ++u64Index){
+		vProc();
+	}
+	const auto dEnd = MCF::GetHiResMonoClock();
+	return (dEnd - dBegin) * 1.0e6 / static_cast<double>(u64Iterations);
+}
+
+// 在 uThreadCount 个线程中分别调用 vProc(uIndex)，所有线程都就绪之后才同时开始。
+// 返回从开始到所有线程结束经过的时间，单位是纳秒。
+template<typename ProcT>
+double RunInThreads(unsigned uThreadCount, const ProcT &vProc){
+	MCF::Atomic<unsigned> uReady(0);
+	MCF::Atomic<bool> bGo(false);
+	const auto fnThreadProc = [&]{
+		const auto uIndex = uReady.FetchAdd(1, MCF::kAtomicRelaxed);
+		while(!bGo.Load(MCF::kAtomicAcquire)){
+			__builtin_ia32_pause();
+		}
+		vProc(uIndex);
+	};
+	MCF::Vector<MCF::IntrusivePtr<MCF::Thread>> vecThreads;
+	for(unsigned uIndex = 0; uIndex < uThreadCount; ++uIndex){
+		vecThreads.Push(MCF::MakeThread(fnThreadProc));
+	}
+	while(uReady.Load(MCF::kAtomicRelaxed) != uThreadCount){
+		MCF::YieldThread();
+	}
+	const auto dBegin = MCF::GetHiResMonoClock();
+	bGo.Store(true, MCF::kAtomicRelease);
+	for(const auto &pThread : vecThreads){
+		pThread->Wait();
+	}
+	const auto dEnd = MCF::GetHiResMonoClock();
+	return (dEnd - dBegin) * 1.0e6;
+}
+
+// 后面紧跟一个不可访问页的可读写内存。把数据放在 GetEnd() 之前，越界读取就会立即引发访问违例。
+class GuardedPages {
+private:
+	unsigned char *x_pbyBegin;
+	std::size_t x_uSize;
+
+public:
+	explicit GuardedPages(std::size_t uSize){
+		SYSTEM_INFO vSystemInfo;
+		::GetSystemInfo(&vSystemInfo);
+		const std::size_t uPageSize = vSystemInfo.dwPageSize;
+		x_uSize = (uSize + uPageSize - 1) / uPageSize * uPageSize;
+		x_pbyBegin = static_cast<unsigned char *>(::VirtualAlloc(nullptr, x_uSize + uPageSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+		if(!x_pbyBegin){
+			Fail(__FILE__, __LINE__, "VirtualAlloc()");
+		}
+		DWORD dwOldProtect;
+		if(!::VirtualProtect(x_pbyBegin + x_uSize, uPageSize, PAGE_NOACCESS, &dwOldProtect)){
+			Fail(__FILE__, __LINE__, "VirtualProtect()");
+		}
+	}
+	~GuardedPages(){
+		::VirtualFree(x_pbyBegin, 0, MEM_RELEASE);
+	}
+
+	GuardedPages(const GuardedPages &) = delete;
+	GuardedPages &operator=(const GuardedPages &) = delete;
+
+public:
+	unsigned char *GetBegin() const noexcept {
+		return x_pbyBegin;
+	}
+	unsigned char *GetEnd() const noexcept {
+		return x_pbyBegin + x_uSize;
+	}
+	std::size_t GetSize() const noexcept {
+		return x_uSize;
+	}
+};
+
+// 名字是 ASCII 字符串，所以可以逐个字符比较。
+inline bool MatchesPrefix(const char *pszName, const wchar_t *pwszPrefix) noexcept {
+	for(;;){
+		if(*pwszPrefix == 0){
+			return true;
+		}
+		if(static_cast<wchar_t>(static_cast<unsigned char>(*pszName)) != *pwszPrefix){
+			return false;
+		}
+		++pszName;
+		++pwszPrefix;
+	}
+}
+
+inline unsigned RunCases(const wchar_t *pwszFilter){
+	bool bAll = false, bKindOnly = false;
+	Kind eKind = kKindTest;
+	if(MatchesPrefix("all", pwszFilter) && (pwszFilter[3] == 0)){
+		bAll = true;
+	} else if(MatchesPrefix("test", pwszFilter) && (pwszFilter[4] == 0)){
+		bKindOnly = true;
+		eKind = kKindTest;
+	} else if(MatchesPrefix("bench", pwszFilter) && (pwszFilter[5] == 0)){
+		bKindOnly = true;
+		eKind = kKindBench;
+	}
+	unsigned uCount = 0;
+	for(auto pCase = g_pFirstCase; pCase; pCase = pCase->pNext){
+		if(bKindOnly ? (pCase->eKind != eKind) : (!bAll && !MatchesPrefix(pCase->pszName, pwszFilter))){
+			continue;
+		}
+		std::printf("[ %s ] %s\n", (pCase->eKind == kKindTest) ? "TEST " : "BENCH", pCase->pszName);
+		std::fflush(stdout);
+		(*(pCase->pfnProc))();
+		++uCount;
+	}
+	if(uCount == 0){
+		std::printf("没有匹配的用例。\n");
+		return 1;
+	}
+	std::printf("运行了 %u 个用例。\n", uCount);
+	return 0;
+}
+
+}
+
+#define HARNESS_CHECK(expr_)	\
+	((expr_) ? (void)0 : ::Harness::Fail(__FILE__, __LINE__, #expr_))
+
+#define HARNESS_CASE_(kind_, name_)	\
+	static void name_();	\
+	namespace {	\
+		::Harness::Case g_vCase_##name_ = { (kind_), #name_, &(name_), nullptr };	\
+		const ::Harness::Registrar g_vRegistrar_##name_(g_vCase_##name_);	\
+	}	\
+	static void name_()
+
+#define HARNESS_TEST(name_)     HARNESS_CASE_(::Harness::kKindTest, name_)
+#define HARNESS_BENCH(name_)    HARNESS_CASE_(::Harness::kKindBench, name_)
+
+#endif
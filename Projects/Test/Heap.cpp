@@ -0,0 +1,316 @@
+#include "Harness.hpp"
+#include <MCFCRT/env/heap.h>
+#include <cstring>
+
+using namespace MCF;
+
+namespace {
+
+// 覆盖所有小块大小类和它们的边界，以及直接映射的大块。
+constexpr std::size_t kSizes[] = { 0, 1, 7, 8, 15, 16, 17, 31, 32, 33, 48, 63, 64, 65, 100, 127, 128, 129, 255, 256, 257, 500, 1000, 1024, 1025, 2048, 4000, 4096, 4097, 8191, 8192, 8193, 20000, 65536, 1000000 };
+
+unsigned char GetPattern(std::size_t uSize, std::size_t uIndex){
+	return static_cast<unsigned char>(uSize * 31 + uIndex * 7 + 1);
+}
+
+void FillBlock(void *pBlock, std::size_t uSize){
+	const auto pbyBlock = static_cast<unsigned char *>(pBlock);
+	for(std::size_t uIndex = 0; uIndex < uSize; ++uIndex){
+		pbyBlock[uIndex] = GetPattern(uSize, uIndex);
+	}
+}
+bool CheckBlock(const void *pBlock, std::size_t uSize){
+	const auto pbyBlock = static_cast<const unsigned char *>(pBlock);
+	for(std::size_t uIndex = 0; uIndex < uSize; ++uIndex){
+		if(pbyBlock[uIndex] != GetPattern(uSize, uIndex)){
+			return false;
+		}
+	}
+	return true;
+}
+
+// 原来的实现把所有请求都转发给进程堆，这里用它作为比较的基准。
+struct ProcessHeap {
+	static void *Alloc(std::size_t uSize){
+		return ::HeapAlloc(::GetProcessHeap(), 0, uSize);
+	}
+	static void Free(void *pBlock){
+		::HeapFree(::GetProcessHeap(), 0, pBlock);
+	}
+};
+struct CrtHeap {
+	static void *Alloc(std::size_t uSize){
+		return ::_MCFCRT_malloc(uSize);
+	}
+	static void Free(void *pBlock){
+		::_MCFCRT_free(pBlock);
+	}
+};
+
+// 每个线程反复分配和释放一组大小在 16 到 uSizeMax 字节之间的内存块，返回每对 malloc()/free() 的平均时间，单位是纳秒。
+template<typename HeapT>
+double MeasureLocalPairs(unsigned uThreadCount, std::size_t uSizeMax){
+	constexpr unsigned kSlots = 256;
+	constexpr unsigned kIterations = 400000;
+	const auto dTotal = Harness::RunInThreads(uThreadCount, [&](unsigned uIndex){
+		void *apBlocks[kSlots] = { };
+		std::uint32_t u32Seed = uIndex * 2654435761u + 1;
+		for(unsigned uIteration = 0; uIteration < kIterations; ++uIteration){
+			u32Seed = u32Seed * 1103515245u + 12345u;
+			auto &pBlock = apBlocks[(u32Seed >> 8) % kSlots];
+			if(pBlock){
+				HeapT::Free(pBlock);
+			}
+			pBlock = HeapT::Alloc(16 + (u32Seed >> 16) % (uSizeMax - 15));
+		}
+		for(const auto pBlock : apBlocks){
+			if(pBlock){
+				HeapT::Free(pBlock);
+			}
+		}
+	});
+	return dTotal / (static_cast<double>(kIterations) * uThreadCount);
+}
+
+// 线程两两配对，一方分配，另一方释放，通过单生产者单消费者的环形缓冲区传递内存块。
+// 消费者取走每个内存块之后都会清空槽位，所以每次测量结束时所有槽位都是空的。
+constexpr unsigned kRingSize = 1024;
+constexpr unsigned kMaxPairCount = 8;
+
+struct Ring {
+	Atomic<void *> apSlots[kRingSize];
+};
+
+Ring g_avRings[kMaxPairCount];
+
+template<typename HeapT>
+double MeasureCrossThreadPairs(unsigned uPairCount){
+	constexpr unsigned kIterations = 400000;
+	HARNESS_CHECK(uPairCount <= kMaxPairCount);
+	const auto dTotal = Harness::RunInThreads(uPairCount * 2, [&](unsigned uIndex){
+		auto &vRing = g_avRings[uIndex / 2];
+		if(uIndex % 2 == 0){
+			for(unsigned uIteration = 0; uIteration < kIterations; ++uIteration){
+				auto &pSlot = vRing.apSlots[uIteration % kRingSize];
+				const auto pBlock = HeapT::Alloc(16 + uIteration % 240);
+				while(pSlot.Load(kAtomicAcquire)){
+					__builtin_ia32_pause();
+				}
+				pSlot.Store(pBlock, kAtomicRelease);
+			}
+		} else {
+			for(unsigned uIteration = 0; uIteration < kIterations; ++uIteration){
+				auto &pSlot = vRing.apSlots[uIteration % kRingSize];
+				void *pBlock;
+				while(!(pBlock = pSlot.Load(kAtomicAcquire))){
+					__builtin_ia32_pause();
+				}
+				pSlot.Store(nullptr, kAtomicRelaxed);
+				HeapT::Free(pBlock);
+			}
+		}
+	});
+	return dTotal / (static_cast<double>(kIterations) * uPairCount);
+}
+
+// 记录某个内存块被重新分配的次数，以及其中有多少次被移动了。
+struct ReallocCounters {
+	const void *pTracked;
+	std::size_t uInPlace;
+	std::size_t uMoved;
+};
+
+ReallocCounters g_vReallocCounters;
+
+void CountReallocations(void *pBlockNew, std::size_t /* uSizeNew */, void *pBlockOld, const void * /* pRetAddrOuter */, const void * /* pRetAddrInner */){
+	if(!pBlockNew || !pBlockOld || (pBlockOld != g_vReallocCounters.pTracked)){
+		return;
+	}
+	if(pBlockNew == pBlockOld){
+		++g_vReallocCounters.uInPlace;
+	} else {
+		++g_vReallocCounters.uMoved;
+		g_vReallocCounters.pTracked = pBlockNew;
+	}
+}
+
+// 每次在末尾追加 uChunkSize 字节，把缓冲区从空增长到 uSizeFinal 字节，就像日志缓冲区那样。返回总时间，单位是毫秒。
+template<typename ReallocT>
+double MeasureGrowth(std::size_t uSizeFinal, std::size_t uChunkSize, ReallocT &&fnRealloc){
+	const auto dBegin = GetHiResMonoClock();
+	void *pBuffer = nullptr;
+	for(std::size_t uSize = uChunkSize; uSize <= uSizeFinal; uSize += uChunkSize){
+		pBuffer = fnRealloc(pBuffer, uSize);
+		HARNESS_CHECK(pBuffer);
+		// 只写新追加的部分，已有的内容不应该被碰到。
+		std::memset(static_cast<unsigned char *>(pBuffer) + uSize - uChunkSize, 0x5A, uChunkSize);
+	}
+	fnRealloc(pBuffer, 0);
+	return GetHiResMonoClock() - dBegin;
+}
+
+}
+
+HARNESS_TEST(HeapPreservesContentsAcrossSizes){
+	// 每种大小都分配多个内存块，确保它们彼此不重叠，内容不会被别的分配破坏。
+	constexpr unsigned kCopies = 16;
+	void *apBlocks[sizeof(kSizes) / sizeof(kSizes[0])][kCopies];
+	for(std::size_t uSizeIndex = 0; uSizeIndex < sizeof(kSizes) / sizeof(kSizes[0]); ++uSizeIndex){
+		for(auto &pBlock : apBlocks[uSizeIndex]){
+			pBlock = ::_MCFCRT_malloc(kSizes[uSizeIndex]);
+			HARNESS_CHECK(pBlock);
+			HARNESS_CHECK(reinterpret_cast<std::uintptr_t>(pBlock) % 16 == 0);
+			FillBlock(pBlock, kSizes[uSizeIndex]);
+		}
+	}
+	for(std::size_t uSizeIndex = 0; uSizeIndex < sizeof(kSizes) / sizeof(kSizes[0]); ++uSizeIndex){
+		for(auto &pBlock : apBlocks[uSizeIndex]){
+			HARNESS_CHECK(CheckBlock(pBlock, kSizes[uSizeIndex]));
+			::_MCFCRT_free(pBlock);
+		}
+	}
+
+	// calloc() 必须返回全零的内存，即使这块内存刚刚被写过又释放了。
+	for(const auto uSize : kSizes){
+		const auto pDirty = ::_MCFCRT_malloc(uSize);
+		HARNESS_CHECK(pDirty);
+		std::memset(pDirty, 0xCC, uSize);
+		::_MCFCRT_free(pDirty);
+		const auto pBlock = static_cast<unsigned char *>(::_MCFCRT_calloc(1, uSize));
+		HARNESS_CHECK(pBlock);
+		for(std::size_t uIndex = 0; uIndex < uSize; ++uIndex){
+			HARNESS_CHECK(pBlock[uIndex] == 0);
+		}
+		::_MCFCRT_free(pBlock);
+	}
+}
+
+HARNESS_TEST(HeapReallocKeepsPrefix){
+	// 在小块的大小类之间、小块和大块之间来回重新分配，前缀必须保持不变。
+	for(const auto uSizeFrom : kSizes){
+		for(const auto uSizeTo : kSizes){
+			const auto pBlock = ::_MCFCRT_malloc(uSizeFrom);
+			HARNESS_CHECK(pBlock);
+			FillBlock(pBlock, uSizeFrom);
+			const auto pNewBlock = ::_MCFCRT_realloc(pBlock, uSizeTo);
+			HARNESS_CHECK(pNewBlock);
+			const auto pbyNewBlock = static_cast<const unsigned char *>(pNewBlock);
+			const auto uCommon = (uSizeFrom < uSizeTo) ? uSizeFrom : uSizeTo;
+			for(std::size_t uIndex = 0; uIndex < uCommon; ++uIndex){
+				HARNESS_CHECK(pbyNewBlock[uIndex] == GetPattern(uSizeFrom, uIndex));
+			}
+			::_MCFCRT_free(pNewBlock);
+		}
+	}
+}
+
+HARNESS_TEST(HeapCrossThreadFree){
+	// 所有内存块都在别的线程中释放，然后在各自的线程中重新使用。释放到中央空闲链表的内存块必须能被再次分配，且内容不能被破坏。
+	constexpr unsigned kThreads = 8;
+	constexpr unsigned kRounds = 200;
+	constexpr unsigned kBlocksPerRound = 500;
+	constexpr auto kSizeCount = sizeof(kSizes) / sizeof(kSizes[0]) - 2;
+	static Atomic<void *> s_apShared[kThreads][kBlocksPerRound];
+	static Atomic<unsigned> s_uArrived;
+	// 每轮分两个阶段：先分配，再释放下一个线程分配的内存块。每个阶段结束时所有线程都要到齐。
+	const auto fnWaitForPhase = [](unsigned uPhase){
+		s_uArrived.FetchAdd(1, kAtomicAcqRel);
+		while(s_uArrived.Load(kAtomicAcquire) < (uPhase + 1) * kThreads){
+			YieldThread();
+		}
+	};
+	Harness::RunInThreads(kThreads, [&](unsigned uIndex){
+		for(unsigned uRound = 0; uRound < kRounds; ++uRound){
+			for(unsigned uBlock = 0; uBlock < kBlocksPerRound; ++uBlock){
+				const auto uSize = kSizes[(uRound + uBlock) % kSizeCount];
+				const auto pBlock = ::_MCFCRT_malloc(uSize);
+				HARNESS_CHECK(pBlock);
+				FillBlock(pBlock, uSize);
+				s_apShared[uIndex][uBlock].Store(pBlock, kAtomicRelease);
+			}
+			fnWaitForPhase(uRound * 2);
+			const auto uVictim = (uIndex + 1) % kThreads;
+			for(unsigned uBlock = 0; uBlock < kBlocksPerRound; ++uBlock){
+				const auto uSize = kSizes[(uRound + uBlock) % kSizeCount];
+				const auto pBlock = s_apShared[uVictim][uBlock].Exchange(nullptr, kAtomicAcqRel);
+				HARNESS_CHECK(CheckBlock(pBlock, uSize));
+				::_MCFCRT_free(pBlock);
+			}
+			fnWaitForPhase(uRound * 2 + 1);
+		}
+	});
+}
+
+HARNESS_BENCH(HeapThroughput){
+	// 单位是纳秒每对 malloc()/free()，由所有线程平摊。进程堆是原来的实现。
+	static constexpr unsigned kThreadCounts[] = { 1, 2, 4, 8, 16 };
+	std::printf("  threads | size <= 256 : CRT / process heap | size <= 8192 : CRT / process heap | cross-thread : CRT / process heap\n");
+	for(const auto uThreads : kThreadCounts){
+		const auto dSmallCrt = MeasureLocalPairs<CrtHeap>(uThreads, 256);
+		const auto dSmallProcess = MeasureLocalPairs<ProcessHeap>(uThreads, 256);
+		const auto dMediumCrt = MeasureLocalPairs<CrtHeap>(uThreads, 8192);
+		const auto dMediumProcess = MeasureLocalPairs<ProcessHeap>(uThreads, 8192);
+		const auto dCrossCrt = MeasureCrossThreadPairs<CrtHeap>((uThreads + 1) / 2);
+		const auto dCrossProcess = MeasureCrossThreadPairs<ProcessHeap>((uThreads + 1) / 2);
+		std::printf("  %7u | %12.2f / %12.2f | %13.2f / %12.2f | %12.2f / %12.2f\n",
+			uThreads, dSmallCrt, dSmallProcess, dMediumCrt, dMediumProcess, dCrossCrt, dCrossProcess);
+		std::fflush(stdout);
+	}
+}
+
+HARNESS_TEST(HeapReallocGrowsLargeBlocksInPlace){
+	// 把一个缓冲区以 64KiB 为单位从 64KiB 增长到 64MiB。移动之后保留的地址空间是新大小的数倍，所以移动的次数是对数级的。
+	// 堆回调在原地调整大小时收到相同的新旧指针，这里用它来计数。
+	constexpr std::size_t kStep = 0x10000;
+	constexpr std::size_t kSizeFinal = 0x4000000;
+	auto pBuffer = static_cast<unsigned char *>(::_MCFCRT_malloc(kStep));
+	HARNESS_CHECK(pBuffer);
+	pBuffer[0] = 0x12;
+	g_vReallocCounters = { pBuffer, 0, 0 };
+	const auto pfnOldCallback = ::_MCFCRT_SetHeapCallback(&CountReallocations);
+	for(std::size_t uSize = kStep * 2; uSize <= kSizeFinal; uSize += kStep){
+		pBuffer = static_cast<unsigned char *>(::_MCFCRT_realloc(pBuffer, uSize));
+		HARNESS_CHECK(pBuffer);
+		pBuffer[uSize - 1] = static_cast<unsigned char>(uSize / kStep);
+	}
+	::_MCFCRT_SetHeapCallback(pfnOldCallback);
+	HARNESS_CHECK(g_vReallocCounters.pTracked == pBuffer);
+	HARNESS_CHECK(g_vReallocCounters.uInPlace + g_vReallocCounters.uMoved == kSizeFinal / kStep - 1);
+	std::printf("  %zu reallocations in place, %zu moved\n", g_vReallocCounters.uInPlace, g_vReallocCounters.uMoved);
+	HARNESS_CHECK(g_vReallocCounters.uMoved <= 16);
+	// 无论是否移动过，原来写入的字节都必须保留。
+	HARNESS_CHECK(pBuffer[0] == 0x12);
+	for(std::size_t uSize = kStep * 2; uSize <= kSizeFinal; uSize += kStep){
+		HARNESS_CHECK(pBuffer[uSize - 1] == static_cast<unsigned char>(uSize / kStep));
+	}
+	::_MCFCRT_free(pBuffer);
+}
+
+HARNESS_BENCH(HeapReallocGrowth){
+	// 单位是毫秒每次从空增长到目标大小。进程堆是原来的实现，它在无法原地扩展时复制整个缓冲区。
+	static constexpr std::size_t kFinalSizes[] = { 0x100000, 0x1000000, 0x4000000 };
+	static constexpr std::size_t kChunkSizes[] = { 0x1000, 0x10000 };
+	const auto fnCrtRealloc = [](void *pBlock, std::size_t uSize) -> void * {
+		if(uSize == 0){
+			::_MCFCRT_free(pBlock);
+			return nullptr;
+		}
+		return pBlock ? ::_MCFCRT_realloc(pBlock, uSize) : ::_MCFCRT_malloc(uSize);
+	};
+	const auto fnProcessRealloc = [](void *pBlock, std::size_t uSize) -> void * {
+		if(uSize == 0){
+			::HeapFree(::GetProcessHeap(), 0, pBlock);
+			return nullptr;
+		}
+		return pBlock ? ::HeapReAlloc(::GetProcessHeap(), 0, pBlock, uSize) : ::HeapAlloc(::GetProcessHeap(), 0, uSize);
+	};
+	std::printf("  final size | chunk size | CRT       | process heap\n");
+	for(const auto uSizeFinal : kFinalSizes){
+		for(const auto uChunkSize : kChunkSizes){
+			const auto dCrt = MeasureGrowth(uSizeFinal, uChunkSize, fnCrtRealloc);
+			const auto dProcess = MeasureGrowth(uSizeFinal, uChunkSize, fnProcessRealloc);
+			std::printf("  %#10zx | %#10zx | %9.3f | %9.3f\n", uSizeFinal, uChunkSize, dCrt, dProcess);
+			std::fflush(stdout);
+		}
+	}
+}
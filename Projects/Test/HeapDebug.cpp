@@ -0,0 +1,201 @@
+#include "Harness.hpp"
+#include <MCFCRT/env/heap_debug.h>
+#include <MCFCRT/env/avl_tree.h>
+#include <MCFCRT/env/mutex.h>
+#include <MCFCRT/env/clocks.h>
+
+using namespace MCF;
+
+namespace {
+
+// 这里直接调用登记函数，存储空间来自进程堆，因此无论 CRT 是否以调试模式构建，测量的都是登记表本身。
+constexpr std::size_t kPayloadSize = 64;
+
+void *AllocStorage(){
+	const auto pStorage = ::HeapAlloc(::GetProcessHeap(), 0, ::__MCFCRT_HeapDebugCalculateSizeToAlloc(kPayloadSize));
+	HARNESS_CHECK(pStorage);
+	return pStorage;
+}
+void FreeStorage(void *pStorage){
+	::HeapFree(::GetProcessHeap(), 0, pStorage);
+}
+
+void *Register(void *pStorage){
+	void *pBlock;
+	::__MCFCRT_HeapDebugRegister(&pBlock, kPayloadSize, pStorage, nullptr, nullptr);
+	return pBlock;
+}
+bool Unregister(void *pBlock, void *pStorageExpected){
+	std::size_t uSize;
+	void *pStorage;
+	if(!::__MCFCRT_HeapDebugValidateAndUnregister(&uSize, &pStorage, pBlock)){
+		return false;
+	}
+	HARNESS_CHECK(uSize == kPayloadSize);
+	HARNESS_CHECK(pStorage == pStorageExpected);
+	return true;
+}
+
+// 原来的登记表：所有内存块放在同一棵 AVL 树中，由同一个互斥锁保护。
+// 头部和尾部的哨兵与现在的实现做同样多的工作，所以两者的差别只在于锁和树。
+class LegacyRegistry {
+private:
+	struct Node {
+		::_MCFCRT_AvlNodeHeader vHeader;
+		std::uintptr_t uCookie;
+		unsigned char abySentry[16 + 64];
+	};
+
+	static int CompareNodeOther(const ::_MCFCRT_AvlNodeHeader *pSelf, std::intptr_t nOther) noexcept {
+		const auto uSelf = reinterpret_cast<std::uintptr_t>(pSelf);
+		const auto uOther = static_cast<std::uintptr_t>(nOther);
+		return (uSelf < uOther) ? -1 : ((uSelf > uOther) ? 1 : 0);
+	}
+	static int CompareNodes(const ::_MCFCRT_AvlNodeHeader *pSelf, const ::_MCFCRT_AvlNodeHeader *pOther) noexcept {
+		return CompareNodeOther(pSelf, static_cast<std::intptr_t>(reinterpret_cast<std::uintptr_t>(pOther)));
+	}
+
+	static void MakeSentry(unsigned char *pbyData, std::size_t uSize, std::uintptr_t uCookie) noexcept {
+		auto ulSeed = static_cast<unsigned long>(uCookie);
+		for(std::size_t uIndex = 0; uIndex < uSize; ++uIndex){
+			ulSeed = ulSeed * 1664525u + 1013904223u;
+			pbyData[uIndex] = static_cast<unsigned char>(ulSeed >> 24);
+		}
+	}
+	static bool CheckSentry(const unsigned char *pbyData, std::size_t uSize, std::uintptr_t uCookie) noexcept {
+		auto ulSeed = static_cast<unsigned long>(uCookie);
+		for(std::size_t uIndex = 0; uIndex < uSize; ++uIndex){
+			ulSeed = ulSeed * 1664525u + 1013904223u;
+			if(pbyData[uIndex] != static_cast<unsigned char>(ulSeed >> 24)){
+				return false;
+			}
+		}
+		return true;
+	}
+
+private:
+	::_MCFCRT_Mutex x_vMutex = { };
+	::_MCFCRT_AvlRoot x_avlBlocks = nullptr;
+
+public:
+	void *Register(void *pStorage) noexcept {
+		const auto pNode = static_cast<Node *>(pStorage);
+		pNode->uCookie = static_cast<std::uintptr_t>(::_MCFCRT_GetFastMonoClock());
+		MakeSentry(pNode->abySentry, sizeof(pNode->abySentry), pNode->uCookie);
+		::_MCFCRT_WaitForMutexForever(&x_vMutex, _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+		::_MCFCRT_AvlAttach(&x_avlBlocks, &(pNode->vHeader), &CompareNodes);
+		::_MCFCRT_SignalMutex(&x_vMutex);
+		return pNode + 1;
+	}
+	bool Unregister(void *pBlock) noexcept {
+		const auto pNode = static_cast<Node *>(pBlock) - 1;
+		if(!CheckSentry(pNode->abySentry, sizeof(pNode->abySentry), pNode->uCookie)){
+			return false;
+		}
+		::_MCFCRT_WaitForMutexForever(&x_vMutex, _MCFCRT_MUTEX_SUGGESTED_SPIN_COUNT);
+		const auto pFound = ::_MCFCRT_AvlFind(&x_avlBlocks, static_cast<std::intptr_t>(reinterpret_cast<std::uintptr_t>(pNode)), &CompareNodeOther);
+		if(pFound != &(pNode->vHeader)){
+			::_MCFCRT_SignalMutex(&x_vMutex);
+			return false;
+		}
+		::_MCFCRT_AvlDetach(pFound);
+		::_MCFCRT_SignalMutex(&x_vMutex);
+		return true;
+	}
+};
+
+LegacyRegistry g_vLegacyRegistry;
+
+// 每个线程保持 uLiveBlocks 个已登记的内存块，反复注销其中一个再重新登记。返回每对登记/注销的平均时间，由所有线程平摊，单位是纳秒。
+template<typename RegisterT, typename UnregisterT>
+double MeasureRegistry(unsigned uThreadCount, unsigned uLiveBlocks, const RegisterT &fnRegister, const UnregisterT &fnUnregister){
+	constexpr unsigned kIterations = 200000;
+	const auto dTotal = Harness::RunInThreads(uThreadCount, [&](unsigned uIndex){
+		Vector<void *> vecStorage, vecBlocks;
+		for(unsigned uBlock = 0; uBlock < uLiveBlocks; ++uBlock){
+			vecStorage.Push(AllocStorage());
+			vecBlocks.Push(fnRegister(vecStorage[uBlock]));
+		}
+		std::uint32_t u32Seed = uIndex * 2654435761u + 1;
+		for(unsigned uIteration = 0; uIteration < kIterations; ++uIteration){
+			u32Seed = u32Seed * 1103515245u + 12345u;
+			const auto uBlock = (u32Seed >> 8) % uLiveBlocks;
+			HARNESS_CHECK(fnUnregister(vecBlocks[uBlock], vecStorage[uBlock]));
+			vecBlocks[uBlock] = fnRegister(vecStorage[uBlock]);
+		}
+		for(unsigned uBlock = 0; uBlock < uLiveBlocks; ++uBlock){
+			HARNESS_CHECK(fnUnregister(vecBlocks[uBlock], vecStorage[uBlock]));
+			FreeStorage(vecStorage[uBlock]);
+		}
+	});
+	return dTotal / (static_cast<double>(kIterations) * uThreadCount);
+}
+
+}
+
+HARNESS_TEST(HeapDebugRegistryValidation){
+	const auto pStorage = AllocStorage();
+	auto pBlock = Register(pStorage);
+
+	// 破坏尾部哨兵之后，注销必须失败，且记录保留。恢复之后可以正常注销。
+	auto &byTrailer = static_cast<unsigned char *>(pBlock)[kPayloadSize + 5];
+	const auto bySaved = byTrailer;
+	byTrailer = static_cast<unsigned char>(~bySaved);
+	HARNESS_CHECK(!Unregister(pBlock, pStorage));
+	byTrailer = bySaved;
+	// 普通的内存块不能当作对齐的内存块注销。
+	std::size_t uSize;
+	void *pStorageOut;
+	HARNESS_CHECK(!::__MCFCRT_HeapDebugValidateAndUnregisterAligned(&uSize, &pStorageOut, pBlock));
+	HARNESS_CHECK(Unregister(pBlock, pStorage));
+	// 已经注销的内存块不能再次注销。
+	HARNESS_CHECK(!Unregister(pBlock, pStorage));
+
+	// 撤销注销之后，内存块重新登记在同一个位置。
+	::__MCFCRT_HeapDebugUndoUnregister(pStorage);
+	HARNESS_CHECK(Unregister(pBlock, pStorage));
+	FreeStorage(pStorage);
+}
+
+HARNESS_TEST(HeapDebugRegistryCrossThread){
+	// 每个线程登记的内存块都由下一个线程注销。任何一个内存块在别的分片中找不到都会导致检查失败。
+	constexpr unsigned kThreads = 16;
+	constexpr unsigned kBlocks = 4000;
+	static void *s_apStorage[kThreads][kBlocks];
+	static void *s_apBlocks[kThreads][kBlocks];
+	static Atomic<unsigned> s_uRegistered;
+	Harness::RunInThreads(kThreads, [&](unsigned uIndex){
+		for(unsigned uBlock = 0; uBlock < kBlocks; ++uBlock){
+			s_apStorage[uIndex][uBlock] = AllocStorage();
+			s_apBlocks[uIndex][uBlock] = Register(s_apStorage[uIndex][uBlock]);
+		}
+		s_uRegistered.FetchAdd(1, kAtomicAcqRel);
+		while(s_uRegistered.Load(kAtomicAcquire) != kThreads){
+			YieldThread();
+		}
+		const auto uVictim = (uIndex + 1) % kThreads;
+		for(unsigned uBlock = 0; uBlock < kBlocks; ++uBlock){
+			HARNESS_CHECK(Unregister(s_apBlocks[uVictim][uBlock], s_apStorage[uVictim][uBlock]));
+			FreeStorage(s_apStorage[uVictim][uBlock]);
+		}
+	});
+}
+
+HARNESS_BENCH(HeapDebugRegistryThroughput){
+	// 单位是纳秒每对登记/注销，由所有线程平摊。单锁 AVL 树是原来的实现。
+	static constexpr unsigned kThreadCounts[] = { 1, 2, 4, 8, 16, 32 };
+	static constexpr unsigned kLiveBlockCounts[] = { 64, 4096 };
+	const auto fnRegister = [](void *pStorage){ return Register(pStorage); };
+	const auto fnUnregister = [](void *pBlock, void *pStorage){ return Unregister(pBlock, pStorage); };
+	const auto fnLegacyRegister = [](void *pStorage){ return g_vLegacyRegistry.Register(pStorage); };
+	const auto fnLegacyUnregister = [](void *pBlock, void *){ return g_vLegacyRegistry.Unregister(pBlock); };
+	std::printf("  threads | live blocks | sharded | single AVL tree | speedup\n");
+	for(const auto uLiveBlocks : kLiveBlockCounts){
+		for(const auto uThreads : kThreadCounts){
+			const auto dSharded = MeasureRegistry(uThreads, uLiveBlocks, fnRegister, fnUnregister);
+			const auto dLegacy = MeasureRegistry(uThreads, uLiveBlocks, fnLegacyRegister, fnLegacyUnregister);
+			std::printf("  %7u | %11u | %7.2f | %14.2f | %6.2fx\n", uThreads, uLiveBlocks, dSharded, dLegacy, dLegacy / dSharded);
+			std::fflush(stdout);
+		}
+	}
+}
@@ -0,0 +1,112 @@
+#include "Harness.hpp"
+#include <MCFCRT/env/heap.h>
+#include <MCFCRT/env/heap_profiler.h>
+#include <cstring>
+
+using namespace MCF;
+
+namespace {
+
+struct DumpBuffer {
+	char achData[0x100000];
+	std::size_t uSize;
+};
+
+DumpBuffer g_vDumpBuffer;
+
+bool WriteToDumpBuffer(std::intptr_t /* nContext */, const char *pchData, std::size_t uSize){
+	if(uSize > sizeof(g_vDumpBuffer.achData) - 1 - g_vDumpBuffer.uSize){
+		return false;
+	}
+	std::memcpy(g_vDumpBuffer.achData + g_vDumpBuffer.uSize, pchData, uSize);
+	g_vDumpBuffer.uSize += uSize;
+	g_vDumpBuffer.achData[g_vDumpBuffer.uSize] = 0;
+	return true;
+}
+
+// 返回 pprof 格式头部中的存活样本数。导出本身不分配内存，所以不会影响结果。
+std::uint64_t DumpAndGetLiveCount(){
+	g_vDumpBuffer.uSize = 0;
+	HARNESS_CHECK(::_MCFCRT_DumpHeapProfile(::_MCFCRT_kHeapProfileFormatPprof, &WriteToDumpBuffer, 0));
+	HARNESS_CHECK(std::strncmp(g_vDumpBuffer.achData, "heap profile: ", 14) == 0);
+	return std::strtoull(g_vDumpBuffer.achData + 14, nullptr, 10);
+}
+
+}
+
+HARNESS_TEST(HeapProfilerRemovesSamplesOnFree){
+	// 间隔为 1 字节时几乎每次分配都被采样。
+	HARNESS_CHECK(::_MCFCRT_StartHeapProfiler(1));
+	const auto u64Baseline = DumpAndGetLiveCount();
+
+	static void *s_apBlocks[1000];
+	for(auto &pBlock : s_apBlocks){
+		pBlock = ::_MCFCRT_malloc(64);
+		HARNESS_CHECK(pBlock);
+	}
+	HARNESS_CHECK(DumpAndGetLiveCount() >= u64Baseline + 900);
+
+	// 重新分配失败时，原来的内存块仍然存活，它的样本也必须保留。
+	const auto u64BeforeFailure = DumpAndGetLiveCount();
+	HARNESS_CHECK(!::_MCFCRT_realloc(s_apBlocks[0], SIZE_MAX / 2));
+	HARNESS_CHECK(DumpAndGetLiveCount() == u64BeforeFailure);
+
+	for(auto &pBlock : s_apBlocks){
+		::_MCFCRT_free(pBlock);
+	}
+	HARNESS_CHECK(DumpAndGetLiveCount() == u64Baseline);
+	HARNESS_CHECK(::_MCFCRT_StopHeapProfiler());
+}
+
+HARNESS_TEST(HeapProfilerSurvivesCrossThreadAddressReuse){
+	// 每个线程把新分配的内存块和共享槽中的交换，然后释放换出来的那个，因此内存块总是在别的线程中释放。
+	// 如果样本在内存块被释放之后才移除，另一个线程可能已经重新分配了同一个地址并采样，存活样本数就会漂移。
+	HARNESS_CHECK(::_MCFCRT_StartHeapProfiler(1));
+	const auto u64Baseline = DumpAndGetLiveCount();
+
+	static Atomic<void *> s_pShared;
+	Harness::RunInThreads(8, [](unsigned){
+		for(unsigned uIndex = 0; uIndex < 100000; ++uIndex){
+			const auto pOld = s_pShared.Exchange(::_MCFCRT_malloc(48), kAtomicAcqRel);
+			::_MCFCRT_free(pOld);
+		}
+	});
+	::_MCFCRT_free(s_pShared.Exchange(nullptr, kAtomicAcqRel));
+
+	HARNESS_CHECK(DumpAndGetLiveCount() == u64Baseline);
+	HARNESS_CHECK(::_MCFCRT_StopHeapProfiler());
+}
+
+HARNESS_TEST(HeapProfilerDumpsMappedLibraries){
+	HARNESS_CHECK(::_MCFCRT_StartHeapProfiler(1));
+	const auto pBlock = ::_MCFCRT_malloc(100);
+	DumpAndGetLiveCount();
+	::_MCFCRT_free(pBlock);
+	HARNESS_CHECK(::_MCFCRT_StopHeapProfiler());
+
+	const auto pchSection = std::strstr(g_vDumpBuffer.achData, "\nMAPPED_LIBRARIES:\n");
+	HARNESS_CHECK(pchSection);
+	// 至少要列出可执行文件本身和 ntdll.dll。
+	HARNESS_CHECK(std::strstr(pchSection, ".exe\n") || std::strstr(pchSection, ".EXE\n"));
+	HARNESS_CHECK(std::strstr(pchSection, "ntdll.dll\n") || std::strstr(pchSection, "NTDLL.DLL\n"));
+}
+
+HARNESS_BENCH(HeapProfilerOverhead){
+	// 单位是纳秒每对 malloc()/free()。
+	constexpr std::uint64_t kIterations = 10000000;
+	const auto fnPair = []{
+		const auto pBlock = ::_MCFCRT_malloc(64);
+		Harness::DoNotOptimize(pBlock);
+		::_MCFCRT_free(pBlock);
+	};
+	const auto dOff = Harness::Measure(kIterations, fnPair);
+	std::printf("  profiler off              : %8.2f ns\n", dOff);
+
+	static constexpr std::size_t kIntervals[] = { _MCFCRT_HEAP_PROFILER_DEFAULT_SAMPLING_INTERVAL, 0x1000, 0x40 };
+	for(const auto uInterval : kIntervals){
+		HARNESS_CHECK(::_MCFCRT_StartHeapProfiler(uInterval));
+		const auto dOn = Harness::Measure(kIterations, fnPair);
+		HARNESS_CHECK(::_MCFCRT_StopHeapProfiler());
+		std::printf("  interval = %#10zx     : %8.2f ns (%+.1f%%)\n", uInterval, dOn, (dOn / dOff - 1) * 100);
+	}
+}
@@ -0,0 +1,81 @@
+#include "Harness.hpp"
+#include <MCF/Thread/Mutex.hpp>
+#include <MCF/Thread/ReadersWriterMutex.hpp>
+#include <MCFCRT/env/lock_profiler.h>
+
+using namespace MCF;
+
+namespace {
+
+::_MCFCRT_LockProfileRecord g_avRecords[0x2000];
+
+const ::_MCFCRT_LockProfileRecord *FindRecord(const void *pLock, ::_MCFCRT_LockKind eKind){
+	const auto uCount = ::_MCFCRT_SnapshotLockProfile(g_avRecords, sizeof(g_avRecords) / sizeof(g_avRecords[0]));
+	HARNESS_CHECK(uCount <= sizeof(g_avRecords) / sizeof(g_avRecords[0]));
+	for(std::size_t uIndex = 0; uIndex < uCount; ++uIndex){
+		const auto &vRecord = g_avRecords[uIndex];
+		if((vRecord.__pLock == pLock) && (vRecord.__eKind == eKind)){
+			return &vRecord;
+		}
+	}
+	return nullptr;
+}
+
+// 成员函数会被内联到这里，所以报告的调用位置应该是这个函数自己的返回地址。
+__attribute__((__noinline__))
+const void *LockMutexTwice(Mutex &vMutex){
+	vMutex.Lock();
+	vMutex.Unlock();
+	HARNESS_CHECK(vMutex.Try());
+	vMutex.Unlock();
+	return __builtin_return_address(0);
+}
+__attribute__((__noinline__))
+const void *LockRwLockAsReader(ReadersWriterMutex &vRwLock){
+	vRwLock.LockAsReader();
+	vRwLock.UnlockAsReader();
+	return __builtin_return_address(0);
+}
+
+}
+
+HARNESS_TEST(LockProfilerCountsUncontendedAcquisitions){
+	static Mutex s_vMutex;
+	static ReadersWriterMutex s_vRwLock;
+	HARNESS_CHECK(::_MCFCRT_StartLockProfiler());
+	const void *pMutexCallSite = nullptr;
+	const void *pRwLockCallSite = nullptr;
+	for(unsigned uIndex = 0; uIndex < 1000; ++uIndex){
+		pMutexCallSite = LockMutexTwice(s_vMutex);
+		pRwLockCallSite = LockRwLockAsReader(s_vRwLock);
+	}
+	HARNESS_CHECK(::_MCFCRT_StopLockProfiler());
+
+	// 互斥锁没有竞争，全部在内联的快速路径上获得。
+	const auto pMutexRecord = FindRecord(&s_vMutex, ::_MCFCRT_kLockKindMutex);
+	HARNESS_CHECK(pMutexRecord);
+	HARNESS_CHECK(pMutexRecord->__u64Acquisitions == 2000);
+	HARNESS_CHECK(pMutexRecord->__u64ContendedAcquisitions == 0);
+	HARNESS_CHECK(pMutexRecord->__pCallSite == pMutexCallSite);
+
+	const auto pRwLockRecord = FindRecord(&s_vRwLock, ::_MCFCRT_kLockKindRwLockShared);
+	HARNESS_CHECK(pRwLockRecord);
+	HARNESS_CHECK(pRwLockRecord->__u64Acquisitions == 1000);
+	HARNESS_CHECK(pRwLockRecord->__pCallSite == pRwLockCallSite);
+}
+
+HARNESS_BENCH(LockProfilerOverhead){
+	// 单位是纳秒每对 Lock()/Unlock()，没有竞争。
+	constexpr std::uint64_t kIterations = 10000000;
+	static Mutex s_vMutex;
+	const auto fnPair = []{
+		s_vMutex.Lock();
+		s_vMutex.Unlock();
+	};
+	const auto dOff = Harness::Measure(kIterations, fnPair);
+	HARNESS_CHECK(::_MCFCRT_StartLockProfiler());
+	const auto dOn = Harness::Measure(kIterations, fnPair);
+	HARNESS_CHECK(::_MCFCRT_StopLockProfiler());
+	std::printf("  profiler off : %8.2f ns\n", dOff);
+	std::printf("  profiler on  : %8.2f ns (%+.1f%%)\n", dOn, (dOn / dOff - 1) * 100);
+}
@@ -0,0 +1,169 @@
+#include "Harness.hpp"
+#include <MCFCRT/env/_cpu_features.h>
+#include <cstring>
+#include <algorithm>
+#include <emmintrin.h>
+
+using namespace MCF;
+
+// 大的复制按大小和处理器特性分为几层：非临时存储、rep movsb、AVX2 和 SSE2。
+// 测试覆盖每一层的边界附近、所有对齐和两个方向的重叠；性能测试从 16 字节到 256MiB。
+
+namespace {
+
+constexpr std::size_t kAlignmentCount = 64;
+
+// 复制使用非临时存储的阈值，与 _memcpy_impl.c 中的计算相同。
+std::size_t GetNonTemporalThreshold() noexcept {
+	const auto uLlcSize = ::__MCFCRT_GetLastLevelCacheSize();
+	return (uLlcSize != 0) ? (uLlcSize / 4) : 0x100000;
+}
+
+void FillPattern(unsigned char *pbyBegin, std::size_t uSize, unsigned uSeed) noexcept {
+	auto u32State = uSeed * 2654435761u + 1;
+	for(std::size_t uIndex = 0; uIndex < uSize; ++uIndex){
+		u32State = u32State * 1103515245u + 12345u;
+		pbyBegin[uIndex] = static_cast<unsigned char>(u32State >> 24);
+	}
+}
+
+// 一个大小为 uSize 的复制。目标前后留有填充的字节，用来检测越界写入。
+void CheckCopy(unsigned char *pbySource, unsigned char *pbyBuffer, std::size_t uSize, std::size_t uDestOffset, std::size_t uSourceOffset){
+	const auto pbyDest = pbyBuffer + kAlignmentCount + uDestOffset;
+	const auto pbySrc = pbySource + uSourceOffset;
+	std::memset(pbyBuffer, 0xCD, uSize + kAlignmentCount * 3);
+	FillPattern(pbySrc, uSize, static_cast<unsigned>(uSize + uDestOffset * 64 + uSourceOffset));
+	HARNESS_CHECK(std::memcpy(pbyDest, pbySrc, uSize) == pbyDest);
+	if(std::memcmp(pbyDest, pbySrc, uSize) != 0){
+		std::printf("  memcpy: size = %zu, dest offset = %zu, source offset = %zu\n", uSize, uDestOffset, uSourceOffset);
+		HARNESS_CHECK(!"复制的内容不正确");
+	}
+	for(std::size_t uIndex = 0; uIndex < kAlignmentCount + uDestOffset; ++uIndex){
+		HARNESS_CHECK(pbyBuffer[uIndex] == 0xCD);
+	}
+	for(std::size_t uIndex = kAlignmentCount + uDestOffset + uSize; uIndex < uSize + kAlignmentCount * 3; ++uIndex){
+		HARNESS_CHECK(pbyBuffer[uIndex] == 0xCD);
+	}
+}
+
+// 在同一块内存中把 uSize 字节从 uFrom 移动到 uTo，与逐字节的结果比较。
+void CheckMove(unsigned char *pbyBuffer, unsigned char *pbyExpected, std::size_t uBufferSize, std::size_t uSize, std::size_t uFrom, std::size_t uTo){
+	FillPattern(pbyBuffer, uBufferSize, static_cast<unsigned>(uSize + uFrom + uTo));
+	std::memcpy(pbyExpected, pbyBuffer, uBufferSize);
+	if(uTo < uFrom){
+		for(std::size_t uIndex = 0; uIndex < uSize; ++uIndex){
+			pbyExpected[uTo + uIndex] = pbyExpected[uFrom + uIndex];
+		}
+	} else {
+		for(std::size_t uIndex = uSize; uIndex != 0; --uIndex){
+			pbyExpected[uTo + uIndex - 1] = pbyExpected[uFrom + uIndex - 1];
+		}
+	}
+	HARNESS_CHECK(std::memmove(pbyBuffer + uTo, pbyBuffer + uFrom, uSize) == pbyBuffer + uTo);
+	if(std::memcmp(pbyBuffer, pbyExpected, uBufferSize) != 0){
+		std::printf("  memmove: size = %zu, from = %zu, to = %zu\n", uSize, uFrom, uTo);
+		HARNESS_CHECK(!"移动的结果不正确");
+	}
+}
+
+// 原来对于 128 字节以上的复制都使用的循环：非对齐读取，对齐写入。用作性能测试的基准。
+void PlainSse2Copy(unsigned char *pbyDest, const unsigned char *pbySrc, std::size_t uSize) noexcept {
+	if(uSize < 16){
+		std::memcpy(pbyDest, pbySrc, uSize);
+		return;
+	}
+	const auto uHead = -reinterpret_cast<std::uintptr_t>(pbyDest) % 16;
+	const auto xmmHead = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pbySrc));
+	const auto xmmTail = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pbySrc + uSize - 16));
+	for(auto uOffset = uHead; uOffset + 16 <= uSize; uOffset += 16){
+		_mm_store_si128(reinterpret_cast<__m128i *>(pbyDest + uOffset), _mm_loadu_si128(reinterpret_cast<const __m128i *>(pbySrc + uOffset)));
+	}
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(pbyDest), xmmHead);
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(pbyDest + uSize - 16), xmmTail);
+}
+
+}
+
+HARNESS_TEST(MemcpyAllTiers){
+	const auto uNonTemporalThreshold = GetNonTemporalThreshold();
+	const auto u32Features = ::__MCFCRT_GetCpuFeatures();
+	std::printf("  AVX2 = %s, ERMS = %s, FSRM = %s, non-temporal threshold = %zu\n",
+		(u32Features & ::__MCFCRT_kCpuFeatureAvx2) ? "yes" : "no", (u32Features & ::__MCFCRT_kCpuFeatureErms) ? "yes" : "no",
+		(u32Features & ::__MCFCRT_kCpuFeatureFsrm) ? "yes" : "no", uNonTemporalThreshold);
+
+	const auto uMaxSize = uNonTemporalThreshold + 0x1000;
+	const Harness::GuardedPages vSource(uMaxSize + kAlignmentCount), vBuffer(uMaxSize + kAlignmentCount * 3);
+	// 小的复制覆盖所有源和目标的对齐组合。
+	for(std::size_t uSize = 0; uSize <= 300; ++uSize){
+		for(std::size_t uDestOffset = 0; uDestOffset < kAlignmentCount; ++uDestOffset){
+			for(std::size_t uSourceOffset = 0; uSourceOffset < kAlignmentCount; uSourceOffset += 7){
+				CheckCopy(vSource.GetBegin(), vBuffer.GetBegin(), uSize, uDestOffset, uSourceOffset);
+			}
+		}
+	}
+	// 在每一层的边界附近。
+	static constexpr std::size_t kDestOffsets[] = { 0, 1, 15, 16, 31, 32, 63 };
+	const std::size_t auBoundaries[] = { 2048, 4096, 0x10000, uNonTemporalThreshold };
+	for(const auto uBoundary : auBoundaries){
+		for(std::size_t uSize = uBoundary - 33; uSize <= uBoundary + 33; ++uSize){
+			for(const auto uDestOffset : kDestOffsets){
+				CheckCopy(vSource.GetBegin(), vBuffer.GetBegin(), uSize, uDestOffset, (uDestOffset * 5) % kAlignmentCount);
+			}
+		}
+	}
+	// 源数据紧贴不可访问页。
+	static constexpr std::size_t kTailSizes[] = { 16, 100, 128, 4000, 0x10001 };
+	for(const auto uSize : kTailSizes){
+		const auto pbySrc = vSource.GetEnd() - uSize;
+		FillPattern(pbySrc, uSize, 1);
+		std::memcpy(vBuffer.GetBegin() + 3, pbySrc, uSize);
+		HARNESS_CHECK(std::memcmp(vBuffer.GetBegin() + 3, pbySrc, uSize) == 0);
+	}
+}
+
+HARNESS_TEST(MemmoveOverlapsInBothDirections){
+	const auto uNonTemporalThreshold = GetNonTemporalThreshold();
+	const auto uBufferSize = uNonTemporalThreshold + 0x2000;
+	const Harness::GuardedPages vBuffer(uBufferSize), vExpected(uBufferSize);
+	const std::size_t auSizes[] = { 0, 1, 15, 16, 17, 64, 127, 128, 129, 255, 1000, 2047, 2048, 2049, 5000, 0x10000, uNonTemporalThreshold + 17 };
+	static constexpr std::size_t kDistances[] = { 0, 1, 2, 15, 16, 17, 31, 32, 33, 64, 100, 4096 };
+	static constexpr std::size_t kBases[] = { 0, 1, 7, 32 };
+	for(const auto uSize : auSizes){
+		for(const auto uDistance : kDistances){
+			for(const auto uBase : kBases){
+				if(uBase + uDistance + uSize + 64 > uBufferSize){
+					continue;
+				}
+				CheckMove(vBuffer.GetBegin(), vExpected.GetBegin(), uBase + uDistance + uSize + 64, uSize, uBase + uDistance, uBase);
+				CheckMove(vBuffer.GetBegin(), vExpected.GetBegin(), uBase + uDistance + uSize + 64, uSize, uBase, uBase + uDistance);
+			}
+		}
+	}
+}
+
+HARNESS_BENCH(MemcpyBandwidth){
+	// 单位是 GB/s。较小的复制一直命中缓存，超过最后一级缓存之后测量的是内存带宽。
+#ifdef _WIN64
+	constexpr std::size_t kMaxSize = 0x10000000;
+#else
+	constexpr std::size_t kMaxSize = 0x4000000;
+#endif
+	const Harness::GuardedPages vSource(kMaxSize + 64), vDest(kMaxSize + 64);
+	std::memset(vSource.GetBegin(), 0x5A, vSource.GetSize());
+	std::memset(vDest.GetBegin(), 0xA5, vDest.GetSize());
+	std::printf("  non-temporal threshold = %zu\n", GetNonTemporalThreshold());
+	std::printf("       size | memcpy | memcpy, misaligned | memmove, overlapping | plain SSE2 loop\n");
+	for(std::size_t uSize = 16; uSize <= kMaxSize; uSize *= 4){
+		const auto u64Iterations = std::max<std::uint64_t>(2000000000 / (uSize + 64), 4);
+		const auto dSize = static_cast<double>(uSize);
+		const auto pbySrc = vSource.GetBegin();
+		const auto pbyDest = vDest.GetBegin();
+		const auto dAligned = dSize / Harness::Measure(u64Iterations, [&]{ Harness::DoNotOptimize(std::memcpy(pbyDest, pbySrc, uSize)); });
+		const auto dMisaligned = dSize / Harness::Measure(u64Iterations, [&]{ Harness::DoNotOptimize(std::memcpy(pbyDest + 3, pbySrc + 17, uSize)); });
+		// 向后移动 64 字节，源和目标重叠。
+		const auto dOverlapping = dSize / Harness::Measure(u64Iterations, [&]{ Harness::DoNotOptimize(std::memmove(pbyDest + 64, pbyDest, uSize)); });
+		const auto dPlain = dSize / Harness::Measure(u64Iterations, [&]{ PlainSse2Copy(pbyDest, pbySrc, uSize); Harness::DoNotOptimize(pbyDest); });
+		std::printf("  %9zu | %6.2f | %18.2f | %20.2f | %15.2f\n", uSize, dAligned, dMisaligned, dOverlapping, dPlain);
+		std::fflush(stdout);
+	}
+}
@@ -0,0 +1,136 @@
+#include "Harness.hpp"
+#include <MCF/Core/MonotonicArena.hpp>
+#include <MCF/Core/DefaultAllocator.hpp>
+#include <MCF/Containers/Vector.hpp>
+#include <MCF/Containers/List.hpp>
+#include <MCF/Containers/FlatMap.hpp>
+#include <cstring>
+
+using namespace MCF;
+
+namespace {
+
+// 模拟一个请求：创建若干个临时容器，填充之后查找一遍，然后全部销毁。返回一个校验和，防止计算被优化掉。
+template<class AllocatorT>
+std::uint64_t HandleRequest(unsigned uRequest){
+	std::uint64_t u64Sum = 0;
+	for(unsigned uContainer = 0; uContainer < 16; ++uContainer){
+		Vector<unsigned, AllocatorT> vecItems;
+		for(unsigned uIndex = 0; uIndex < 40; ++uIndex){
+			vecItems.Push(uRequest + uIndex);
+		}
+		List<unsigned, AllocatorT> lstPending;
+		for(unsigned uIndex = 0; uIndex < 10; ++uIndex){
+			lstPending.Push(uIndex * uContainer);
+		}
+		FlatMap<unsigned, unsigned, Less, AllocatorT> mapHeaders;
+		for(unsigned uIndex = 0; uIndex < 12; ++uIndex){
+			mapHeaders.Add((uIndex * 7919u) % 64u, uIndex);
+		}
+		for(const auto uItem : vecItems){
+			u64Sum += uItem;
+		}
+		for(auto pElement = lstPending.GetFirst(); pElement; pElement = lstPending.GetNext(pElement)){
+			u64Sum += *pElement;
+		}
+		if(const auto pElement = mapHeaders.GetMatch(7919u % 64u)){
+			u64Sum += pElement->second;
+		}
+	}
+	return u64Sum;
+}
+
+// 返回每个请求的平均时间，由所有线程平摊，单位是纳秒。
+double MeasureDefaultAllocator(unsigned uThreadCount, unsigned uRequests){
+	return Harness::RunInThreads(uThreadCount, [&](unsigned){
+		for(unsigned uRequest = 0; uRequest < uRequests; ++uRequest){
+			Harness::DoNotOptimize(HandleRequest<DefaultAllocator>(uRequest));
+		}
+	}) / (static_cast<double>(uRequests) * uThreadCount);
+}
+double MeasureMonotonicArena(unsigned uThreadCount, unsigned uRequests){
+	return Harness::RunInThreads(uThreadCount, [&](unsigned){
+		// 每个线程一个区域，每个请求结束之后一次性释放。
+		MonotonicArena vArena;
+		for(unsigned uRequest = 0; uRequest < uRequests; ++uRequest){
+			{
+				const MonotonicArena::Scope vScope(vArena);
+				Harness::DoNotOptimize(HandleRequest<MonotonicArenaAllocator>(uRequest));
+			}
+			vArena.Release();
+		}
+	}) / (static_cast<double>(uRequests) * uThreadCount);
+}
+
+}
+
+HARNESS_TEST(MonotonicArenaAllocate){
+	MonotonicArena vArena(64);
+	// 所有块都按 max_align_t 对齐且互不重叠，包括大小为零的和超过大块容量的请求。
+	static constexpr std::size_t kSizes[] = { 0, 0, 1, 3, 16, 17, 63, 64, 65, 200, 1000, 5000, 0x100000, 0x300000, 7, 0 };
+	unsigned char *apbyBlocks[sizeof(kSizes) / sizeof(kSizes[0])];
+	for(std::size_t uIndex = 0; uIndex < sizeof(kSizes) / sizeof(kSizes[0]); ++uIndex){
+		apbyBlocks[uIndex] = static_cast<unsigned char *>(vArena.Allocate(kSizes[uIndex]));
+		HARNESS_CHECK(apbyBlocks[uIndex]);
+		HARNESS_CHECK(reinterpret_cast<std::uintptr_t>(apbyBlocks[uIndex]) % alignof(std::max_align_t) == 0);
+		std::memset(apbyBlocks[uIndex], static_cast<int>(uIndex + 1), kSizes[uIndex]);
+	}
+	for(std::size_t uIndex = 0; uIndex < sizeof(kSizes) / sizeof(kSizes[0]); ++uIndex){
+		for(std::size_t uOther = 0; uOther < uIndex; ++uOther){
+			HARNESS_CHECK(apbyBlocks[uIndex] != apbyBlocks[uOther]);
+		}
+		for(std::size_t uByte = 0; uByte < kSizes[uIndex]; ++uByte){
+			HARNESS_CHECK(apbyBlocks[uIndex][uByte] == static_cast<unsigned char>(uIndex + 1));
+		}
+	}
+
+	// 释放之后区域仍然可用。
+	vArena.Release();
+	for(unsigned uIndex = 0; uIndex < 10000; ++uIndex){
+		const auto pbyBlock = static_cast<unsigned char *>(vArena.Allocate(uIndex % 300));
+		HARNESS_CHECK(pbyBlock);
+		std::memset(pbyBlock, 0xAA, uIndex % 300);
+	}
+	HARNESS_CHECK(!vArena.Allocate(std::nothrow, SIZE_MAX - 8));
+}
+
+HARNESS_TEST(MonotonicArenaScopes){
+	HARNESS_CHECK(MonotonicArena::GetCurrent() == nullptr);
+	HARNESS_CHECK(!MonotonicArenaAllocator()(std::nothrow, 16));
+	MonotonicArena vOuter, vInner;
+	{
+		const MonotonicArena::Scope vOuterScope(vOuter);
+		HARNESS_CHECK(MonotonicArena::GetCurrent() == &vOuter);
+		{
+			const MonotonicArena::Scope vInnerScope(vInner);
+			HARNESS_CHECK(MonotonicArena::GetCurrent() == &vInner);
+			// 其他线程不受当前线程的 Scope 影响。
+			Harness::RunInThreads(1, [](unsigned){
+				HARNESS_CHECK(MonotonicArena::GetCurrent() == nullptr);
+			});
+		}
+		HARNESS_CHECK(MonotonicArena::GetCurrent() == &vOuter);
+
+		Vector<unsigned, MonotonicArenaAllocator> vecItems;
+		for(unsigned uIndex = 0; uIndex < 10000; ++uIndex){
+			vecItems.Push(uIndex);
+		}
+		for(unsigned uIndex = 0; uIndex < 10000; ++uIndex){
+			HARNESS_CHECK(vecItems[uIndex] == uIndex);
+		}
+	}
+	HARNESS_CHECK(MonotonicArena::GetCurrent() == nullptr);
+}
+
+HARNESS_BENCH(MonotonicArenaRequestWorkload){
+	// 单位是纳秒每个请求，由所有线程平摊。每个请求创建并销毁 48 个容器。
+	constexpr unsigned kRequests = 20000;
+	static constexpr unsigned kThreadCounts[] = { 1, 2, 4, 8, 16 };
+	std::printf("  threads | DefaultAllocator | MonotonicArena | speedup\n");
+	for(const auto uThreads : kThreadCounts){
+		const auto dDefault = MeasureDefaultAllocator(uThreads, kRequests);
+		const auto dArena = MeasureMonotonicArena(uThreads, kRequests);
+		std::printf("  %7u | %16.2f | %14.2f | %6.2fx\n", uThreads, dDefault, dArena, dDefault / dArena);
+		std::fflush(stdout);
+	}
+}
@@ -0,0 +1,103 @@
+#include "Harness.hpp"
+#include <MCFCRT/env/_mopthread.h>
+
+using namespace MCF;
+
+namespace {
+
+// 线程函数收到的是参数的副本，它可以修改这个副本，等待线程的一方在 __MCFCRT_MopthreadJoin() 中把它取回。
+struct Params {
+	std::uint64_t u64Input;
+	std::uint64_t u64Output;
+};
+
+void SquareProc(void *pParams){
+	const auto pMyParams = static_cast<Params *>(pParams);
+	pMyParams->u64Output = pMyParams->u64Input * pMyParams->u64Input;
+}
+
+void EmptyProc(void *){
+}
+
+std::uintptr_t CreateSquareThread(std::uint64_t u64Input){
+	const Params vParams = { u64Input, 0 };
+	const auto uTid = ::__MCFCRT_MopthreadCreate(&SquareProc, &vParams, sizeof(vParams));
+	HARNESS_CHECK(uTid != 0);
+	return uTid;
+}
+void JoinSquareThread(std::uintptr_t uTid, std::uint64_t u64Input){
+	Params vParams;
+	std::size_t uSize = sizeof(vParams);
+	HARNESS_CHECK(::__MCFCRT_MopthreadJoin(uTid, &vParams, &uSize));
+	HARNESS_CHECK(uSize == sizeof(vParams));
+	HARNESS_CHECK(vParams.u64Input == u64Input);
+	HARNESS_CHECK(vParams.u64Output == u64Input * u64Input);
+}
+
+}
+
+HARNESS_TEST(MopthreadJoinReturnsParams){
+	// 一个线程只能被等待一次；被分离的线程不能被等待。
+	const auto uTid = CreateSquareThread(12345);
+	JoinSquareThread(uTid, 12345);
+	HARNESS_CHECK(!::__MCFCRT_MopthreadJoin(uTid, nullptr, nullptr));
+	HARNESS_CHECK(!::__MCFCRT_MopthreadDetach(uTid));
+
+	const auto uDetached = ::__MCFCRT_MopthreadCreate(&EmptyProc, nullptr, 0);
+	HARNESS_CHECK(uDetached != 0);
+	HARNESS_CHECK(::__MCFCRT_MopthreadDetach(uDetached));
+	HARNESS_CHECK(!::__MCFCRT_MopthreadJoin(uDetached, nullptr, nullptr));
+	HARNESS_CHECK(::__MCFCRT_MopthreadCreateDetached(&EmptyProc, nullptr, 0) != 0);
+
+	// 参数区超过控制块池的上限时，控制块来自堆，行为相同。
+	struct LargeParams {
+		std::uint64_t au64Data[64];
+	} vLarge = { };
+	vLarge.au64Data[63] = 42;
+	const auto uLargeTid = ::__MCFCRT_MopthreadCreate([](void *pParams){ static_cast<LargeParams *>(pParams)->au64Data[0] = 7; }, &vLarge, sizeof(vLarge));
+	HARNESS_CHECK(uLargeTid != 0);
+	std::size_t uSize = sizeof(vLarge);
+	HARNESS_CHECK(::__MCFCRT_MopthreadJoin(uLargeTid, &vLarge, &uSize));
+	HARNESS_CHECK((vLarge.au64Data[0] == 7) && (vLarge.au64Data[63] == 42));
+}
+
+HARNESS_TEST(MopthreadJoinsFromOtherThreads){
+	// 控制块从创建者所在的分片中取出，最后一个引用把它还给原来的分片，不论等待者是哪个线程。
+	// 这里每个线程等待的是另一个线程创建的线程。
+	constexpr unsigned kCreators = 8;
+	constexpr unsigned kThreadsPerCreator = 500;
+	static std::uintptr_t s_auTids[kCreators][kThreadsPerCreator];
+	Atomic<unsigned> uCreated(0);
+	Harness::RunInThreads(kCreators, [&](unsigned uIndex){
+		for(unsigned uThread = 0; uThread < kThreadsPerCreator; ++uThread){
+			s_auTids[uIndex][uThread] = CreateSquareThread(uIndex * kThreadsPerCreator + uThread);
+		}
+		uCreated.Increment(kAtomicAcqRel);
+		while(uCreated.Load(kAtomicAcquire) != kCreators){
+			YieldThread();
+		}
+		const auto uOther = (uIndex + 1) % kCreators;
+		for(unsigned uThread = 0; uThread < kThreadsPerCreator; ++uThread){
+			JoinSquareThread(s_auTids[uOther][uThread], uOther * kThreadsPerCreator + uThread);
+		}
+	});
+}
+
+HARNESS_BENCH(MopthreadCreateJoinScaling){
+	// 每个创建者线程反复创建一个线程并立即等待它结束。单位是微秒每个线程，由所有创建者平摊；总吞吐量是每秒创建并等待的线程数。
+	constexpr unsigned kThreadsPerCreator = 2000;
+	static constexpr unsigned kCreatorCounts[] = { 1, 2, 4, 8, 16 };
+	std::printf("  creators | us per thread | threads per second\n");
+	for(const auto uCreators : kCreatorCounts){
+		const auto dTotal = Harness::RunInThreads(uCreators, [&](unsigned){
+			for(unsigned uThread = 0; uThread < kThreadsPerCreator; ++uThread){
+				const auto uTid = ::__MCFCRT_MopthreadCreate(&EmptyProc, nullptr, 0);
+				HARNESS_CHECK(uTid != 0);
+				HARNESS_CHECK(::__MCFCRT_MopthreadJoin(uTid, nullptr, nullptr));
+			}
+		});
+		const auto dThreads = static_cast<double>(kThreadsPerCreator) * uCreators;
+		std::printf("  %8u | %13.2f | %18.0f\n", uCreators, dTotal / 1000 / dThreads, dThreads / (dTotal / 1.0e9));
+		std::fflush(stdout);
+	}
+}
@@ -0,0 +1,227 @@
+#include "Harness.hpp"
+#include <MCF/Thread/ParallelAlgorithms.hpp>
+#include <MCF/Core/ArrayView.hpp>
+#include <algorithm>
+#include <numeric>
+
+using namespace MCF;
+
+namespace {
+
+// 覆盖空区间、单个元素、粒度边界附近和较大的区间。
+constexpr std::size_t kSizes[] = { 0, 1, 2, 3, 1023, 1024, 1025, 4097, 100000 };
+// 零表示自动选择。粒度为 1 时每一段只有一个元素，递归最深。
+constexpr std::size_t kGrainSizes[] = { 0, 1, 7, 1000 };
+
+std::uint32_t NextRandom(std::uint32_t &u32Seed){
+	u32Seed = u32Seed * 1103515245u + 12345u;
+	return u32Seed >> 8;
+}
+
+// 2x2 矩阵乘法满足结合律但不满足交换律，用来检查归约和扫描是否保持了顺序。
+struct Matrix {
+	std::uint64_t a, b, c, d;
+
+	bool operator==(const Matrix &rhs) const noexcept {
+		return (a == rhs.a) && (b == rhs.b) && (c == rhs.c) && (d == rhs.d);
+	}
+};
+
+Matrix Multiply(const Matrix &lhs, const Matrix &rhs) noexcept {
+	return { lhs.a * rhs.a + lhs.b * rhs.c, lhs.a * rhs.b + lhs.b * rhs.d, lhs.c * rhs.a + lhs.d * rhs.c, lhs.c * rhs.b + lhs.d * rhs.d };
+}
+
+Vector<Matrix> MakeMatrices(std::size_t uSize){
+	Vector<Matrix> vecMatrices;
+	std::uint32_t u32Seed = static_cast<std::uint32_t>(uSize);
+	for(std::size_t uIndex = 0; uIndex < uSize; ++uIndex){
+		vecMatrices.Push(Matrix{ NextRandom(u32Seed), NextRandom(u32Seed), NextRandom(u32Seed), NextRandom(u32Seed) });
+	}
+	return vecMatrices;
+}
+
+enum Shape {
+	kShapeRandom,
+	kShapeFewDistinct,
+	kShapeSorted,
+	kShapeReversed,
+};
+
+Vector<std::uint32_t> MakeKeys(std::size_t uSize, Shape eShape){
+	Vector<std::uint32_t> vecKeys;
+	std::uint32_t u32Seed = static_cast<std::uint32_t>(uSize * 4 + static_cast<unsigned>(eShape));
+	for(std::size_t uIndex = 0; uIndex < uSize; ++uIndex){
+		switch(eShape){
+		case kShapeRandom:
+			vecKeys.Push(NextRandom(u32Seed));
+			break;
+		case kShapeFewDistinct:
+			vecKeys.Push(NextRandom(u32Seed) % 3);
+			break;
+		case kShapeSorted:
+			vecKeys.Push(static_cast<std::uint32_t>(uIndex));
+			break;
+		case kShapeReversed:
+			vecKeys.Push(static_cast<std::uint32_t>(uSize - uIndex));
+			break;
+		}
+	}
+	return vecKeys;
+}
+
+}
+
+HARNESS_TEST(ParallelForVisitsEachIndexOnce){
+	for(const auto uSize : kSizes){
+		for(const auto uGrainSize : kGrainSizes){
+			// Atomic 不能移动，不能放在 Vector 中。
+			static Atomic<unsigned> s_auVisits[kSizes[sizeof(kSizes) / sizeof(kSizes[0]) - 1]];
+			for(std::size_t uIndex = 0; uIndex < uSize; ++uIndex){
+				s_auVisits[uIndex].Store(0, kAtomicRelaxed);
+			}
+			// 起点不为零，检查下标没有被平移。
+			ParallelFor(5, uSize + 5, [&](std::size_t uIndex){ s_auVisits[uIndex - 5].Increment(kAtomicRelaxed); }, uGrainSize);
+			for(std::size_t uIndex = 0; uIndex < uSize; ++uIndex){
+				HARNESS_CHECK(s_auVisits[uIndex].Load(kAtomicRelaxed) == 1);
+			}
+		}
+	}
+	// 在工作线程中嵌套调用。
+	Atomic<std::size_t> uTotal(0);
+	ParallelFor(0, 64, [&](std::size_t){
+		ParallelFor(0, 1000, [&](std::size_t){ uTotal.Increment(kAtomicRelaxed); }, 10);
+	}, 1);
+	HARNESS_CHECK(uTotal.Load(kAtomicRelaxed) == 64000);
+}
+
+HARNESS_TEST(ParallelTransformAndReduceKeepOrder){
+	for(const auto uSize : kSizes){
+		const auto vecMatrices = MakeMatrices(uSize);
+		Matrix vExpected = { 1, 0, 0, 1 };
+		for(const auto &vMatrix : vecMatrices){
+			vExpected = Multiply(vExpected, vMatrix);
+		}
+		for(const auto uGrainSize : kGrainSizes){
+			const auto vResult = ParallelReduce(vecMatrices, Matrix{ 1, 0, 0, 1 }, [](const Matrix &lhs, const Matrix &rhs){ return Multiply(lhs, rhs); }, uGrainSize);
+			HARNESS_CHECK(vResult == vExpected);
+
+			// 输出到另一个区间，以及原地变换。
+			Vector<std::uint64_t> vecOutput(uSize, std::uint64_t());
+			ParallelTransform(vecMatrices, vecOutput, [](const Matrix &vMatrix){ return vMatrix.a + vMatrix.d; }, uGrainSize);
+			auto vecInPlace = MakeMatrices(uSize);
+			ParallelTransform(vecInPlace, vecInPlace, [](const Matrix &vMatrix){ return Multiply(vMatrix, vMatrix); }, uGrainSize);
+			for(std::size_t uIndex = 0; uIndex < uSize; ++uIndex){
+				HARNESS_CHECK(vecOutput[uIndex] == vecMatrices[uIndex].a + vecMatrices[uIndex].d);
+				HARNESS_CHECK(vecInPlace[uIndex] == Multiply(vecMatrices[uIndex], vecMatrices[uIndex]));
+			}
+		}
+	}
+}
+
+HARNESS_TEST(ParallelSortMatchesSerialSort){
+	for(const auto uSize : kSizes){
+		for(const auto eShape : { kShapeRandom, kShapeFewDistinct, kShapeSorted, kShapeReversed }){
+			auto vecExpected = MakeKeys(uSize, eShape);
+			std::sort(vecExpected.GetBegin(), vecExpected.GetEnd());
+			for(const auto uGrainSize : kGrainSizes){
+				auto vecKeys = MakeKeys(uSize, eShape);
+				ParallelSort(vecKeys, Less(), uGrainSize);
+				HARNESS_CHECK(std::equal(vecKeys.GetBegin(), vecKeys.GetEnd(), vecExpected.GetBegin()));
+
+				// 通过 ArrayView 排序区间的一部分，使用自定义的比较器。
+				auto vecPartial = MakeKeys(uSize, eShape);
+				const auto uSkip = uSize / 4;
+				ParallelSort(ArrayView<std::uint32_t>(vecPartial.GetData() + uSkip, uSize - uSkip * 2), Greater(), uGrainSize);
+				HARNESS_CHECK(std::is_sorted(vecPartial.GetBegin() + uSkip, vecPartial.GetEnd() - uSkip, [](std::uint32_t lhs, std::uint32_t rhs){ return lhs > rhs; }));
+				const auto vecOriginal = MakeKeys(uSize, eShape);
+				HARNESS_CHECK(std::equal(vecPartial.GetBegin(), vecPartial.GetBegin() + uSkip, vecOriginal.GetBegin()));
+				HARNESS_CHECK(std::equal(vecPartial.GetEnd() - uSkip, vecPartial.GetEnd(), vecOriginal.GetEnd() - uSkip));
+			}
+		}
+	}
+}
+
+HARNESS_TEST(ParallelInclusiveScanMatchesSerialScan){
+	for(const auto uSize : kSizes){
+		const auto vecMatrices = MakeMatrices(uSize);
+		Vector<Matrix> vecExpected;
+		for(std::size_t uIndex = 0; uIndex < uSize; ++uIndex){
+			vecExpected.Push((uIndex == 0) ? vecMatrices[0] : Multiply(vecExpected[uIndex - 1], vecMatrices[uIndex]));
+		}
+		for(const auto uGrainSize : kGrainSizes){
+			Vector<Matrix> vecOutput(uSize, Matrix());
+			ParallelInclusiveScan(vecMatrices, vecOutput, [](const Matrix &lhs, const Matrix &rhs){ return Multiply(lhs, rhs); }, uGrainSize);
+			auto vecInPlace = MakeMatrices(uSize);
+			ParallelInclusiveScan(vecInPlace, vecInPlace, [](const Matrix &lhs, const Matrix &rhs){ return Multiply(lhs, rhs); }, uGrainSize);
+			for(std::size_t uIndex = 0; uIndex < uSize; ++uIndex){
+				HARNESS_CHECK(vecOutput[uIndex] == vecExpected[uIndex]);
+				HARNESS_CHECK(vecInPlace[uIndex] == vecExpected[uIndex]);
+			}
+		}
+	}
+}
+
+HARNESS_TEST(ParallelForRethrowsAfterAllSegmentsFinish){
+	constexpr std::size_t kSize = 100000;
+	Atomic<std::size_t> uVisited(0);
+	bool bCaught = false;
+	try {
+		ParallelFor(0, kSize, [&](std::size_t uIndex){
+			uVisited.Increment(kAtomicRelaxed);
+			if(uIndex % 10007 == 5){
+				throw uIndex;
+			}
+		}, 100);
+	} catch(std::size_t uIndex){
+		HARNESS_CHECK(uIndex % 10007 == 5);
+		bCaught = true;
+	}
+	HARNESS_CHECK(bCaught);
+	// 抛出异常的段停止了，其他段仍然执行完毕，所以至少有这么多下标被访问过。
+	HARNESS_CHECK(uVisited.Load(kAtomicRelaxed) >= kSize - 100 * (kSize / 10007 + 1));
+}
+
+HARNESS_BENCH(ParallelAlgorithmsScaling){
+	// 单位是毫秒。串行版本使用相同的元素和标准库算法。
+	static constexpr std::size_t kBenchSizes[] = {
+		10000, 100000, 1000000, 10000000,
+#ifdef _WIN64
+		100000000,
+#endif
+	};
+	std::printf("  workers = %zu\n", GetDefaultThreadPool().GetWorkerCount());
+	std::printf("  elements  | sort: serial / parallel | transform: serial / parallel | reduce: serial / parallel | scan: serial / parallel\n");
+	for(const auto uSize : kBenchSizes){
+		const auto vecKeys = MakeKeys(uSize, kShapeRandom);
+		Vector<std::uint32_t> vecWork(uSize, 0u);
+		Vector<std::uint64_t> vecOutput(uSize, std::uint64_t());
+		const auto fnTime = [](auto &&fnProc){
+			const auto dBegin = GetHiResMonoClock();
+			fnProc();
+			return GetHiResMonoClock() - dBegin;
+		};
+		const auto fnTransform = [](std::uint32_t u32Key){ return static_cast<std::uint64_t>(u32Key) * u32Key + (u32Key >> 3); };
+		const auto fnAdd = [](std::uint64_t lhs, std::uint64_t rhs){ return lhs + rhs; };
+
+		std::copy(vecKeys.GetBegin(), vecKeys.GetEnd(), vecWork.GetBegin());
+		const auto dSortSerial = fnTime([&]{ std::sort(vecWork.GetBegin(), vecWork.GetEnd()); });
+		std::copy(vecKeys.GetBegin(), vecKeys.GetEnd(), vecWork.GetBegin());
+		const auto dSortParallel = fnTime([&]{ ParallelSort(vecWork); });
+		HARNESS_CHECK(std::is_sorted(vecWork.GetBegin(), vecWork.GetEnd()));
+
+		const auto dTransformSerial = fnTime([&]{ std::transform(vecKeys.GetBegin(), vecKeys.GetEnd(), vecOutput.GetBegin(), fnTransform); });
+		const auto dTransformParallel = fnTime([&]{ ParallelTransform(vecKeys, vecOutput, fnTransform); });
+
+		std::uint64_t u64Serial = 0, u64Parallel = 0;
+		const auto dReduceSerial = fnTime([&]{ u64Serial = std::accumulate(vecOutput.GetBegin(), vecOutput.GetEnd(), std::uint64_t()); });
+		const auto dReduceParallel = fnTime([&]{ u64Parallel = ParallelReduce(vecOutput, std::uint64_t(), fnAdd); });
+		HARNESS_CHECK(u64Serial == u64Parallel);
+
+		const auto dScanSerial = fnTime([&]{ std::partial_sum(vecOutput.GetBegin(), vecOutput.GetEnd(), vecOutput.GetBegin()); });
+		const auto dScanParallel = fnTime([&]{ ParallelInclusiveScan(vecOutput, vecOutput, fnAdd); });
+
+		std::printf("  %9zu | %10.3f / %10.3f | %15.3f / %10.3f | %12.3f / %10.3f | %10.3f / %10.3f\n", uSize,
+			dSortSerial, dSortParallel, dTransformSerial, dTransformParallel, dReduceSerial, dReduceParallel, dScanSerial, dScanParallel);
+		std::fflush(stdout);
+	}
+}
@@ -0,0 +1,239 @@
+#include "Harness.hpp"
+#include <MCF/Thread/Mutex.hpp>
+#include <MCF/Thread/ReadersWriterMutex.hpp>
+
+using namespace MCF;
+
+namespace {
+
+// 等待条件成立，最多等待 u64Milliseconds 毫秒。返回条件最终是否成立。
+template<typename PredicateT>
+bool WaitUntil(std::uint64_t u64Milliseconds, const PredicateT &fnPredicate){
+	const auto u64Until = GetFastMonoClock() + u64Milliseconds;
+	while(!fnPredicate()){
+		if(GetFastMonoClock() >= u64Until){
+			return false;
+		}
+		YieldThread();
+	}
+	return true;
+}
+
+// 写者开始等待之后，新的读者就不能再进入了。用这一点判断写者是否已经在等待。
+bool WaitUntilWriterIsWaiting(ReadersWriterMutex &vRwLock){
+	return WaitUntil(5000, [&]{
+		if(vRwLock.TryAsReader()){
+			vRwLock.UnlockAsReader();
+			return false;
+		}
+		return true;
+	});
+}
+
+// 原来的实现：读者通过一个互斥锁排队，第一个读者和写者争夺另一个互斥锁。
+class LegacyReadersWriterMutex {
+private:
+	Mutex x_mtxReaderGuard;
+	Mutex x_mtxExclusive;
+	Atomic<std::size_t> x_uReaderCount;
+
+public:
+	void LockAsReader() noexcept {
+		x_mtxReaderGuard.Lock();
+		if(x_uReaderCount.Increment(kAtomicRelaxed) == 1){
+			x_mtxExclusive.Lock();
+		}
+		x_mtxReaderGuard.Unlock();
+	}
+	void UnlockAsReader() noexcept {
+		if(x_uReaderCount.Decrement(kAtomicRelaxed) == 0){
+			x_mtxExclusive.Unlock();
+		}
+	}
+	void LockAsWriter() noexcept {
+		x_mtxReaderGuard.Lock();
+		x_mtxExclusive.Lock();
+	}
+	void UnlockAsWriter() noexcept {
+		x_mtxExclusive.Unlock();
+		x_mtxReaderGuard.Unlock();
+	}
+};
+
+// 受保护的数据。写者总是同时修改两个成员，读者检查它们是否相等。
+struct alignas(64) Protected {
+	std::uint64_t u64First = 0;
+	std::uint64_t u64Second = 0;
+};
+
+// 每个线程执行 uOperations 次操作，每 uWriteInterval 次中有一次是写操作，0 表示只读。返回每次操作的平均时间，由所有线程平摊，单位是纳秒。
+template<typename RwLockT>
+double MeasureReadHeavy(unsigned uThreadCount, unsigned uWriteInterval){
+	constexpr unsigned kOperations = 200000;
+	RwLockT vRwLock;
+	Protected vData;
+	const auto dTotal = Harness::RunInThreads(uThreadCount, [&](unsigned){
+		for(unsigned uOperation = 0; uOperation < kOperations; ++uOperation){
+			if((uWriteInterval != 0) && (uOperation % uWriteInterval == 0)){
+				vRwLock.LockAsWriter();
+				++vData.u64First;
+				++vData.u64Second;
+				vRwLock.UnlockAsWriter();
+			} else {
+				vRwLock.LockAsReader();
+				const auto u64First = vData.u64First;
+				const auto u64Second = vData.u64Second;
+				vRwLock.UnlockAsReader();
+				HARNESS_CHECK(u64First == u64Second);
+			}
+		}
+	});
+	return dTotal / (static_cast<double>(kOperations) * uThreadCount);
+}
+
+}
+
+HARNESS_TEST(ReadersWriterMutexExcludesWriters){
+	constexpr unsigned kThreads = 16;
+	constexpr unsigned kOperations = 100000;
+	ReadersWriterMutex vRwLock;
+	Protected vData;
+	Atomic<unsigned> uReadersInside(0);
+	Atomic<unsigned> uMaxReadersInside(0);
+	Harness::RunInThreads(kThreads, [&](unsigned uIndex){
+		for(unsigned uOperation = 0; uOperation < kOperations; ++uOperation){
+			if((uIndex % 4 == 0) && (uOperation % 16 == 0)){
+				const auto vLock = vRwLock.GetLockAsWriter();
+				HARNESS_CHECK(uReadersInside.Load(kAtomicRelaxed) == 0);
+				++vData.u64First;
+				++vData.u64Second;
+			} else {
+				const auto vLock = vRwLock.GetLockAsReader();
+				const auto uInside = uReadersInside.Increment(kAtomicRelaxed);
+				auto uMax = uMaxReadersInside.Load(kAtomicRelaxed);
+				while((uMax < uInside) && !uMaxReadersInside.CompareExchange(uMax, uInside, kAtomicRelaxed)){ }
+				HARNESS_CHECK(vData.u64First == vData.u64Second);
+				uReadersInside.Decrement(kAtomicRelaxed);
+			}
+		}
+	});
+	HARNESS_CHECK(vData.u64First == 4 * (kOperations / 16));
+	// 读者是否真的同时进入取决于调度，这里只打印出来。下一个用例会确定地检查这一点。
+	std::printf("  at most %u readers inside at once\n", uMaxReadersInside.Load(kAtomicRelaxed));
+}
+
+HARNESS_TEST(ReadersWriterMutexHandsOffBetweenReadersAndWriters){
+	constexpr unsigned kQueuedReaders = 4;
+	ReadersWriterMutex vRwLock;
+	Atomic<bool> bWriterInside(false);
+	Atomic<bool> bWriterMayLeave(false);
+	Atomic<unsigned> uQueuedReadersInside(0);
+
+	// 当前线程作为读者持有锁，写者只能等待。
+	vRwLock.LockAsReader();
+	const auto fnWriter = [&]{
+		vRwLock.LockAsWriter();
+		bWriterInside.Store(true, kAtomicRelease);
+		while(!bWriterMayLeave.Load(kAtomicAcquire)){
+			YieldThread();
+		}
+		bWriterInside.Store(false, kAtomicRelease);
+		vRwLock.UnlockAsWriter();
+	};
+	const auto pWriter = MakeThread(fnWriter);
+	// 写者优先：写者开始等待之后，新的读者不能进入，即使锁仍由读者持有。
+	HARNESS_CHECK(WaitUntilWriterIsWaiting(vRwLock));
+	HARNESS_CHECK(!bWriterInside.Load(kAtomicAcquire));
+
+	// 最后一个读者离开时，锁交给写者。
+	vRwLock.UnlockAsReader();
+	HARNESS_CHECK(WaitUntil(5000, [&]{ return bWriterInside.Load(kAtomicAcquire); }));
+	HARNESS_CHECK(!vRwLock.TryAsReader(GetFastMonoClock() + 20));
+	HARNESS_CHECK(!vRwLock.TryAsWriter(GetFastMonoClock() + 20));
+
+	// 在写者持有锁时排队的读者，在写者离开后一起进入。每个读者都要等到其他读者也进入之后才离开。
+	const auto fnReader = [&]{
+		vRwLock.LockAsReader();
+		HARNESS_CHECK(!bWriterInside.Load(kAtomicAcquire));
+		uQueuedReadersInside.Increment(kAtomicAcqRel);
+		HARNESS_CHECK(WaitUntil(5000, [&]{ return uQueuedReadersInside.Load(kAtomicAcquire) == kQueuedReaders; }));
+		vRwLock.UnlockAsReader();
+	};
+	Vector<IntrusivePtr<Thread>> vecReaders;
+	for(unsigned uIndex = 0; uIndex < kQueuedReaders; ++uIndex){
+		vecReaders.Push(MakeThread(fnReader));
+	}
+	Sleep(GetFastMonoClock() + 50);
+	HARNESS_CHECK(uQueuedReadersInside.Load(kAtomicAcquire) == 0);
+	bWriterMayLeave.Store(true, kAtomicRelease);
+	pWriter->Wait();
+	for(const auto &pReader : vecReaders){
+		pReader->Wait();
+	}
+	HARNESS_CHECK(uQueuedReadersInside.Load(kAtomicAcquire) == kQueuedReaders);
+
+	// 所有人都离开之后，锁应该是空闲的。
+	HARNESS_CHECK(vRwLock.TryAsWriter());
+	vRwLock.UnlockAsWriter();
+}
+
+HARNESS_TEST(ReadersWriterMutexTimedOutWriterLetsReadersIn){
+	// 一个读者持有锁，一个写者带超时等待，另一个读者排在写者之后。
+	// 写者超时放弃之后，没有人会在释放锁时唤醒排队的读者，所以写者必须自己放它们进来。
+	ReadersWriterMutex vRwLock;
+	Atomic<bool> bWriterGaveUp(false);
+	Atomic<bool> bReaderInside(false);
+
+	vRwLock.LockAsReader();
+	const auto fnWriter = [&]{
+		const auto u64Begin = GetFastMonoClock();
+		HARNESS_CHECK(!vRwLock.TryAsWriter(u64Begin + 200));
+		HARNESS_CHECK(GetFastMonoClock() >= u64Begin + 150);
+		bWriterGaveUp.Store(true, kAtomicRelease);
+	};
+	const auto pWriter = MakeThread(fnWriter);
+	HARNESS_CHECK(WaitUntilWriterIsWaiting(vRwLock));
+	const auto fnReader = [&]{
+		vRwLock.LockAsReader();
+		bReaderInside.Store(true, kAtomicRelease);
+		vRwLock.UnlockAsReader();
+	};
+	const auto pReader = MakeThread(fnReader);
+
+	pWriter->Wait();
+	HARNESS_CHECK(bWriterGaveUp.Load(kAtomicAcquire));
+	// 第一个读者仍然持有锁。
+	HARNESS_CHECK(WaitUntil(5000, [&]{ return bReaderInside.Load(kAtomicAcquire); }));
+	pReader->Wait();
+	vRwLock.UnlockAsReader();
+
+	// 读者在写者持有锁时带超时等待，超时之后写者仍然可以正常释放锁。
+	vRwLock.LockAsWriter();
+	const auto fnTimedReader = [&]{
+		HARNESS_CHECK(!vRwLock.TryAsReader(GetFastMonoClock() + 50));
+	};
+	MakeThread(fnTimedReader)->Wait();
+	vRwLock.UnlockAsWriter();
+	HARNESS_CHECK(vRwLock.TryAsReader());
+	vRwLock.UnlockAsReader();
+}
+
+HARNESS_BENCH(ReadersWriterMutexScaling){
+	// 单位是纳秒每次操作，由所有线程平摊。两个互斥锁组成的读写锁是原来的实现。
+	static constexpr unsigned kThreadCounts[] = { 1, 2, 4, 8, 16, 32, 64 };
+	static constexpr unsigned kWriteIntervals[] = { 0, 1000, 100 };
+	for(const auto uWriteInterval : kWriteIntervals){
+		if(uWriteInterval == 0){
+			std::printf("  reads only\n");
+		} else {
+			std::printf("  one write per %u operations\n", uWriteInterval);
+		}
+		std::printf("  threads | native  | two mutexes | speedup\n");
+		for(const auto uThreads : kThreadCounts){
+			const auto dNative = MeasureReadHeavy<ReadersWriterMutex>(uThreads, uWriteInterval);
+			const auto dLegacy = MeasureReadHeavy<LegacyReadersWriterMutex>(uThreads, uWriteInterval);
+			std::printf("  %7u | %7.2f | %11.2f | %6.2fx\n", uThreads, dNative, dLegacy, dLegacy / dNative);
+			std::fflush(stdout);
+		}
+	}
+}
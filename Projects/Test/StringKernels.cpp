@@ -0,0 +1,290 @@
+#include "Harness.hpp"
+#include <MCFCRT/env/_cpu_features.h>
+#include <MCFCRT/ext/rawmemchr.h>
+#include <cstring>
+
+using namespace MCF;
+
+// 把 memchr()、_MCFCRT_rawmemchr()、strlen()、strcmp() 和 memcmp() 与逐字节的实现对比。
+// 短数据覆盖所有长度、所有对齐和所有匹配位置；长数据只覆盖 32 和 64 字节边界附近的情况。
+// 数据或者放在缓冲区中间，两侧填上会导致错误结果的字节；或者紧贴着不可访问页，越界读取会立即崩溃。
+
+namespace {
+
+constexpr std::size_t kAlignmentCount = 64;
+constexpr std::size_t kShortLengthMax = 300;
+constexpr std::size_t kLongLengths[] = { 511, 512, 513, 1023, 1024, 1025, 4095, 4096, 4097, 10000 };
+constexpr std::size_t kNoMatch = SIZE_MAX;
+
+// 所有用于比较的字节值，包括会被有符号比较弄错的值。
+constexpr unsigned char kInterestingBytes[] = { 0x00, 0x01, 0x41, 0x7F, 0x80, 0x81, 0xFE, 0xFF };
+
+class Random {
+private:
+	std::uint32_t x_u32State = 0x12345678;
+
+public:
+	unsigned char GetByteExcept(unsigned char byExcluded) noexcept {
+		for(;;){
+			x_u32State ^= x_u32State << 13;
+			x_u32State ^= x_u32State >> 17;
+			x_u32State ^= x_u32State << 5;
+			const auto byValue = static_cast<unsigned char>(x_u32State >> 24);
+			if(byValue != byExcluded){
+				return byValue;
+			}
+		}
+	}
+};
+
+Random g_vRandom;
+
+struct Case {
+	const char *pszKernel;
+	std::size_t uLength;
+	std::size_t uOffset1;
+	std::size_t uOffset2;
+	std::size_t uPosition;
+	unsigned uValue;
+};
+
+void Expect(bool bOk, const Case &vCase){
+	if(bOk){
+		return;
+	}
+	std::printf("  %s: length = %zu, offset1 = %zu, offset2 = %zu, position = %zd, value = %#x\n",
+		vCase.pszKernel, vCase.uLength, vCase.uOffset1, vCase.uOffset2, static_cast<std::ptrdiff_t>(vCase.uPosition), vCase.uValue);
+	Harness::Fail(__FILE__, __LINE__, "SIMD 实现的结果与逐字节实现的结果不同");
+}
+
+int GetSign(int nValue) noexcept {
+	return (nValue > 0) - (nValue < 0);
+}
+
+const void *ReferenceMemchr(const void *pData, int nValue, std::size_t uSize) noexcept {
+	const auto pbyData = static_cast<const unsigned char *>(pData);
+	for(std::size_t uIndex = 0; uIndex < uSize; ++uIndex){
+		if(pbyData[uIndex] == static_cast<unsigned char>(nValue)){
+			return pbyData + uIndex;
+		}
+	}
+	return nullptr;
+}
+int ReferenceMemcmp(const void *p1, const void *p2, std::size_t uSize) noexcept {
+	const auto pby1 = static_cast<const unsigned char *>(p1);
+	const auto pby2 = static_cast<const unsigned char *>(p2);
+	for(std::size_t uIndex = 0; uIndex < uSize; ++uIndex){
+		if(pby1[uIndex] != pby2[uIndex]){
+			return (pby1[uIndex] < pby2[uIndex]) ? -1 : 1;
+		}
+	}
+	return 0;
+}
+int ReferenceStrcmp(const char *psz1, const char *psz2) noexcept {
+	const auto pby1 = reinterpret_cast<const unsigned char *>(psz1);
+	const auto pby2 = reinterpret_cast<const unsigned char *>(psz2);
+	for(std::size_t uIndex = 0; ; ++uIndex){
+		if(pby1[uIndex] != pby2[uIndex]){
+			return (pby1[uIndex] < pby2[uIndex]) ? -1 : 1;
+		}
+		if(pby1[uIndex] == 0){
+			return 0;
+		}
+	}
+}
+
+// 对每个长度调用 vProc(uLength, bExhaustive)。bExhaustive 为真时应该测试每一个位置。
+template<typename ProcT>
+void ForEachLength(ProcT &&vProc){
+	for(std::size_t uLength = 0; uLength <= kShortLengthMax; ++uLength){
+		vProc(uLength, uLength <= kShortLengthMax / 2);
+	}
+	for(const auto uLength : kLongLengths){
+		vProc(uLength, false);
+	}
+}
+// 对每个需要测试的位置调用 vProc(uPosition)，最后以 kNoMatch 调用一次。
+template<typename ProcT>
+void ForEachPosition(std::size_t uLength, bool bExhaustive, ProcT &&vProc){
+	if(bExhaustive){
+		for(std::size_t uPosition = 0; uPosition < uLength; ++uPosition){
+			vProc(uPosition);
+		}
+	} else {
+		for(std::size_t uBoundary = 0; uBoundary <= uLength; uBoundary += 32){
+			for(std::size_t uPosition = (uBoundary < 2) ? 0 : (uBoundary - 2); (uPosition < uBoundary + 2) && (uPosition < uLength); ++uPosition){
+				vProc(uPosition);
+			}
+		}
+		if(uLength != 0){
+			vProc(uLength - 1);
+		}
+	}
+	vProc(kNoMatch);
+}
+
+void FillExcept(unsigned char *pbyBegin, std::size_t uSize, unsigned char byExcluded){
+	for(std::size_t uIndex = 0; uIndex < uSize; ++uIndex){
+		pbyBegin[uIndex] = g_vRandom.GetByteExcept(byExcluded);
+	}
+}
+
+}
+
+HARNESS_TEST(StringKernelsMemchr){
+	std::printf("  AVX2 = %s\n", (::__MCFCRT_GetCpuFeatures() & ::__MCFCRT_kCpuFeatureAvx2) ? "yes" : "no");
+	const Harness::GuardedPages vPages(0x10000);
+	for(const auto byValue : kInterestingBytes){
+		// 传入的值需要先转换为 unsigned char。
+		const int anValues[] = { byValue, byValue | 0x100, static_cast<signed char>(byValue) };
+		ForEachLength([&](std::size_t uLength, bool bExhaustive){
+			ForEachPosition(uLength, bExhaustive, [&](std::size_t uPosition){
+				for(std::size_t uOffset = 0; uOffset <= kAlignmentCount; ++uOffset){
+					// 最后一次放在不可访问页之前。
+					const auto pbyData = (uOffset < kAlignmentCount) ? (vPages.GetBegin() + 0x1000 + uOffset) : (vPages.GetEnd() - uLength);
+					// 范围之外的字节都等于要找的值。
+					std::memset(pbyData - kAlignmentCount, byValue, kAlignmentCount);
+					FillExcept(pbyData, uLength, byValue);
+					if(pbyData + uLength != vPages.GetEnd()){
+						std::memset(pbyData + uLength, byValue, kAlignmentCount);
+					}
+					if(uPosition != kNoMatch){
+						pbyData[uPosition] = byValue;
+					}
+					const Case vCase = { "memchr", uLength, uOffset, 0, uPosition, byValue };
+					for(const auto nValue : anValues){
+						Expect(std::memchr(pbyData, nValue, uLength) == ReferenceMemchr(pbyData, nValue, uLength), vCase);
+					}
+				}
+			});
+		});
+	}
+}
+
+HARNESS_TEST(StringKernelsRawmemchrAndStrlen){
+	const Harness::GuardedPages vPages(0x10000);
+	for(const auto byValue : kInterestingBytes){
+		ForEachLength([&](std::size_t uLength, bool){
+			for(std::size_t uOffset = 0; uOffset <= kAlignmentCount; ++uOffset){
+				// 要找的字节在 uLength 处。最后一次把它放在不可访问页之前的最后一个字节。
+				const auto pbyData = (uOffset < kAlignmentCount) ? (vPages.GetBegin() + 0x1000 + uOffset) : (vPages.GetEnd() - uLength - 1);
+				std::memset(pbyData - kAlignmentCount, byValue, kAlignmentCount);
+				FillExcept(pbyData, uLength, byValue);
+				pbyData[uLength] = byValue;
+				const Case vCase = { "_MCFCRT_rawmemchr", uLength, uOffset, 0, uLength, byValue };
+				Expect(::_MCFCRT_rawmemchr(pbyData, byValue) == pbyData + uLength, vCase);
+				Expect(::_MCFCRT_rawmemchr(pbyData, static_cast<signed char>(byValue)) == pbyData + uLength, vCase);
+				if(byValue == 0){
+					const Case vStrlenCase = { "strlen", uLength, uOffset, 0, uLength, 0 };
+					Expect(std::strlen(reinterpret_cast<const char *>(pbyData)) == uLength, vStrlenCase);
+				}
+			}
+		});
+	}
+}
+
+HARNESS_TEST(StringKernelsMemcmp){
+	const Harness::GuardedPages vPages1(0x10000), vPages2(0x10000);
+	// 两个操作数的对齐各不相同，再加上紧贴不可访问页的情况。
+	static constexpr std::size_t kOffsets[] = { 0, 1, 2, 3, 7, 8, 15, 16, 17, 31, 32, 33, 47, 63, kAlignmentCount };
+	static constexpr unsigned char kPairs[][2] = { { 0x00, 0x01 }, { 0x7F, 0x80 }, { 0x01, 0xFF }, { 0xFE, 0xFF } };
+	ForEachLength([&](std::size_t uLength, bool bExhaustive){
+		ForEachPosition(uLength, bExhaustive, [&](std::size_t uPosition){
+			for(const auto uOffset1 : kOffsets){
+				for(const auto uOffset2 : kOffsets){
+					const auto pby1 = (uOffset1 < kAlignmentCount) ? (vPages1.GetBegin() + 0x1000 + uOffset1) : (vPages1.GetEnd() - uLength);
+					const auto pby2 = (uOffset2 < kAlignmentCount) ? (vPages2.GetBegin() + 0x1000 + uOffset2) : (vPages2.GetEnd() - uLength);
+					FillExcept(pby1, uLength, 0);
+					std::memcpy(pby2, pby1, uLength);
+					// 范围之后的字节都不相等。
+					if(pby1 + uLength != vPages1.GetEnd()){
+						std::memset(pby1 + uLength, 0x00, kAlignmentCount);
+					}
+					if(pby2 + uLength != vPages2.GetEnd()){
+						std::memset(pby2 + uLength, 0xFF, kAlignmentCount);
+					}
+					const Case vCase = { "memcmp", uLength, uOffset1, uOffset2, uPosition, 0 };
+					if(uPosition == kNoMatch){
+						Expect(std::memcmp(pby1, pby2, uLength) == 0, vCase);
+						continue;
+					}
+					for(const auto &abyPair : kPairs){
+						for(unsigned uSwap = 0; uSwap < 2; ++uSwap){
+							pby1[uPosition] = abyPair[uSwap];
+							pby2[uPosition] = abyPair[1 - uSwap];
+							Expect(GetSign(std::memcmp(pby1, pby2, uLength)) == ReferenceMemcmp(pby1, pby2, uLength), vCase);
+						}
+					}
+				}
+			}
+		});
+	});
+}
+
+HARNESS_TEST(StringKernelsStrcmp){
+	const Harness::GuardedPages vPages1(0x10000), vPages2(0x10000);
+	static constexpr std::size_t kOffsets[] = { 0, 1, 2, 3, 7, 8, 15, 16, 17, 31, 32, 33, 47, 63, kAlignmentCount };
+	// 第二种情况下其中一个字符串提前结束。
+	static constexpr unsigned char kPairs[][2] = { { 0x00, 0x41 }, { 0x7F, 0x80 }, { 0x01, 0xFF }, { 0x41, 0x42 } };
+	ForEachLength([&](std::size_t uLength, bool bExhaustive){
+		ForEachPosition(uLength, bExhaustive, [&](std::size_t uPosition){
+			for(const auto uOffset1 : kOffsets){
+				for(const auto uOffset2 : kOffsets){
+					// 字符串包括结尾的空字符，紧贴不可访问页时空字符是最后一个可读的字节。
+					const auto pby1 = (uOffset1 < kAlignmentCount) ? (vPages1.GetBegin() + 0x1000 + uOffset1) : (vPages1.GetEnd() - uLength - 1);
+					const auto pby2 = (uOffset2 < kAlignmentCount) ? (vPages2.GetBegin() + 0x1000 + uOffset2) : (vPages2.GetEnd() - uLength - 1);
+					FillExcept(pby1, uLength, 0);
+					std::memcpy(pby2, pby1, uLength);
+					pby1[uLength] = 0;
+					pby2[uLength] = 0;
+					// 空字符之后的字节都不相等。
+					if(pby1 + uLength + 1 != vPages1.GetEnd()){
+						std::memset(pby1 + uLength + 1, 0x01, kAlignmentCount);
+					}
+					if(pby2 + uLength + 1 != vPages2.GetEnd()){
+						std::memset(pby2 + uLength + 1, 0xFE, kAlignmentCount);
+					}
+					const auto psz1 = reinterpret_cast<const char *>(pby1);
+					const auto psz2 = reinterpret_cast<const char *>(pby2);
+					const Case vCase = { "strcmp", uLength, uOffset1, uOffset2, uPosition, 0 };
+					if(uPosition == kNoMatch){
+						Expect(std::strcmp(psz1, psz2) == 0, vCase);
+						continue;
+					}
+					for(const auto &abyPair : kPairs){
+						for(unsigned uSwap = 0; uSwap < 2; ++uSwap){
+							pby1[uPosition] = abyPair[uSwap];
+							pby2[uPosition] = abyPair[1 - uSwap];
+							Expect(GetSign(std::strcmp(psz1, psz2)) == ReferenceStrcmp(psz1, psz2), vCase);
+						}
+					}
+				}
+			}
+		});
+	});
+}
+
+HARNESS_BENCH(StringKernelsThroughput){
+	// 单位是字节每纳秒。
+	const Harness::GuardedPages vPages1(0x100000), vPages2(0x100000);
+	static constexpr std::size_t kSizes[] = { 16, 64, 256, 1024, 4096, 65536, 1048575 };
+	std::printf("  AVX2 = %s\n", (::__MCFCRT_GetCpuFeatures() & ::__MCFCRT_kCpuFeatureAvx2) ? "yes" : "no");
+	std::printf("     size |   memchr |   strlen |   memcmp |   strcmp\n");
+	for(const auto uSize : kSizes){
+		const auto pby1 = vPages1.GetEnd() - uSize - 1;
+		const auto pby2 = vPages2.GetEnd() - uSize - 1;
+		FillExcept(pby1, uSize, 0);
+		std::memcpy(pby2, pby1, uSize);
+		pby1[uSize] = 0;
+		pby2[uSize] = 0;
+		const auto psz1 = reinterpret_cast<const char *>(pby1);
+		const auto psz2 = reinterpret_cast<const char *>(pby2);
+		const auto u64Iterations = 1000000000 / (uSize + 64);
+		const auto dSize = static_cast<double>(uSize);
+		const auto dMemchr = dSize / Harness::Measure(u64Iterations, [&]{ Harness::DoNotOptimize(std::memchr(pby1, 0, uSize)); });
+		const auto dStrlen = dSize / Harness::Measure(u64Iterations, [&]{ Harness::DoNotOptimize(std::strlen(psz1)); });
+		const auto dMemcmp = dSize / Harness::Measure(u64Iterations, [&]{ Harness::DoNotOptimize(std::memcmp(pby1, pby2, uSize)); });
+		const auto dStrcmp = dSize / Harness::Measure(u64Iterations, [&]{ Harness::DoNotOptimize(std::strcmp(psz1, psz2)); });
+		std::printf("  %7zu | %8.2f | %8.2f | %8.2f | %8.2f\n", uSize, dMemchr, dStrlen, dMemcmp, dStrcmp);
+	}
+}
@@ -0,0 +1,292 @@
+#include "Harness.hpp"
+#include <MCF/Core/StringView.hpp>
+#include <MCFCRT/ext/memmem.h>
+#include <MCFCRT/ext/wmemmem.h>
+#include <cstring>
+#include <cwchar>
+#include <iterator>
+
+using namespace MCF;
+
+// 把 _MCFCRT_memmem()、_MCFCRT_wmemmem()、strstr()、wcsstr() 和 StringView::Find() 与逐字符的实现对比。
+// 不超过 32 个字符的模式串走首尾字符过滤，更长的走 Two-Way，因此模式串的长度覆盖这个边界两侧。
+// 文本和模式串都紧贴着不可访问页，越界读取会立即崩溃。
+
+namespace {
+
+constexpr std::size_t kShortTextMax = 70;
+constexpr std::size_t kLongTexts[] = { 127, 128, 129, 255, 256, 257, 1000, 4096 };
+constexpr std::size_t kShortPatternMax = 40;
+constexpr std::size_t kLongPatterns[] = { 63, 64, 65, 100, 257, 1000 };
+
+class Random {
+private:
+	std::uint32_t x_u32State = 0x12345678;
+
+public:
+	unsigned Get(unsigned uBound) noexcept {
+		x_u32State ^= x_u32State << 13;
+		x_u32State ^= x_u32State >> 17;
+		x_u32State ^= x_u32State << 5;
+		return static_cast<unsigned>((static_cast<std::uint64_t>(x_u32State) * uBound) >> 32);
+	}
+};
+
+Random g_vRandom;
+
+template<typename CharT>
+const CharT *ReferenceFind(const CharT *pchText, std::size_t uTextLength, const CharT *pchPattern, std::size_t uPatternLength) noexcept {
+	if(uPatternLength > uTextLength){
+		return nullptr;
+	}
+	for(std::size_t uOffset = 0; uOffset <= uTextLength - uPatternLength; ++uOffset){
+		std::size_t uIndex = 0;
+		while((uIndex < uPatternLength) && (pchText[uOffset + uIndex] == pchPattern[uIndex])){
+			++uIndex;
+		}
+		if(uIndex == uPatternLength){
+			return pchText + uOffset;
+		}
+	}
+	return nullptr;
+}
+
+// 字符表中的第 uIndex 个字符。窄字符从 'a' 开始，字符表有 256 个字符时包括空字符。
+// 宽字符中相邻的两个的低字节相同，使以低字节为下标的坏字符表发生冲突。
+char MakeNarrowChar(unsigned uIndex) noexcept {
+	return static_cast<char>((uIndex < 26) ? ('a' + uIndex) : uIndex);
+}
+wchar_t MakeWideChar(unsigned uIndex) noexcept {
+	return static_cast<wchar_t>(0x0061u + uIndex / 2 + ((uIndex % 2 != 0) ? 0xFF00u : 0u));
+}
+
+enum class Shape : unsigned {
+	kCopied,    // 模式串从文本中的随机位置复制，一定能找到。
+	kRandom,    // 模式串是随机的，对于较大的字符表几乎找不到。
+	kNearMiss,  // 同 kCopied，但是最后一个字符被修改。
+	kAtEnd,     // 模式串从文本的末尾复制，匹配紧贴着不可访问页。
+};
+
+// 对每一组文本长度、模式串长度和形状，在 vTextPages 和 vPatternPages 的末尾构造数据，比较 vSearch 和逐字符实现的结果。
+// vSearch(pchText, uTextLength, pchPattern, uPatternLength) 找不到时返回空指针。bNullTerminated 为真时两者之后都有空字符。
+template<typename CharT, typename SearchT>
+void CheckAllShapes(const char *pszKernel, const Harness::GuardedPages &vTextPages, const Harness::GuardedPages &vPatternPages,
+	unsigned uAlphabet, CharT (*pfnMakeChar)(unsigned), bool bNullTerminated, SearchT &&vSearch)
+{
+	const std::size_t uTerminator = bNullTerminated ? 1 : 0;
+	const auto fnCheck = [&](std::size_t uTextLength, std::size_t uPatternLength, Shape eShape){
+		const auto pchText = reinterpret_cast<CharT *>(vTextPages.GetEnd()) - uTextLength - uTerminator;
+		const auto pchPattern = reinterpret_cast<CharT *>(vPatternPages.GetEnd()) - uPatternLength - uTerminator;
+		for(std::size_t uIndex = 0; uIndex < uTextLength; ++uIndex){
+			pchText[uIndex] = (*pfnMakeChar)(g_vRandom.Get(uAlphabet));
+		}
+		if((eShape == Shape::kRandom) || (uPatternLength > uTextLength)){
+			for(std::size_t uIndex = 0; uIndex < uPatternLength; ++uIndex){
+				pchPattern[uIndex] = (*pfnMakeChar)(g_vRandom.Get(uAlphabet));
+			}
+		} else {
+			const auto uMaxOffset = static_cast<unsigned>(uTextLength - uPatternLength);
+			const auto uOffset = (eShape == Shape::kAtEnd) ? uMaxOffset : g_vRandom.Get(uMaxOffset + 1);
+			std::memcpy(pchPattern, pchText + uOffset, uPatternLength * sizeof(CharT));
+			if((eShape == Shape::kNearMiss) && (uPatternLength != 0)){
+				const auto chLast = pchPattern[uPatternLength - 1];
+				do {
+					pchPattern[uPatternLength - 1] = (*pfnMakeChar)(g_vRandom.Get(uAlphabet));
+				} while(pchPattern[uPatternLength - 1] == chLast);
+			}
+		}
+		if(bNullTerminated){
+			pchText[uTextLength] = 0;
+			pchPattern[uPatternLength] = 0;
+		}
+		if(vSearch(pchText, uTextLength, pchPattern, uPatternLength) != ReferenceFind(pchText, uTextLength, pchPattern, uPatternLength)){
+			std::printf("  %s: alphabet = %u, text length = %zu, pattern length = %zu, shape = %u\n",
+				pszKernel, uAlphabet, uTextLength, uPatternLength, static_cast<unsigned>(eShape));
+			Harness::Fail(__FILE__, __LINE__, "搜索的结果与逐字符实现的结果不同");
+		}
+	};
+	static constexpr Shape kShapes[] = { Shape::kCopied, Shape::kRandom, Shape::kNearMiss, Shape::kAtEnd };
+	const auto fnForEachPattern = [&](std::size_t uTextLength){
+		for(std::size_t uPatternLength = 0; (uPatternLength <= kShortPatternMax) && (uPatternLength <= uTextLength + 1); ++uPatternLength){
+			for(const auto eShape : kShapes){
+				fnCheck(uTextLength, uPatternLength, eShape);
+			}
+		}
+		for(const auto uPatternLength : kLongPatterns){
+			if(uPatternLength <= uTextLength){
+				for(const auto eShape : kShapes){
+					fnCheck(uTextLength, uPatternLength, eShape);
+				}
+			}
+		}
+	};
+	for(std::size_t uTextLength = 0; uTextLength <= kShortTextMax; ++uTextLength){
+		fnForEachPattern(uTextLength);
+	}
+	for(const auto uTextLength : kLongTexts){
+		fnForEachPattern(uTextLength);
+	}
+}
+
+const char *SearchWithMemmem(const char *pchText, std::size_t uTextLength, const char *pchPattern, std::size_t uPatternLength) noexcept {
+	return static_cast<const char *>(::_MCFCRT_memmem(pchText, uTextLength, pchPattern, uPatternLength));
+}
+const char *SearchWithStrstr(const char *pchText, std::size_t, const char *pchPattern, std::size_t) noexcept {
+	return std::strstr(pchText, pchPattern);
+}
+const char *SearchWithStringView(const char *pchText, std::size_t uTextLength, const char *pchPattern, std::size_t uPatternLength) noexcept {
+	const auto uPosition = NarrowStringView(pchText, pchText + uTextLength).Find(NarrowStringView(pchPattern, pchPattern + uPatternLength));
+	return (uPosition == NarrowStringView::kNpos) ? nullptr : (pchText + uPosition);
+}
+const wchar_t *SearchWithWmemmem(const wchar_t *pwcText, std::size_t uTextLength, const wchar_t *pwcPattern, std::size_t uPatternLength) noexcept {
+	return ::_MCFCRT_wmemmem(pwcText, uTextLength, pwcPattern, uPatternLength);
+}
+const wchar_t *SearchWithWcsstr(const wchar_t *pwcText, std::size_t, const wchar_t *pwcPattern, std::size_t) noexcept {
+	return std::wcsstr(pwcText, pwcPattern);
+}
+const wchar_t *SearchWithWideStringView(const wchar_t *pwcText, std::size_t uTextLength, const wchar_t *pwcPattern, std::size_t uPatternLength) noexcept {
+	const auto uPosition = WideStringView(pwcText, pwcText + uTextLength).Find(WideStringView(pwcPattern, pwcPattern + uPatternLength));
+	return (uPosition == WideStringView::kNpos) ? nullptr : (pwcText + uPosition);
+}
+
+// 原来的 StringView::Find() 使用的 Boyer-Moore-Horspool 模板，用作性能测试的基准。
+const char *SearchWithBoyerMoore(const char *pchText, std::size_t uTextLength, const char *pchPattern, std::size_t uPatternLength){
+	const auto pchEnd = pchText + uTextLength;
+	const auto pchPosition = Impl_StringTraits::FindSpan<const char *, const char *, const char *, const char *>(pchText, pchEnd, pchPattern, pchPattern + uPatternLength);
+	return (pchPosition == pchEnd) ? nullptr : pchPosition;
+}
+
+}
+
+HARNESS_TEST(SubstringSearchNarrow){
+	const Harness::GuardedPages vTextPages(0x10000), vPatternPages(0x10000);
+	static constexpr unsigned kAlphabets[] = { 2, 4, 26, 256 };
+	for(const auto uAlphabet : kAlphabets){
+		CheckAllShapes("_MCFCRT_memmem", vTextPages, vPatternPages, uAlphabet, &MakeNarrowChar, false, &SearchWithMemmem);
+		CheckAllShapes("NarrowStringView::Find", vTextPages, vPatternPages, uAlphabet, &MakeNarrowChar, false, &SearchWithStringView);
+		// strstr() 的字符串中不能有空字符。
+		if(uAlphabet <= 26){
+			CheckAllShapes("strstr", vTextPages, vPatternPages, uAlphabet, &MakeNarrowChar, true, &SearchWithStrstr);
+		}
+	}
+}
+
+HARNESS_TEST(SubstringSearchWide){
+	const Harness::GuardedPages vTextPages(0x10000), vPatternPages(0x10000);
+	static constexpr unsigned kAlphabets[] = { 2, 4, 26, 256 };
+	for(const auto uAlphabet : kAlphabets){
+		CheckAllShapes("_MCFCRT_wmemmem", vTextPages, vPatternPages, uAlphabet, &MakeWideChar, false, &SearchWithWmemmem);
+		CheckAllShapes("WideStringView::Find", vTextPages, vPatternPages, uAlphabet, &MakeWideChar, false, &SearchWithWideStringView);
+		CheckAllShapes("wcsstr", vTextPages, vPatternPages, uAlphabet, &MakeWideChar, true, &SearchWithWcsstr);
+	}
+}
+
+HARNESS_TEST(SubstringSearchPeriodicPatterns){
+	// 周期性的模式串会使 Two-Way 使用记忆，也是朴素的实现的最坏情况。
+	constexpr std::size_t kTextLength = 5000;
+	const Harness::GuardedPages vTextPages(0x10000), vPatternPages(0x10000);
+	static constexpr const char *kUnits[] = { "a", "ab", "aab", "abaab" };
+	static constexpr std::size_t kPatternLengths[] = { 2, 3, 16, 31, 32, 33, 64, 200, 1000 };
+	for(const auto pszTextUnit : kUnits){
+		for(const auto pszPatternUnit : kUnits){
+			for(const auto uPatternLength : kPatternLengths){
+				const auto pchText = reinterpret_cast<char *>(vTextPages.GetEnd()) - kTextLength;
+				const auto pchPattern = reinterpret_cast<char *>(vPatternPages.GetEnd()) - uPatternLength;
+				const auto uTextUnitLength = std::strlen(pszTextUnit);
+				const auto uPatternUnitLength = std::strlen(pszPatternUnit);
+				for(std::size_t uIndex = 0; uIndex < kTextLength; ++uIndex){
+					pchText[uIndex] = pszTextUnit[uIndex % uTextUnitLength];
+				}
+				for(std::size_t uIndex = 0; uIndex < uPatternLength; ++uIndex){
+					pchPattern[uIndex] = pszPatternUnit[uIndex % uPatternUnitLength];
+				}
+				// 分别测试没有修改、修改模式串的最后一个字符和修改文本的最后一个字符的情况。
+				for(unsigned uVariant = 0; uVariant < 3; ++uVariant){
+					if(uVariant == 1){
+						pchPattern[uPatternLength - 1] = 'c';
+					} else if(uVariant == 2){
+						pchText[kTextLength - 1] = 'c';
+					}
+					const auto pchExpected = ReferenceFind<char>(pchText, kTextLength, pchPattern, uPatternLength);
+					if((SearchWithMemmem(pchText, kTextLength, pchPattern, uPatternLength) != pchExpected) ||
+						(SearchWithStringView(pchText, kTextLength, pchPattern, uPatternLength) != pchExpected))
+					{
+						std::printf("  text unit = %s, pattern unit = %s, pattern length = %zu, variant = %u\n", pszTextUnit, pszPatternUnit, uPatternLength, uVariant);
+						Harness::Fail(__FILE__, __LINE__, "搜索的结果与逐字符实现的结果不同");
+					}
+				}
+			}
+		}
+	}
+}
+
+HARNESS_BENCH(SubstringSearchThroughput){
+	// 单位是文本的字节每纳秒。所有模式串都不出现在文本中，所以每次搜索都扫描整个文本。
+	// “Boyer-Moore”一栏是原来 StringView::Find() 使用的模板，“naive”一栏是逐字符的实现。
+	constexpr std::size_t kTextLength = 0x40000;
+	constexpr std::uint64_t kIterations = 20;
+	const Harness::GuardedPages vTextPages(kTextLength), vPatternPages(0x1000);
+	const auto pchText = reinterpret_cast<char *>(vTextPages.GetBegin());
+	const auto pchPattern = reinterpret_cast<char *>(vPatternPages.GetBegin());
+
+	// 英文文本由小写单词和空格组成，单词的频率大致按照 Zipf 分布。模式串是文本的一部分，最后一个字符换成大写字母。
+	char achWords[64][12];
+	for(auto &achWord : achWords){
+		const auto uLength = 2 + g_vRandom.Get(9);
+		for(unsigned uIndex = 0; uIndex < uLength; ++uIndex){
+			achWord[uIndex] = static_cast<char>('a' + g_vRandom.Get(26));
+		}
+		achWord[uLength] = 0;
+	}
+	const auto fnMakeEnglish = [&]{
+		std::size_t uOffset = 0;
+		while(uOffset < kTextLength){
+			const auto pszWord = achWords[g_vRandom.Get(g_vRandom.Get(64) + 1)];
+			for(auto pch = pszWord; (*pch != 0) && (uOffset < kTextLength); ++pch){
+				pchText[uOffset++] = *pch;
+			}
+			if(uOffset < kTextLength){
+				pchText[uOffset++] = ' ';
+			}
+		}
+	};
+	// DNA 序列只有四个字母，模式串的最后一个字母换成 'N'。
+	const auto fnMakeDna = [&]{
+		static constexpr char kBases[] = { 'A', 'C', 'G', 'T' };
+		for(std::size_t uOffset = 0; uOffset < kTextLength; ++uOffset){
+			pchText[uOffset] = kBases[g_vRandom.Get(4)];
+		}
+	};
+	// 最坏情况：文本全部是 'a'，模式串是若干个 'a' 之后跟一个 'b'。
+	const auto fnMakeRepeated = [&]{
+		std::memset(pchText, 'a', kTextLength);
+	};
+
+	struct Row {
+		std::size_t uPatternLength;
+		char chLast;
+	};
+	std::printf("  text     | pattern | memmem | Boyer-Moore |  naive\n");
+	const auto fnRun = [&](const char *pszText, const Row *pRowBegin, const Row *pRowEnd){
+		for(auto pRow = pRowBegin; pRow != pRowEnd; ++pRow){
+			const auto uPatternLength = pRow->uPatternLength;
+			std::memcpy(pchPattern, pchText + kTextLength / 2, uPatternLength);
+			pchPattern[uPatternLength - 1] = pRow->chLast;
+			const auto dSize = static_cast<double>(kTextLength);
+			const auto dMemmem = dSize / Harness::Measure(kIterations, [&]{ Harness::DoNotOptimize(SearchWithMemmem(pchText, kTextLength, pchPattern, uPatternLength)); });
+			const auto dBoyerMoore = dSize / Harness::Measure(kIterations, [&]{ Harness::DoNotOptimize(SearchWithBoyerMoore(pchText, kTextLength, pchPattern, uPatternLength)); });
+			const auto dNaive = dSize / Harness::Measure(kIterations, [&]{ Harness::DoNotOptimize(ReferenceFind<char>(pchText, kTextLength, pchPattern, uPatternLength)); });
+			std::printf("  %-8s | %7zu | %6.2f | %11.2f | %6.2f\n", pszText, uPatternLength, dMemmem, dBoyerMoore, dNaive);
+			std::fflush(stdout);
+		}
+	};
+	static constexpr Row kEnglishRows[] = { { 2, 'X' }, { 4, 'X' }, { 8, 'X' }, { 16, 'X' }, { 32, 'X' }, { 64, 'X' }, { 256, 'X' } };
+	fnMakeEnglish();
+	fnRun("english", std::begin(kEnglishRows), std::end(kEnglishRows));
+	static constexpr Row kDnaRows[] = { { 8, 'N' }, { 32, 'N' }, { 100, 'N' } };
+	fnMakeDna();
+	fnRun("dna", std::begin(kDnaRows), std::end(kDnaRows));
+	static constexpr Row kRepeatedRows[] = { { 16, 'b' }, { 64, 'b' }, { 256, 'b' } };
+	fnMakeRepeated();
+	fnRun("repeated", std::begin(kRepeatedRows), std::end(kRepeatedRows));
+}
@@ -0,0 +1,236 @@
+#include "Harness.hpp"
+#include <MCF/Thread/ThreadLocal.hpp>
+#include <MCF/SmartPointers/UniquePtr.hpp>
+#include <MCFCRT/pre/tls.h>
+#include <array>
+
+using namespace MCF;
+
+namespace {
+
+// 每个键在分配时得到一个稠密的下标，一共只有这么多。下标用完之后，新的键只能通过每个线程的 AVL 树查找。
+constexpr std::size_t kDenseIndexCount = 1024;
+
+// 占用所有剩余的稠密下标，使之后分配的键都只能走原来的路径。
+class DenseIndexExhauster {
+private:
+	::_MCFCRT_TlsKeyHandle x_ahKeys[kDenseIndexCount];
+
+public:
+	DenseIndexExhauster(){
+		for(auto &hKey : x_ahKeys){
+			hKey = ::_MCFCRT_TlsAllocKey(sizeof(int), nullptr, nullptr, 0);
+			HARNESS_CHECK(hKey);
+		}
+	}
+	~DenseIndexExhauster(){
+		for(const auto hKey : x_ahKeys){
+			::_MCFCRT_TlsFreeKey(hKey);
+		}
+	}
+
+	DenseIndexExhauster(const DenseIndexExhauster &) = delete;
+	DenseIndexExhauster &operator=(const DenseIndexExhauster &) = delete;
+};
+
+Vector<UniquePtr<ThreadLocal<unsigned>>> MakeThreadLocals(std::size_t uCount){
+	Vector<UniquePtr<ThreadLocal<unsigned>>> vecThreadLocals;
+	for(std::size_t uIndex = 0; uIndex < uCount; ++uIndex){
+		vecThreadLocals.Push(MakeUnique<ThreadLocal<unsigned>>());
+	}
+	return vecThreadLocals;
+}
+
+// 每个线程写入自己的值，然后检查所有值都没有被其他线程或者其他键覆盖。
+void CheckIsolation(const Vector<UniquePtr<ThreadLocal<unsigned>>> &vecThreadLocals){
+	Harness::RunInThreads(4, [&](unsigned uThread){
+		for(std::size_t uIndex = 0; uIndex < vecThreadLocals.GetSize(); ++uIndex){
+			HARNESS_CHECK(vecThreadLocals[uIndex]->Get() == nullptr);
+			vecThreadLocals[uIndex]->Require(static_cast<unsigned>(uIndex * 4 + uThread));
+		}
+		for(unsigned uRound = 0; uRound < 10; ++uRound){
+			YieldThread();
+			for(std::size_t uIndex = 0; uIndex < vecThreadLocals.GetSize(); ++uIndex){
+				const auto puValue = vecThreadLocals[uIndex]->Get();
+				HARNESS_CHECK(puValue && (*puValue == uIndex * 4 + uThread));
+			}
+		}
+	});
+}
+
+// 在一个新的线程中，在所有键之间轮流调用 Get()，返回每次调用的平均时间，单位是纳秒。
+// 已经释放的键的对象在线程退出之前仍然留在树中，所以不能在当前线程中测量。
+double MeasureGet(const Vector<UniquePtr<ThreadLocal<unsigned>>> &vecThreadLocals){
+	double dResult = 0;
+	Harness::RunInThreads(1, [&](unsigned){
+		for(const auto &pThreadLocal : vecThreadLocals){
+			pThreadLocal->Require(1u);
+		}
+		constexpr std::size_t kCalls = 10000000;
+		std::size_t uIndex = 0;
+		dResult = Harness::Measure(kCalls, [&]{
+			Harness::DoNotOptimize(vecThreadLocals[uIndex]->Get());
+			if(++uIndex == vecThreadLocals.GetSize()){
+				uIndex = 0;
+			}
+		});
+	});
+	return dResult;
+}
+
+// 析构时记录自己的编号，用来检查线程退出时的析构顺序。
+// 同一时刻只有一个线程在使用，所以不需要同步。
+struct Tracker {
+	static unsigned s_uAlive;
+	static unsigned s_uLastDestroyed;
+
+	unsigned uId;
+
+	explicit Tracker(unsigned uId_) noexcept
+		: uId(uId_)
+	{
+		++s_uAlive;
+	}
+	~Tracker(){
+		// 后创建的对象先被销毁。
+		HARNESS_CHECK(s_uLastDestroyed == uId + 1);
+		s_uLastDestroyed = uId;
+		--s_uAlive;
+	}
+};
+
+unsigned Tracker::s_uAlive = 0;
+unsigned Tracker::s_uLastDestroyed = 0;
+
+// 比一个块的上限（64KiB）稍小，在一个新线程中第一个被访问时几乎占满整个块。
+struct LargeElement {
+	unsigned char abyData[0xFE00];
+};
+
+// 依次创建并等待 uThreads 个线程，每个线程访问 vecThreadLocals 中的所有变量。返回每个线程的平均时间，单位是纳秒。
+double MeasureSpawnAndExit(unsigned uThreads, const ThreadLocal<LargeElement> *pLarge, const Vector<UniquePtr<ThreadLocal<unsigned>>> &vecThreadLocals){
+	const auto fnThreadProc = [&]{
+		if(pLarge){
+			pLarge->Require();
+		}
+		for(const auto &pThreadLocal : vecThreadLocals){
+			pThreadLocal->Require(1u);
+		}
+	};
+	const auto dBegin = GetHiResMonoClock();
+	for(unsigned uThread = 0; uThread < uThreads; ++uThread){
+		MakeThread(fnThreadProc)->Wait();
+	}
+	return (GetHiResMonoClock() - dBegin) * 1.0e6 / uThreads;
+}
+
+}
+
+HARNESS_TEST(ThreadLocalIsPerThreadAndPerKey){
+	CheckIsolation(MakeThreadLocals(100));
+	// 稠密下标用完之后分配的键走原来的路径，结果必须相同。
+	const DenseIndexExhauster vExhauster;
+	CheckIsolation(MakeThreadLocals(100));
+}
+
+HARNESS_TEST(ThreadLocalReusedIndexDoesNotSeeOldObject){
+	// 键被释放之后，它的下标会被下一个键重用。当前线程的数组里仍然缓存着旧对象的指针，新的键不能看到它。
+	for(unsigned uRound = 0; uRound < 100; ++uRound){
+		auto pOld = MakeUnique<ThreadLocal<unsigned>>();
+		HARNESS_CHECK(*(pOld->Require(12345u)) == 12345);
+		HARNESS_CHECK(*(pOld->Get()) == 12345);
+		pOld.Reset();
+
+		const auto pNew = MakeUnique<ThreadLocal<unsigned>>();
+		HARNESS_CHECK(pNew->Get() == nullptr);
+		HARNESS_CHECK(*(pNew->Require(uRound)) == uRound);
+		HARNESS_CHECK(*(pNew->Get()) == uRound);
+	}
+	// 另一个线程持有旧的键的对象，在旧的键被释放之后才第一次访问新的键。
+	auto pOld = MakeUnique<ThreadLocal<unsigned>>();
+	UniquePtr<ThreadLocal<unsigned>> pNew;
+	Atomic<bool> bOldTouched(false), bOldFreed(false);
+	const auto fnOther = [&]{
+		pOld->Require(1u);
+		bOldTouched.Store(true, kAtomicRelease);
+		while(!bOldFreed.Load(kAtomicAcquire)){
+			YieldThread();
+		}
+		HARNESS_CHECK(pNew->Get() == nullptr);
+		HARNESS_CHECK(*(pNew->Require(2u)) == 2);
+	};
+	const auto pThread = MakeThread(fnOther);
+	while(!bOldTouched.Load(kAtomicAcquire)){
+		YieldThread();
+	}
+	pOld.Reset();
+	pNew = MakeUnique<ThreadLocal<unsigned>>();
+	bOldFreed.Store(true, kAtomicRelease);
+	pThread->Wait();
+	HARNESS_CHECK(pNew->Get() == nullptr);
+}
+
+HARNESS_TEST(ThreadLocalObjectsAreDestroyedInReverseOnThreadExit){
+	// 小的对象从线程的块中分配，超过块上限的对象来自堆。块在线程之间重复使用，不能残留上一个线程的数据。
+	constexpr unsigned kThreadLocals = 50;
+	Vector<UniquePtr<ThreadLocal<Tracker>>> vecTrackers;
+	for(unsigned uIndex = 0; uIndex < kThreadLocals; ++uIndex){
+		vecTrackers.Push(MakeUnique<ThreadLocal<Tracker>>());
+	}
+	const ThreadLocal<LargeElement> vLarge;
+	const ThreadLocal<std::array<unsigned char, 0x20000>> vHuge;
+	for(unsigned uRound = 0; uRound < 200; ++uRound){
+		const auto fnThreadProc = [&]{
+			Tracker::s_uLastDestroyed = kThreadLocals;
+			for(unsigned uIndex = 0; uIndex < kThreadLocals; ++uIndex){
+				HARNESS_CHECK(vecTrackers[uIndex]->Get() == nullptr);
+				if(uIndex == kThreadLocals / 2){
+					// 中间穿插一个大对象和一个来自堆的对象，之后的对象只能来自堆。
+					HARNESS_CHECK(vLarge.Get() == nullptr);
+					HARNESS_CHECK(vHuge.Get() == nullptr);
+					vLarge.Require();
+					vHuge.Require();
+				}
+				vecTrackers[uIndex]->Require(uIndex);
+			}
+			for(unsigned uIndex = 0; uIndex < kThreadLocals; ++uIndex){
+				HARNESS_CHECK(vecTrackers[uIndex]->Get()->uId == uIndex);
+			}
+		};
+		MakeThread(fnThreadProc)->Wait();
+		HARNESS_CHECK(Tracker::s_uAlive == 0);
+		HARNESS_CHECK(Tracker::s_uLastDestroyed == 0);
+	}
+}
+
+HARNESS_BENCH(ThreadLocalGet){
+	// 单位是纳秒每次 Get()。“AVL 树”一栏在稠密下标用完之后测量，相当于原来的实现。
+	static constexpr std::size_t kKeyCounts[] = { 1, 10, 100, 1000 };
+	std::printf("  keys | dense index | AVL tree | speedup\n");
+	for(const auto uKeys : kKeyCounts){
+		const auto dDense = MeasureGet(MakeThreadLocals(uKeys));
+		double dTree;
+		{
+			const DenseIndexExhauster vExhauster;
+			dTree = MeasureGet(MakeThreadLocals(uKeys));
+		}
+		std::printf("  %4zu | %11.2f | %8.2f | %6.2fx\n", uKeys, dDense, dTree, dTree / dDense);
+		std::fflush(stdout);
+	}
+}
+
+HARNESS_BENCH(ThreadLocalSpawnAndExit){
+	// 单位是微秒每个线程，包括创建、访问所有变量、退出和等待。
+	// 最后两行先访问一个几乎占满块的大对象，之后的小对象只能逐个从堆上分配，相当于原来的实现。大对象单独的开销在倒数第二行。
+	constexpr unsigned kThreads = 2000;
+	constexpr unsigned kThreadLocals = 50;
+	const ThreadLocal<LargeElement> vLarge;
+	const auto vecNone = MakeThreadLocals(0);
+	const auto vecSmall = MakeThreadLocals(kThreadLocals);
+	// 先运行一次，使块的缓存就绪。
+	MeasureSpawnAndExit(100, nullptr, vecSmall);
+	std::printf("  no ThreadLocal                           : %8.2f us\n", MeasureSpawnAndExit(kThreads, nullptr, vecNone) / 1000);
+	std::printf("  %u ThreadLocal<unsigned>                  : %8.2f us\n", kThreadLocals, MeasureSpawnAndExit(kThreads, nullptr, vecSmall) / 1000);
+	std::printf("  one 63.5KiB ThreadLocal                  : %8.2f us\n", MeasureSpawnAndExit(kThreads, &vLarge, vecNone) / 1000);
+	std::printf("  one 63.5KiB ThreadLocal, then %u from heap : %8.2f us\n", kThreadLocals, MeasureSpawnAndExit(kThreads, &vLarge, vecSmall) / 1000);
+}
@@ -0,0 +1,159 @@
+#include "Harness.hpp"
+#include <MCF/Thread/ThreadPool.hpp>
+#include <MCF/Thread/Latch.hpp>
+
+using namespace MCF;
+
+namespace {
+
+// 递归地把 [uBegin, uEnd) 分成两半，每一半作为一个子任务提交，直到只剩一个元素。
+// 等待子任务时执行其他任务，因此即使只有一个工作线程也不会死锁。
+void SumRecursively(ThreadPool &vPool, std::uint64_t u64Begin, std::uint64_t u64End, Atomic<std::uint64_t> &u64Sum){
+	if(u64End - u64Begin == 1){
+		u64Sum.FetchAdd(u64Begin, kAtomicRelaxed);
+		return;
+	}
+	const auto u64Middle = u64Begin + (u64End - u64Begin) / 2;
+	Latch vDone(2);
+	vPool.Submit([&, u64Begin, u64Middle]{
+		SumRecursively(vPool, u64Begin, u64Middle, u64Sum);
+		vDone.CountDown();
+	});
+	vPool.Submit([&, u64Middle, u64End]{
+		SumRecursively(vPool, u64Middle, u64End, u64Sum);
+		vDone.CountDown();
+	});
+	while(!vDone.IsReady()){
+		if(!vPool.RunOne()){
+			YieldThread();
+		}
+	}
+}
+
+// 每个任务忙等待 dMicroseconds 微秒，总工作量固定。返回效率，即理想时间与实际时间之比。
+// 如果 bFromWorker 为 true，所有任务都由一个工作线程提交，进入它自己的双端队列，其他工作线程必须窃取；否则从当前线程提交到公共队列。
+double MeasureEfficiency(std::size_t uWorkers, double dMicroseconds, bool bFromWorker){
+	constexpr double kTotalMicroseconds = 400000;
+	const auto uJobs = static_cast<std::size_t>(kTotalMicroseconds / dMicroseconds);
+	ThreadPool vPool(uWorkers);
+	Latch vDone(uJobs);
+	const auto fnSubmitAll = [&]{
+		for(std::size_t uJob = 0; uJob < uJobs; ++uJob){
+			vPool.Submit([&]{
+				Harness::SpinFor(dMicroseconds);
+				vDone.CountDown();
+			});
+		}
+	};
+	const auto dBegin = GetHiResMonoClock();
+	if(bFromWorker){
+		vPool.Submit(fnSubmitAll);
+	} else {
+		fnSubmitAll();
+	}
+	vDone.Wait();
+	const auto dElapsed = (GetHiResMonoClock() - dBegin) * 1000;
+	return kTotalMicroseconds / static_cast<double>(uWorkers) / dElapsed;
+}
+
+}
+
+HARNESS_TEST(LatchCountsDownAndWakesWaiters){
+	Latch vLatch(3);
+	HARNESS_CHECK(!vLatch.IsReady());
+	HARNESS_CHECK(!vLatch.Wait(GetFastMonoClock() + 20));
+	HARNESS_CHECK(vLatch.CountDown() == 2);
+
+	constexpr unsigned kWaiters = 8;
+	Atomic<unsigned> uReleased(0);
+	Harness::RunInThreads(kWaiters + 1, [&](unsigned uIndex){
+		if(uIndex == 0){
+			Sleep(GetFastMonoClock() + 50);
+			HARNESS_CHECK(uReleased.Load(kAtomicAcquire) == 0);
+			HARNESS_CHECK(vLatch.CountDown(2) == 0);
+			return;
+		}
+		if(uIndex % 2 == 0){
+			vLatch.Wait();
+		} else {
+			HARNESS_CHECK(vLatch.Wait(GetFastMonoClock() + 10000));
+		}
+		uReleased.FetchAdd(1, kAtomicRelaxed);
+	});
+	HARNESS_CHECK(uReleased.Load(kAtomicRelaxed) == kWaiters);
+	// 计数归零之后立即返回。
+	HARNESS_CHECK(vLatch.IsReady());
+	HARNESS_CHECK(vLatch.Wait(0));
+	vLatch.Wait();
+}
+
+HARNESS_TEST(ThreadPoolRunsEveryJob){
+	constexpr std::size_t kWorkers = 4;
+	constexpr std::size_t kJobs = 100000;
+	Atomic<std::size_t> uRan(0);
+	Atomic<std::size_t> auRanByWorker[kWorkers];
+	{
+		ThreadPool vPool(kWorkers);
+		HARNESS_CHECK(vPool.GetWorkerCount() == kWorkers);
+		HARNESS_CHECK(vPool.GetCurrentWorkerIndex() == static_cast<std::size_t>(-1));
+		for(std::size_t uJob = 0; uJob < kJobs; ++uJob){
+			vPool.Submit([&]{
+				const auto uWorker = vPool.GetCurrentWorkerIndex();
+				HARNESS_CHECK(uWorker < kWorkers);
+				auRanByWorker[uWorker].FetchAdd(1, kAtomicRelaxed);
+				uRan.FetchAdd(1, kAtomicRelaxed);
+			});
+		}
+		// 析构函数等待所有已提交的任务执行完毕。
+	}
+	HARNESS_CHECK(uRan.Load(kAtomicRelaxed) == kJobs);
+	for(std::size_t uWorker = 0; uWorker < kWorkers; ++uWorker){
+		std::printf("  worker %zu ran %zu jobs\n", uWorker, auRanByWorker[uWorker].Load(kAtomicRelaxed));
+	}
+}
+
+HARNESS_TEST(ThreadPoolNestedSubmissionDoesNotDeadlock){
+	// 工作线程提交子任务并等待它们，任务只能通过窃取分散到其他工作线程上。
+	constexpr std::uint64_t kLeaves = 1 << 16;
+	static constexpr std::size_t kWorkerCounts[] = { 1, 2, 8 };
+	for(const auto uWorkers : kWorkerCounts){
+		ThreadPool vPool(uWorkers);
+		Atomic<std::uint64_t> u64Sum(0);
+		Latch vDone(1);
+		vPool.Submit([&]{
+			SumRecursively(vPool, 0, kLeaves, u64Sum);
+			vDone.CountDown();
+		});
+		HARNESS_CHECK(vDone.Wait(GetFastMonoClock() + 60000));
+		HARNESS_CHECK(u64Sum.Load(kAtomicRelaxed) == kLeaves * (kLeaves - 1) / 2);
+	}
+}
+
+HARNESS_TEST(ThreadPoolWakesSleepingWorkers){
+	// 工作线程空闲足够久之后会休眠。之后提交的任务必须唤醒它们，而不是等到下一次提交。
+	ThreadPool vPool(4);
+	for(unsigned uRound = 0; uRound < 20; ++uRound){
+		Sleep(GetFastMonoClock() + 20);
+		Latch vDone(1);
+		vPool.Submit([&]{ vDone.CountDown(); });
+		HARNESS_CHECK(vDone.Wait(GetFastMonoClock() + 5000));
+	}
+}
+
+HARNESS_BENCH(ThreadPoolScaling){
+	// 效率是理想时间与实际时间之比，1.00 表示没有任何开销。
+	static constexpr double kGrains[] = { 1, 10, 100, 1000 };
+	static constexpr std::size_t kWorkerCounts[] = { 1, 2, 4, 8, 16 };
+	for(const bool bFromWorker : { false, true }){
+		std::printf("  jobs submitted %s\n", bFromWorker ? "by a worker (stolen from its deque)" : "from outside (injected queue)");
+		std::printf("  workers |   1 us |  10 us | 100 us |   1 ms\n");
+		for(const auto uWorkers : kWorkerCounts){
+			std::printf("  %7zu |", uWorkers);
+			for(const auto dGrain : kGrains){
+				std::printf(" %6.2f |", MeasureEfficiency(uWorkers, dGrain, bFromWorker));
+				std::fflush(stdout);
+			}
+			std::printf("\n");
+		}
+	}
+}
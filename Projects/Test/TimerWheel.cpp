@@ -0,0 +1,352 @@
+#include "Harness.hpp"
+#include <MCF/Thread/TimerWheel.hpp>
+#include <MCF/Thread/Mutex.hpp>
+#include <algorithm>
+
+using namespace MCF;
+
+namespace {
+
+std::uint32_t NextRandom(std::uint32_t &u32Seed){
+	u32Seed = u32Seed * 1103515245u + 12345u;
+	return u32Seed >> 8;
+}
+
+// 等待条件成立，最多等待 u64Milliseconds 毫秒。返回条件最终是否成立。
+template<typename PredicateT>
+bool WaitUntil(std::uint64_t u64Milliseconds, const PredicateT &fnPredicate){
+	const auto u64Until = GetFastMonoClock() + u64Milliseconds;
+	while(!fnPredicate()){
+		if(GetFastMonoClock() >= u64Until){
+			return false;
+		}
+		Sleep(GetFastMonoClock() + 1);
+	}
+	return true;
+}
+
+// 原来的做法：所有定时器按截止时间放在一个二叉堆里。取消只是做一个标记，定时器在到期时被丢弃。
+class LegacyTimerQueue {
+public:
+	class Timer : public IntrusiveBase<Timer> {
+		friend LegacyTimerQueue;
+
+	private:
+		std::uint64_t x_u64DueTime;
+		UniquePtr<TimerWheel::Callback> x_pCallback;
+		bool x_bCancelled;
+
+	public:
+		Timer(std::uint64_t u64DueTime, UniquePtr<TimerWheel::Callback> pCallback) noexcept
+			: x_u64DueTime(u64DueTime), x_pCallback(std::move(pCallback)), x_bCancelled(false)
+		{ }
+	};
+
+private:
+	struct Entry {
+		std::uint64_t u64DueTime;
+		IntrusivePtr<Timer> pTimer;
+
+		bool operator<(const Entry &rhs) const noexcept {
+			// std::push_heap() 建立的是最大堆，所以这里反过来比较。
+			return u64DueTime > rhs.u64DueTime;
+		}
+	};
+
+private:
+	mutable Mutex x_mtxGuard;
+	Vector<Entry> x_vecHeap;
+
+public:
+	std::uint64_t GetNextWakeTime() const noexcept {
+		const auto vLock = x_mtxGuard.GetLock();
+		if(x_vecHeap.IsEmpty()){
+			return UINT64_MAX;
+		}
+		return x_vecHeap[0].u64DueTime;
+	}
+
+	template<typename FunctionT>
+	IntrusivePtr<Timer> Schedule(std::uint64_t u64DueTime, FunctionT &&vFunction){
+		auto pTimer = MakeIntrusive<Timer>(u64DueTime, UniquePtr<TimerWheel::Callback>(MakeFunction<void ()>(std::forward<FunctionT>(vFunction))));
+		const auto vLock = x_mtxGuard.GetLock();
+		x_vecHeap.Push(Entry{ u64DueTime, pTimer });
+		std::push_heap(x_vecHeap.GetBegin(), x_vecHeap.GetEnd());
+		return pTimer;
+	}
+	bool Cancel(const IntrusivePtr<Timer> &pTimer) noexcept {
+		const auto vLock = x_mtxGuard.GetLock();
+		if(pTimer->x_bCancelled){
+			return false;
+		}
+		pTimer->x_bCancelled = true;
+		return true;
+	}
+
+	std::size_t Pump(std::uint64_t u64Now){
+		Vector<IntrusivePtr<Timer>> vecExpired;
+		{
+			const auto vLock = x_mtxGuard.GetLock();
+			while(!x_vecHeap.IsEmpty() && (x_vecHeap[0].u64DueTime <= u64Now)){
+				std::pop_heap(x_vecHeap.GetBegin(), x_vecHeap.GetEnd());
+				auto &vEntry = x_vecHeap[x_vecHeap.GetSize() - 1];
+				if(!vEntry.pTimer->x_bCancelled){
+					vEntry.pTimer->x_bCancelled = true;
+					vecExpired.Push(std::move(vEntry.pTimer));
+				}
+				x_vecHeap.Pop();
+			}
+		}
+		for(const auto &pTimer : vecExpired){
+			(*(pTimer->x_pCallback))();
+		}
+		return vecExpired.GetSize();
+	}
+};
+
+// 调度 uCount 个定时器，截止时间均匀分布在 1 到 61 秒之后，模拟连接超时；然后取消其中的 90%，剩下的全部到期。
+// 结果依次是每次调度、每次取消和每个到期定时器的平均时间，单位是纳秒。
+struct Throughput {
+	double dSchedule;
+	double dCancel;
+	double dFire;
+};
+
+template<typename QueueT, typename TimerPtrT>
+Throughput MeasureThroughput(QueueT &vQueue, Vector<TimerPtrT> &vecTimers, std::size_t uCount){
+	Throughput vResult;
+	const auto u64Base = GetFastMonoClock();
+	std::uint32_t u32Seed = 1;
+	std::size_t uFired = 0;
+	vecTimers.Reserve(uCount);
+
+	auto dBegin = GetHiResMonoClock();
+	for(std::size_t uIndex = 0; uIndex < uCount; ++uIndex){
+		vecTimers.Push(vQueue.Schedule(u64Base + 1000 + NextRandom(u32Seed) % 60000, [&]{ ++uFired; }));
+	}
+	vResult.dSchedule = (GetHiResMonoClock() - dBegin) * 1.0e6 / static_cast<double>(uCount);
+
+	const auto uCancelled = uCount - uCount / 10;
+	dBegin = GetHiResMonoClock();
+	for(std::size_t uIndex = 0; uIndex < uCancelled; ++uIndex){
+		vQueue.Cancel(vecTimers[uIndex]);
+	}
+	vResult.dCancel = (GetHiResMonoClock() - dBegin) * 1.0e6 / static_cast<double>(uCancelled);
+
+	dBegin = GetHiResMonoClock();
+	vQueue.Pump(u64Base + 61000);
+	vResult.dFire = (GetHiResMonoClock() - dBegin) * 1.0e6 / static_cast<double>(uCount - uCancelled);
+	HARNESS_CHECK(uFired == uCount - uCancelled);
+	return vResult;
+}
+
+// 截止时间和回调函数被调用的时刻之差，单位是毫秒。
+struct Lateness {
+	Atomic<std::size_t> uFired;
+	double dSum;
+	double dMax;
+};
+
+template<typename QueueT>
+void ScheduleForJitter(QueueT &vQueue, Lateness &vLateness, unsigned uCount){
+	std::uint32_t u32Seed = 2;
+	for(unsigned uIndex = 0; uIndex < uCount; ++uIndex){
+		const auto u64Delay = 10 + NextRandom(u32Seed) % 1000;
+		// 回调函数总是在同一个线程中被调用，所以累加不需要同步。
+		const auto dDue = GetHiResMonoClock() + static_cast<double>(u64Delay);
+		vQueue.Schedule(GetFastMonoClock() + u64Delay, [&vLateness, dDue]{
+			const auto dLate = GetHiResMonoClock() - dDue;
+			vLateness.dSum += dLate;
+			vLateness.dMax = std::max(vLateness.dMax, dLate);
+			vLateness.uFired.Increment(kAtomicRelease);
+		});
+	}
+}
+
+}
+
+HARNESS_TEST(TimerWheelCascadesThroughEveryLevel){
+	// 时间轮由调用者推动，所以时间是确定的。每个定时器都必须在第一次覆盖其截止时间的 Pump() 中到期，不能早，也不能晚。
+	static constexpr std::uint64_t kDelays[] = {
+		0, 1, 2, 255, 256, 257, 511, 512, 1000,
+		(1u << 14) - 1, 1u << 14, (1u << 14) + 1, 20000,
+		(1u << 20) - 1, 1u << 20, (1u << 20) + 1, 3000000,
+		(1u << 26) - 1, 1u << 26, (1u << 26) + 1, 100000000,
+	};
+	struct Record {
+		std::uint64_t u64DueTime;
+		unsigned uFiredCount;
+	};
+
+	TimerWheel vWheel;
+	const auto u64Base = GetFastMonoClock();
+	Vector<Record> vecRecords;
+	for(const auto u64Delay : kDelays){
+		vecRecords.Push(Record{ u64Base + u64Delay, 0 });
+	}
+	std::uint32_t u32Seed = 3;
+	for(unsigned uIndex = 0; uIndex < 2000; ++uIndex){
+		const auto uBits = NextRandom(u32Seed) % 28;
+		vecRecords.Push(Record{ u64Base + NextRandom(u32Seed) % (1u << uBits), 0 });
+	}
+
+	std::uint64_t u64Previous = u64Base - 1, u64Now = u64Base - 1, u64LastFired = 0;
+	std::size_t uFiredInPump = 0;
+	for(std::size_t uIndex = 0; uIndex < vecRecords.GetSize(); ++uIndex){
+		vWheel.Schedule(vecRecords[uIndex].u64DueTime, [&, uIndex]{
+			auto &vRecord = vecRecords[uIndex];
+			HARNESS_CHECK(vRecord.u64DueTime <= u64Now);
+			HARNESS_CHECK(vRecord.u64DueTime > u64Previous);
+			// 同一次 Pump() 中按截止时间的顺序调用。
+			HARNESS_CHECK(vRecord.u64DueTime >= u64LastFired);
+			u64LastFired = vRecord.u64DueTime;
+			++vRecord.uFiredCount;
+			++uFiredInPump;
+		});
+	}
+	// 超出时间轮范围的定时器不会被提前调用，析构时被丢弃。
+	bool bFarFired = false;
+	vWheel.Schedule(u64Base + (1ull << 40), [&]{ bFarFired = true; });
+	HARNESS_CHECK(vWheel.GetPendingCount() == vecRecords.GetSize() + 1);
+
+	Vector<std::uint64_t> vecDueTimes;
+	for(const auto &vRecord : vecRecords){
+		vecDueTimes.Push(vRecord.u64DueTime);
+	}
+	std::sort(vecDueTimes.GetBegin(), vecDueTimes.GetEnd());
+
+	// 步长在 1 毫秒和 2^17 毫秒之间随机变化，所以既有逐毫秒推进，也有一次跨越多个槽和多次级联。
+	std::size_t uFired = 0;
+	while(uFired < vecRecords.GetSize()){
+		u64Previous = u64Now;
+		u64Now += 1 + NextRandom(u32Seed) % (1u << (NextRandom(u32Seed) % 18));
+		u64LastFired = 0;
+		uFiredInPump = 0;
+		const auto uCalled = vWheel.Pump(u64Now);
+		HARNESS_CHECK(uCalled == uFiredInPump);
+		uFired += uFiredInPump;
+		HARNESS_CHECK(vWheel.GetPendingCount() == vecRecords.GetSize() + 1 - uFired);
+		// 下一次醒来的时间不晚于最早的未到期定时器。
+		const auto u64NextWakeTime = vWheel.GetNextWakeTime();
+		HARNESS_CHECK(u64NextWakeTime > u64Now);
+		if(uFired < vecRecords.GetSize()){
+			HARNESS_CHECK(u64NextWakeTime <= vecDueTimes[uFired]);
+		}
+	}
+	for(const auto &vRecord : vecRecords){
+		HARNESS_CHECK(vRecord.uFiredCount == 1);
+	}
+	HARNESS_CHECK(!bFarFired);
+}
+
+HARNESS_TEST(TimerWheelCancelsAndReschedulesFromCallbacks){
+	constexpr unsigned kTimers = 10000;
+	TimerWheel vWheel;
+	const auto u64Base = GetFastMonoClock();
+	unsigned auFiredCount[kTimers] = { };
+	Vector<IntrusivePtr<TimerWheel::Timer>> vecTimers;
+	std::uint32_t u32Seed = 4;
+	for(unsigned uIndex = 0; uIndex < kTimers; ++uIndex){
+		vecTimers.Push(vWheel.Schedule(u64Base + NextRandom(u32Seed) % (1u << 20), [&, uIndex]{ ++auFiredCount[uIndex]; }));
+	}
+	// 取消所有奇数编号的定时器。第二次取消返回 false。
+	for(unsigned uIndex = 1; uIndex < kTimers; uIndex += 2){
+		HARNESS_CHECK(vWheel.Cancel(vecTimers[uIndex]));
+		HARNESS_CHECK(!vWheel.Cancel(vecTimers[uIndex]));
+	}
+	HARNESS_CHECK(vWheel.GetPendingCount() == kTimers / 2);
+
+	// 回调函数中可以调度和取消定时器，因为调用时不持有锁。
+	IntrusivePtr<TimerWheel::Timer> pVictim, pRescheduled;
+	bool bVictimFired = false, bRescheduledFired = false;
+	pVictim = vWheel.Schedule(u64Base + 5010, [&]{ bVictimFired = true; });
+	vWheel.Schedule(u64Base + 5000, [&]{
+		HARNESS_CHECK(vWheel.Cancel(pVictim));
+		// 截止时间已经过去的定时器在下一次 Pump() 中到期，而不是在这一次。
+		pRescheduled = vWheel.Schedule(u64Base, [&]{ bRescheduledFired = true; });
+	});
+	std::size_t uExpected = 0;
+	for(unsigned uIndex = 0; uIndex < kTimers; uIndex += 2){
+		if(vecTimers[uIndex]->GetDueTime() <= u64Base + 4999){
+			++uExpected;
+		}
+	}
+	HARNESS_CHECK(vWheel.Pump(u64Base + 4999) == uExpected);
+	vWheel.Pump(u64Base + 5000);
+	HARNESS_CHECK(pRescheduled);
+	HARNESS_CHECK(!bRescheduledFired);
+	vWheel.Pump(u64Base + 5001);
+	HARNESS_CHECK(bRescheduledFired);
+	HARNESS_CHECK(!vWheel.Cancel(pRescheduled));
+
+	vWheel.Pump(u64Base + (1u << 20));
+	HARNESS_CHECK(!bVictimFired);
+	HARNESS_CHECK(vWheel.GetPendingCount() == 0);
+	HARNESS_CHECK(vWheel.GetNextWakeTime() == UINT64_MAX);
+	for(unsigned uIndex = 0; uIndex < kTimers; ++uIndex){
+		HARNESS_CHECK(auFiredCount[uIndex] == ((uIndex % 2 == 0) ? 1u : 0u));
+		// 已经到期的定时器不能再被取消。
+		HARNESS_CHECK(!vWheel.Cancel(vecTimers[uIndex]));
+	}
+}
+
+HARNESS_TEST(TimerWheelExpiryThreadWakesForEarlierTimers){
+	Atomic<bool> bLateFired(false);
+	Atomic<bool> bEarlyFired(false);
+	{
+		TimerWheel vWheel(true);
+		// 到期线程先按照较晚的定时器休眠，之后调度的较早的定时器必须唤醒它。
+		const auto u64Late = GetFastMonoClock() + 10000;
+		vWheel.Schedule(u64Late, [&]{ bLateFired.Store(true, kAtomicRelease); });
+		Sleep(GetFastMonoClock() + 50);
+		const auto u64Early = GetFastMonoClock() + 50;
+		vWheel.Schedule(u64Early, [&, u64Early]{
+			HARNESS_CHECK(GetFastMonoClock() >= u64Early);
+			bEarlyFired.Store(true, kAtomicRelease);
+		});
+		HARNESS_CHECK(WaitUntil(2000, [&]{ return bEarlyFired.Load(kAtomicAcquire); }));
+		HARNESS_CHECK(vWheel.GetPendingCount() == 1);
+		// 析构函数停止到期线程，并丢弃未到期的定时器。
+	}
+	HARNESS_CHECK(!bLateFired.Load(kAtomicAcquire));
+}
+
+HARNESS_BENCH(TimerWheelVersusBinaryHeap){
+	// 吞吐量的单位是纳秒每次操作；抖动是回调函数被调用的时刻晚于截止时间的毫秒数，包括快速时钟本身的精度。
+	static constexpr std::size_t kCounts[] = { 10000, 100000, 1000000 };
+	std::printf("  timers  | schedule: wheel / heap | cancel: wheel / heap | fire: wheel / heap\n");
+	for(const auto uCount : kCounts){
+		TimerWheel vWheel;
+		Vector<IntrusivePtr<TimerWheel::Timer>> vecWheelTimers;
+		const auto vWheelResult = MeasureThroughput(vWheel, vecWheelTimers, uCount);
+		LegacyTimerQueue vHeap;
+		Vector<IntrusivePtr<LegacyTimerQueue::Timer>> vecHeapTimers;
+		const auto vHeapResult = MeasureThroughput(vHeap, vecHeapTimers, uCount);
+		std::printf("  %7zu | %9.2f / %8.2f | %9.2f / %6.2f | %8.2f / %6.2f\n", uCount,
+			vWheelResult.dSchedule, vHeapResult.dSchedule, vWheelResult.dCancel, vHeapResult.dCancel, vWheelResult.dFire, vHeapResult.dFire);
+		std::fflush(stdout);
+	}
+
+	constexpr unsigned kJitterTimers = 500;
+	{
+		Lateness vLateness = { };
+		TimerWheel vWheel(true);
+		ScheduleForJitter(vWheel, vLateness, kJitterTimers);
+		HARNESS_CHECK(WaitUntil(5000, [&]{ return vLateness.uFired.Load(kAtomicAcquire) == kJitterTimers; }));
+		std::printf("  lateness, wheel with its expiry thread : mean %6.3f ms, max %6.3f ms\n", vLateness.dSum / kJitterTimers, vLateness.dMax);
+	}
+	{
+		// 二叉堆由一个线程推动，每次休眠到堆顶的截止时间。
+		Lateness vLateness = { };
+		LegacyTimerQueue vHeap;
+		ScheduleForJitter(vHeap, vLateness, kJitterTimers);
+		const auto fnPump = [&]{
+			while(vLateness.uFired.Load(kAtomicAcquire) != kJitterTimers){
+				vHeap.Pump(GetFastMonoClock());
+				Sleep(vHeap.GetNextWakeTime());
+			}
+		};
+		MakeThread(fnPump)->Wait();
+		std::printf("  lateness, heap pumped by a thread      : mean %6.3f ms, max %6.3f ms\n", vLateness.dSum / kJitterTimers, vLateness.dMax);
+	}
+}
@@ -0,0 +1,465 @@
+#include "Harness.hpp"
+#include <MCFCRT/ext/utf_bulk.h>
+#include <cstring>
+#include <type_traits>
+
+using namespace MCF;
+
+// 把 utf_bulk.h 中一次处理整个缓冲区的函数与循环调用 utf.h 中逐码点的函数的结果对比，包括返回值、读写指针的位置和输出的内容。
+// 输入覆盖 ASCII、拉丁字母、CJK、emoji 和它们的混合，以检测成块转换的入口和出口；另外还有各种错误的输入和太小的输出缓冲区。
+// 输入和输出都紧贴着不可访问页，越界读写会立即崩溃。
+
+namespace {
+
+constexpr std::size_t kBufferSize = 0x10000;
+
+template<typename ReadT>
+using DecodeProc = char32_t (*)(const ReadT **, const ReadT *, bool);
+template<typename WriteT>
+using EncodeProc = char32_t (*)(WriteT **, WriteT *, char32_t, bool);
+template<typename WriteT, typename ReadT>
+using ConvertProc = char32_t (*)(WriteT **, WriteT *, const ReadT **, const ReadT *, bool);
+template<typename ReadT>
+using MeasureProc = char32_t (*)(std::size_t *, const ReadT **, const ReadT *, bool);
+
+class Random {
+private:
+	std::uint32_t x_u32State = 0x12345678;
+
+public:
+	std::uint32_t Get(std::uint32_t u32Bound) noexcept {
+		x_u32State ^= x_u32State << 13;
+		x_u32State ^= x_u32State >> 17;
+		x_u32State ^= x_u32State << 5;
+		return static_cast<std::uint32_t>((static_cast<std::uint64_t>(x_u32State) * u32Bound) >> 32);
+	}
+	std::uint32_t GetInRange(std::uint32_t u32Min, std::uint32_t u32Max) noexcept {
+		return u32Min + Get(u32Max - u32Min + 1);
+	}
+};
+
+Random g_vRandom;
+
+enum class Corpus : unsigned {
+	kAscii,  // U+0000 - U+007F，包括空字符。
+	kLatin,  // U+0080 - U+07FF，在 UTF-8 中占两个字节。
+	kCjk,    // U+0800 - U+FFFF 中的非代理字符，大部分是 CJK 统一表意文字，在 UTF-8 中占三个字节。
+	kEmoji,  // U+10000 - U+10FFFF，大部分是 emoji，在 UTF-16 中占两个字符。
+	kMixed,  // 以上四种字符的随机长度的片段交替出现。
+};
+
+constexpr Corpus kCorpora[] = { Corpus::kAscii, Corpus::kLatin, Corpus::kCjk, Corpus::kEmoji, Corpus::kMixed };
+
+char32_t GetCodePoint(Corpus eCorpus) noexcept {
+	switch(eCorpus){
+	case Corpus::kAscii:
+		return g_vRandom.GetInRange(0x00, 0x7F);
+	case Corpus::kLatin:
+		return g_vRandom.GetInRange(0x80, 0x7FF);
+	case Corpus::kCjk:
+		if(g_vRandom.Get(4) != 0){
+			return g_vRandom.GetInRange(0x4E00, 0x9FFF);
+		}
+		for(;;){
+			const auto c32CodePoint = g_vRandom.GetInRange(0x800, 0xFFFF);
+			if(c32CodePoint - 0xD800u >= 0x800){
+				return c32CodePoint;
+			}
+		}
+	case Corpus::kEmoji:
+		if(g_vRandom.Get(4) != 0){
+			return g_vRandom.GetInRange(0x1F300, 0x1FAFF);
+		}
+		return g_vRandom.GetInRange(0x10000, 0x10FFFF);
+	default:
+		return GetCodePoint(static_cast<Corpus>(g_vRandom.Get(4)));
+	}
+}
+
+Vector<char32_t> MakeCodePoints(Corpus eCorpus, std::size_t uCount){
+	Vector<char32_t> vecCodePoints;
+	while(vecCodePoints.GetSize() < uCount){
+		// 混合的文本中每个片段的长度在 1 到 100 之间，超过一个 SIMD 块。
+		const auto eRun = (eCorpus == Corpus::kMixed) ? static_cast<Corpus>(g_vRandom.Get(4)) : eCorpus;
+		const std::size_t uRun = (eCorpus == Corpus::kMixed) ? g_vRandom.GetInRange(1, 100) : uCount;
+		for(std::size_t uIndex = 0; (uIndex < uRun) && (vecCodePoints.GetSize() < uCount); ++uIndex){
+			vecCodePoints.Push(GetCodePoint(eRun));
+		}
+	}
+	return vecCodePoints;
+}
+
+template<typename WriteT>
+Vector<WriteT> EncodeAll(const Vector<char32_t> &vecCodePoints, EncodeProc<WriteT> pfnEncode){
+	Vector<WriteT> vecOutput;
+	for(const auto c32CodePoint : vecCodePoints){
+		WriteT aBuffer[8];
+		auto pWrite = aBuffer;
+		HARNESS_CHECK(_MCFCRT_UTF_SUCCESS((*pfnEncode)(&pWrite, aBuffer + 8, c32CodePoint, false)));
+		vecOutput.Append(aBuffer, pWrite);
+	}
+	return vecOutput;
+}
+
+// 同 utf_bulk.c 中的 CONVERT_，但是只调用逐码点的函数。
+template<typename WriteT, typename ReadT>
+char32_t ReferenceConvert(WriteT **ppWrite, WriteT *pWriteEnd, const ReadT **ppRead, const ReadT *pReadEnd, bool bPermissive, DecodeProc<ReadT> pfnDecode, EncodeProc<WriteT> pfnEncode){
+	char32_t c32Result;
+	for(;;){
+		auto pReadNext = *ppRead;
+		c32Result = (*pfnDecode)(&pReadNext, pReadEnd, bPermissive);
+		if(!_MCFCRT_UTF_SUCCESS(c32Result)){
+			break;
+		}
+		c32Result = (*pfnEncode)(ppWrite, pWriteEnd, c32Result, true);
+		if(!_MCFCRT_UTF_SUCCESS(c32Result)){
+			break;
+		}
+		*ppRead = pReadNext;
+	}
+	return c32Result;
+}
+
+std::size_t GetUtf16Length(char32_t c32CodePoint) noexcept {
+	return 1u + (c32CodePoint >= 0x10000);
+}
+std::size_t GetUtf32Length(char32_t) noexcept {
+	return 1;
+}
+std::size_t GetUtf8Length(char32_t c32CodePoint) noexcept {
+	return 1u + (c32CodePoint >= 0x80) + (c32CodePoint >= 0x800) + (c32CodePoint >= 0x10000);
+}
+
+template<typename ReadT>
+char32_t ReferenceMeasure(std::size_t *puSize, const ReadT **ppRead, const ReadT *pReadEnd, bool bPermissive, DecodeProc<ReadT> pfnDecode, std::size_t (*pfnGetLength)(char32_t)){
+	std::size_t uSize = 0;
+	char32_t c32Result;
+	for(;;){
+		c32Result = (*pfnDecode)(ppRead, pReadEnd, bPermissive);
+		if(!_MCFCRT_UTF_SUCCESS(c32Result)){
+			break;
+		}
+		uSize += (*pfnGetLength)(c32Result);
+	}
+	*puSize = uSize;
+	return c32Result;
+}
+
+// 输入和两个输出分别紧贴着不可访问页。
+struct Buffers {
+	Harness::GuardedPages vInput;
+	Harness::GuardedPages vOutput;
+	Harness::GuardedPages vExpected;
+
+	Buffers()
+		: vInput(kBufferSize), vOutput(kBufferSize), vExpected(kBufferSize)
+	{
+	}
+};
+
+template<typename ReadT>
+const ReadT *PlaceInput(const Buffers &vBuffers, const Vector<ReadT> &vecInput){
+	const auto pInput = reinterpret_cast<ReadT *>(vBuffers.vInput.GetEnd()) - vecInput.GetSize();
+	std::memcpy(pInput, vecInput.GetData(), vecInput.GetSize() * sizeof(ReadT));
+	return pInput;
+}
+
+void Report(const char *pszFunction, const char *pszInput, std::size_t uLength, bool bPermissive, std::size_t uCapacity){
+	std::printf("  %s: input = %s, length = %zu, permissive = %d, capacity = %zu\n", pszFunction, pszInput, uLength, bPermissive, uCapacity);
+	Harness::Fail(__FILE__, __LINE__, "成块处理的结果与逐码点处理的结果不同");
+}
+
+// 输出缓冲区能容纳 uCapacity 个字符时，比较两种实现的返回值、读写指针和输出的内容。返回输出的字符数。
+template<typename WriteT, typename ReadT>
+std::size_t CheckConversionWithCapacity(const char *pszFunction, ConvertProc<WriteT, ReadT> pfnConvert, DecodeProc<ReadT> pfnDecode, EncodeProc<WriteT> pfnEncode,
+	const Buffers &vBuffers, const ReadT *pInput, std::size_t uLength, const char *pszInput, bool bPermissive, std::size_t uCapacity)
+{
+	const auto pOutputEnd = reinterpret_cast<WriteT *>(vBuffers.vOutput.GetEnd());
+	const auto pExpectedEnd = reinterpret_cast<WriteT *>(vBuffers.vExpected.GetEnd());
+	auto pWrite = pOutputEnd - uCapacity;
+	auto pRead = pInput;
+	const auto c32Result = (*pfnConvert)(&pWrite, pOutputEnd, &pRead, pInput + uLength, bPermissive);
+	auto pExpectedWrite = pExpectedEnd - uCapacity;
+	auto pExpectedRead = pInput;
+	const auto c32Expected = ReferenceConvert(&pExpectedWrite, pExpectedEnd, &pExpectedRead, pInput + uLength, bPermissive, pfnDecode, pfnEncode);
+	const auto uWritten = static_cast<std::size_t>(pWrite - (pOutputEnd - uCapacity));
+	const auto uExpectedWritten = static_cast<std::size_t>(pExpectedWrite - (pExpectedEnd - uCapacity));
+	if((c32Result != c32Expected) || (pRead != pExpectedRead) || (uWritten != uExpectedWritten) ||
+		(std::memcmp(pOutputEnd - uCapacity, pExpectedEnd - uCapacity, uWritten * sizeof(WriteT)) != 0))
+	{
+		Report(pszFunction, pszInput, uLength, bPermissive, uCapacity);
+	}
+	return uWritten;
+}
+
+// 先使用足够大的输出缓冲区，然后测试恰好够用、少一个字符和更小的输出缓冲区。
+template<typename WriteT, typename ReadT>
+void CheckConversion(const char *pszFunction, ConvertProc<WriteT, ReadT> pfnConvert, DecodeProc<ReadT> pfnDecode, EncodeProc<WriteT> pfnEncode,
+	const Buffers &vBuffers, const Vector<ReadT> &vecInput, const char *pszInput)
+{
+	const auto pInput = PlaceInput(vBuffers, vecInput);
+	const auto uLength = vecInput.GetSize();
+	for(const bool bPermissive : { false, true }){
+		const auto uRequired = CheckConversionWithCapacity(pszFunction, pfnConvert, pfnDecode, pfnEncode, vBuffers, pInput, uLength, pszInput, bPermissive, kBufferSize / sizeof(WriteT));
+		const std::size_t auCapacities[] = { uRequired, uRequired - 1, uRequired / 2, uRequired / 3 + 1, 1, 0 };
+		for(const auto uCapacity : auCapacities){
+			if(uCapacity <= uRequired){
+				CheckConversionWithCapacity(pszFunction, pfnConvert, pfnDecode, pfnEncode, vBuffers, pInput, uLength, pszInput, bPermissive, uCapacity);
+			}
+		}
+	}
+}
+
+template<typename ReadT>
+void CheckMeasure(const char *pszFunction, MeasureProc<ReadT> pfnMeasure, DecodeProc<ReadT> pfnDecode, std::size_t (*pfnGetLength)(char32_t),
+	const Buffers &vBuffers, const Vector<ReadT> &vecInput, const char *pszInput)
+{
+	const auto pInput = PlaceInput(vBuffers, vecInput);
+	const auto uLength = vecInput.GetSize();
+	for(const bool bPermissive : { false, true }){
+		std::size_t uSize = 12345, uExpectedSize = 54321;
+		auto pRead = pInput, pExpectedRead = pInput;
+		const auto c32Result = (*pfnMeasure)(&uSize, &pRead, pInput + uLength, bPermissive);
+		const auto c32Expected = ReferenceMeasure(&uExpectedSize, &pExpectedRead, pInput + uLength, bPermissive, pfnDecode, pfnGetLength);
+		if((c32Result != c32Expected) || (pRead != pExpectedRead) || (uSize != uExpectedSize)){
+			Report(pszFunction, pszInput, uLength, bPermissive, 0);
+		}
+	}
+}
+
+void CheckValidate(const Buffers &vBuffers, const Vector<char> &vecInput, const char *pszInput){
+	const auto pInput = PlaceInput(vBuffers, vecInput);
+	const auto uLength = vecInput.GetSize();
+	auto pRead = pInput, pExpectedRead = pInput;
+	const auto c32Result = ::_MCFCRT_ValidateUtf8(&pRead, pInput + uLength);
+	char32_t c32Expected;
+	do {
+		c32Expected = ::_MCFCRT_DecodeUtf8(&pExpectedRead, pInput + uLength, false);
+	} while(_MCFCRT_UTF_SUCCESS(c32Expected));
+	if((c32Result != c32Expected) || (pRead != pExpectedRead)){
+		Report("_MCFCRT_ValidateUtf8", pszInput, uLength, false, 0);
+	}
+}
+
+// 对同一段 UTF-8 或者 CESU-8 输入调用所有读取它的函数。
+void CheckAllFromUtf8(const Buffers &vBuffers, const Vector<char> &vecUtf8, const char *pszInput){
+	CheckValidate(vBuffers, vecUtf8, pszInput);
+	CheckMeasure("_MCFCRT_MeasureUtf8AsUtf16", &::_MCFCRT_MeasureUtf8AsUtf16, &::_MCFCRT_DecodeUtf8, &GetUtf16Length, vBuffers, vecUtf8, pszInput);
+	CheckMeasure("_MCFCRT_MeasureUtf8AsUtf32", &::_MCFCRT_MeasureUtf8AsUtf32, &::_MCFCRT_DecodeUtf8, &GetUtf32Length, vBuffers, vecUtf8, pszInput);
+	CheckConversion("_MCFCRT_ConvertUtf8ToUtf16", &::_MCFCRT_ConvertUtf8ToUtf16, &::_MCFCRT_DecodeUtf8, &::_MCFCRT_EncodeUtf16, vBuffers, vecUtf8, pszInput);
+	CheckConversion("_MCFCRT_ConvertUtf8ToUtf32", &::_MCFCRT_ConvertUtf8ToUtf32, &::_MCFCRT_DecodeUtf8, &::_MCFCRT_EncodeUtf32, vBuffers, vecUtf8, pszInput);
+}
+void CheckAllFromCesu8(const Buffers &vBuffers, const Vector<char> &vecCesu8, const char *pszInput){
+	CheckConversion("_MCFCRT_ConvertCesu8ToUtf16", &::_MCFCRT_ConvertCesu8ToUtf16, &::_MCFCRT_DecodeCesu8, &::_MCFCRT_EncodeUtf16, vBuffers, vecCesu8, pszInput);
+	CheckConversion("_MCFCRT_ConvertCesu8ToUtf32", &::_MCFCRT_ConvertCesu8ToUtf32, &::_MCFCRT_DecodeCesu8, &::_MCFCRT_EncodeUtf32, vBuffers, vecCesu8, pszInput);
+}
+void CheckAllFromUtf16(const Buffers &vBuffers, const Vector<char16_t> &vecUtf16, const char *pszInput){
+	CheckMeasure("_MCFCRT_MeasureUtf16AsUtf8", &::_MCFCRT_MeasureUtf16AsUtf8, &::_MCFCRT_DecodeUtf16, &GetUtf8Length, vBuffers, vecUtf16, pszInput);
+	CheckConversion("_MCFCRT_ConvertUtf16ToUtf8", &::_MCFCRT_ConvertUtf16ToUtf8, &::_MCFCRT_DecodeUtf16, &::_MCFCRT_EncodeUtf8, vBuffers, vecUtf16, pszInput);
+	CheckConversion("_MCFCRT_ConvertUtf16ToUtf32", &::_MCFCRT_ConvertUtf16ToUtf32, &::_MCFCRT_DecodeUtf16, &::_MCFCRT_EncodeUtf32, vBuffers, vecUtf16, pszInput);
+	CheckConversion("_MCFCRT_ConvertUtf16ToCesu8", &::_MCFCRT_ConvertUtf16ToCesu8, &::_MCFCRT_DecodeUtf16, &::_MCFCRT_EncodeCesu8, vBuffers, vecUtf16, pszInput);
+}
+void CheckAllFromUtf32(const Buffers &vBuffers, const Vector<char32_t> &vecUtf32, const char *pszInput){
+	CheckConversion("_MCFCRT_ConvertUtf32ToUtf8", &::_MCFCRT_ConvertUtf32ToUtf8, &::_MCFCRT_DecodeUtf32, &::_MCFCRT_EncodeUtf8, vBuffers, vecUtf32, pszInput);
+	CheckConversion("_MCFCRT_ConvertUtf32ToUtf16", &::_MCFCRT_ConvertUtf32ToUtf16, &::_MCFCRT_DecodeUtf32, &::_MCFCRT_EncodeUtf16, vBuffers, vecUtf32, pszInput);
+	CheckConversion("_MCFCRT_ConvertUtf32ToCesu8", &::_MCFCRT_ConvertUtf32ToCesu8, &::_MCFCRT_DecodeUtf32, &::_MCFCRT_EncodeCesu8, vBuffers, vecUtf32, pszInput);
+}
+
+// 把 vecSource 中从 uPosition 开始的 uErase 个字符替换为 ilInsert。
+template<typename CharT>
+Vector<CharT> Splice(const Vector<CharT> &vecSource, std::size_t uPosition, std::size_t uErase, std::initializer_list<CharT> ilInsert){
+	Vector<CharT> vecResult;
+	vecResult.Append(vecSource.GetBegin(), vecSource.GetBegin() + uPosition);
+	vecResult.Append(ilInsert);
+	vecResult.Append(vecSource.GetBegin() + uPosition + uErase, vecSource.GetEnd());
+	return vecResult;
+}
+
+const char *GetCorpusName(Corpus eCorpus) noexcept {
+	static constexpr const char *kNames[] = { "ASCII", "Latin", "CJK", "emoji", "mixed" };
+	return kNames[static_cast<unsigned>(eCorpus)];
+}
+
+}
+
+HARNESS_TEST(UtfBulkMatchesPerCodePointFunctions){
+	const Buffers vBuffers;
+	static constexpr std::size_t kLongCounts[] = { 255, 256, 257, 1000, 2500 };
+	const auto fnCheck = [&](Corpus eCorpus, std::size_t uCount){
+		const auto vecCodePoints = MakeCodePoints(eCorpus, uCount);
+		const auto vecUtf8 = EncodeAll(vecCodePoints, &::_MCFCRT_EncodeUtf8);
+		const auto vecCesu8 = EncodeAll(vecCodePoints, &::_MCFCRT_EncodeCesu8);
+		const auto vecUtf16 = EncodeAll(vecCodePoints, &::_MCFCRT_EncodeUtf16);
+		const auto pszName = GetCorpusName(eCorpus);
+		CheckAllFromUtf8(vBuffers, vecUtf8, pszName);
+		CheckAllFromCesu8(vBuffers, vecCesu8, pszName);
+		CheckAllFromUtf16(vBuffers, vecUtf16, pszName);
+		CheckAllFromUtf32(vBuffers, vecCodePoints, pszName);
+	};
+	for(const auto eCorpus : kCorpora){
+		for(std::size_t uCount = 0; uCount <= 130; ++uCount){
+			fnCheck(eCorpus, uCount);
+		}
+		for(const auto uCount : kLongCounts){
+			fnCheck(eCorpus, uCount);
+		}
+	}
+}
+
+HARNESS_TEST(UtfBulkRoundTrips){
+	// 所有编码之间转换之后再转换回来，结果应该与原来的相同。
+	const Buffers vBuffers;
+	for(const auto eCorpus : kCorpora){
+		const auto vecCodePoints = MakeCodePoints(eCorpus, 2500);
+		const auto vecUtf8 = EncodeAll(vecCodePoints, &::_MCFCRT_EncodeUtf8);
+		const auto vecCesu8 = EncodeAll(vecCodePoints, &::_MCFCRT_EncodeCesu8);
+		const auto vecUtf16 = EncodeAll(vecCodePoints, &::_MCFCRT_EncodeUtf16);
+		const auto fnConvert = [&](auto pfnConvert, const auto &vecInput, const auto &vecExpected){
+			using WriteT = std::remove_const_t<std::remove_pointer_t<decltype(vecExpected.GetData())>>;
+			Vector<WriteT> vecOutput;
+			vecOutput.Resize(vecExpected.GetSize() + 16);
+			auto pWrite = vecOutput.GetData();
+			auto pRead = vecInput.GetData();
+			HARNESS_CHECK((*pfnConvert)(&pWrite, vecOutput.GetEnd(), &pRead, vecInput.GetEnd(), false) == _MCFCRT_UTF_NO_DATA);
+			HARNESS_CHECK(pRead == vecInput.GetEnd());
+			HARNESS_CHECK(static_cast<std::size_t>(pWrite - vecOutput.GetData()) == vecExpected.GetSize());
+			HARNESS_CHECK(std::memcmp(vecOutput.GetData(), vecExpected.GetData(), vecExpected.GetSize() * sizeof(WriteT)) == 0);
+		};
+		fnConvert(&::_MCFCRT_ConvertUtf8ToUtf16, vecUtf8, vecUtf16);
+		fnConvert(&::_MCFCRT_ConvertUtf16ToUtf8, vecUtf16, vecUtf8);
+		fnConvert(&::_MCFCRT_ConvertUtf8ToUtf32, vecUtf8, vecCodePoints);
+		fnConvert(&::_MCFCRT_ConvertUtf32ToUtf8, vecCodePoints, vecUtf8);
+		fnConvert(&::_MCFCRT_ConvertUtf16ToUtf32, vecUtf16, vecCodePoints);
+		fnConvert(&::_MCFCRT_ConvertUtf32ToUtf16, vecCodePoints, vecUtf16);
+		fnConvert(&::_MCFCRT_ConvertCesu8ToUtf16, vecCesu8, vecUtf16);
+		fnConvert(&::_MCFCRT_ConvertUtf16ToCesu8, vecUtf16, vecCesu8);
+		fnConvert(&::_MCFCRT_ConvertCesu8ToUtf32, vecCesu8, vecCodePoints);
+		fnConvert(&::_MCFCRT_ConvertUtf32ToCesu8, vecCodePoints, vecCesu8);
+
+		std::size_t uSize;
+		auto pRead8 = vecUtf8.GetData();
+		HARNESS_CHECK(::_MCFCRT_MeasureUtf8AsUtf16(&uSize, &pRead8, vecUtf8.GetEnd(), false) == _MCFCRT_UTF_NO_DATA);
+		HARNESS_CHECK(uSize == vecUtf16.GetSize());
+		pRead8 = vecUtf8.GetData();
+		HARNESS_CHECK(::_MCFCRT_MeasureUtf8AsUtf32(&uSize, &pRead8, vecUtf8.GetEnd(), false) == _MCFCRT_UTF_NO_DATA);
+		HARNESS_CHECK(uSize == vecCodePoints.GetSize());
+		auto pRead16 = vecUtf16.GetData();
+		HARNESS_CHECK(::_MCFCRT_MeasureUtf16AsUtf8(&uSize, &pRead16, vecUtf16.GetEnd(), false) == _MCFCRT_UTF_NO_DATA);
+		HARNESS_CHECK(uSize == vecUtf8.GetSize());
+	}
+}
+
+HARNESS_TEST(UtfBulkStopsAtInvalidInput){
+	// 在混合的文本中的不同位置插入错误的序列，严格模式下应该停在错误之前，宽松模式下应该以 U+FFFD 替换。
+	const Buffers vBuffers;
+	const auto vecCodePoints = MakeCodePoints(Corpus::kMixed, 300);
+	const auto vecUtf8 = EncodeAll(vecCodePoints, &::_MCFCRT_EncodeUtf8);
+	const auto vecCesu8 = EncodeAll(vecCodePoints, &::_MCFCRT_EncodeCesu8);
+	const auto vecUtf16 = EncodeAll(vecCodePoints, &::_MCFCRT_EncodeUtf16);
+	// 孤立的后续字节、不可能出现的字节、过长的编码、UTF-8 中的代理字符、超出范围的码点、缺少后续字节的首字节。
+	const std::initializer_list<char> kBadUtf8[] = {
+		{ '\x80' }, { '\xBF' }, { '\xFF' }, { '\xC0', '\x80' }, { '\xE0', '\x80', '\x80' }, { '\xED', '\xA0', '\x80' },
+		{ '\xF4', '\x90', '\x80', '\x80' }, { '\xE4', 'a' }, { '\xF0', '\x9F', 'a' },
+	};
+	// 孤立的高代理和低代理，以及顺序相反的代理对。
+	const std::initializer_list<char16_t> kBadUtf16[] = { { 0xD800 }, { 0xDFFF }, { 0xDC00, 0xD800 }, { 0xDBFF, 0x0041 } };
+	const std::initializer_list<char32_t> kBadUtf32[] = { { 0xD800 }, { 0xDFFF }, { 0x110000 }, { 0xFFFFFFFF } };
+	static constexpr std::size_t kPositions[] = { 0, 1, 15, 16, 17, 63, 64, 65, 200 };
+	for(const auto uCodePoint : kPositions){
+		// 把错误的序列插入在码点的边界上。
+		std::size_t uOffset8 = 0, uOffset16 = 0;
+		for(std::size_t uIndex = 0; uIndex < uCodePoint; ++uIndex){
+			uOffset8 += GetUtf8Length(vecCodePoints[uIndex]);
+			uOffset16 += GetUtf16Length(vecCodePoints[uIndex]);
+		}
+		for(const auto &ilBad : kBadUtf8){
+			CheckAllFromUtf8(vBuffers, Splice(vecUtf8, uOffset8, 0, ilBad), "invalid UTF-8");
+		}
+		for(const auto &ilBad : kBadUtf16){
+			CheckAllFromUtf16(vBuffers, Splice(vecUtf16, uOffset16, 0, ilBad), "invalid UTF-16");
+		}
+		for(const auto &ilBad : kBadUtf32){
+			CheckAllFromUtf32(vBuffers, Splice(vecCodePoints, uCodePoint, 0, ilBad), "invalid UTF-32");
+		}
+		// CESU-8 中不允许出现 UTF-8 的四字节编码。
+		std::size_t uOffsetCesu8 = 0;
+		for(std::size_t uIndex = 0; uIndex < uCodePoint; ++uIndex){
+			uOffsetCesu8 += (vecCodePoints[uIndex] >= 0x10000) ? 6 : GetUtf8Length(vecCodePoints[uIndex]);
+		}
+		CheckAllFromCesu8(vBuffers, Splice(vecCesu8, uOffsetCesu8, 0, { '\xF0', '\x9F', '\x98', '\x80' }), "invalid CESU-8");
+	}
+	// 截断最后一个码点。
+	for(const auto c32Last : { char32_t(0x41), char32_t(0xE9), char32_t(0x4E2D), char32_t(0x1F600) }){
+		auto vecTruncated = vecCodePoints;
+		vecTruncated.Push(c32Last);
+		const auto vecTruncatedUtf8 = EncodeAll(vecTruncated, &::_MCFCRT_EncodeUtf8);
+		const auto vecTruncatedCesu8 = EncodeAll(vecTruncated, &::_MCFCRT_EncodeCesu8);
+		const auto vecTruncatedUtf16 = EncodeAll(vecTruncated, &::_MCFCRT_EncodeUtf16);
+		for(std::size_t uDrop = 1; uDrop < GetUtf8Length(c32Last); ++uDrop){
+			CheckAllFromUtf8(vBuffers, Splice(vecTruncatedUtf8, vecTruncatedUtf8.GetSize() - uDrop, uDrop, { }), "truncated UTF-8");
+		}
+		for(std::size_t uDrop = 1; uDrop < ((c32Last >= 0x10000) ? 6 : GetUtf8Length(c32Last)); ++uDrop){
+			CheckAllFromCesu8(vBuffers, Splice(vecTruncatedCesu8, vecTruncatedCesu8.GetSize() - uDrop, uDrop, { }), "truncated CESU-8");
+		}
+		if(c32Last >= 0x10000){
+			CheckAllFromUtf16(vBuffers, Splice(vecTruncatedUtf16, vecTruncatedUtf16.GetSize() - 1, 1, { }), "truncated UTF-16");
+		}
+	}
+}
+
+HARNESS_BENCH(UtfBulkThroughput){
+	// 单位是 UTF-8 输入或者输出的字节每纳秒。“per code point”一栏循环调用 utf.h 中逐码点的函数。
+	// 拉丁文本中 80% 是 ASCII，CJK 文本中 10% 是 ASCII 标点和空格，emoji 文本中 70% 是 ASCII。
+	constexpr std::size_t kCodePoints = 0x40000;
+	static constexpr unsigned kAsciiPercents[] = { 100, 80, 10, 70 };
+	static constexpr Corpus kOthers[] = { Corpus::kAscii, Corpus::kLatin, Corpus::kCjk, Corpus::kEmoji };
+	std::printf("  corpus | validate | per code point | UTF-8 to UTF-16 | per code point | UTF-16 to UTF-8 | per code point\n");
+	for(unsigned uCorpus = 0; uCorpus < 4; ++uCorpus){
+		Vector<char32_t> vecCodePoints;
+		for(std::size_t uIndex = 0; uIndex < kCodePoints; ++uIndex){
+			vecCodePoints.Push((g_vRandom.Get(100) < kAsciiPercents[uCorpus]) ? g_vRandom.GetInRange(0x20, 0x7E) : GetCodePoint(kOthers[uCorpus]));
+		}
+		const auto vecUtf8 = EncodeAll(vecCodePoints, &::_MCFCRT_EncodeUtf8);
+		const auto vecUtf16 = EncodeAll(vecCodePoints, &::_MCFCRT_EncodeUtf16);
+		Vector<char> vecOutput8;
+		vecOutput8.Resize(vecUtf8.GetSize());
+		Vector<char16_t> vecOutput16;
+		vecOutput16.Resize(vecUtf16.GetSize());
+
+		const auto u64Iterations = std::uint64_t(200000000) / vecUtf8.GetSize() + 1;
+		const auto dSize = static_cast<double>(vecUtf8.GetSize());
+		const auto dValidate = dSize / Harness::Measure(u64Iterations, [&]{
+			auto pRead = vecUtf8.GetData();
+			Harness::DoNotOptimize(::_MCFCRT_ValidateUtf8(&pRead, vecUtf8.GetEnd()));
+		});
+		const auto dValidateScalar = dSize / Harness::Measure(u64Iterations, [&]{
+			auto pRead = vecUtf8.GetData();
+			while(_MCFCRT_UTF_SUCCESS(::_MCFCRT_DecodeUtf8(&pRead, vecUtf8.GetEnd(), false))){
+			}
+			Harness::DoNotOptimize(pRead);
+		});
+		const auto d8To16 = dSize / Harness::Measure(u64Iterations, [&]{
+			auto pWrite = vecOutput16.GetData();
+			auto pRead = vecUtf8.GetData();
+			Harness::DoNotOptimize(::_MCFCRT_ConvertUtf8ToUtf16(&pWrite, vecOutput16.GetEnd(), &pRead, vecUtf8.GetEnd(), false));
+		});
+		const auto d8To16Scalar = dSize / Harness::Measure(u64Iterations, [&]{
+			auto pWrite = vecOutput16.GetData();
+			auto pRead = vecUtf8.GetData();
+			Harness::DoNotOptimize(ReferenceConvert(&pWrite, vecOutput16.GetEnd(), &pRead, vecUtf8.GetEnd(), false, &::_MCFCRT_DecodeUtf8, &::_MCFCRT_EncodeUtf16));
+		});
+		const auto d16To8 = dSize / Harness::Measure(u64Iterations, [&]{
+			auto pWrite = vecOutput8.GetData();
+			auto pRead = vecUtf16.GetData();
+			Harness::DoNotOptimize(::_MCFCRT_ConvertUtf16ToUtf8(&pWrite, vecOutput8.GetEnd(), &pRead, vecUtf16.GetEnd(), false));
+		});
+		const auto d16To8Scalar = dSize / Harness::Measure(u64Iterations, [&]{
+			auto pWrite = vecOutput8.GetData();
+			auto pRead = vecUtf16.GetData();
+			Harness::DoNotOptimize(ReferenceConvert(&pWrite, vecOutput8.GetEnd(), &pRead, vecUtf16.GetEnd(), false, &::_MCFCRT_DecodeUtf16, &::_MCFCRT_EncodeUtf8));
+		});
+		std::printf("  %-6s | %8.2f | %14.2f | %15.2f | %14.2f | %15.2f | %14.2f\n",
+			GetCorpusName(kOthers[uCorpus]), dValidate, dValidateScalar, d8To16, d8To16Scalar, d16To8, d16To8Scalar);
+		std::fflush(stdout);
+	}
+}
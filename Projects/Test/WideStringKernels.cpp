@@ -0,0 +1,288 @@
+#include "Harness.hpp"
+#include <MCFCRT/env/_cpu_features.h>
+#include <MCFCRT/ext/rawwmemchr.h>
+#include <cstring>
+#include <cwchar>
+
+using namespace MCF;
+
+// 把 wmemchr()、_MCFCRT_rawwmemchr()、wcslen()、wcschr()、wcscmp() 和 wcsncmp() 与逐字符的实现对比。
+// 长度、偏移和位置的单位都是字符。SSE2 实现每次处理 32 个字符，AVX2 实现每次处理 64 个字符，所以偏移覆盖一整个 AVX2 块。
+// 随机字符有一半和要找的字符有一个字节相同，以检测按字节而不是按字符比较的错误。
+
+namespace {
+
+constexpr std::size_t kAlignmentCount = 64;
+constexpr std::size_t kShortLengthMax = 300;
+constexpr std::size_t kLongLengths[] = { 255, 256, 257, 511, 512, 513, 2047, 2048, 2049, 10000 };
+constexpr std::size_t kNoMatch = SIZE_MAX;
+
+// 所有用于比较的字符，包括会被有符号比较弄错的值，以及高低字节相同或者交换的值。
+constexpr wchar_t kInterestingChars[] = { 0x0000, 0x0001, 0x0041, 0x0080, 0x00FF, 0x0100, 0x4141, 0x7FFF, 0x8000, 0xFFFE, 0xFFFF };
+
+class Random {
+private:
+	std::uint32_t x_u32State = 0x12345678;
+
+public:
+	wchar_t GetCharExcept(wchar_t wcExcluded1, wchar_t wcExcluded2) noexcept {
+		const auto u16Excluded = static_cast<std::uint16_t>(wcExcluded1);
+		for(;;){
+			x_u32State ^= x_u32State << 13;
+			x_u32State ^= x_u32State >> 17;
+			x_u32State ^= x_u32State << 5;
+			auto u16Value = static_cast<std::uint16_t>(x_u32State >> 16);
+			switch(x_u32State & 3){
+			case 0:
+				u16Value = static_cast<std::uint16_t>((u16Value & 0xFF00u) | (u16Excluded & 0x00FFu));
+				break;
+			case 1:
+				u16Value = static_cast<std::uint16_t>((u16Value & 0x00FFu) | (u16Excluded & 0xFF00u));
+				break;
+			}
+			const auto wcValue = static_cast<wchar_t>(u16Value);
+			if((wcValue != wcExcluded1) && (wcValue != wcExcluded2)){
+				return wcValue;
+			}
+		}
+	}
+};
+
+Random g_vRandom;
+
+struct Case {
+	const char *pszKernel;
+	std::size_t uLength;
+	std::size_t uOffset1;
+	std::size_t uOffset2;
+	std::size_t uPosition;
+	unsigned uValue;
+};
+
+void Expect(bool bOk, const Case &vCase){
+	if(bOk){
+		return;
+	}
+	std::printf("  %s: length = %zu, offset1 = %zu, offset2 = %zu, position = %zd, value = %#x\n",
+		vCase.pszKernel, vCase.uLength, vCase.uOffset1, vCase.uOffset2, static_cast<std::ptrdiff_t>(vCase.uPosition), vCase.uValue);
+	Harness::Fail(__FILE__, __LINE__, "SIMD 实现的结果与逐字符实现的结果不同");
+}
+
+int GetSign(int nValue) noexcept {
+	return (nValue > 0) - (nValue < 0);
+}
+
+const wchar_t *ReferenceWmemchr(const wchar_t *pwcData, wchar_t wcValue, std::size_t uSize) noexcept {
+	for(std::size_t uIndex = 0; uIndex < uSize; ++uIndex){
+		if(pwcData[uIndex] == wcValue){
+			return pwcData + uIndex;
+		}
+	}
+	return nullptr;
+}
+std::size_t ReferenceWcslen(const wchar_t *pwszData) noexcept {
+	std::size_t uIndex = 0;
+	while(pwszData[uIndex] != 0){
+		++uIndex;
+	}
+	return uIndex;
+}
+// wchar_t 是无符号的 16 位整数，逐字符比较时按无符号数比较。
+int ReferenceWcsncmp(const wchar_t *pwsz1, const wchar_t *pwsz2, std::size_t uSize) noexcept {
+	for(std::size_t uIndex = 0; uIndex < uSize; ++uIndex){
+		if(pwsz1[uIndex] != pwsz2[uIndex]){
+			return (pwsz1[uIndex] < pwsz2[uIndex]) ? -1 : 1;
+		}
+		if(pwsz1[uIndex] == 0){
+			return 0;
+		}
+	}
+	return 0;
+}
+int ReferenceWcscmp(const wchar_t *pwsz1, const wchar_t *pwsz2) noexcept {
+	return ReferenceWcsncmp(pwsz1, pwsz2, SIZE_MAX);
+}
+
+// 对每个长度调用 vProc(uLength, bExhaustive)。bExhaustive 为真时应该测试每一个位置。
+template<typename ProcT>
+void ForEachLength(ProcT &&vProc){
+	for(std::size_t uLength = 0; uLength <= kShortLengthMax; ++uLength){
+		vProc(uLength, uLength <= kShortLengthMax / 2);
+	}
+	for(const auto uLength : kLongLengths){
+		vProc(uLength, false);
+	}
+}
+// 对每个需要测试的位置调用 vProc(uPosition)，最后以 kNoMatch 调用一次。
+template<typename ProcT>
+void ForEachPosition(std::size_t uLength, bool bExhaustive, ProcT &&vProc){
+	if(bExhaustive){
+		for(std::size_t uPosition = 0; uPosition < uLength; ++uPosition){
+			vProc(uPosition);
+		}
+	} else {
+		for(std::size_t uBoundary = 0; uBoundary <= uLength; uBoundary += 16){
+			for(std::size_t uPosition = (uBoundary < 2) ? 0 : (uBoundary - 2); (uPosition < uBoundary + 2) && (uPosition < uLength); ++uPosition){
+				vProc(uPosition);
+			}
+		}
+		if(uLength != 0){
+			vProc(uLength - 1);
+		}
+	}
+	vProc(kNoMatch);
+}
+
+void FillExcept(wchar_t *pwcBegin, std::size_t uSize, wchar_t wcExcluded1, wchar_t wcExcluded2){
+	for(std::size_t uIndex = 0; uIndex < uSize; ++uIndex){
+		pwcBegin[uIndex] = g_vRandom.GetCharExcept(wcExcluded1, wcExcluded2);
+	}
+}
+void FillWith(wchar_t *pwcBegin, std::size_t uSize, wchar_t wcValue){
+	for(std::size_t uIndex = 0; uIndex < uSize; ++uIndex){
+		pwcBegin[uIndex] = wcValue;
+	}
+}
+
+wchar_t *GetBegin(const Harness::GuardedPages &vPages) noexcept {
+	return reinterpret_cast<wchar_t *>(vPages.GetBegin() + 0x1000);
+}
+wchar_t *GetEnd(const Harness::GuardedPages &vPages) noexcept {
+	return reinterpret_cast<wchar_t *>(vPages.GetEnd());
+}
+
+}
+
+HARNESS_TEST(WideStringKernelsWmemchr){
+	std::printf("  AVX2 = %s\n", (::__MCFCRT_GetCpuFeatures() & ::__MCFCRT_kCpuFeatureAvx2) ? "yes" : "no");
+	const Harness::GuardedPages vPages(0x10000);
+	for(const auto wcValue : kInterestingChars){
+		ForEachLength([&](std::size_t uLength, bool bExhaustive){
+			ForEachPosition(uLength, bExhaustive, [&](std::size_t uPosition){
+				for(std::size_t uOffset = 0; uOffset <= kAlignmentCount; ++uOffset){
+					// 最后一次放在不可访问页之前。
+					const auto pwcData = (uOffset < kAlignmentCount) ? (GetBegin(vPages) + uOffset) : (GetEnd(vPages) - uLength);
+					// 范围之外的字符都等于要找的值。
+					FillWith(pwcData - kAlignmentCount, kAlignmentCount, wcValue);
+					FillExcept(pwcData, uLength, wcValue, wcValue);
+					if(pwcData + uLength != GetEnd(vPages)){
+						FillWith(pwcData + uLength, kAlignmentCount, wcValue);
+					}
+					if(uPosition != kNoMatch){
+						pwcData[uPosition] = wcValue;
+					}
+					const Case vCase = { "wmemchr", uLength, uOffset, 0, uPosition, static_cast<unsigned>(wcValue) };
+					Expect(std::wmemchr(pwcData, wcValue, uLength) == ReferenceWmemchr(pwcData, wcValue, uLength), vCase);
+				}
+			});
+		});
+	}
+}
+
+HARNESS_TEST(WideStringKernelsRawwmemchrWcslenAndWcschr){
+	const Harness::GuardedPages vPages(0x10000);
+	for(const auto wcValue : kInterestingChars){
+		ForEachLength([&](std::size_t uLength, bool){
+			for(std::size_t uOffset = 0; uOffset <= kAlignmentCount; ++uOffset){
+				// 要找的字符在 uLength 处，之后是结尾的空字符（要找的就是空字符时只有一个）。
+				// 最后一次把结尾的空字符放在不可访问页之前的最后一个字符。
+				const std::size_t uTotal = (wcValue == 0) ? (uLength + 1) : (uLength + 2);
+				const auto pwcData = (uOffset < kAlignmentCount) ? (GetBegin(vPages) + uOffset) : (GetEnd(vPages) - uTotal);
+				FillWith(pwcData - kAlignmentCount, kAlignmentCount, wcValue);
+				FillExcept(pwcData, uLength, wcValue, 0);
+				pwcData[uLength] = wcValue;
+				pwcData[uTotal - 1] = 0;
+				const Case vCase = { "_MCFCRT_rawwmemchr", uLength, uOffset, 0, uLength, static_cast<unsigned>(wcValue) };
+				Expect(::_MCFCRT_rawwmemchr(pwcData, wcValue) == pwcData + uLength, vCase);
+				const Case vWcschrCase = { "wcschr", uLength, uOffset, 0, uLength, static_cast<unsigned>(wcValue) };
+				Expect(std::wcschr(pwcData, wcValue) == pwcData + uLength, vWcschrCase);
+				const Case vWcslenCase = { "wcslen", uTotal - 1, uOffset, 0, uTotal - 1, 0 };
+				Expect(std::wcslen(pwcData) == uTotal - 1, vWcslenCase);
+				if(wcValue != 0){
+					// 要找的字符在空字符之后，不能被找到。
+					pwcData[uLength] = 0;
+					pwcData[uTotal - 1] = wcValue;
+					const Case vMissCase = { "wcschr", uLength, uOffset, 0, kNoMatch, static_cast<unsigned>(wcValue) };
+					Expect(std::wcschr(pwcData, wcValue) == nullptr, vMissCase);
+				}
+			}
+		});
+	}
+}
+
+HARNESS_TEST(WideStringKernelsWcscmpAndWcsncmp){
+	const Harness::GuardedPages vPages1(0x10000), vPages2(0x10000);
+	static constexpr std::size_t kOffsets[] = { 0, 1, 7, 8, 15, 16, 17, 31, 32, 33, 63, kAlignmentCount };
+	// 第一种情况下其中一个字符串提前结束；最后两种情况下按字节比较会得到相反的结果。
+	static constexpr wchar_t kPairs[][2] = { { 0x0000, 0x0041 }, { 0x7FFF, 0x8000 }, { 0x0001, 0xFFFF }, { 0x00FF, 0x0100 }, { 0x4142, 0x4241 } };
+	ForEachLength([&](std::size_t uLength, bool bExhaustive){
+		ForEachPosition(uLength, bExhaustive, [&](std::size_t uPosition){
+			for(const auto uOffset1 : kOffsets){
+				for(const auto uOffset2 : kOffsets){
+					// 字符串包括结尾的空字符，紧贴不可访问页时空字符是最后一个可读的字符。
+					const auto pwc1 = (uOffset1 < kAlignmentCount) ? (GetBegin(vPages1) + uOffset1) : (GetEnd(vPages1) - uLength - 1);
+					const auto pwc2 = (uOffset2 < kAlignmentCount) ? (GetBegin(vPages2) + uOffset2) : (GetEnd(vPages2) - uLength - 1);
+					FillExcept(pwc1, uLength, 0, 0);
+					std::wmemcpy(pwc2, pwc1, uLength);
+					pwc1[uLength] = 0;
+					pwc2[uLength] = 0;
+					// 空字符之后的字符都不相等。
+					if(pwc1 + uLength + 1 != GetEnd(vPages1)){
+						FillWith(pwc1 + uLength + 1, kAlignmentCount, 0x0001);
+					}
+					if(pwc2 + uLength + 1 != GetEnd(vPages2)){
+						FillWith(pwc2 + uLength + 1, kAlignmentCount, 0xFFFE);
+					}
+					const Case vCase = { "wcscmp", uLength, uOffset1, uOffset2, uPosition, 0 };
+					// wcsncmp() 的长度在差异之前、恰好包含差异、到结尾的空字符以及远超过结尾的空字符。
+					const std::size_t uFirstDifference = (uPosition == kNoMatch) ? uLength : uPosition;
+					const std::size_t auLimits[] = { uFirstDifference, uFirstDifference + 1, uLength + 1, uLength + 1000 };
+					const auto fnCheck = [&]{
+						Expect(GetSign(std::wcscmp(pwc1, pwc2)) == ReferenceWcscmp(pwc1, pwc2), vCase);
+						for(const auto uLimit : auLimits){
+							const Case vLimitCase = { "wcsncmp", uLength, uOffset1, uOffset2, uLimit, 0 };
+							Expect(GetSign(std::wcsncmp(pwc1, pwc2, uLimit)) == ReferenceWcsncmp(pwc1, pwc2, uLimit), vLimitCase);
+						}
+					};
+					if(uPosition == kNoMatch){
+						fnCheck();
+						continue;
+					}
+					for(const auto &awcPair : kPairs){
+						for(unsigned uSwap = 0; uSwap < 2; ++uSwap){
+							pwc1[uPosition] = awcPair[uSwap];
+							pwc2[uPosition] = awcPair[1 - uSwap];
+							fnCheck();
+						}
+					}
+				}
+			}
+		});
+	});
+}
+
+HARNESS_BENCH(WideStringKernelsThroughput){
+	// 单位是字节每纳秒。“scalar”一栏是同一个操作的逐字符实现。
+	const Harness::GuardedPages vPages1(0x100000), vPages2(0x100000);
+	static constexpr std::size_t kLengths[] = { 8, 32, 128, 512, 2048, 32768, 524287 };
+	std::printf("  AVX2 = %s\n", (::__MCFCRT_GetCpuFeatures() & ::__MCFCRT_kCpuFeatureAvx2) ? "yes" : "no");
+	std::printf("   length |  wmemchr |   scalar |   wcslen |   scalar |   wcscmp |   scalar\n");
+	for(const auto uLength : kLengths){
+		const auto pwc1 = GetEnd(vPages1) - uLength - 1;
+		const auto pwc2 = GetEnd(vPages2) - uLength - 1;
+		FillExcept(pwc1, uLength, 0, 0);
+		std::wmemcpy(pwc2, pwc1, uLength);
+		pwc1[uLength] = 0;
+		pwc2[uLength] = 0;
+		const auto u64Iterations = 1000000000 / (uLength * sizeof(wchar_t) + 64);
+		const auto dSize = static_cast<double>(uLength * sizeof(wchar_t));
+		const auto dWmemchr = dSize / Harness::Measure(u64Iterations, [&]{ Harness::DoNotOptimize(std::wmemchr(pwc1, 0, uLength)); });
+		const auto dScalarWmemchr = dSize / Harness::Measure(u64Iterations, [&]{ Harness::DoNotOptimize(ReferenceWmemchr(pwc1, 0, uLength)); });
+		const auto dWcslen = dSize / Harness::Measure(u64Iterations, [&]{ Harness::DoNotOptimize(std::wcslen(pwc1)); });
+		const auto dScalarWcslen = dSize / Harness::Measure(u64Iterations, [&]{ Harness::DoNotOptimize(ReferenceWcslen(pwc1)); });
+		const auto dWcscmp = dSize / Harness::Measure(u64Iterations, [&]{ Harness::DoNotOptimize(std::wcscmp(pwc1, pwc2)); });
+		const auto dScalarWcscmp = dSize / Harness::Measure(u64Iterations, [&]{ Harness::DoNotOptimize(ReferenceWcscmp(pwc1, pwc2)); });
+		std::printf("  %7zu | %8.2f | %8.2f | %8.2f | %8.2f | %8.2f | %8.2f\n", uLength, dWmemchr, dScalarWmemchr, dWcslen, dScalarWcslen, dWcscmp, dScalarWcscmp);
+		std::fflush(stdout);
+	}
+}
@@ -9,4 +9,4 @@ LDFLAGS+=" -Og -nostdlib -L../../debug/mingw32/lib -lmcf -lstdc++ -lmcfcrt -lmin
 
 cp -fp ../../debug/mingw32/bin/*.dll ./
 
-i686-w64-mingw32-g++ ${CPPFLAGS} ${CXXFLAGS} main.cpp ${LDFLAGS}
+i686-w64-mingw32-g++ ${CPPFLAGS} ${CXXFLAGS} *.cpp ${LDFLAGS}
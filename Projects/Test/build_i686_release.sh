@@ -9,4 +9,4 @@ LDFLAGS+=" -O3 -nostdlib -L../../release/mingw32/lib -lmcf -lstdc++ -lmcfcrt -lm
 
 cp -fp ../../release/mingw32/bin/*.dll ./
 
-i686-w64-mingw32-g++ ${CPPFLAGS} ${CXXFLAGS} main.cpp ${LDFLAGS}
+i686-w64-mingw32-g++ ${CPPFLAGS} ${CXXFLAGS} *.cpp ${LDFLAGS}
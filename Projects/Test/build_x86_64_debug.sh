@@ -9,4 +9,4 @@ LDFLAGS+=" -Og -nostdlib -L../../debug/mingw64/lib -lmcf -lstdc++ -lmcfcrt -lmin
 
 cp -fp ../../debug/mingw64/bin/*.dll ./
 
-x86_64-w64-mingw32-g++ ${CPPFLAGS} ${CXXFLAGS} main.cpp ${LDFLAGS}
+x86_64-w64-mingw32-g++ ${CPPFLAGS} ${CXXFLAGS} *.cpp ${LDFLAGS}
@@ -9,4 +9,4 @@ LDFLAGS+=" -O3 -nostdlib -L../../release/mingw64/lib -lmcf -lstdc++ -lmcfcrt -lm
 
 cp -fp ../../release/mingw64/bin/*.dll ./
 
-x86_64-w64-mingw32-g++ ${CPPFLAGS} ${CXXFLAGS} main.cpp ${LDFLAGS}
+x86_64-w64-mingw32-g++ ${CPPFLAGS} ${CXXFLAGS} *.cpp ${LDFLAGS}
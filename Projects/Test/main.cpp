@@ -6,6 +6,7 @@
 #include <MCF/Core/LastError.hpp>
 #include <MCF/Core/CopyMoveFill.hpp>
 #include <MCF/Core/MinMax.hpp>
+#include "Harness.hpp"
 
 using namespace MCF;
 
@@ -22,7 +23,40 @@ using Char = char;
 
 constexpr std::size_t size = 0x100;
 
+// 跳过程序名，返回第一个参数。没有参数时返回空指针。参数中不能包含空白和引号。
+static const wchar_t *GetFirstArgument(wchar_t *pwszCommandLine) noexcept {
+	auto pwcRead = pwszCommandLine;
+	if(*pwcRead == L'\"'){
+		do {
+			++pwcRead;
+		} while((*pwcRead != 0) && (*pwcRead != L'\"'));
+		if(*pwcRead != 0){
+			++pwcRead;
+		}
+	} else {
+		while((*pwcRead != 0) && (*pwcRead != L' ') && (*pwcRead != L'\t')){
+			++pwcRead;
+		}
+	}
+	while((*pwcRead == L' ') || (*pwcRead == L'\t')){
+		++pwcRead;
+	}
+	if(*pwcRead == 0){
+		return nullptr;
+	}
+	const auto pwcBegin = pwcRead;
+	while((*pwcRead != 0) && (*pwcRead != L' ') && (*pwcRead != L'\t')){
+		++pwcRead;
+	}
+	*pwcRead = 0;
+	return pwcBegin;
+}
+
 extern "C" unsigned _MCFCRT_Main(void) noexcept {
+	// 有参数时运行其他文件中注册的用例，否则运行下面的代码。
+	if(const auto pwszFilter = GetFirstArgument(::GetCommandLineW())){
+		return Harness::RunCases(pwszFilter);
+	}
 
 	const UniquePtr<void, PageDeleter> p1(::VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
 	const UniquePtr<void, PageDeleter> p2(::VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));